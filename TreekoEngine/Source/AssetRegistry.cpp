@@ -0,0 +1,357 @@
+#include "AssetRegistry.h"
+#include "Device.h"
+#include "HashUtils.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "ModelLoader.h"
+#include <filesystem>
+
+namespace {
+  // Key of an asset: its content hash chained with the load parameters
+  uint64_t
+  assetKey(uint64_t contentHash, const void* parameters, size_t parameterSize) {
+    return hashBytes64(parameters, parameterSize, contentHash);
+  }
+
+  // File Texture::init reads for a name and type
+  std::string
+  textureFileName(const std::string& textureName, ExtensionType extensionType) {
+    switch (extensionType) {
+    case DDS:
+      return textureName + ".dds";
+    case PNG:
+      return textureName + ".png";
+    default:
+      return textureName + ".jpg";
+    }
+  }
+}
+
+AssetRegistry::AssetRegistry(Device& device, unsigned int workerCount)
+  : m_device(device),
+    m_workers(std::max(1u, workerCount)) {}
+
+AssetRegistry::~AssetRegistry() {
+  // The tracker outlives the registry, so its callbacks must not reach it
+  std::vector<MeshHandle> meshes;
+  std::vector<TextureHandle> textures;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_closing = true;
+  releaseRetained(m_meshes, meshes);
+  releaseRetained(m_textures, textures);
+}
+
+AssetRegistry::MeshHandle
+AssetRegistry::loadMesh(const std::string& fileName, const MeshOptions& options) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+  }
+  uint64_t hash = 0;
+  if (!contentHash(fileName, hash)) {
+    ERROR("AssetRegistry", "loadMesh", ("Cannot read " + fileName).c_str());
+    return nullptr;
+  }
+  const unsigned char parameters[3] = { options.optimize, options.buildMeshlets, options.buildLods };
+  return acquire(m_meshes, assetKey(hash, parameters, sizeof(parameters)), fileName, [&]() {
+    return createMesh(fileName, options);
+  });
+}
+
+std::shared_future<AssetRegistry::MeshHandle>
+AssetRegistry::requestMesh(const std::string& fileName, const MeshOptions& options) {
+  return m_workers.submit([this, fileName, options]() {
+    return loadMesh(fileName, options);
+  }).share();
+}
+
+AssetRegistry::TextureHandle
+AssetRegistry::loadTexture(const std::string& textureName, ExtensionType extensionType) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+  }
+  uint64_t hash = 0;
+  if (!contentHash(textureFileName(textureName, extensionType), hash)) {
+    ERROR("AssetRegistry", "loadTexture",
+      ("Cannot read " + textureFileName(textureName, extensionType)).c_str());
+    return nullptr;
+  }
+  const uint32_t parameters = static_cast<uint32_t>(extensionType);
+  return acquire(m_textures,
+    assetKey(hash, &parameters, sizeof(parameters)),
+    textureFileName(textureName, extensionType),
+    [&]() {
+    return createTexture(textureName, extensionType);
+  });
+}
+
+std::shared_future<AssetRegistry::TextureHandle>
+AssetRegistry::requestTexture(const std::string& textureName, ExtensionType extensionType) {
+  return m_workers.submit([this, textureName, extensionType]() {
+    return loadTexture(textureName, extensionType);
+  }).share();
+}
+
+template<typename Asset, typename Load>
+std::shared_ptr<Asset>
+AssetRegistry::acquire(std::unordered_map<uint64_t, Entry<Asset>>& entries,
+  uint64_t key,
+  const std::string& owner,
+  Load&& load) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Entry<Asset>& entry = entries[key];
+  if (std::shared_ptr<Asset> existing = entry.asset.lock()) {
+    ++m_stats.hits;
+    m_device.m_memoryTracker->touch(entry.owner);
+    return existing;
+  }
+  if (entry.pending.valid()) {
+    ++m_stats.joinedLoads;
+    std::shared_future<std::shared_ptr<Asset>> pending = entry.pending;
+    lock.unlock();
+    return pending.get();
+  }
+
+  // This thread loads; later requests for the key wait on the promise
+  std::promise<std::shared_ptr<Asset>> loaded;
+  entry.pending = loaded.get_future().share();
+  ++m_stats.loads;
+  lock.unlock();
+
+  std::shared_ptr<Asset> asset = load();
+
+  lock.lock();
+  if (asset) {
+    Entry<Asset>& done = entries[key];
+    done.asset = asset;
+    done.pending = std::shared_future<std::shared_ptr<Asset>>();
+    done.owner = owner;
+    if (m_retainUnused && !m_closing) {
+      done.retained = asset;
+      m_device.m_memoryTracker->setEvictable(owner, [this, &entries, key]() {
+        return evictUnused(entries, key);
+      });
+    }
+  }
+  else {
+    // Failures are not remembered, so a fixed file loads on the next request
+    ++m_stats.failedLoads;
+    entries.erase(key);
+  }
+  lock.unlock();
+  loaded.set_value(asset);
+  return asset;
+}
+
+template<typename Asset>
+bool
+AssetRegistry::evictUnused(std::unordered_map<uint64_t, Entry<Asset>>& entries, uint64_t key) {
+  // Destroyed after the lock is released: releasing GPU resources calls back
+  // into the tracker
+  std::shared_ptr<Asset> released;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = entries.find(key);
+  // Handles are only copied from the weak reference under the lock, so a
+  // count of one cannot grow while it is held
+  if (entry == entries.end() || !entry->second.retained || entry->second.retained.use_count() > 1) {
+    return false;
+  }
+  released = std::move(entry->second.retained);
+  return true;
+}
+
+template<typename Asset>
+void
+AssetRegistry::releaseRetained(std::unordered_map<uint64_t, Entry<Asset>>& entries,
+  std::vector<std::shared_ptr<Asset>>& outReleased) {
+  for (auto& entry : entries) {
+    if (!entry.second.owner.empty()) {
+      m_device.m_memoryTracker->clearEvictable(entry.second.owner);
+    }
+    if (entry.second.retained) {
+      outReleased.push_back(std::move(entry.second.retained));
+    }
+  }
+}
+
+AssetRegistry::MeshHandle
+AssetRegistry::createMesh(const std::string& fileName, const MeshOptions& options) {
+  GpuMemoryTracker::OwnerScope owner(fileName);
+  // Resources are released with the last handle
+  MeshHandle asset(new MeshAsset(), [](MeshAsset* released) {
+    released->vertexBuffer.destroy();
+    released->indexBuffer.destroy();
+    delete released;
+  });
+  MeshComponent& mesh = asset->mesh;
+
+  // Prefer the binary mesh cache: it is mapped and uploaded without parsing
+  // or copying. A missing or stale cache falls back to the OBJ, which
+  // rewrites the cache for the next run.
+  MeshCache meshCache;
+  const void* vertexData = nullptr;
+  const void* indexData = nullptr;
+  const bool defaultOptions = options.optimize && options.buildMeshlets && options.buildLods;
+
+  if (defaultOptions && meshCache.open(MeshCache::cachePathFor(fileName), fileName)) {
+    const MeshCache::TMeshHeader* cacheHeader = meshCache.header();
+    mesh.m_numVertex = static_cast<int>(meshCache.vertexCount());
+    mesh.m_numIndex = static_cast<int>(meshCache.indexCount());
+    mesh.m_boundsMin = XMFLOAT3(cacheHeader->boundsMin[0], cacheHeader->boundsMin[1], cacheHeader->boundsMin[2]);
+    mesh.m_boundsMax = XMFLOAT3(cacheHeader->boundsMax[0], cacheHeader->boundsMax[1], cacheHeader->boundsMax[2]);
+    vertexData = meshCache.vertexData();
+    indexData = meshCache.indexData();
+    mesh.m_meshlets.assign(meshCache.meshletData(), meshCache.meshletData() + meshCache.meshletCount());
+    mesh.m_lods.assign(meshCache.lodData(), meshCache.lodData() + meshCache.lodCount());
+    mesh.m_submeshes.assign(meshCache.submeshData(), meshCache.submeshData() + meshCache.submeshCount());
+    meshCache.readMaterials(mesh.m_materials);
+  }
+  else {
+    ModelLoader modelLoader;
+    modelLoader.setOptimizeMesh(options.optimize);
+    modelLoader.setBuildMeshlets(options.buildMeshlets);
+    modelLoader.setBuildLods(options.buildLods);
+    modelLoader.setWriteMeshCache(defaultOptions);
+    if (!modelLoader.loadModel(fileName, mesh)) {
+      ERROR("AssetRegistry", "createMesh", ("Failed to load model " + fileName).c_str());
+      return nullptr;
+    }
+    const MeshOptimizer::OptimizeStats& optimizeStats = modelLoader.getLastLoadStats().optimize;
+    MESSAGE("AssetRegistry", "createMesh", (fileName +
+      " ACMR " + std::to_string(optimizeStats.before.acmr) + " -> " + std::to_string(optimizeStats.after.acmr) +
+      ", ATVR " + std::to_string(optimizeStats.before.atvr) + " -> " + std::to_string(optimizeStats.after.atvr)).c_str());
+    vertexData = mesh.m_vertex.data();
+    indexData = mesh.m_index.data();
+  }
+
+  HRESULT hr = asset->vertexBuffer.init(m_device,
+    vertexData,
+    sizeof(SimpleVertex),
+    static_cast<unsigned int>(mesh.m_numVertex),
+    D3D11_BIND_VERTEX_BUFFER);
+  if (FAILED(hr)) {
+    ERROR("AssetRegistry", "createMesh",
+      ("Failed to initialize VertexBuffer. HRESULT: " + std::to_string(hr)).c_str());
+    return nullptr;
+  }
+
+  hr = asset->indexBuffer.init(m_device,
+    indexData,
+    sizeof(unsigned int),
+    static_cast<unsigned int>(mesh.m_numIndex),
+    D3D11_BIND_INDEX_BUFFER);
+  if (FAILED(hr)) {
+    ERROR("AssetRegistry", "createMesh",
+      ("Failed to initialize IndexBuffer. HRESULT: " + std::to_string(hr)).c_str());
+    return nullptr;
+  }
+
+  // The GPU has its own copy now
+  mesh.m_vertex = std::vector<SimpleVertex>();
+  mesh.m_index = std::vector<unsigned int>();
+  return asset;
+}
+
+AssetRegistry::TextureHandle
+AssetRegistry::createTexture(const std::string& textureName, ExtensionType extensionType) {
+  TextureHandle asset(new TextureAsset(), [](TextureAsset* released) {
+    released->texture.destroy();
+    delete released;
+  });
+  if (FAILED(asset->texture.init(m_device, textureName, extensionType))) {
+    return nullptr;
+  }
+  return asset;
+}
+
+bool
+AssetRegistry::contentHash(const std::string& fileName, uint64_t& outHash) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(fileName, error);
+  if (error) {
+    return false;
+  }
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(fileName, error);
+  if (error) {
+    return false;
+  }
+  ContentHash stamp;
+  stamp.size = static_cast<uint64_t>(size);
+  stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto known = m_contentHashes.find(fileName);
+    if (known != m_contentHashes.end() &&
+      known->second.size == stamp.size && known->second.time == stamp.time) {
+      outHash = known->second.hash;
+      return true;
+    }
+  }
+
+  // Hashed outside the lock; two threads may hash the same new file once each
+  MappedFile file;
+  if (!file.open(fileName)) {
+    return false;
+  }
+  stamp.hash = hashBytes64(file.data(), file.size());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_contentHashes[fileName] = stamp;
+  }
+  outHash = stamp.hash;
+  return true;
+}
+
+void
+AssetRegistry::setRetainUnused(bool retainUnused) {
+  std::vector<MeshHandle> meshes;
+  std::vector<TextureHandle> textures;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_retainUnused == retainUnused) {
+    return;
+  }
+  m_retainUnused = retainUnused;
+  if (!retainUnused) {
+    releaseRetained(m_meshes, meshes);
+    releaseRetained(m_textures, textures);
+  }
+}
+
+void
+AssetRegistry::purge() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto entry = m_meshes.begin(); entry != m_meshes.end();) {
+    entry = (!entry->second.pending.valid() && entry->second.asset.expired()) ? m_meshes.erase(entry) : std::next(entry);
+  }
+  for (auto entry = m_textures.begin(); entry != m_textures.end();) {
+    entry = (!entry->second.pending.valid() && entry->second.asset.expired()) ? m_textures.erase(entry) : std::next(entry);
+  }
+}
+
+size_t
+AssetRegistry::liveMeshCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t live = 0;
+  for (const auto& entry : m_meshes) {
+    live += !entry.second.asset.expired();
+  }
+  return live;
+}
+
+size_t
+AssetRegistry::liveTextureCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t live = 0;
+  for (const auto& entry : m_textures) {
+    live += !entry.second.asset.expired();
+  }
+  return live;
+}
+
+AssetRegistry::RegistryStats
+AssetRegistry::getStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
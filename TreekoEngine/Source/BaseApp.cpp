@@ -1,5 +1,40 @@
 ﻿#include "BaseApp.h"
 
+namespace {
+  // Frames between two reports of the render queue statistics (debug builds)
+  const unsigned int kQueueReportInterval = 300;
+
+  // GPU memory above which unused registry assets are evicted
+  const size_t kGpuMemoryBudget = 512ull * 1024 * 1024;
+
+  // Splits "dir/name.png" into the name Texture::init expects and its type
+  bool
+  splitTexturePath(const std::string& path, std::string& outName, ExtensionType& outType) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) {
+      return false;
+    }
+    std::string extension = path.substr(dot + 1);
+    for (char& c : extension) {
+      c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    if (extension == "png") {
+      outType = PNG;
+    }
+    else if (extension == "jpg") {
+      outType = JPG;
+    }
+    else if (extension == "dds") {
+      outType = DDS;
+    }
+    else {
+      return false;
+    }
+    outName = path.substr(0, dot);
+    return true;
+  }
+}
+
 BaseApp::BaseApp(HINSTANCE hInst, int nCmdShow) {
 
 }
@@ -100,71 +135,33 @@ BaseApp::init() {
   // Load Resources
 
   // Define the input layout
-  std::vector<D3D11_INPUT_ELEMENT_DESC> layout;
-  D3D11_INPUT_ELEMENT_DESC position;
-  position.SemanticName = "POSITION";
-  position.SemanticIndex = 0;
-  position.Format = DXGI_FORMAT_R32G32B32_FLOAT;
-  position.InputSlot = 0;
-  position.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT /*0*/;
-  position.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-  position.InstanceDataStepRate = 0;
-  layout.push_back(position);
-
-  D3D11_INPUT_ELEMENT_DESC texcoord;
-  texcoord.SemanticName = "TEXCOORD";
-  texcoord.SemanticIndex = 0;
-  texcoord.Format = DXGI_FORMAT_R32G32_FLOAT;
-  texcoord.InputSlot = 0;
-  texcoord.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT /*0*/;
-  texcoord.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-  texcoord.InstanceDataStepRate = 0;
-  layout.push_back(texcoord);
-
-  D3D11_INPUT_ELEMENT_DESC normal;
-  normal.SemanticName = "NORMAL";
-  normal.SemanticIndex = 0;
-  normal.Format = DXGI_FORMAT_R32G32B32_FLOAT; 
-  normal.InputSlot = 0;
-  normal.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-  normal.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-  normal.InstanceDataStepRate = 0;
-  layout.push_back(normal);
+  std::vector<D3D11_INPUT_ELEMENT_DESC> layout = InputLayout::simpleVertexLayout();
 
   // Create the Shader Program
+  m_shaderProgram.setShaderCache(&m_shaderCache);
   hr = m_shaderProgram.init(m_device, "TreekoEngine.fx", layout);
   if (FAILED(hr)) {
     ERROR("Main", "InitDevice",
       ("Failed to initialize ShaderProgram. HRESULT: " + std::to_string(hr)).c_str());
     return hr;
   }
+  // Editing TreekoEngine.fx recompiles it in the background; a broken edit keeps the current shaders
+  if (!m_shaderHotReload.watch(m_shaderProgram)) {
+    ERROR("Main", "InitDevice", "Shader hot reload is disabled.");
+  }
 
 
-  bool ModelL = m_modelLoader.loadModel("calavera.obj", m_mesh);
-
-  if (!ModelL)
-  {
+  // Meshes and textures come from the asset registry, which shares them by
+  // content and uses the binary mesh cache when it is up to date
+  m_assetRegistry = std::make_unique<AssetRegistry>(m_device);
+  m_assetRegistry->setRetainUnused(true);
+  m_device.m_memoryTracker->setBudget(kGpuMemoryBudget);
+  m_meshAsset = m_assetRegistry->loadMesh("calavera.obj");
+  if (!m_meshAsset) {
     ERROR("BaseApp.cpp", "init", "Failed to load model calavera.obj");
     return E_FAIL;
   }
-
-  // Create vertex buffer
-  hr = m_vertexBuffer.init(m_device, m_mesh, D3D11_BIND_VERTEX_BUFFER);
-
-  if (FAILED(hr)) {
-    ERROR("Main", "InitDevice",
-      ("Failed to initialize VertexBuffer. HRESULT: " + std::to_string(hr)).c_str());
-    return hr;
-  }
-
-  // Create index buffer
-  hr = m_indexBuffer.init(m_device, m_mesh, D3D11_BIND_INDEX_BUFFER);
-
-  if (FAILED(hr)) {
-    ERROR("Main", "InitDevice",
-      ("Failed to initialize IndexBuffer. HRESULT: " + std::to_string(hr)).c_str());
-    return hr;
-  }
+  m_meshletCuller.init(m_meshAsset->mesh.m_meshlets);
 
   // Set primitive topology
   m_deviceContext.m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -184,22 +181,28 @@ BaseApp::init() {
     return hr;
   }
 
-  hr = m_cbChangesEveryFrame.init(m_device, sizeof(CBChangesEveryFrame));
+  // Fallback of the constant ring: dynamic, so each update is a Map(WRITE_DISCARD)
+  hr = m_cbChangesEveryFrame.init(m_device, sizeof(CBChangesEveryFrame), true);
   if (FAILED(hr)) {
     ERROR("Main", "InitDevice",
       ("Failed to initialize ChangesEveryFrame Buffer. HRESULT: " + std::to_string(hr)).c_str());
     return hr;
   }
 
-  hr = m_textureCube.init(m_device, "Stone", ExtensionType::JPG);
-
-  // Load the Texture
+  hr = m_constantAllocator.init(m_device, m_deviceContext);
   if (FAILED(hr)) {
     ERROR("Main", "InitDevice",
-      ("Failed to initialize texture Cube. HRESULT: " + std::to_string(hr)).c_str());
+      ("Failed to initialize the constant allocator. HRESULT: " + std::to_string(hr)).c_str());
     return hr;
   }
 
+  // Load the Texture
+  m_textureCube = m_assetRegistry->loadTexture("Stone", ExtensionType::JPG);
+  if (!m_textureCube) {
+    ERROR("Main", "InitDevice", "Failed to initialize texture Cube.");
+    return E_FAIL;
+  }
+
   // Create the sample state
   hr = m_samplerState.init(m_device);
   if (FAILED(hr)) {
@@ -208,6 +211,23 @@ BaseApp::init() {
     return hr;
   }
 
+  // One binding per material. The registry hands materials sharing a diffuse
+  // map the same texture; those without a loadable one use the default texture.
+  m_materialTextures.assign(m_meshAsset->mesh.m_materials.size(), AssetRegistry::TextureHandle());
+  m_materialBindings.assign(std::max<size_t>(1, m_meshAsset->mesh.m_materials.size()),
+    { &m_textureCube->texture, &m_samplerState });
+  for (size_t i = 0; i < m_meshAsset->mesh.m_materials.size(); ++i) {
+    std::string textureName;
+    ExtensionType textureType;
+    if (!splitTexturePath(m_meshAsset->mesh.m_materials[i].diffuseMap, textureName, textureType)) {
+      continue;
+    }
+    m_materialTextures[i] = m_assetRegistry->loadTexture(textureName, textureType);
+    if (m_materialTextures[i]) {
+      m_materialBindings[i].texture = &m_materialTextures[i]->texture;
+    }
+  }
+
   // Initialize the world matrices
   m_World = XMMatrixIdentity();
 
@@ -229,6 +249,10 @@ BaseApp::init() {
 }
 
 void BaseApp::update(float deltaTime) {
+  // Swap in shaders recompiled since the last frame
+  m_shaderHotReload.update(m_device);
+  m_constantAllocator.beginFrame(m_deviceContext);
+
   // Update our time
   static float t = 0.0f;
   if (m_swapChain.m_driverType == D3D_DRIVER_TYPE_REFERENCE)
@@ -260,11 +284,53 @@ void BaseApp::update(float deltaTime) {
   m_World = XMMatrixRotationY(t);
   cb.mWorld = XMMatrixTranspose(m_World);
   cb.vMeshColor = m_vMeshColor;
-  m_cbChangesEveryFrame.update(m_deviceContext, nullptr, 0, nullptr, &cb, 0, 0);
+  m_changesEveryFrameRange = m_constantAllocator.update(m_deviceContext, m_cbChangesEveryFrame, &cb, sizeof(cb));
+
+  // The camera in model space is the origin of the inverse world-view matrix
+  XMMATRIX worldView = XMMatrixMultiply(m_World, m_View);
+  XMVECTOR determinant;
+  XMMATRIX viewToModel = XMMatrixInverse(&determinant, worldView);
+  XMFLOAT3 cameraPosition;
+  XMStoreFloat3(&cameraPosition, viewToModel.r[3]);
+
+  // Pick the coarsest level whose error projects to at most one pixel at the
+  // nearest point of the bounding sphere. The world matrix only rotates, so
+  // model units are world units.
+  m_lod = 0;
+  if (m_meshAsset->mesh.m_lods.size() > 1) {
+    XMVECTOR boundsMin = XMLoadFloat3(&m_meshAsset->mesh.m_boundsMin);
+    XMVECTOR boundsMax = XMLoadFloat3(&m_meshAsset->mesh.m_boundsMax);
+    XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+    float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, center)));
+    float distance = XMVectorGetX(XMVector3Length(
+      XMVectorSubtract(XMLoadFloat3(&cameraPosition), center))) - radius;
+    XMFLOAT4X4 projection;
+    XMStoreFloat4x4(&projection, m_Projection);
+    float pixelsPerUnit = projection.m[1][1] * m_window.m_height * 0.5f;
+    m_lod = MeshSimplifier::selectLod(m_meshAsset->mesh.m_lods, distance, pixelsPerUnit, 1.0f);
+  }
+
+  // Meshlets only describe the full-resolution level; simplified levels are
+  // drawn as a single range
+  if (m_lod == 0 && m_meshletCuller.getMeshletCount() > 0) {
+    XMFLOAT4X4 worldViewProjection;
+    XMStoreFloat4x4(&worldViewProjection, XMMatrixMultiply(worldView, m_Projection));
+    m_meshletCuller.cull(worldViewProjection, cameraPosition, m_drawRanges);
+  }
+  else {
+    MeshletDrawRange range = { 0, static_cast<unsigned int>(m_meshAsset->mesh.m_numIndex) };
+    if (!m_meshAsset->mesh.m_lods.empty()) {
+      range.indexOffset = m_meshAsset->mesh.m_lods[m_lod].indexOffset;
+      range.indexCount = m_meshAsset->mesh.m_lods[m_lod].indexCount;
+    }
+    m_drawRanges.assign(1, range);
+  }
 }
 
 void
 BaseApp::render() {
+  m_device.m_memoryTracker->beginFrame();
+
   // Set Render Target View
   float ClearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
   m_renderTargetView.render(m_deviceContext, m_depthStencilView, 1, ClearColor);
@@ -281,24 +347,49 @@ BaseApp::render() {
 
   // Render the cube
   // Asignar buffers Vertex e Index
-  m_vertexBuffer.render(m_deviceContext, 0, 1);
-  m_indexBuffer.render(m_deviceContext, 0, 1, false, DXGI_FORMAT_R32_UINT);
+  m_meshAsset->vertexBuffer.render(m_deviceContext, 0, 1);
+  m_meshAsset->indexBuffer.render(m_deviceContext, 0, 1, false, DXGI_FORMAT_R32_UINT);
 
   // Asignar buffers constantes
   m_cbNeverChanges.render(m_deviceContext, 0, 1);
   m_cbChangeOnResize.render(m_deviceContext, 1, 1);
-  m_cbChangesEveryFrame.render(m_deviceContext, 2, 1);
-  m_cbChangesEveryFrame.render(m_deviceContext, 2, 1, true);
-
-  // Asignar textura y sampler
-  m_textureCube.render(m_deviceContext, 0, 1);
-  m_samplerState.render(m_deviceContext, 0, 1);
-  m_deviceContext.DrawIndexed(m_mesh.m_numIndex, 0, 0);
+  m_constantAllocator.bind(m_deviceContext, m_cbChangesEveryFrame, m_changesEveryFrameRange, 2, true);
+
+  // Asignar textura y sampler una vez por material
+  m_renderQueue.clear();
+  m_renderQueue.addRanges(m_drawRanges, m_meshAsset->mesh.m_submeshes);
+  m_renderQueue.submit(m_deviceContext, m_materialBindings);
+
+  // Everything drawn above is still held, so only unused assets can go
+  m_device.m_memoryTracker->enforceBudget();
+
+#if defined( DEBUG ) || defined( _DEBUG )
+  // Debug builds only: the report allocates and formats on the frame path
+  if (++m_frameCount % kQueueReportInterval == 0) {
+    const RenderQueue::SubmitStats& queueStats = m_renderQueue.getLastStats();
+    std::wostringstream report;
+    report << L"RenderQueue: " << queueStats.items << L" ranges, " << queueStats.drawCalls
+      << L" draws, " << queueStats.materialChanges << L" material changes, texture binds "
+      << queueStats.textureBinds << L" (unsorted " << queueStats.unsortedTextureBinds
+      << L"), sampler binds " << queueStats.samplerBinds << L" (unsorted "
+      << queueStats.unsortedSamplerBinds << L")\n";
+
+    const GpuMemoryTracker::CategoryTotals memory = m_device.m_memoryTracker->getCategoryTotals();
+    report << L"GPU memory: " << memory.totalBytes / 1024 << L" KB";
+    for (int category = 0; category < MEMORY_CATEGORY_COUNT; ++category) {
+      const char* name = GpuMemoryTracker::categoryName(static_cast<MemoryCategory>(category));
+      report << L", " << std::wstring(name, name + strlen(name)) << L" " << memory.bytes[category] / 1024 << L" KB";
+    }
+    report << L"\n";
+    DEBUG_OUTPUT(report.str().c_str());
+  }
+#endif
 
   //
   // Present our back buffer to our front buffer
   //
   m_swapChain.present();
+  m_constantAllocator.endFrame(m_deviceContext);
 }
 
 void
@@ -306,13 +397,19 @@ BaseApp::destroy() {
   if (m_deviceContext.m_deviceContext) m_deviceContext.m_deviceContext->ClearState();
 
   m_samplerState.destroy();
-  m_textureCube.destroy();
+  // The last handles release the registry's buffers and textures
+  m_materialBindings.clear();
+  m_materialTextures.clear();
+  m_textureCube.reset();
+  m_meshAsset.reset();
+  m_assetRegistry.reset();
 
   m_cbNeverChanges.destroy();
   m_cbChangeOnResize.destroy();
   m_cbChangesEveryFrame.destroy();
-  m_vertexBuffer.destroy();
-  m_indexBuffer.destroy();
+  m_constantAllocator.destroy();
+  m_meshletCuller.destroy();
+  m_shaderHotReload.clear();
   m_shaderProgram.destroy();
   m_depthStencil.destroy();
   m_depthStencilView.destroy();
@@ -0,0 +1,884 @@
+#include "BlockCompressor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BLOCKCOMPRESSOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // Blocks per tile: enough work to amortize the scheduling, small enough for
+  // the last tiles of a chain to spread over the workers
+  const unsigned int kTileBlocks = 256;
+
+  // Least-squares passes of BLOCK_HIGH
+  const int kRefineIterations = 3;
+
+  // BC7 4-bit index weights (out of 64)
+  const int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+  // Weight of the second endpoint for each BC1 (4-color) and BC4 (8-value) index
+  const float kBc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+  const float kBc4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+  // The 16 texels of a block as float RGBA
+  struct BlockTexels {
+    float c[16][4];
+  };
+
+  // Decoded palette of a candidate encoding, one array per channel (SoA) so
+  // four entries fit a register. Counts are always a multiple of 4.
+  struct BlockPalette {
+    float c[4][16];
+    unsigned int count;
+  };
+
+  // Picks the nearest palette entry for every texel and returns the total
+  // squared error
+#if BLOCKCOMPRESSOR_SSE2
+  float
+  fitPalette(const BlockTexels& texels, const BlockPalette& palette, unsigned char* outIndices) {
+    float totalError = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+      __m128 r = _mm_set1_ps(texels.c[i][0]);
+      __m128 g = _mm_set1_ps(texels.c[i][1]);
+      __m128 b = _mm_set1_ps(texels.c[i][2]);
+      __m128 a = _mm_set1_ps(texels.c[i][3]);
+      __m128 bestError = _mm_set1_ps(std::numeric_limits<float>::max());
+      __m128 bestIndex = _mm_setzero_ps();
+      __m128 index = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+      for (unsigned int entry = 0; entry < palette.count; entry += 4) {
+        __m128 dr = _mm_sub_ps(_mm_loadu_ps(&palette.c[0][entry]), r);
+        __m128 dg = _mm_sub_ps(_mm_loadu_ps(&palette.c[1][entry]), g);
+        __m128 db = _mm_sub_ps(_mm_loadu_ps(&palette.c[2][entry]), b);
+        __m128 da = _mm_sub_ps(_mm_loadu_ps(&palette.c[3][entry]), a);
+        __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+          _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+        __m128 closer = _mm_cmplt_ps(error, bestError);
+        bestError = _mm_min_ps(error, bestError);
+        bestIndex = _mm_or_ps(_mm_and_ps(closer, index), _mm_andnot_ps(closer, bestIndex));
+        index = _mm_add_ps(index, _mm_set1_ps(4.0f));
+      }
+
+      // Lowest error of the four lanes; ties keep the lowest index
+      float errors[4];
+      float indices[4];
+      _mm_storeu_ps(errors, bestError);
+      _mm_storeu_ps(indices, bestIndex);
+      int lane = 0;
+      for (int j = 1; j < 4; ++j) {
+        if (errors[j] < errors[lane] || (errors[j] == errors[lane] && indices[j] < indices[lane])) {
+          lane = j;
+        }
+      }
+      outIndices[i] = static_cast<unsigned char>(indices[lane]);
+      totalError += errors[lane];
+    }
+    return totalError;
+  }
+#else
+  float
+  fitPalette(const BlockTexels& texels, const BlockPalette& palette, unsigned char* outIndices) {
+    float totalError = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+      float bestError = std::numeric_limits<float>::max();
+      unsigned int bestIndex = 0;
+      for (unsigned int entry = 0; entry < palette.count; ++entry) {
+        float error = 0.0f;
+        for (int channel = 0; channel < 4; ++channel) {
+          float delta = palette.c[channel][entry] - texels.c[i][channel];
+          error += delta * delta;
+        }
+        if (error < bestError) {
+          bestError = error;
+          bestIndex = entry;
+        }
+      }
+      outIndices[i] = static_cast<unsigned char>(bestIndex);
+      totalError += bestError;
+    }
+    return totalError;
+  }
+#endif
+
+  // Mean and principal axis of the first channelCount channels
+  void
+  principalAxis(const BlockTexels& texels, int channelCount, float* outMean, float* outAxis) {
+    float covariance[4][4] = {};
+    for (int channel = 0; channel < 4; ++channel) {
+      outMean[channel] = 0.0f;
+      outAxis[channel] = 0.0f;
+    }
+    for (int i = 0; i < 16; ++i) {
+      for (int channel = 0; channel < channelCount; ++channel) {
+        outMean[channel] += texels.c[i][channel] / 16.0f;
+      }
+    }
+    for (int i = 0; i < 16; ++i) {
+      for (int row = 0; row < channelCount; ++row) {
+        for (int column = 0; column < channelCount; ++column) {
+          covariance[row][column] += (texels.c[i][row] - outMean[row]) * (texels.c[i][column] - outMean[column]);
+        }
+      }
+    }
+
+    // Power iteration from the row of the widest channel
+    int widest = 0;
+    for (int channel = 1; channel < channelCount; ++channel) {
+      if (covariance[channel][channel] > covariance[widest][widest]) {
+        widest = channel;
+      }
+    }
+    if (covariance[widest][widest] <= 0.0f) {
+      return;
+    }
+    float axis[4] = {};
+    for (int channel = 0; channel < channelCount; ++channel) {
+      axis[channel] = covariance[widest][channel];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+      float next[4] = {};
+      float largest = 0.0f;
+      for (int row = 0; row < channelCount; ++row) {
+        for (int column = 0; column < channelCount; ++column) {
+          next[row] += covariance[row][column] * axis[column];
+        }
+        largest = std::max(largest, std::fabs(next[row]));
+      }
+      if (largest <= 0.0f) {
+        break;
+      }
+      for (int channel = 0; channel < channelCount; ++channel) {
+        axis[channel] = next[channel] / largest;
+      }
+    }
+    float length = 0.0f;
+    for (int channel = 0; channel < channelCount; ++channel) {
+      length += axis[channel] * axis[channel];
+    }
+    length = std::sqrt(length);
+    for (int channel = 0; length > 0.0f && channel < channelCount; ++channel) {
+      outAxis[channel] = axis[channel] / length;
+    }
+  }
+
+  // Endpoints at the extreme projections of the texels on the principal axis
+  void
+  axisEndpoints(const BlockTexels& texels, int channelCount, float* outLow, float* outHigh) {
+    float mean[4];
+    float axis[4];
+    principalAxis(texels, channelCount, mean, axis);
+    float low = 0.0f;
+    float high = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+      float projection = 0.0f;
+      for (int channel = 0; channel < channelCount; ++channel) {
+        projection += (texels.c[i][channel] - mean[channel]) * axis[channel];
+      }
+      low = std::min(low, projection);
+      high = std::max(high, projection);
+    }
+    for (int channel = 0; channel < 4; ++channel) {
+      outLow[channel] = std::min(255.0f, std::max(0.0f, mean[channel] + axis[channel] * low));
+      outHigh[channel] = std::min(255.0f, std::max(0.0f, mean[channel] + axis[channel] * high));
+    }
+  }
+
+  // Endpoints minimizing the squared error for fixed per-texel weights of the
+  // second endpoint. Returns false when the weights do not constrain both.
+  bool
+  refineEndpoints(const BlockTexels& texels, int channelCount, const float* weights, float* outFirst, float* outSecond) {
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = {};
+    float bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+      float b = weights[i];
+      float a = 1.0f - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (int channel = 0; channel < channelCount; ++channel) {
+        ax[channel] += a * texels.c[i][channel];
+        bx[channel] += b * texels.c[i][channel];
+      }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+      return false;
+    }
+    for (int channel = 0; channel < channelCount; ++channel) {
+      outFirst[channel] = std::min(255.0f, std::max(0.0f, (bb * ax[channel] - ab * bx[channel]) / determinant));
+      outSecond[channel] = std::min(255.0f, std::max(0.0f, (aa * bx[channel] - ab * ax[channel]) / determinant));
+    }
+    return true;
+  }
+
+  void
+  loadBlock(const BlockCompressor::BlockImage& image, unsigned int blockX, unsigned int blockY, BlockTexels& outTexels) {
+    for (unsigned int y = 0; y < 4; ++y) {
+      unsigned int row = std::min(blockY * 4 + y, image.height - 1);
+      for (unsigned int x = 0; x < 4; ++x) {
+        unsigned int column = std::min(blockX * 4 + x, image.width - 1);
+        const unsigned char* texel = image.pixels + (static_cast<size_t>(row) * image.width + column) * 4;
+        for (int channel = 0; channel < 4; ++channel) {
+          outTexels.c[y * 4 + x][channel] = texel[channel];
+        }
+      }
+    }
+  }
+
+  // --- BC1 ---------------------------------------------------------------
+
+  unsigned int
+  packRgb565(const float* color) {
+    unsigned int r = static_cast<unsigned int>(color[0] * 31.0f / 255.0f + 0.5f);
+    unsigned int g = static_cast<unsigned int>(color[1] * 63.0f / 255.0f + 0.5f);
+    unsigned int b = static_cast<unsigned int>(color[2] * 31.0f / 255.0f + 0.5f);
+    return (r << 11) | (g << 5) | b;
+  }
+
+  void
+  unpackRgb565(unsigned int packed, int* outColor) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    outColor[0] = (r << 3) | (r >> 2);
+    outColor[1] = (g << 2) | (g >> 4);
+    outColor[2] = (b << 3) | (b >> 2);
+  }
+
+  // The four colors of a 4-color BC1 block
+  void
+  bc1Palette(unsigned int color0, unsigned int color1, int palette[4][3]) {
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    for (int channel = 0; channel < 3; ++channel) {
+      palette[2][channel] = (2 * palette[0][channel] + palette[1][channel] + 1) / 3;
+      palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel] + 1) / 3;
+    }
+  }
+
+  // Encodes two float endpoints; keeps the block if it beats bestError
+  void
+  tryBc1(const BlockTexels& texels, const float* first, const float* second,
+    float& bestError, unsigned char* bestIndices, unsigned char* outBlock) {
+    unsigned int color0 = packRgb565(first);
+    unsigned int color1 = packRgb565(second);
+    // The 4-color mode needs color0 > color1
+    if (color0 < color1) {
+      std::swap(color0, color1);
+    }
+
+    BlockPalette palette = {};
+    palette.count = 4;
+    int colors[4][3];
+    bc1Palette(color0, color1, colors);
+    for (int entry = 0; entry < 4; ++entry) {
+      for (int channel = 0; channel < 3; ++channel) {
+        palette.c[channel][entry] = static_cast<float>(colors[entry][channel]);
+      }
+    }
+    unsigned char indices[16];
+    float error = (color0 == color1) ? 0.0f : fitPalette(texels, palette, indices);
+    if (color0 == color1) {
+      // Equal endpoints select the 3-color mode, where index 0 is still color0
+      memset(indices, 0, sizeof(indices));
+      for (int i = 0; i < 16; ++i) {
+        for (int channel = 0; channel < 3; ++channel) {
+          float delta = palette.c[channel][0] - texels.c[i][channel];
+          error += delta * delta;
+        }
+      }
+    }
+    if (error >= bestError) {
+      return;
+    }
+    bestError = error;
+    memcpy(bestIndices, indices, sizeof(indices));
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+      bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+    }
+    outBlock[0] = static_cast<unsigned char>(color0);
+    outBlock[1] = static_cast<unsigned char>(color0 >> 8);
+    outBlock[2] = static_cast<unsigned char>(color1);
+    outBlock[3] = static_cast<unsigned char>(color1 >> 8);
+    memcpy(outBlock + 4, &bits, sizeof(bits));
+  }
+
+  // 8-byte opaque color block (also the color half of BC3)
+  void
+  encodeBc1(BlockTexels texels, bool high, unsigned char* outBlock) {
+    for (int i = 0; i < 16; ++i) {
+      texels.c[i][3] = 0.0f;
+    }
+    float low[4];
+    float highEnd[4];
+    axisEndpoints(texels, 3, low, highEnd);
+
+    float bestError = std::numeric_limits<float>::max();
+    unsigned char indices[16];
+    tryBc1(texels, highEnd, low, bestError, indices, outBlock);
+    for (int iteration = 0; high && iteration < kRefineIterations && bestError > 0.0f; ++iteration) {
+      // Weights of the second stored endpoint, whichever order tryBc1 kept
+      float weights[16];
+      for (int i = 0; i < 16; ++i) {
+        weights[i] = kBc1Weights[indices[i]];
+      }
+      float first[4] = {};
+      float second[4] = {};
+      if (!refineEndpoints(texels, 3, weights, first, second)) {
+        break;
+      }
+      tryBc1(texels, first, second, bestError, indices, outBlock);
+    }
+  }
+
+  // --- BC4 ---------------------------------------------------------------
+
+  // Palette of a BC4 block; 8 interpolated values when first > second, else 6
+  // plus 0 and 255
+  void
+  bc4Palette(int first, int second, int palette[8]) {
+    palette[0] = first;
+    palette[1] = second;
+    if (first > second) {
+      for (int i = 2; i < 8; ++i) {
+        palette[i] = ((8 - i) * first + (i - 1) * second + 3) / 7;
+      }
+    }
+    else {
+      for (int i = 2; i < 6; ++i) {
+        palette[i] = ((6 - i) * first + (i - 1) * second + 2) / 5;
+      }
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+  }
+
+  void
+  tryBc4(const BlockTexels& values, int first, int second,
+    float& bestError, unsigned char* bestIndices, unsigned char* outBlock) {
+    BlockPalette palette = {};
+    palette.count = 8;
+    int entries[8];
+    bc4Palette(first, second, entries);
+    for (int entry = 0; entry < 8; ++entry) {
+      palette.c[0][entry] = static_cast<float>(entries[entry]);
+    }
+    unsigned char indices[16];
+    float error = fitPalette(values, palette, indices);
+    if (error >= bestError) {
+      return;
+    }
+    bestError = error;
+    memcpy(bestIndices, indices, sizeof(indices));
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+      bits |= static_cast<uint64_t>(indices[i]) << (i * 3);
+    }
+    outBlock[0] = static_cast<unsigned char>(first);
+    outBlock[1] = static_cast<unsigned char>(second);
+    for (int i = 0; i < 6; ++i) {
+      outBlock[2 + i] = static_cast<unsigned char>(bits >> (i * 8));
+    }
+  }
+
+  // 8-byte single channel block
+  void
+  encodeBc4(const BlockTexels& texels, int channel, bool high, unsigned char* outBlock) {
+    BlockTexels values = {};
+    float minimum = 255.0f;
+    float maximum = 0.0f;
+    float innerMinimum = 255.0f;
+    float innerMaximum = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+      float value = texels.c[i][channel];
+      values.c[i][0] = value;
+      minimum = std::min(minimum, value);
+      maximum = std::max(maximum, value);
+      if (value > 0.0f && value < 255.0f) {
+        innerMinimum = std::min(innerMinimum, value);
+        innerMaximum = std::max(innerMaximum, value);
+      }
+    }
+
+    float bestError = std::numeric_limits<float>::max();
+    unsigned char indices[16];
+    tryBc4(values, static_cast<int>(maximum), static_cast<int>(minimum), bestError, indices, outBlock);
+    if (!high || bestError == 0.0f) {
+      return;
+    }
+
+    // 6-value mode: 0 and 255 come for free, the range covers the rest
+    if (innerMinimum <= innerMaximum) {
+      tryBc4(values, static_cast<int>(innerMinimum), static_cast<int>(innerMaximum), bestError, indices, outBlock);
+    }
+
+    // Least squares on the 8-value mode
+    float eightError = std::numeric_limits<float>::max();
+    unsigned char eightIndices[16];
+    unsigned char eightBlock[8];
+    tryBc4(values, static_cast<int>(maximum), static_cast<int>(minimum), eightError, eightIndices, eightBlock);
+    for (int iteration = 0; iteration < kRefineIterations && maximum > minimum; ++iteration) {
+      float weights[16];
+      for (int i = 0; i < 16; ++i) {
+        weights[i] = kBc4Weights[eightIndices[i]];
+      }
+      float first[4] = {};
+      float second[4] = {};
+      if (!refineEndpoints(values, 1, weights, first, second)) {
+        break;
+      }
+      int first8 = static_cast<int>(first[0] + 0.5f);
+      int second8 = static_cast<int>(second[0] + 0.5f);
+      if (first8 < second8) {
+        std::swap(first8, second8);
+      }
+      if (first8 == second8) {
+        break;
+      }
+      tryBc4(values, first8, second8, eightError, eightIndices, eightBlock);
+    }
+    if (eightError < bestError) {
+      bestError = eightError;
+      memcpy(outBlock, eightBlock, sizeof(eightBlock));
+    }
+  }
+
+  // --- BC7 (mode 6) ------------------------------------------------------
+
+  // Appends bits to a 16-byte block, least significant first
+  struct BlockBitWriter {
+    unsigned char* block;
+    unsigned int position;
+
+    void
+    write(unsigned int value, unsigned int bitCount) {
+      for (unsigned int i = 0; i < bitCount; ++i, ++position) {
+        if ((value >> i) & 1u) {
+          block[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+        }
+      }
+    }
+  };
+
+  struct BlockBitReader {
+    const unsigned char* block;
+    unsigned int position;
+
+    unsigned int
+    read(unsigned int bitCount) {
+      unsigned int value = 0;
+      for (unsigned int i = 0; i < bitCount; ++i, ++position) {
+        value |= ((block[position >> 3] >> (position & 7)) & 1u) << i;
+      }
+      return value;
+    }
+  };
+
+  // A mode 6 endpoint: 7 bits per channel plus a shared p-bit
+  struct Bc7Endpoint {
+    unsigned int quantized[4];
+    unsigned int pBit;
+  };
+
+  Bc7Endpoint
+  quantizeBc7(const float* color) {
+    Bc7Endpoint best = {};
+    float bestError = std::numeric_limits<float>::max();
+    for (unsigned int pBit = 0; pBit < 2; ++pBit) {
+      Bc7Endpoint candidate = {};
+      candidate.pBit = pBit;
+      float error = 0.0f;
+      for (int channel = 0; channel < 4; ++channel) {
+        float scaled = (color[channel] - pBit) * 0.5f + 0.5f;
+        candidate.quantized[channel] = static_cast<unsigned int>(std::min(127.0f, std::max(0.0f, scaled)));
+        float delta = static_cast<float>((candidate.quantized[channel] << 1) | pBit) - color[channel];
+        error += delta * delta;
+      }
+      if (error < bestError) {
+        bestError = error;
+        best = candidate;
+      }
+    }
+    return best;
+  }
+
+  void
+  tryBc7(const BlockTexels& texels, const float* first, const float* second,
+    float& bestError, unsigned char* bestIndices, Bc7Endpoint* bestEndpoints) {
+    Bc7Endpoint endpoints[2] = { quantizeBc7(first), quantizeBc7(second) };
+    BlockPalette palette = {};
+    palette.count = 16;
+    for (int channel = 0; channel < 4; ++channel) {
+      int e0 = static_cast<int>((endpoints[0].quantized[channel] << 1) | endpoints[0].pBit);
+      int e1 = static_cast<int>((endpoints[1].quantized[channel] << 1) | endpoints[1].pBit);
+      for (int entry = 0; entry < 16; ++entry) {
+        palette.c[channel][entry] = static_cast<float>(((64 - kBc7Weights[entry]) * e0 + kBc7Weights[entry] * e1 + 32) >> 6);
+      }
+    }
+    unsigned char indices[16];
+    float error = fitPalette(texels, palette, indices);
+    if (error >= bestError) {
+      return;
+    }
+    bestError = error;
+    memcpy(bestIndices, indices, sizeof(indices));
+    bestEndpoints[0] = endpoints[0];
+    bestEndpoints[1] = endpoints[1];
+  }
+
+  // 16-byte RGBA block
+  void
+  encodeBc7(const BlockTexels& texels, bool high, unsigned char* outBlock) {
+    float low[4];
+    float highEnd[4];
+    axisEndpoints(texels, 4, low, highEnd);
+
+    float bestError = std::numeric_limits<float>::max();
+    unsigned char indices[16];
+    Bc7Endpoint endpoints[2];
+    tryBc7(texels, low, highEnd, bestError, indices, endpoints);
+    for (int iteration = 0; high && iteration < kRefineIterations && bestError > 0.0f; ++iteration) {
+      float weights[16];
+      for (int i = 0; i < 16; ++i) {
+        weights[i] = kBc7Weights[indices[i]] / 64.0f;
+      }
+      float first[4] = {};
+      float second[4] = {};
+      if (!refineEndpoints(texels, 4, weights, first, second)) {
+        break;
+      }
+      tryBc7(texels, first, second, bestError, indices, endpoints);
+    }
+
+    // The anchor index (texel 0) is stored without its top bit
+    if (indices[0] & 8) {
+      std::swap(endpoints[0], endpoints[1]);
+      for (int i = 0; i < 16; ++i) {
+        indices[i] = static_cast<unsigned char>(15 - indices[i]);
+      }
+    }
+
+    memset(outBlock, 0, 16);
+    BlockBitWriter writer = { outBlock, 0 };
+    writer.write(1u << 6, 7);
+    for (int channel = 0; channel < 4; ++channel) {
+      writer.write(endpoints[0].quantized[channel], 7);
+      writer.write(endpoints[1].quantized[channel], 7);
+    }
+    writer.write(endpoints[0].pBit, 1);
+    writer.write(endpoints[1].pBit, 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+      writer.write(indices[i], 4);
+    }
+  }
+
+  // --- Decoders ----------------------------------------------------------
+
+  void
+  decodeBc1(const unsigned char* block, bool alwaysFourColor, unsigned char outTexels[16][4]) {
+    unsigned int color0 = block[0] | (block[1] << 8);
+    unsigned int color1 = block[2] | (block[3] << 8);
+    int palette[4][3];
+    bc1Palette(color0, color1, palette);
+    uint32_t bits;
+    memcpy(&bits, block + 4, sizeof(bits));
+    for (int i = 0; i < 16; ++i) {
+      unsigned int index = (bits >> (i * 2)) & 3;
+      if (!alwaysFourColor && color0 <= color1 && index >= 2) {
+        // 3-color mode: midpoint and transparent black (never written by the encoder)
+        for (int channel = 0; channel < 3; ++channel) {
+          int value = (index == 2) ? (palette[0][channel] + palette[1][channel] + 1) / 2 : 0;
+          outTexels[i][channel] = static_cast<unsigned char>(value);
+        }
+        outTexels[i][3] = (index == 2) ? 255 : 0;
+        continue;
+      }
+      for (int channel = 0; channel < 3; ++channel) {
+        outTexels[i][channel] = static_cast<unsigned char>(palette[index][channel]);
+      }
+      outTexels[i][3] = 255;
+    }
+  }
+
+  void
+  decodeBc4(const unsigned char* block, unsigned char outTexels[16][4], int channel) {
+    int palette[8];
+    bc4Palette(block[0], block[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) {
+      bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; ++i) {
+      outTexels[i][channel] = static_cast<unsigned char>(palette[(bits >> (i * 3)) & 7]);
+    }
+  }
+
+  bool
+  decodeBc7(const unsigned char* block, unsigned char outTexels[16][4]) {
+    BlockBitReader reader = { block, 0 };
+    if (reader.read(7) != (1u << 6)) {
+      return false;
+    }
+    int endpoints[2][4];
+    for (int channel = 0; channel < 4; ++channel) {
+      endpoints[0][channel] = static_cast<int>(reader.read(7)) << 1;
+      endpoints[1][channel] = static_cast<int>(reader.read(7)) << 1;
+    }
+    int pBit0 = static_cast<int>(reader.read(1));
+    int pBit1 = static_cast<int>(reader.read(1));
+    for (int channel = 0; channel < 4; ++channel) {
+      endpoints[0][channel] |= pBit0;
+      endpoints[1][channel] |= pBit1;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int weight = kBc7Weights[reader.read(i == 0 ? 3 : 4)];
+      for (int channel = 0; channel < 4; ++channel) {
+        outTexels[i][channel] = static_cast<unsigned char>(
+          ((64 - weight) * endpoints[0][channel] + weight * endpoints[1][channel] + 32) >> 6);
+      }
+    }
+    return true;
+  }
+
+  // Squared error over the channels a format stores
+  double
+  squaredError(const unsigned char* reference, const unsigned char* decoded, size_t texelCount,
+    BlockFormat format, size_t& outSamples) {
+    int channelCount = (format == BLOCK_BC5) ? 2 : (format == BLOCK_BC1) ? 3 : 4;
+    double error = 0.0;
+    for (size_t i = 0; i < texelCount; ++i) {
+      for (int channel = 0; channel < channelCount; ++channel) {
+        double delta = static_cast<double>(reference[i * 4 + channel]) - decoded[i * 4 + channel];
+        error += delta * delta;
+      }
+    }
+    outSamples = texelCount * channelCount;
+    return error;
+  }
+
+  double
+  psnrFromError(double error, size_t samples) {
+    if (error <= 0.0 || samples == 0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return 10.0 * std::log10(255.0 * 255.0 * samples / error);
+  }
+}
+
+bool
+BlockCompressor::compress(const BlockImage& image, BlockFormat format, BlockChain& outChain, unsigned int threadCount) {
+  return compress(&image, 1, format, outChain, threadCount);
+}
+
+bool
+BlockCompressor::compress(const BlockImage* images,
+  size_t imageCount,
+  BlockFormat format,
+  BlockChain& outChain,
+  unsigned int threadCount) {
+  if (imageCount == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < imageCount; ++i) {
+    if (!images[i].pixels || images[i].width == 0 || images[i].height == 0) {
+      return false;
+    }
+  }
+
+  auto encodeStart = std::chrono::steady_clock::now();
+  m_lastStats = CompressStats();
+  if (format == BLOCK_AUTO) {
+    format = chooseFormat(images[0], m_quality, m_colorData);
+  }
+  const unsigned int bytesPerBlock = blockBytes(format);
+
+  // Lay out the levels and cut them into tiles of whole block rows
+  outChain.format = format;
+  outChain.levels.assign(imageCount, BlockLevel());
+  m_tiles.clear();
+  size_t offset = 0;
+  for (size_t i = 0; i < imageCount; ++i) {
+    BlockLevel& level = outChain.levels[i];
+    unsigned int blocksWide = (images[i].width + 3) / 4;
+    unsigned int blocksHigh = (images[i].height + 3) / 4;
+    level.width = images[i].width;
+    level.height = images[i].height;
+    level.rowPitch = blocksWide * bytesPerBlock;
+    level.offset = offset;
+    level.size = static_cast<size_t>(level.rowPitch) * blocksHigh;
+    offset += level.size;
+    m_lastStats.blocks += static_cast<size_t>(blocksWide) * blocksHigh;
+
+    unsigned int tileRows = std::max(1u, kTileBlocks / blocksWide);
+    for (unsigned int row = 0; row < blocksHigh; row += tileRows) {
+      BlockTile tile;
+      tile.image = static_cast<unsigned int>(i);
+      tile.blockRowBegin = row;
+      tile.blockRowEnd = std::min(blocksHigh, row + tileRows);
+      m_tiles.push_back(tile);
+    }
+  }
+  outChain.blocks.assign(offset, 0);
+
+  m_scheduler.run(m_tiles.size(), threadCount, [&](size_t tile) {
+    encodeTile(images, m_tiles[tile], format, outChain);
+  });
+
+  auto encodeEnd = std::chrono::steady_clock::now();
+  m_lastStats.format = format;
+  m_lastStats.tiles = m_scheduler.getLastStats().tiles;
+  m_lastStats.threads = m_scheduler.getLastStats().threads;
+  m_lastStats.steals = m_scheduler.getLastStats().steals;
+  m_lastStats.encodeMs = std::chrono::duration<double, std::milli>(encodeEnd - encodeStart).count();
+
+  if (m_measureError) {
+    double error = 0.0;
+    size_t samples = 0;
+    std::vector<unsigned char> decoded;
+    for (size_t i = 0; i < imageCount; ++i) {
+      const BlockLevel& level = outChain.levels[i];
+      decompress(outChain.blocks.data() + level.offset, level.width, level.height, format, decoded);
+      size_t levelSamples = 0;
+      error += squaredError(images[i].pixels, decoded.data(),
+        static_cast<size_t>(level.width) * level.height, format, levelSamples);
+      samples += levelSamples;
+    }
+    m_lastStats.psnr = psnrFromError(error, samples);
+  }
+  return true;
+}
+
+void
+BlockCompressor::encodeTile(const BlockImage* images, const BlockTile& tile, BlockFormat format, BlockChain& chain) const {
+  const BlockImage& image = images[tile.image];
+  const BlockLevel& level = chain.levels[tile.image];
+  const unsigned int bytesPerBlock = blockBytes(format);
+  const unsigned int blocksWide = (image.width + 3) / 4;
+  const bool high = (m_quality == BLOCK_HIGH);
+
+  BlockTexels texels;
+  for (unsigned int blockY = tile.blockRowBegin; blockY < tile.blockRowEnd; ++blockY) {
+    unsigned char* block = chain.blocks.data() + level.offset + static_cast<size_t>(blockY) * level.rowPitch;
+    for (unsigned int blockX = 0; blockX < blocksWide; ++blockX, block += bytesPerBlock) {
+      loadBlock(image, blockX, blockY, texels);
+      switch (format) {
+      case BLOCK_BC1:
+        encodeBc1(texels, high, block);
+        break;
+      case BLOCK_BC3:
+        encodeBc4(texels, 3, high, block);
+        encodeBc1(texels, high, block + 8);
+        break;
+      case BLOCK_BC5:
+        encodeBc4(texels, 0, high, block);
+        encodeBc4(texels, 1, high, block + 8);
+        break;
+      default:
+        encodeBc7(texels, high, block);
+        break;
+      }
+    }
+  }
+}
+
+BlockFormat
+BlockCompressor::chooseFormat(const BlockImage& image, BlockQuality quality, bool colorData) {
+  bool opaque = true;
+  bool constantBlue = true;
+  const size_t texelCount = static_cast<size_t>(image.width) * image.height;
+  for (size_t i = 0; i < texelCount && (opaque || constantBlue); ++i) {
+    opaque = opaque && image.pixels[i * 4 + 3] == 255;
+    constantBlue = constantBlue && image.pixels[i * 4 + 2] == image.pixels[2];
+  }
+  if (!colorData && opaque && constantBlue) {
+    return BLOCK_BC5;
+  }
+  if (quality == BLOCK_HIGH) {
+    return BLOCK_BC7;
+  }
+  return opaque ? BLOCK_BC1 : BLOCK_BC3;
+}
+
+unsigned int
+BlockCompressor::blockBytes(BlockFormat format) {
+  switch (format) {
+  case BLOCK_BC1:
+    return 8;
+  case BLOCK_BC3:
+  case BLOCK_BC5:
+  case BLOCK_BC7:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+bool
+BlockCompressor::decompress(const unsigned char* blocks,
+  unsigned int width,
+  unsigned int height,
+  BlockFormat format,
+  std::vector<unsigned char>& outPixels) {
+  const unsigned int bytesPerBlock = blockBytes(format);
+  if (bytesPerBlock == 0) {
+    return false;
+  }
+  outPixels.assign(static_cast<size_t>(width) * height * 4, 0);
+  const unsigned int blocksWide = (width + 3) / 4;
+  const unsigned int blocksHigh = (height + 3) / 4;
+  unsigned char texels[16][4];
+  for (unsigned int blockY = 0; blockY < blocksHigh; ++blockY) {
+    for (unsigned int blockX = 0; blockX < blocksWide; ++blockX) {
+      const unsigned char* block = blocks + (static_cast<size_t>(blockY) * blocksWide + blockX) * bytesPerBlock;
+      memset(texels, 0, sizeof(texels));
+      switch (format) {
+      case BLOCK_BC1:
+        decodeBc1(block, false, texels);
+        break;
+      case BLOCK_BC3:
+        // The color half of BC3 always uses the 4-color palette
+        decodeBc1(block + 8, true, texels);
+        decodeBc4(block, texels, 3);
+        break;
+      case BLOCK_BC5:
+        decodeBc4(block, texels, 0);
+        decodeBc4(block + 8, texels, 1);
+        for (int i = 0; i < 16; ++i) {
+          texels[i][3] = 255;
+        }
+        break;
+      default:
+        if (!decodeBc7(block, texels)) {
+          return false;
+        }
+        break;
+      }
+      for (unsigned int y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+        for (unsigned int x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+          memcpy(&outPixels[((static_cast<size_t>(blockY) * 4 + y) * width + blockX * 4 + x) * 4], texels[y * 4 + x], 4);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+double
+BlockCompressor::psnr(const unsigned char* reference,
+  const unsigned char* decoded,
+  size_t texelCount,
+  BlockFormat format) {
+  size_t samples = 0;
+  double error = squaredError(reference, decoded, texelCount, format, samples);
+  return psnrFromError(error, samples);
+}
@@ -1,6 +1,7 @@
 ﻿#include "Buffer.h"
 #include "Device.h"
 #include "DeviceContext.h"
+#include <cstring>
 
 HRESULT
 Buffer::init(Device& device, const MeshComponent& mesh, unsigned int bindFlag) {
@@ -17,31 +18,51 @@ Buffer::init(Device& device, const MeshComponent& mesh, unsigned int bindFlag) {
 		return E_INVALIDARG;
 	}
 
+	if (bindFlag & D3D11_BIND_VERTEX_BUFFER) {
+		return init(device,
+			mesh.m_vertex.data(),
+			sizeof(SimpleVertex),
+			static_cast<unsigned int>(mesh.m_vertex.size()),
+			bindFlag);
+	}
+	return init(device,
+		mesh.m_index.data(),
+		sizeof(unsigned int),
+		static_cast<unsigned int>(mesh.m_index.size()),
+		bindFlag);
+}
+
+HRESULT
+Buffer::init(Device& device,
+	const void* data,
+	unsigned int elementSize,
+	unsigned int elementCount,
+	unsigned int bindFlag) {
+	if (!device.m_device) {
+		ERROR("Buffer", "init", "Device is null.");
+		return E_POINTER;
+	}
+	if (!data || elementSize == 0 || elementCount == 0) {
+		ERROR("Buffer", "init", "Buffer data is empty");
+		return E_INVALIDARG;
+	}
+
 	D3D11_BUFFER_DESC desc = {};
-	D3D11_SUBRESOURCE_DATA data = {};
+	D3D11_SUBRESOURCE_DATA initData = {};
 
 	desc.Usage = D3D11_USAGE_DEFAULT;
 	desc.CPUAccessFlags = 0;
+	desc.ByteWidth = elementSize * elementCount;
+	desc.BindFlags = (D3D11_BIND_FLAG)bindFlag;
 	m_bindFlag = bindFlag;
+	m_stride = elementSize;
+	initData.pSysMem = data;
 
-	if (bindFlag & D3D11_BIND_VERTEX_BUFFER) {
-		m_stride = sizeof(SimpleVertex);
-		desc.ByteWidth = m_stride * static_cast<unsigned int>(mesh.m_vertex.size());
-		desc.BindFlags = (D3D11_BIND_FLAG)bindFlag;
-		data.pSysMem = mesh.m_vertex.data();
-	}
-	else if (bindFlag & D3D11_BIND_INDEX_BUFFER) {
-		m_stride = sizeof(unsigned int);
-		desc.ByteWidth = m_stride * static_cast<unsigned int>(mesh.m_index.size());
-		desc.BindFlags = (D3D11_BIND_FLAG)bindFlag;
-		data.pSysMem = mesh.m_index.data();
-	}
-
-	return createBuffer(device, desc, &data);
+	return createBuffer(device, desc, &initData);
 }
 
 HRESULT
-Buffer::init(Device& device, unsigned int ByteWidth) {
+Buffer::init(Device& device, unsigned int ByteWidth, bool dynamic) {
 	if (!device.m_device) {
 		ERROR("ShaderProgram", "init", "Device is null.");
 		return E_POINTER;
@@ -53,10 +74,12 @@ Buffer::init(Device& device, unsigned int ByteWidth) {
 	m_stride = ByteWidth;
 
 	D3D11_BUFFER_DESC desc = {};
-	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
 	desc.ByteWidth = ByteWidth;
 	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
 	m_bindFlag = desc.BindFlags;
+	m_dynamic = dynamic;
 
 	return createBuffer(device, desc, nullptr);
 }
@@ -77,6 +100,23 @@ Buffer::update(DeviceContext& deviceContext,
 		ERROR("ShaderProgram", "update", "pSrcData is null.");
 		return;
 	}
+	if (m_dynamic) {
+		if (pDstBox) {
+			ERROR("Buffer", "update", "A dynamic buffer can only be updated whole.");
+			return;
+		}
+		// WRITE_DISCARD hands back fresh memory while the GPU still reads the
+		// previous contents, so each draw can rewrite the same buffer
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		HRESULT hr = deviceContext.m_deviceContext->Map(m_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+		if (FAILED(hr)) {
+			ERROR("Buffer", "update", ("Failed to map the buffer. HRESULT: " + std::to_string(hr)).c_str());
+			return;
+		}
+		memcpy(mapped.pData, pSrcData, m_stride);
+		deviceContext.m_deviceContext->Unmap(m_buffer, 0);
+		return;
+	}
 	deviceContext.m_deviceContext->UpdateSubresource(m_buffer,
 		DstSubresource,
 		pDstBox,
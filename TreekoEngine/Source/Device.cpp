@@ -1,4 +1,167 @@
 #include "Device.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+	// Identifica el token de memoria guardado en cada recurso rastreado
+	const GUID kTrackedAllocationGuid =
+	{ 0x6f1c2b3a, 0x8d4e, 0x4b7a, { 0x9c, 0x21, 0x5e, 0x3f, 0x70, 0x18, 0xa4, 0xd2 } };
+
+	/*
+	  *  @brief Token held by a resource through its private data. D3D releases
+	  *         it when the resource is destroyed, which forgets the allocation.
+	*/
+	class
+		TrackedAllocation final : public IUnknown {
+	public:
+		TrackedAllocation(std::shared_ptr<GpuMemoryTracker> tracker, uint64_t allocationId)
+			: m_tracker(std::move(tracker)), m_allocationId(allocationId) {}
+
+		HRESULT STDMETHODCALLTYPE
+			QueryInterface(REFIID riid, void** ppvObject) override {
+			if (!ppvObject) {
+				return E_POINTER;
+			}
+			if (riid == IID_IUnknown) {
+				*ppvObject = static_cast<IUnknown*>(this);
+				AddRef();
+				return S_OK;
+			}
+			*ppvObject = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE
+			AddRef() override {
+			return ++m_references;
+		}
+
+		ULONG STDMETHODCALLTYPE
+			Release() override {
+			const ULONG references = --m_references;
+			if (references == 0) {
+				delete this;
+			}
+			return references;
+		}
+
+	private:
+		~TrackedAllocation() {
+			m_tracker->release(m_allocationId);
+		}
+
+		std::shared_ptr<GpuMemoryTracker> m_tracker;
+		uint64_t m_allocationId;
+		std::atomic<ULONG> m_references{ 1 };
+	};
+
+	// Bytes por bloque de 4x4 de los formatos comprimidos, 0 si no lo es
+	size_t
+	blockBytes(DXGI_FORMAT format) {
+		if ((format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC1_UNORM_SRGB) ||
+			(format >= DXGI_FORMAT_BC4_TYPELESS && format <= DXGI_FORMAT_BC4_SNORM)) {
+			return 8;
+		}
+		if ((format >= DXGI_FORMAT_BC2_TYPELESS && format <= DXGI_FORMAT_BC3_UNORM_SRGB) ||
+			(format >= DXGI_FORMAT_BC5_UNORM && format <= DXGI_FORMAT_BC5_SNORM) ||
+			(format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB)) {
+			return 16;
+		}
+		return 0;
+	}
+
+	// Bits por texel de los formatos sin comprimir (los valores de DXGI_FORMAT
+	// estan agrupados por tamano)
+	size_t
+	bitsPerTexel(DXGI_FORMAT format) {
+		if (format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && format <= DXGI_FORMAT_R32G32B32A32_SINT) {
+			return 128;
+		}
+		if (format >= DXGI_FORMAT_R32G32B32_TYPELESS && format <= DXGI_FORMAT_R32G32B32_SINT) {
+			return 96;
+		}
+		if (format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT) {
+			return 64;
+		}
+		if ((format >= DXGI_FORMAT_R8G8_TYPELESS && format <= DXGI_FORMAT_R16_SINT) ||
+			format == DXGI_FORMAT_B5G6R5_UNORM || format == DXGI_FORMAT_B5G5R5A1_UNORM) {
+			return 16;
+		}
+		if (format >= DXGI_FORMAT_R8_TYPELESS && format <= DXGI_FORMAT_A8_UNORM) {
+			return 8;
+		}
+		if (format == DXGI_FORMAT_R1_UNORM) {
+			return 1;
+		}
+		return 32;
+	}
+
+	size_t
+	textureBytes(const D3D11_TEXTURE2D_DESC& desc) {
+		UINT levels = desc.MipLevels;
+		if (levels == 0) {
+			// 0 pide la cadena completa
+			levels = 1;
+			for (UINT size = std::max(desc.Width, desc.Height); size > 1; size >>= 1) {
+				++levels;
+			}
+		}
+		const size_t block = blockBytes(desc.Format);
+		const size_t bits = bitsPerTexel(desc.Format);
+		size_t bytes = 0;
+		for (UINT level = 0; level < levels; ++level) {
+			const size_t width = std::max(1u, desc.Width >> level);
+			const size_t height = std::max(1u, desc.Height >> level);
+			bytes += block ? ((width + 3) / 4) * ((height + 3) / 4) * block
+				: (width * height * bits + 7) / 8;
+		}
+		return bytes * std::max(1u, desc.ArraySize) * std::max(1u, desc.SampleDesc.Count);
+	}
+
+	MemoryCategory
+	textureCategory(UINT bindFlags) {
+		if (bindFlags & D3D11_BIND_DEPTH_STENCIL) {
+			return MEMORY_DEPTH_STENCIL;
+		}
+		if (bindFlags & D3D11_BIND_RENDER_TARGET) {
+			return MEMORY_RENDER_TARGET;
+		}
+		return MEMORY_TEXTURE;
+	}
+
+	MemoryCategory
+	bufferCategory(UINT bindFlags) {
+		if (bindFlags & D3D11_BIND_CONSTANT_BUFFER) {
+			return MEMORY_CONSTANT_BUFFER;
+		}
+		if (bindFlags & D3D11_BIND_INDEX_BUFFER) {
+			return MEMORY_INDEX_BUFFER;
+		}
+		if (bindFlags & D3D11_BIND_VERTEX_BUFFER) {
+			return MEMORY_VERTEX_BUFFER;
+		}
+		return MEMORY_OTHER_BUFFER;
+	}
+
+	// Registra la memoria del recurso y le entrega el token que la olvida
+	void
+	trackResource(const std::shared_ptr<GpuMemoryTracker>& tracker,
+		ID3D11DeviceChild* resource,
+		size_t bytes,
+		MemoryCategory category) {
+		if (!tracker || !resource) {
+			return;
+		}
+		const std::string& owner = GpuMemoryTracker::currentOwner();
+		const uint64_t allocationId = tracker->track(bytes, category, owner.empty() ? "unowned" : owner);
+		TrackedAllocation* token = new TrackedAllocation(tracker, allocationId);
+		if (FAILED(resource->SetPrivateDataInterface(kTrackedAllocationGuid, token))) {
+			tracker->release(allocationId);
+		}
+		token->Release();
+	}
+}
+
 void
 Device::destroy() {
 	SAFE_RELEASE(m_device);
@@ -51,6 +214,7 @@ Device::CreateTexture2D(const D3D11_TEXTURE2D_DESC* pDesc,
 	HRESULT hr = m_device->CreateTexture2D(pDesc, pInitialData, ppTexture2D);
 
 	if (SUCCEEDED(hr)) {
+		trackResource(m_memoryTracker, *ppTexture2D, textureBytes(*pDesc), textureCategory(pDesc->BindFlags));
 		MESSAGE("Device", "CreateTexture2D",
 			"Texture2D created successfully!");
 	}
@@ -62,6 +226,17 @@ Device::CreateTexture2D(const D3D11_TEXTURE2D_DESC* pDesc,
 	return hr;
 }
 
+void
+Device::TrackTexture2D(ID3D11Texture2D* texture) {
+	if (!texture) {
+		ERROR("Device", "TrackTexture2D", "texture is nullptr");
+		return;
+	}
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	trackResource(m_memoryTracker, texture, textureBytes(desc), textureCategory(desc.BindFlags));
+}
+
 HRESULT
 Device::CreateDepthStencilView(ID3D11Resource* pResource,
 	const D3D11_DEPTH_STENCIL_VIEW_DESC* pDesc,
@@ -238,6 +413,7 @@ Device::CreateBuffer(const D3D11_BUFFER_DESC* pDesc,
 	HRESULT hr = m_device->CreateBuffer(pDesc, pInitialData, ppBuffer);
 
 	if (SUCCEEDED(hr)) {
+		trackResource(m_memoryTracker, *ppBuffer, pDesc->ByteWidth, bufferCategory(pDesc->BindFlags));
 		MESSAGE("Device", "CreateBuffer",
 			"Buffer created successfully!");
 	}
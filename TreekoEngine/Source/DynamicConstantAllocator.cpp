@@ -0,0 +1,248 @@
+#include "DynamicConstantAllocator.h"
+#include "Buffer.h"
+#include "Device.h"
+#include "DeviceContext.h"
+#include "GpuMemoryTracker.h"
+#include <cstring>
+#include <thread>
+
+// d3d11_1.h is not part of the June 2010 SDK. These are the slots of
+// ID3D11DeviceContext1 up to PSSetConstantBuffers1, in vtable order, and
+// D3D11_FEATURE_DATA_D3D11_OPTIONS; the 11.1 runtime answers both.
+struct
+  DynamicConstantAllocator::DeviceContext1 : public ID3D11DeviceContext {
+  virtual void STDMETHODCALLTYPE
+    CopySubresourceRegion1(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*, UINT) = 0;
+  virtual void STDMETHODCALLTYPE
+    UpdateSubresource1(ID3D11Resource*, UINT, const D3D11_BOX*, const void*, UINT, UINT, UINT) = 0;
+  virtual void STDMETHODCALLTYPE
+    DiscardResource(ID3D11Resource*) = 0;
+  virtual void STDMETHODCALLTYPE
+    DiscardView(ID3D11View*) = 0;
+  virtual void STDMETHODCALLTYPE
+    VSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers,
+      const UINT* pFirstConstant, const UINT* pNumConstants) = 0;
+  virtual void STDMETHODCALLTYPE
+    HSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) = 0;
+  virtual void STDMETHODCALLTYPE
+    DSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) = 0;
+  virtual void STDMETHODCALLTYPE
+    GSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) = 0;
+  virtual void STDMETHODCALLTYPE
+    PSSetConstantBuffers1(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers,
+      const UINT* pFirstConstant, const UINT* pNumConstants) = 0;
+};
+
+namespace {
+  const IID kIIDDeviceContext1 =
+    { 0xbb2c6faa, 0xb5fb, 0x4082, { 0x8e, 0x6b, 0x38, 0x8b, 0x8c, 0xfa, 0x90, 0xe1 } };
+
+  const D3D11_FEATURE kFeatureD3D11Options = static_cast<D3D11_FEATURE>(5);
+
+  struct FeatureDataD3D11Options {
+    BOOL OutputMergerLogicOp;
+    BOOL UAVOnlyRenderingForcedSampleCount;
+    BOOL DiscardAPIsSeenByDriver;
+    BOOL FlagsForUpdateAndCopySeenByDriver;
+    BOOL ClearView;
+    BOOL CopyWithOverlap;
+    BOOL ConstantBufferPartialUpdate;
+    BOOL ConstantBufferOffsetting;
+    BOOL MapNoOverwriteOnDynamicConstantBuffer;
+    BOOL MapNoOverwriteOnDynamicBufferSRV;
+    BOOL MultisampleRTVWithForcedSampleCountOne;
+    BOOL SAD4ShaderInstructions;
+    BOOL ExtendedDoublesShaderInstructions;
+    BOOL ExtendedResourceSharing;
+  };
+
+  // A constant buffer binding holds at most 4096 constants
+  const unsigned int kMaxRangeBytes = 4096 * 16;
+}
+
+HRESULT
+DynamicConstantAllocator::init(Device& device, DeviceContext& deviceContext, unsigned int capacity) {
+  if (!device.m_device || !deviceContext.m_deviceContext) {
+    ERROR("DynamicConstantAllocator", "init", "Device or DeviceContext is null.");
+    return E_POINTER;
+  }
+  if (capacity < kAlignment) {
+    ERROR("DynamicConstantAllocator", "init", "Capacity is too small.");
+    return E_INVALIDARG;
+  }
+  destroy();
+
+  // An 11.0 runtime rejects the query; that only means no ring
+  FeatureDataD3D11Options options = {};
+  if (FAILED(device.m_device->CheckFeatureSupport(kFeatureD3D11Options, &options, sizeof(options))) ||
+    !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer) {
+    MESSAGE("DynamicConstantAllocator", "init", "No constant buffer offsetting; using WRITE_DISCARD per draw.");
+    return S_OK;
+  }
+  void* context1 = nullptr;
+  if (FAILED(deviceContext.m_deviceContext->QueryInterface(kIIDDeviceContext1, &context1))) {
+    MESSAGE("DynamicConstantAllocator", "init", "No ID3D11DeviceContext1; using WRITE_DISCARD per draw.");
+    return S_OK;
+  }
+  m_context1 = static_cast<DeviceContext1*>(context1);
+
+  D3D11_BUFFER_DESC desc = {};
+  desc.Usage = D3D11_USAGE_DYNAMIC;
+  desc.ByteWidth = capacity / kAlignment * kAlignment;
+  desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+  desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  HRESULT hr = S_OK;
+  {
+    GpuMemoryTracker::OwnerScope owner("DynamicConstantAllocator");
+    hr = device.CreateBuffer(&desc, nullptr, &m_buffer);
+  }
+  if (FAILED(hr)) {
+    ERROR("DynamicConstantAllocator", "init",
+      ("Failed to create the ring buffer. HRESULT: " + std::to_string(hr)).c_str());
+    destroy();
+    return hr;
+  }
+
+  D3D11_QUERY_DESC queryDesc = {};
+  queryDesc.Query = D3D11_QUERY_EVENT;
+  for (unsigned int i = 0; i < kMaxFramesInFlight; ++i) {
+    hr = device.m_device->CreateQuery(&queryDesc, &m_fences[i]);
+    if (FAILED(hr)) {
+      ERROR("DynamicConstantAllocator", "init",
+        ("Failed to create a fence query. HRESULT: " + std::to_string(hr)).c_str());
+      destroy();
+      return hr;
+    }
+  }
+
+  m_ring.reset(desc.ByteWidth, kAlignment);
+  m_discardNext = true;
+  return S_OK;
+}
+
+void
+DynamicConstantAllocator::beginFrame(DeviceContext& deviceContext) {
+  if (!m_buffer) {
+    return;
+  }
+  // Queries complete in order, so stop at the first one still pending
+  while (m_pendingFences > 0 &&
+    deviceContext.m_deviceContext->GetData(m_fences[m_oldestFence], nullptr, 0,
+      D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK) {
+    m_ring.retire(m_fenceFrames[m_oldestFence]);
+    m_oldestFence = (m_oldestFence + 1) % kMaxFramesInFlight;
+    --m_pendingFences;
+  }
+}
+
+DynamicConstantAllocator::ConstantRange
+DynamicConstantAllocator::update(DeviceContext& deviceContext,
+  Buffer& constantBuffer,
+  const void* data,
+  unsigned int size) {
+  ConstantRange range;
+  RingAllocator::Allocation allocation;
+  // Offset binding counts whole blocks of 16 constants
+  const unsigned int rangeBytes = (size + kAlignment - 1) / kAlignment * kAlignment;
+  if (!m_buffer || rangeBytes > kMaxRangeBytes || !m_ring.allocate(rangeBytes, allocation) ||
+    !map(deviceContext)) {
+    constantBuffer.update(deviceContext, nullptr, 0, nullptr, data, 0, 0);
+    return range;
+  }
+  memcpy(m_mapped + allocation.offset, data, size);
+  range.firstConstant = static_cast<unsigned int>(allocation.offset / 16);
+  range.numConstants = rangeBytes / 16;
+  range.inRing = true;
+  return range;
+}
+
+void
+DynamicConstantAllocator::bind(DeviceContext& deviceContext,
+  Buffer& constantBuffer,
+  const ConstantRange& range,
+  unsigned int slot,
+  bool setPixelShader) {
+  if (!range.inRing) {
+    constantBuffer.render(deviceContext, slot, 1, setPixelShader);
+    return;
+  }
+  // The GPU reads the ring only once it is unmapped
+  unmap(deviceContext);
+
+  // Some 11.1 runtimes skip a rebind of the bound buffer when only the
+  // offset changes, so unbind the slot first
+  ID3D11Buffer* none = nullptr;
+  m_context1->VSSetConstantBuffers(slot, 1, &none);
+  m_context1->VSSetConstantBuffers1(slot, 1, &m_buffer, &range.firstConstant, &range.numConstants);
+  if (setPixelShader) {
+    m_context1->PSSetConstantBuffers(slot, 1, &none);
+    m_context1->PSSetConstantBuffers1(slot, 1, &m_buffer, &range.firstConstant, &range.numConstants);
+  }
+}
+
+void
+DynamicConstantAllocator::endFrame(DeviceContext& deviceContext) {
+  if (!m_buffer) {
+    return;
+  }
+  unmap(deviceContext);
+
+  // Every query busy: the GPU is kMaxFramesInFlight frames behind, wait for the oldest
+  if (m_pendingFences == kMaxFramesInFlight) {
+    while (deviceContext.m_deviceContext->GetData(m_fences[m_oldestFence], nullptr, 0, 0) == S_FALSE) {
+      std::this_thread::yield();
+    }
+    m_ring.retire(m_fenceFrames[m_oldestFence]);
+    m_oldestFence = (m_oldestFence + 1) % kMaxFramesInFlight;
+    --m_pendingFences;
+  }
+
+  const unsigned int slot = (m_oldestFence + m_pendingFences) % kMaxFramesInFlight;
+  m_fenceFrames[slot] = ++m_frame;
+  deviceContext.m_deviceContext->End(m_fences[slot]);
+  ++m_pendingFences;
+  m_ring.endFrame(m_frame);
+}
+
+bool
+DynamicConstantAllocator::map(DeviceContext& deviceContext) {
+  if (m_mapped) {
+    return true;
+  }
+  // Ranges in flight are never handed out again, so only the first Map discards
+  D3D11_MAPPED_SUBRESOURCE mapped = {};
+  HRESULT hr = deviceContext.m_deviceContext->Map(m_buffer,
+    0,
+    m_discardNext ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+    0,
+    &mapped);
+  if (FAILED(hr)) {
+    ERROR("DynamicConstantAllocator", "map",
+      ("Failed to map the ring buffer. HRESULT: " + std::to_string(hr)).c_str());
+    return false;
+  }
+  m_mapped = static_cast<char*>(mapped.pData);
+  m_discardNext = false;
+  return true;
+}
+
+void
+DynamicConstantAllocator::unmap(DeviceContext& deviceContext) {
+  if (m_mapped) {
+    deviceContext.m_deviceContext->Unmap(m_buffer, 0);
+    m_mapped = nullptr;
+  }
+}
+
+void
+DynamicConstantAllocator::destroy() {
+  SAFE_RELEASE(m_buffer);
+  SAFE_RELEASE(m_context1);
+  for (unsigned int i = 0; i < kMaxFramesInFlight; ++i) {
+    SAFE_RELEASE(m_fences[i]);
+  }
+  m_mapped = nullptr;
+  m_oldestFence = 0;
+  m_pendingFences = 0;
+  m_ring.reset(0, kAlignment);
+}
@@ -0,0 +1,298 @@
+#include "FileWatcher.h"
+#include <filesystem>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  std::string
+  normalizeDirectory(const std::string& directory) {
+    if (directory.empty()) {
+      return ".";
+    }
+    std::string normalized = std::filesystem::path(directory).lexically_normal().string();
+    // "dir/" normalizes to "dir/", which would not match "dir"
+    while (normalized.size() > 1 && (normalized.back() == '/' || normalized.back() == '\\')) {
+      normalized.pop_back();
+    }
+    return normalized;
+  }
+}
+
+FileWatcher::FileWatcher(unsigned int settleMs)
+  : m_settle(std::chrono::milliseconds(settleMs)) {}
+
+FileWatcher::~FileWatcher() {
+  stop();
+}
+
+// Called with m_mutex held
+bool
+FileWatcher::start() {
+  if (m_thread.joinable()) {
+    return true;
+  }
+#ifdef _WIN32
+  m_wakeEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  if (!m_wakeEvent) {
+    return false;
+  }
+#else
+  m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotify < 0) {
+    return false;
+  }
+  if (pipe2(m_wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+    close(m_inotify);
+    m_inotify = -1;
+    return false;
+  }
+#endif
+  m_stopping = false;
+  m_thread = std::thread(&FileWatcher::watchLoop, this);
+  return true;
+}
+
+void
+FileWatcher::stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+#ifdef _WIN32
+  SetEvent(m_wakeEvent);
+  m_thread.join();
+  CloseHandle(m_wakeEvent);
+  m_wakeEvent = nullptr;
+  // Directories added after the thread last woke were never picked up
+  for (auto& added : m_addedDirectories) {
+    CloseHandle(added.second);
+  }
+  m_addedDirectories.clear();
+#else
+  const char wake = 1;
+  (void)write(m_wakePipe[1], &wake, 1);
+  m_thread.join();
+  close(m_inotify);
+  close(m_wakePipe[0]);
+  close(m_wakePipe[1]);
+  m_inotify = -1;
+  m_wakePipe[0] = m_wakePipe[1] = -1;
+  m_watches.clear();
+#endif
+  m_directories.clear();
+}
+
+bool
+FileWatcher::isRunning() const {
+  return m_thread.joinable();
+}
+
+bool
+FileWatcher::watchDirectory(const std::string& directory) {
+  const std::string normalized = normalizeDirectory(directory);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const std::string& watched : m_directories) {
+    if (watched == normalized) {
+      return true;
+    }
+  }
+  if (!start()) {
+    return false;
+  }
+
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(normalized.c_str(),
+    FILE_LIST_DIRECTORY,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+    nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  m_addedDirectories.emplace_back(normalized, handle);
+  SetEvent(m_wakeEvent);
+#else
+  // Saving through a temporary file shows up as IN_MOVED_TO
+  const int watch = inotify_add_watch(m_inotify, normalized.c_str(),
+    IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO);
+  if (watch < 0) {
+    return false;
+  }
+  m_watches[watch] = normalized;
+#endif
+  m_directories.push_back(normalized);
+  return true;
+}
+
+void
+FileWatcher::recordChange(const std::string& directory, const std::string& fileName) {
+  const std::string path = (std::filesystem::path(directory) / fileName).lexically_normal().string();
+  const Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pending[path] = now;
+}
+
+void
+FileWatcher::poll(std::vector<std::string>& outChanged) {
+  const Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto pending = m_pending.begin(); pending != m_pending.end();) {
+    if (now - pending->second >= m_settle) {
+      outChanged.push_back(pending->first);
+      pending = m_pending.erase(pending);
+    }
+    else {
+      ++pending;
+    }
+  }
+}
+
+#ifdef _WIN32
+void
+FileWatcher::watchLoop() {
+  struct Watch {
+    std::string directory;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped = {};
+    DWORD buffer[4096];
+  };
+  std::vector<std::unique_ptr<Watch>> watches;
+
+  auto arm = [](Watch& watch) {
+    ResetEvent(watch.overlapped.hEvent);
+    return ReadDirectoryChangesW(watch.handle,
+      watch.buffer,
+      sizeof(watch.buffer),
+      FALSE,
+      FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+      nullptr,
+      &watch.overlapped,
+      nullptr) != FALSE;
+  };
+
+  std::vector<HANDLE> events;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopping) {
+        break;
+      }
+      ResetEvent(m_wakeEvent);
+      for (auto& added : m_addedDirectories) {
+        std::unique_ptr<Watch> watch(new Watch());
+        watch->directory = added.first;
+        watch->handle = added.second;
+        watch->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        // WaitForMultipleObjects takes the wake event and 63 directories
+        if (!watch->overlapped.hEvent || watches.size() + 1 >= MAXIMUM_WAIT_OBJECTS || !arm(*watch)) {
+          if (watch->overlapped.hEvent) {
+            CloseHandle(watch->overlapped.hEvent);
+          }
+          CloseHandle(watch->handle);
+          continue;
+        }
+        watches.push_back(std::move(watch));
+      }
+      m_addedDirectories.clear();
+    }
+
+    events.clear();
+    events.push_back(m_wakeEvent);
+    for (auto& watch : watches) {
+      events.push_back(watch->overlapped.hEvent);
+    }
+    const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, INFINITE);
+    if (result == WAIT_OBJECT_0) {
+      continue;
+    }
+    const DWORD index = result - WAIT_OBJECT_0 - 1;
+    if (result == WAIT_FAILED || index >= watches.size()) {
+      break;
+    }
+
+    Watch& watch = *watches[index];
+    DWORD bytes = 0;
+    // Zero bytes means the buffer overflowed and the changes were dropped
+    if (GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, FALSE) && bytes > 0) {
+      const char* entry = reinterpret_cast<const char*>(watch.buffer);
+      while (true) {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+        if (info->Action == FILE_ACTION_ADDED ||
+          info->Action == FILE_ACTION_MODIFIED ||
+          info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+          const int wideLength = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+          const int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, nullptr, 0, nullptr, nullptr);
+          if (length > 0) {
+            std::string fileName(static_cast<size_t>(length), '\0');
+            WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, &fileName[0], length, nullptr, nullptr);
+            recordChange(watch.directory, fileName);
+          }
+        }
+        if (info->NextEntryOffset == 0) {
+          break;
+        }
+        entry += info->NextEntryOffset;
+      }
+    }
+    arm(watch);
+  }
+
+  for (auto& watch : watches) {
+    CancelIo(watch->handle);
+    CloseHandle(watch->handle);
+    CloseHandle(watch->overlapped.hEvent);
+  }
+}
+#else
+void
+FileWatcher::watchLoop() {
+  alignas(inotify_event) char buffer[16384];
+  while (true) {
+    pollfd descriptors[2] = { { m_inotify, POLLIN, 0 }, { m_wakePipe[0], POLLIN, 0 } };
+    if (::poll(descriptors, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (descriptors[1].revents != 0) {
+      break;
+    }
+
+    ssize_t length = 0;
+    while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+      for (const char* entry = buffer; entry < buffer + length;) {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(entry);
+        if (event->len > 0 && (event->mask & IN_ISDIR) == 0) {
+          std::string directory;
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto watch = m_watches.find(event->wd);
+            if (watch != m_watches.end()) {
+              directory = watch->second;
+            }
+          }
+          if (!directory.empty()) {
+            recordChange(directory, event->name);
+          }
+        }
+        entry += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+}
+#endif
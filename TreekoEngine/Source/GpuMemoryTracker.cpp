@@ -0,0 +1,268 @@
+#include "GpuMemoryTracker.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+  thread_local std::string t_currentOwner;
+
+  void
+  writeJsonString(std::ostream& stream, const std::string& text) {
+    static const char kHex[] = "0123456789abcdef";
+    stream << '"';
+    for (char c : text) {
+      switch (c) {
+      case '"': stream << "\\\""; break;
+      case '\\': stream << "\\\\"; break;
+      case '\n': stream << "\\n"; break;
+      case '\r': stream << "\\r"; break;
+      case '\t': stream << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          stream << "\\u00" << kHex[(c >> 4) & 0xF] << kHex[c & 0xF];
+        }
+        else {
+          stream << c;
+        }
+      }
+    }
+    stream << '"';
+  }
+}
+
+GpuMemoryTracker::OwnerScope::OwnerScope(const std::string& owner)
+  : m_previous(t_currentOwner) {
+  t_currentOwner = owner;
+}
+
+GpuMemoryTracker::OwnerScope::~OwnerScope() {
+  t_currentOwner = m_previous;
+}
+
+const std::string&
+GpuMemoryTracker::currentOwner() {
+  return t_currentOwner;
+}
+
+const char*
+GpuMemoryTracker::categoryName(MemoryCategory category) {
+  switch (category) {
+  case MEMORY_TEXTURE: return "texture";
+  case MEMORY_RENDER_TARGET: return "renderTarget";
+  case MEMORY_DEPTH_STENCIL: return "depthStencil";
+  case MEMORY_VERTEX_BUFFER: return "vertexBuffer";
+  case MEMORY_INDEX_BUFFER: return "indexBuffer";
+  case MEMORY_CONSTANT_BUFFER: return "constantBuffer";
+  case MEMORY_OTHER_BUFFER: return "otherBuffer";
+  default: return "unknown";
+  }
+}
+
+uint64_t
+GpuMemoryTracker::track(size_t bytes, MemoryCategory category, const std::string& owner) {
+  if (category < 0 || category >= MEMORY_CATEGORY_COUNT) {
+    category = MEMORY_OTHER_BUFFER;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const uint64_t id = m_nextId++;
+  m_allocations.emplace(id, Allocation{ bytes, category, owner });
+  m_totals.bytes[category] += bytes;
+  m_totals.allocations[category] += 1;
+  m_totals.totalBytes += bytes;
+
+  Owner& entry = m_owners[owner];
+  entry.bytes += bytes;
+  entry.allocations += 1;
+  entry.lastUsedFrame = m_frame;
+  return id;
+}
+
+void
+GpuMemoryTracker::release(uint64_t allocationId) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_allocations.find(allocationId);
+  if (it == m_allocations.end()) {
+    return;
+  }
+  const Allocation& allocation = it->second;
+  m_totals.bytes[allocation.category] -= allocation.bytes;
+  m_totals.allocations[allocation.category] -= 1;
+  m_totals.totalBytes -= allocation.bytes;
+
+  auto owner = m_owners.find(allocation.owner);
+  if (owner != m_owners.end()) {
+    owner->second.bytes -= allocation.bytes;
+    owner->second.allocations -= 1;
+    // Keep owners with a callback so they stay evictable after a reload
+    if (owner->second.allocations == 0 && !owner->second.evict) {
+      m_owners.erase(owner);
+    }
+  }
+  m_allocations.erase(it);
+}
+
+void
+GpuMemoryTracker::beginFrame() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_frame;
+}
+
+void
+GpuMemoryTracker::touch(const std::string& owner) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_owners.find(owner);
+  if (it != m_owners.end()) {
+    it->second.lastUsedFrame = m_frame;
+  }
+}
+
+void
+GpuMemoryTracker::setEvictable(const std::string& owner, EvictCallback evict) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Owner& entry = m_owners[owner];
+  entry.evict = std::move(evict);
+  entry.lastUsedFrame = m_frame;
+}
+
+void
+GpuMemoryTracker::clearEvictable(const std::string& owner) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_owners.find(owner);
+  if (it == m_owners.end()) {
+    return;
+  }
+  it->second.evict = nullptr;
+  if (it->second.allocations == 0) {
+    m_owners.erase(it);
+  }
+}
+
+void
+GpuMemoryTracker::setBudget(size_t budget) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_budget = budget;
+}
+
+size_t
+GpuMemoryTracker::enforceBudget() {
+  struct Candidate {
+    std::string name;
+    uint64_t lastUsedFrame;
+    EvictCallback evict;
+  };
+  std::vector<Candidate> candidates;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_budget == 0 || m_totals.totalBytes <= m_budget) {
+      return 0;
+    }
+    for (const auto& owner : m_owners) {
+      if (owner.second.evict && owner.second.bytes > 0 && owner.second.lastUsedFrame < m_frame) {
+        candidates.push_back({ owner.first, owner.second.lastUsedFrame, owner.second.evict });
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+    return a.lastUsedFrame < b.lastUsedFrame;
+  });
+
+  // The callbacks release resources, which calls back into release, so they
+  // run without the lock
+  size_t released = 0;
+  for (const Candidate& candidate : candidates) {
+    size_t before = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_totals.totalBytes <= m_budget) {
+        break;
+      }
+      before = m_totals.totalBytes;
+    }
+    if (!candidate.evict()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t freed = before > m_totals.totalBytes ? before - m_totals.totalBytes : 0;
+    released += freed;
+    m_evictedBytes += freed;
+    ++m_evictions;
+  }
+  return released;
+}
+
+GpuMemoryTracker::CategoryTotals
+GpuMemoryTracker::getCategoryTotals() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_totals;
+}
+
+std::vector<GpuMemoryTracker::OwnerReport>
+GpuMemoryTracker::getOwnerReport() const {
+  std::vector<OwnerReport> report;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    report.reserve(m_owners.size());
+    for (const auto& owner : m_owners) {
+      OwnerReport entry;
+      entry.name = owner.first;
+      entry.bytes = owner.second.bytes;
+      entry.allocations = owner.second.allocations;
+      entry.lastUsedFrame = owner.second.lastUsedFrame;
+      entry.evictable = static_cast<bool>(owner.second.evict);
+      report.push_back(entry);
+    }
+  }
+  std::sort(report.begin(), report.end(), [](const OwnerReport& a, const OwnerReport& b) {
+    return a.bytes != b.bytes ? a.bytes > b.bytes : a.name < b.name;
+  });
+  return report;
+}
+
+void
+GpuMemoryTracker::writeJson(std::ostream& stream) const {
+  CategoryTotals totals;
+  size_t budget = 0;
+  size_t evictions = 0;
+  size_t evictedBytes = 0;
+  uint64_t frame = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    totals = m_totals;
+    budget = m_budget;
+    evictions = m_evictions;
+    evictedBytes = m_evictedBytes;
+    frame = m_frame;
+  }
+  const std::vector<OwnerReport> owners = getOwnerReport();
+
+  stream << "{\n  \"frame\": " << frame
+    << ",\n  \"totalBytes\": " << totals.totalBytes
+    << ",\n  \"budgetBytes\": " << budget
+    << ",\n  \"evictions\": " << evictions
+    << ",\n  \"evictedBytes\": " << evictedBytes
+    << ",\n  \"categories\": {";
+  for (int i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+    stream << (i ? "," : "") << "\n    \"" << categoryName(static_cast<MemoryCategory>(i))
+      << "\": { \"bytes\": " << totals.bytes[i]
+      << ", \"allocations\": " << totals.allocations[i] << " }";
+  }
+  stream << "\n  },\n  \"owners\": [";
+  for (size_t i = 0; i < owners.size(); ++i) {
+    stream << (i ? "," : "") << "\n    { \"name\": ";
+    writeJsonString(stream, owners[i].name);
+    stream << ", \"bytes\": " << owners[i].bytes
+      << ", \"allocations\": " << owners[i].allocations
+      << ", \"lastUsedFrame\": " << owners[i].lastUsedFrame
+      << ", \"evictable\": " << (owners[i].evictable ? "true" : "false") << " }";
+  }
+  stream << (owners.empty() ? "]" : "\n  ]") << "\n}\n";
+}
+
+bool
+GpuMemoryTracker::dumpJson(const std::string& fileName) const {
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  writeJson(file);
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,49 @@
+#include "GpuStreamingDevice.h"
+#include "Device.h"
+#include "Texture.h"
+
+void
+GpuStreamingDevice::bindTexture(unsigned int textureId, Texture& texture) {
+  if (textureId == TextureStreamer::kInvalidTexture) {
+    return;
+  }
+  if (textureId >= m_textures.size()) {
+    m_textures.resize(textureId + 1, nullptr);
+  }
+  m_textures[textureId] = &texture;
+}
+
+bool
+GpuStreamingDevice::setResidentLevels(unsigned int textureId,
+  uint32_t dxgiFormat,
+  const TextureCache::CacheLevel* levels,
+  unsigned int levelCount) {
+  if (textureId >= m_textures.size() || !m_textures[textureId]) {
+    ERROR("GpuStreamingDevice", "setResidentLevels", "Texture id is not bound.");
+    return false;
+  }
+  Texture& texture = *m_textures[textureId];
+
+  TextureDecoder::TextureData data;
+  data.dxgiFormat = dxgiFormat;
+  data.levels.assign(levels, levels + levelCount);
+  Texture streamed;
+  HRESULT hr = streamed.init(m_device, texture.m_textureName, data);
+  if (FAILED(hr)) {
+    ERROR("GpuStreamingDevice", "setResidentLevels",
+      ("Failed to stream " + texture.m_textureName + ". HRESULT: " + std::to_string(hr)).c_str());
+    return false;
+  }
+
+  texture.destroy();
+  texture.m_textureFromImg = streamed.m_textureFromImg;
+  texture.m_textureName = streamed.m_textureName;
+  return true;
+}
+
+void
+GpuStreamingDevice::releaseTexture(unsigned int textureId) {
+  if (textureId < m_textures.size() && m_textures[textureId]) {
+    m_textures[textureId]->destroy();
+  }
+}
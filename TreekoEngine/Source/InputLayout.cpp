@@ -30,6 +30,19 @@ InputLayout::init(Device& device,
 	return S_OK;
 }
 
+std::vector<D3D11_INPUT_ELEMENT_DESC>
+InputLayout::simpleVertexLayout() {
+	return SimpleVertexLayout::toVector();
+}
+
+std::vector<D3D11_INPUT_ELEMENT_DESC>
+InputLayout::packedVertexLayout(const PackedVertexParams& params) {
+	if (params.texCoordFormat == DXGI_FORMAT_R16G16_FLOAT) {
+		return PackedVertexHalfLayout::toVector();
+	}
+	return PackedVertexLayout::toVector();
+}
+
 void
 InputLayout::update() {
 	// M�todo vac�o, se puede utilizar en caso de necesitar cambios din�micos en el layout
@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool
+MappedFile::open(const std::string& fileName) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName.c_str(),
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_size = static_cast<size_t>(fileSize.QuadPart);
+  m_isOpen = true;
+
+  // CreateFileMapping rejects zero-length files, so empty files stay unmapped
+  if (m_size == 0) {
+    return true;
+  }
+
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!m_mapping) {
+    close();
+    return false;
+  }
+
+  m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!m_data) {
+    close();
+    return false;
+  }
+#else
+  m_fd = ::open(fileName.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    return false;
+  }
+
+  struct stat fileInfo;
+  if (fstat(m_fd, &fileInfo) != 0) {
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_size = static_cast<size_t>(fileInfo.st_size);
+  m_isOpen = true;
+
+  if (m_size == 0) {
+    return true;
+  }
+
+  void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (view == MAP_FAILED) {
+    close();
+    return false;
+  }
+  // The parsers walk the file front to back exactly once
+  madvise(view, m_size, MADV_SEQUENTIAL);
+  m_data = static_cast<const char*>(view);
+#endif
+
+  return true;
+}
+
+void
+MappedFile::close() {
+#ifdef _WIN32
+  if (m_data) {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file) {
+    CloseHandle(m_file);
+  }
+  m_mapping = nullptr;
+  m_file = nullptr;
+#else
+  if (m_data) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+  m_fd = -1;
+#endif
+
+  m_data = nullptr;
+  m_size = 0;
+  m_isOpen = false;
+}
@@ -0,0 +1,138 @@
+#include "MaterialLibrary.h"
+#include "MappedFile.h"
+#include "ObjTokenizer.h"
+#include <filesystem>
+#include <string_view>
+
+namespace {
+  // Remainder of the line, since names and paths may contain spaces
+  std::string
+  restOfLine(ObjTokenizer& tokenizer) {
+    const char* begin;
+    const char* end;
+    return tokenizer.restOfLine(begin, end) ? std::string(begin, end) : std::string();
+  }
+
+  // Number of arguments taken by a texture map option, e.g. "-s u v w"
+  unsigned int
+  optionArguments(std::string_view option) {
+    if (option == "-o" || option == "-s" || option == "-t") {
+      return 3;
+    }
+    if (option == "-mm") {
+      return 2;
+    }
+    return 1;
+  }
+
+  // Skips the options of a map statement; whatever follows them is the file name
+  std::string
+  textureFileName(const std::string& arguments) {
+    const char* cursor = arguments.data();
+    const char* end = cursor + arguments.size();
+    ObjTokenizer tokenizer(cursor, end);
+    tokenizer.nextLine();
+    const char* tokenBegin;
+    const char* tokenEnd;
+
+    for (;;) {
+      const char* tokenStart = tokenizer.lineCursor();
+      if (!tokenizer.nextToken(tokenBegin, tokenEnd) || *tokenBegin != '-') {
+        cursor = tokenStart;
+        break;
+      }
+      unsigned int count = optionArguments(std::string_view(tokenBegin, tokenEnd - tokenBegin));
+      for (unsigned int i = 0; i < count; ++i) {
+        const char* argumentStart = tokenizer.lineCursor();
+        if (!tokenizer.nextToken(tokenBegin, tokenEnd)) {
+          break;
+        }
+        // -o, -s and -t take one to three numbers
+        float value;
+        if (count == 3 && i > 0 &&
+          (!ObjTokenizer::parseFloat(tokenBegin, tokenEnd, value) || tokenBegin != tokenEnd)) {
+          tokenizer = ObjTokenizer(argumentStart, end);
+          tokenizer.nextLine();
+          break;
+        }
+      }
+    }
+
+    while (cursor < end && ObjTokenizer::isSpace(*cursor)) {
+      ++cursor;
+    }
+    return std::string(cursor, end);
+  }
+}
+
+bool
+MaterialLibrary::load(const std::string& fileName) {
+  MappedFile file;
+  if (!file.open(fileName)) {
+    return false;
+  }
+
+  const std::filesystem::path directory = std::filesystem::path(fileName).parent_path();
+  ObjTokenizer tokenizer(file.data(), file.data() + file.size());
+  const char* tokenBegin;
+  const char* tokenEnd;
+  Material* current = nullptr;
+
+  while (tokenizer.nextLine()) {
+    if (!tokenizer.nextToken(tokenBegin, tokenEnd)) {
+      continue;
+    }
+    std::string_view lineHeader(tokenBegin, tokenEnd - tokenBegin);
+
+    if (lineHeader == "newmtl") {
+      std::string name = restOfLine(tokenizer);
+      const Material* existing = findMaterial(name);
+      if (existing) {
+        current = &m_materials[existing - m_materials.data()];
+        *current = Material();
+      }
+      else {
+        m_materials.emplace_back();
+        current = &m_materials.back();
+      }
+      current->name = name;
+    }
+    else if (!current) {
+      continue;
+    }
+    else if (lineHeader == "Kd") {
+      // "Kd spectral" and "Kd xyz" forms are not supported and keep the default
+      XMFLOAT3 color;
+      if (tokenizer.readFloat(color.x) && tokenizer.readFloat(color.y) && tokenizer.readFloat(color.z)) {
+        current->diffuse = XMFLOAT4(color.x, color.y, color.z, current->diffuse.w);
+      }
+    }
+    else if (lineHeader == "d") {
+      float opacity = 1.0f;
+      if (tokenizer.readFloat(opacity)) {
+        current->diffuse.w = opacity;
+      }
+    }
+    else if (lineHeader == "Tr") {
+      float transparency = 0.0f;
+      if (tokenizer.readFloat(transparency)) {
+        current->diffuse.w = 1.0f - transparency;
+      }
+    }
+    else if (lineHeader == "map_Kd") {
+      std::string map = textureFileName(restOfLine(tokenizer));
+      current->diffuseMap = map.empty() ? std::string() : (directory / map).string();
+    }
+  }
+  return true;
+}
+
+const Material*
+MaterialLibrary::findMaterial(const std::string& name) const {
+  for (const Material& material : m_materials) {
+    if (material.name == name) {
+      return &material;
+    }
+  }
+  return nullptr;
+}
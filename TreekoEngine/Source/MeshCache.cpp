@@ -0,0 +1,381 @@
+#include "MeshCache.h"
+#include "HashUtils.h"
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+  // Every section payload starts on a 16-byte boundary of the file
+  uint64_t
+  alignTo16(uint64_t offset) {
+    return (offset + 15) & ~uint64_t(15);
+  }
+}
+
+bool
+MeshCache::open(const std::string& cachePath,
+  const std::string& sourcePath,
+  bool allowMissingSource) {
+  close();
+
+  if (!m_file.open(cachePath)) {
+    return false;
+  }
+  if (m_file.size() < sizeof(TMeshHeader)) {
+    close();
+    return false;
+  }
+
+  const TMeshHeader* header = reinterpret_cast<const TMeshHeader*>(m_file.data());
+  if (header->magic != kMagic ||
+    header->version != kVersion ||
+    header->vertexStride != sizeof(SimpleVertex)) {
+    close();
+    return false;
+  }
+
+  uint64_t directoryEnd = sizeof(TMeshHeader) + uint64_t(header->sectionCount) * sizeof(TMeshSection);
+  if (directoryEnd > m_file.size()) {
+    close();
+    return false;
+  }
+
+  // A cache shipped without its source cannot be checked: only trusted on request
+  uint64_t sourceSize = 0;
+  int64_t sourceTime = 0;
+  if (!getSourceStamp(sourcePath, sourceSize, sourceTime)) {
+    if (!allowMissingSource) {
+      close();
+      return false;
+    }
+    MESSAGE("MeshCache", "open", ("source " + sourcePath + " is missing, trusting " + cachePath).c_str());
+  }
+  else {
+    if (sourceSize != header->sourceSize) {
+      close();
+      return false;
+    }
+    // Touched but possibly unchanged (e.g. a fresh checkout): compare content
+    if (sourceTime != header->sourceTime) {
+      uint64_t sourceHash = 0;
+      if (!hashSource(sourcePath, sourceHash) || sourceHash != header->sourceHash) {
+        close();
+        return false;
+      }
+    }
+  }
+
+  m_header = header;
+  m_vertices = static_cast<const SimpleVertex*>(
+    findSection(SECTION_VERTICES, sizeof(SimpleVertex), m_vertexCount));
+  m_indices = static_cast<const unsigned int*>(
+    findSection(SECTION_INDICES, sizeof(unsigned int), m_indexCount));
+  if (!m_vertices && !m_indices && !decodeSections()) {
+    close();
+    return false;
+  }
+
+  if (!m_vertices || !m_indices || m_vertexCount == 0 || m_indexCount == 0) {
+    close();
+    return false;
+  }
+
+  // The index buffer goes to the GPU as is: an index past the vertex buffer
+  // would read outside it
+  unsigned int maxIndex = 0;
+  for (unsigned int i = 0; i < m_indexCount; ++i) {
+    maxIndex = std::max(maxIndex, m_indices[i]);
+  }
+  if (maxIndex >= m_vertexCount) {
+    close();
+    return false;
+  }
+
+  // Meshlets are optional, but must tile the start of the index section
+  m_meshlets = static_cast<const Meshlet*>(
+    findSection(SECTION_MESHLETS, sizeof(Meshlet), m_meshletCount));
+  uint64_t meshletIndices = 0;
+  for (unsigned int i = 0; i < m_meshletCount; ++i) {
+    if (m_meshlets[i].indexOffset != meshletIndices) {
+      close();
+      return false;
+    }
+    meshletIndices += m_meshlets[i].indexCount;
+  }
+  if (meshletIndices > m_indexCount) {
+    close();
+    return false;
+  }
+
+  // Submeshes are optional, but must lie inside the index section and
+  // reference an existing material
+  m_submeshes = static_cast<const Submesh*>(
+    findSection(SECTION_SUBMESHES, sizeof(Submesh), m_submeshCount));
+  m_materials = static_cast<const TMeshMaterial*>(
+    findSection(SECTION_MATERIALS, sizeof(TMeshMaterial), m_materialCount));
+  for (unsigned int i = 0; i < m_submeshCount; ++i) {
+    if (m_submeshes[i].indexCount % 3 != 0 ||
+      static_cast<uint64_t>(m_submeshes[i].indexOffset) + m_submeshes[i].indexCount > m_indexCount ||
+      m_submeshes[i].materialIndex >= m_materialCount) {
+      close();
+      return false;
+    }
+  }
+
+  // LODs are optional, but every level must lie inside the index section
+  m_lods = static_cast<const MeshLod*>(
+    findSection(SECTION_LODS, sizeof(MeshLod), m_lodCount));
+  for (unsigned int i = 0; i < m_lodCount; ++i) {
+    if (m_lods[i].indexCount % 3 != 0 ||
+      static_cast<uint64_t>(m_lods[i].indexOffset) + m_lods[i].indexCount > m_indexCount) {
+      close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+MeshCache::close() {
+  m_file.close();
+  m_header = nullptr;
+  m_vertices = nullptr;
+  m_indices = nullptr;
+  m_meshlets = nullptr;
+  m_vertexCount = 0;
+  m_indexCount = 0;
+  m_meshletCount = 0;
+  m_lods = nullptr;
+  m_lodCount = 0;
+  m_submeshes = nullptr;
+  m_submeshCount = 0;
+  m_materials = nullptr;
+  m_materialCount = 0;
+  m_decodedVertices.clear();
+  m_decodedVertices.shrink_to_fit();
+  m_decodedIndices.clear();
+  m_decodedIndices.shrink_to_fit();
+}
+
+bool
+MeshCache::write(const std::string& cachePath,
+  const std::string& sourcePath,
+  const MeshComponent& mesh,
+  bool compress) {
+  if (mesh.m_vertex.empty() || mesh.m_index.empty()) {
+    return false;
+  }
+
+  std::vector<unsigned char> encodedVertices;
+  std::vector<unsigned char> encodedIndices;
+  if (compress &&
+    (!MeshCodec::encodeVertices(mesh.m_vertex.data(), mesh.m_vertex.size(), sizeof(SimpleVertex), encodedVertices) ||
+    !MeshCodec::encodeIndices(mesh.m_index.data(), mesh.m_index.size(), encodedIndices))) {
+    return false;
+  }
+
+  std::vector<TMeshMaterial> materials(mesh.m_materials.size());
+  for (size_t i = 0; i < mesh.m_materials.size(); ++i) {
+    const Material& material = mesh.m_materials[i];
+    TMeshMaterial& record = materials[i];
+    record = {};
+    if (material.name.size() >= sizeof(record.name) ||
+      material.diffuseMap.size() >= sizeof(record.diffuseMap)) {
+      return false;
+    }
+    record.diffuse[0] = material.diffuse.x;
+    record.diffuse[1] = material.diffuse.y;
+    record.diffuse[2] = material.diffuse.z;
+    record.diffuse[3] = material.diffuse.w;
+    std::memcpy(record.name, material.name.data(), material.name.size());
+    std::memcpy(record.diffuseMap, material.diffuseMap.data(), material.diffuseMap.size());
+  }
+
+  TMeshHeader header = {};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.vertexStride = sizeof(SimpleVertex);
+  if (!getSourceStamp(sourcePath, header.sourceSize, header.sourceTime) ||
+    !hashSource(sourcePath, header.sourceHash)) {
+    return false;
+  }
+  header.boundsMin[0] = mesh.m_boundsMin.x;
+  header.boundsMin[1] = mesh.m_boundsMin.y;
+  header.boundsMin[2] = mesh.m_boundsMin.z;
+  header.boundsMax[0] = mesh.m_boundsMax.x;
+  header.boundsMax[1] = mesh.m_boundsMax.y;
+  header.boundsMax[2] = mesh.m_boundsMax.z;
+
+  struct SectionPayload {
+    TMeshSection desc;
+    const void* data;
+  };
+  std::vector<SectionPayload> payloads;
+  if (compress) {
+    payloads.push_back({ { SECTION_VERTICES_ENCODED, static_cast<uint32_t>(mesh.m_vertex.size()), 0,
+      encodedVertices.size() }, encodedVertices.data() });
+    payloads.push_back({ { SECTION_INDICES_ENCODED, static_cast<uint32_t>(mesh.m_index.size()), 0,
+      encodedIndices.size() }, encodedIndices.data() });
+  }
+  else {
+    payloads.push_back({ { SECTION_VERTICES, static_cast<uint32_t>(mesh.m_vertex.size()), 0,
+      mesh.m_vertex.size() * sizeof(SimpleVertex) }, mesh.m_vertex.data() });
+    payloads.push_back({ { SECTION_INDICES, static_cast<uint32_t>(mesh.m_index.size()), 0,
+      mesh.m_index.size() * sizeof(unsigned int) }, mesh.m_index.data() });
+  }
+  if (!mesh.m_meshlets.empty()) {
+    payloads.push_back({ { SECTION_MESHLETS, static_cast<uint32_t>(mesh.m_meshlets.size()), 0,
+      mesh.m_meshlets.size() * sizeof(Meshlet) }, mesh.m_meshlets.data() });
+  }
+  if (!mesh.m_lods.empty()) {
+    payloads.push_back({ { SECTION_LODS, static_cast<uint32_t>(mesh.m_lods.size()), 0,
+      mesh.m_lods.size() * sizeof(MeshLod) }, mesh.m_lods.data() });
+  }
+  if (!mesh.m_submeshes.empty()) {
+    payloads.push_back({ { SECTION_SUBMESHES, static_cast<uint32_t>(mesh.m_submeshes.size()), 0,
+      mesh.m_submeshes.size() * sizeof(Submesh) }, mesh.m_submeshes.data() });
+    payloads.push_back({ { SECTION_MATERIALS, static_cast<uint32_t>(materials.size()), 0,
+      materials.size() * sizeof(TMeshMaterial) }, materials.data() });
+  }
+  header.sectionCount = static_cast<uint32_t>(payloads.size());
+
+  uint64_t offset = sizeof(TMeshHeader) + header.sectionCount * sizeof(TMeshSection);
+  for (SectionPayload& payload : payloads) {
+    offset = alignTo16(offset);
+    payload.desc.offset = offset;
+    offset += payload.desc.byteSize;
+  }
+
+  // Write next to the target and rename, so a crash never leaves a torn cache
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const SectionPayload& payload : payloads) {
+      file.write(reinterpret_cast<const char*>(&payload.desc), sizeof(payload.desc));
+    }
+    const char padding[16] = {};
+    uint64_t written = sizeof(TMeshHeader) + header.sectionCount * sizeof(TMeshSection);
+    for (const SectionPayload& payload : payloads) {
+      file.write(padding, static_cast<std::streamsize>(payload.desc.offset - written));
+      file.write(static_cast<const char*>(payload.data),
+        static_cast<std::streamsize>(payload.desc.byteSize));
+      written = payload.desc.offset + payload.desc.byteSize;
+    }
+    if (!file) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  return true;
+}
+
+void
+MeshCache::readMaterials(std::vector<Material>& outMaterials) const {
+  outMaterials.resize(m_materialCount);
+  for (unsigned int i = 0; i < m_materialCount; ++i) {
+    const TMeshMaterial& record = m_materials[i];
+    Material& material = outMaterials[i];
+    material.diffuse = XMFLOAT4(record.diffuse[0], record.diffuse[1], record.diffuse[2], record.diffuse[3]);
+    material.name.assign(record.name, strnlen(record.name, sizeof(record.name)));
+    material.diffuseMap.assign(record.diffuseMap, strnlen(record.diffuseMap, sizeof(record.diffuseMap)));
+  }
+}
+
+bool
+MeshCache::getSourceStamp(const std::string& sourcePath, uint64_t& outSize, int64_t& outTime) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(sourcePath, error);
+  if (error) {
+    return false;
+  }
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(sourcePath, error);
+  if (error) {
+    return false;
+  }
+  outSize = static_cast<uint64_t>(size);
+  outTime = static_cast<int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+bool
+MeshCache::hashSource(const std::string& sourcePath, uint64_t& outHash) {
+  MappedFile source;
+  if (!source.open(sourcePath)) {
+    return false;
+  }
+  outHash = hashBytes64(source.data(), source.size());
+  return true;
+}
+
+const void*
+MeshCache::findSection(uint32_t type, uint64_t elementSize, uint32_t& outCount,
+  uint64_t* outByteSize) const {
+  const TMeshSection* sections = reinterpret_cast<const TMeshSection*>(m_file.data() + sizeof(TMeshHeader));
+
+  for (uint32_t i = 0; i < m_header->sectionCount; ++i) {
+    const TMeshSection& section = sections[i];
+    if (section.type != type) {
+      continue;
+    }
+    if ((elementSize != 0 && section.byteSize != uint64_t(section.elementCount) * elementSize) ||
+      section.offset % 16 != 0 ||
+      section.offset > m_file.size() ||
+      section.byteSize > m_file.size() - section.offset) {
+      return nullptr;
+    }
+    outCount = section.elementCount;
+    if (outByteSize) {
+      *outByteSize = section.byteSize;
+    }
+    return m_file.data() + section.offset;
+  }
+  return nullptr;
+}
+
+bool
+MeshCache::decodeSections() {
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  uint64_t vertexBytes = 0;
+  uint64_t indexBytes = 0;
+  const void* vertexStream = findSection(SECTION_VERTICES_ENCODED, 0, vertexCount, &vertexBytes);
+  const void* indexStream = findSection(SECTION_INDICES_ENCODED, 0, indexCount, &indexBytes);
+  if (!vertexStream || !indexStream) {
+    return false;
+  }
+
+  // The counts come from the file: a corrupt one must not turn into a huge allocation
+  if (vertexCount > MeshCodec::maxVertexCount(sizeof(SimpleVertex), static_cast<size_t>(vertexBytes)) ||
+    indexCount > MeshCodec::maxIndexCount(static_cast<size_t>(indexBytes)) ||
+    indexCount % 3 != 0) {
+    return false;
+  }
+
+  m_decodedVertices.resize(vertexCount);
+  m_decodedIndices.resize(indexCount);
+  if (!MeshCodec::decodeVertices(m_decodedVertices.data(), vertexCount, sizeof(SimpleVertex),
+    static_cast<const unsigned char*>(vertexStream), static_cast<size_t>(vertexBytes)) ||
+    !MeshCodec::decodeIndices(m_decodedIndices.data(), indexCount,
+      static_cast<const unsigned char*>(indexStream), static_cast<size_t>(indexBytes))) {
+    return false;
+  }
+
+  m_vertices = m_decodedVertices.data();
+  m_indices = m_decodedIndices.data();
+  m_vertexCount = vertexCount;
+  m_indexCount = indexCount;
+  return true;
+}
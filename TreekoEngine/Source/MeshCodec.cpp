@@ -0,0 +1,530 @@
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESHCODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // Index codec: a triangle code byte holds the matched edge in the low nibble
+  // (kNoEdge if none) and the third vertex reference in the high nibble
+  const unsigned int kFifoSize = 16;
+  const unsigned int kEdgeSearch = 15;
+  const unsigned int kVertexSearch = 14;
+  const uint8_t kNoEdge = 15;
+  const uint8_t kRefNext = 0;
+  const uint8_t kRefExplicit = 15;
+  const size_t kIndexHeaderSize = 8;
+
+  // Vertex codec
+  const size_t kBlockSize = 16;
+  const size_t kMaxStride = 256;
+  const size_t kVertexHeaderSize = 4;
+  const size_t kLaneBytes[4] = { 0, 4, 8, 16 };
+
+  struct IndexCodecState {
+    unsigned int edges[kFifoSize][2];
+    unsigned int vertices[kFifoSize];
+    unsigned int edgeHead = 0;
+    unsigned int vertexHead = 0;
+    unsigned int next = 0;
+    unsigned int last = 0;
+
+    IndexCodecState() {
+      std::memset(edges, 0xFF, sizeof(edges));
+      std::memset(vertices, 0xFF, sizeof(vertices));
+    }
+
+    void
+    pushEdge(unsigned int a, unsigned int b) {
+      edges[edgeHead % kFifoSize][0] = a;
+      edges[edgeHead % kFifoSize][1] = b;
+      ++edgeHead;
+    }
+
+    void
+    pushVertex(unsigned int v) {
+      vertices[vertexHead % kFifoSize] = v;
+      ++vertexHead;
+    }
+
+    // Entry 0 is the most recent one
+    const unsigned int*
+    edge(unsigned int i) const {
+      return edges[(edgeHead - 1 - i) % kFifoSize];
+    }
+
+    unsigned int
+    vertex(unsigned int i) const {
+      return vertices[(vertexHead - 1 - i) % kFifoSize];
+    }
+  };
+
+  uint32_t
+  zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+  }
+
+  int32_t
+  unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+  }
+
+  void
+  writeVarint(std::vector<unsigned char>& out, uint32_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<unsigned char>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+  }
+
+  bool
+  readVarint(const unsigned char*& cursor, const unsigned char* end, uint32_t& outValue) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      if (cursor == end) {
+        return false;
+      }
+      unsigned char byte = *cursor++;
+      value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        outValue = value;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns the 4-bit reference code of a vertex and updates the state
+  uint8_t
+  encodeVertexRef(IndexCodecState& state, unsigned int v, std::vector<unsigned char>& data) {
+    if (v == state.next) {
+      ++state.next;
+      state.pushVertex(v);
+      return kRefNext;
+    }
+    for (unsigned int i = 0; i < kVertexSearch; ++i) {
+      if (state.vertex(i) == v) {
+        return static_cast<uint8_t>(1 + i);
+      }
+    }
+    writeVarint(data, zigzag(static_cast<int32_t>(v - state.last)));
+    state.last = v;
+    state.pushVertex(v);
+    return kRefExplicit;
+  }
+
+  bool
+  decodeVertexRef(IndexCodecState& state,
+    uint8_t code,
+    const unsigned char*& data,
+    const unsigned char* dataEnd,
+    unsigned int& outVertex) {
+    if (code == kRefNext) {
+      outVertex = state.next++;
+      state.pushVertex(outVertex);
+    }
+    else if (code < kRefExplicit) {
+      outVertex = state.vertex(code - 1);
+    }
+    else {
+      uint32_t delta;
+      if (!readVarint(data, dataEnd, delta)) {
+        return false;
+      }
+      outVertex = state.last + static_cast<uint32_t>(unzigzag(delta));
+      state.last = outVertex;
+      state.pushVertex(outVertex);
+    }
+    return true;
+  }
+
+#if !MESHCODEC_SSE2
+  void
+  decodeLaneScalar(const unsigned char* data, int width, unsigned char previous, unsigned char* outLane) {
+    for (size_t i = 0; i < kBlockSize; ++i) {
+      unsigned char encoded = 0;
+      if (width == 1) {
+        encoded = (data[i % 4] >> ((i / 4) * 2)) & 0x03;
+      }
+      else if (width == 2) {
+        encoded = (data[i % 8] >> ((i / 8) * 4)) & 0x0F;
+      }
+      else if (width == 3) {
+        encoded = data[i];
+      }
+      unsigned char delta = static_cast<unsigned char>((encoded >> 1) ^ (0u - (encoded & 1u)));
+      previous = static_cast<unsigned char>(previous + delta);
+      outLane[i] = previous;
+    }
+  }
+#endif
+
+#if MESHCODEC_SSE2
+  void
+  decodeLaneSse2(const unsigned char* data, int width, unsigned char previous, unsigned char* outLane) {
+    __m128i encoded;
+    if (width == 0) {
+      encoded = _mm_setzero_si128();
+    }
+    else if (width == 1) {
+      // Byte j holds values j, j + 4, j + 8 and j + 12
+      int packed;
+      std::memcpy(&packed, data, sizeof(packed));
+      __m128i bits = _mm_cvtsi32_si128(packed);
+      __m128i mask = _mm_set1_epi8(0x03);
+      __m128i q0 = _mm_and_si128(bits, mask);
+      __m128i q1 = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+      __m128i q2 = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+      __m128i q3 = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+      encoded = _mm_unpacklo_epi64(_mm_unpacklo_epi32(q0, q1), _mm_unpacklo_epi32(q2, q3));
+    }
+    else if (width == 2) {
+      // Byte j holds values j and j + 8
+      __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+      __m128i mask = _mm_set1_epi8(0x0F);
+      encoded = _mm_unpacklo_epi64(_mm_and_si128(bits, mask),
+        _mm_and_si128(_mm_srli_epi16(bits, 4), mask));
+    }
+    else {
+      encoded = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    // Undo the zigzag mapping: (x >> 1) ^ -(x & 1)
+    __m128i one = _mm_set1_epi8(1);
+    __m128i halved = _mm_and_si128(_mm_srli_epi16(encoded, 1), _mm_set1_epi8(0x7F));
+    __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(encoded, one));
+    __m128i delta = _mm_xor_si128(halved, sign);
+
+    // Inclusive prefix sum of the 16 deltas, offset by the previous value
+    delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 1));
+    delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 2));
+    delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 4));
+    delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 8));
+    delta = _mm_add_epi8(delta, _mm_set1_epi8(static_cast<char>(previous)));
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(outLane), delta);
+  }
+
+  // Turns 16 lanes of 16 vertices into 16 vertices of 16 lanes
+  void
+  transpose16x16(const unsigned char* lanes, unsigned char* destination, size_t stride) {
+    __m128i x[16];
+    __m128i y[16];
+    for (int i = 0; i < 16; ++i) {
+      x[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes + i * kBlockSize));
+    }
+    // Lane pairs: y[i] vertices 0-7, y[i + 8] vertices 8-15
+    for (int i = 0; i < 8; ++i) {
+      y[i] = _mm_unpacklo_epi8(x[2 * i], x[2 * i + 1]);
+      y[i + 8] = _mm_unpackhi_epi8(x[2 * i], x[2 * i + 1]);
+    }
+    // Lane quads: x[4g + i] holds vertices 4g..4g+3, lanes 4i..4i+3
+    for (int h = 0; h < 2; ++h) {
+      for (int i = 0; i < 4; ++i) {
+        x[h * 8 + i] = _mm_unpacklo_epi16(y[h * 8 + 2 * i], y[h * 8 + 2 * i + 1]);
+        x[h * 8 + 4 + i] = _mm_unpackhi_epi16(y[h * 8 + 2 * i], y[h * 8 + 2 * i + 1]);
+      }
+    }
+    // Lane octets: y[4g + 2p + i] holds vertices 4g+2p..4g+2p+1, lanes 8i..8i+7
+    for (int g = 0; g < 4; ++g) {
+      for (int i = 0; i < 2; ++i) {
+        y[g * 4 + i] = _mm_unpacklo_epi32(x[g * 4 + 2 * i], x[g * 4 + 2 * i + 1]);
+        y[g * 4 + 2 + i] = _mm_unpackhi_epi32(x[g * 4 + 2 * i], x[g * 4 + 2 * i + 1]);
+      }
+    }
+    // Whole vertices
+    for (int g = 0; g < 4; ++g) {
+      for (int p = 0; p < 2; ++p) {
+        __m128i low = _mm_unpacklo_epi64(y[g * 4 + 2 * p], y[g * 4 + 2 * p + 1]);
+        __m128i high = _mm_unpackhi_epi64(y[g * 4 + 2 * p], y[g * 4 + 2 * p + 1]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (g * 4 + 2 * p) * stride), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (g * 4 + 2 * p + 1) * stride), high);
+      }
+    }
+  }
+#endif
+}
+
+bool
+MeshCodec::encodeIndices(const unsigned int* indices, size_t indexCount, std::vector<unsigned char>& outData) {
+  if (indexCount % 3 != 0) {
+    return false;
+  }
+  size_t triangleCount = indexCount / 3;
+
+  std::vector<unsigned char> codes;
+  std::vector<unsigned char> rotations((triangleCount + 3) / 4, 0);
+  std::vector<unsigned char> data;
+  codes.reserve(triangleCount + triangleCount / 8);
+
+  IndexCodecState state;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    const unsigned int* triangle = indices + t * 3;
+
+    // Look for an edge of this triangle among the recent ones, in any rotation
+    unsigned int edge = kNoEdge;
+    unsigned int rotation = 0;
+    for (unsigned int r = 0; r < 3 && edge == kNoEdge; ++r) {
+      unsigned int x = triangle[r];
+      unsigned int y = triangle[(r + 1) % 3];
+      for (unsigned int i = 0; i < kEdgeSearch; ++i) {
+        const unsigned int* candidate = state.edge(i);
+        if (candidate[0] == x && candidate[1] == y) {
+          edge = i;
+          rotation = r;
+          break;
+        }
+      }
+    }
+
+    if (edge != kNoEdge) {
+      unsigned int x = triangle[rotation];
+      unsigned int y = triangle[(rotation + 1) % 3];
+      unsigned int z = triangle[(rotation + 2) % 3];
+      uint8_t reference = encodeVertexRef(state, z, data);
+      codes.push_back(static_cast<unsigned char>(edge | (reference << 4)));
+      rotations[t / 4] |= static_cast<unsigned char>(rotation << ((t % 4) * 2));
+
+      // A neighbour walks a shared edge in the opposite direction
+      state.pushEdge(z, y);
+      state.pushEdge(x, z);
+    }
+    else {
+      unsigned int a = triangle[0];
+      unsigned int b = triangle[1];
+      unsigned int c = triangle[2];
+      uint8_t referenceA = encodeVertexRef(state, a, data);
+      uint8_t referenceB = encodeVertexRef(state, b, data);
+      uint8_t referenceC = encodeVertexRef(state, c, data);
+      codes.push_back(static_cast<unsigned char>(kNoEdge | (referenceA << 4)));
+      codes.push_back(static_cast<unsigned char>(referenceB | (referenceC << 4)));
+
+      state.pushEdge(b, a);
+      state.pushEdge(c, b);
+      state.pushEdge(a, c);
+    }
+  }
+
+  uint32_t codeBytes = static_cast<uint32_t>(codes.size());
+  outData.clear();
+  outData.reserve(kIndexHeaderSize + codes.size() + rotations.size() + data.size());
+  outData.push_back(static_cast<unsigned char>(kIndexVersion));
+  outData.push_back(0);
+  outData.push_back(0);
+  outData.push_back(0);
+  for (int i = 0; i < 4; ++i) {
+    outData.push_back(static_cast<unsigned char>(codeBytes >> (i * 8)));
+  }
+  outData.insert(outData.end(), codes.begin(), codes.end());
+  outData.insert(outData.end(), rotations.begin(), rotations.end());
+  outData.insert(outData.end(), data.begin(), data.end());
+  return true;
+}
+
+bool
+MeshCodec::decodeIndices(unsigned int* destination, size_t indexCount, const unsigned char* data, size_t size) {
+  if (indexCount % 3 != 0 || size < kIndexHeaderSize || data[0] != kIndexVersion) {
+    return false;
+  }
+  size_t triangleCount = indexCount / 3;
+
+  uint32_t codeBytes = 0;
+  for (int i = 0; i < 4; ++i) {
+    codeBytes |= static_cast<uint32_t>(data[4 + i]) << (i * 8);
+  }
+  size_t rotationBytes = (triangleCount + 3) / 4;
+  if (codeBytes > size - kIndexHeaderSize || rotationBytes > size - kIndexHeaderSize - codeBytes) {
+    return false;
+  }
+
+  const unsigned char* code = data + kIndexHeaderSize;
+  const unsigned char* codeEnd = code + codeBytes;
+  const unsigned char* rotations = codeEnd;
+  const unsigned char* cursor = rotations + rotationBytes;
+  const unsigned char* dataEnd = data + size;
+
+  IndexCodecState state;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    if (code == codeEnd) {
+      return false;
+    }
+    unsigned char triangleCode = *code++;
+    unsigned int edge = triangleCode & 0x0F;
+    unsigned int* triangle = destination + t * 3;
+
+    if (edge != kNoEdge) {
+      const unsigned int* shared = state.edge(edge);
+      unsigned int x = shared[0];
+      unsigned int y = shared[1];
+      unsigned int z;
+      if (!decodeVertexRef(state, static_cast<uint8_t>(triangleCode >> 4), cursor, dataEnd, z)) {
+        return false;
+      }
+      unsigned int rotation = (rotations[t / 4] >> ((t % 4) * 2)) & 0x03;
+      if (rotation > 2) {
+        return false;
+      }
+      triangle[rotation] = x;
+      triangle[(rotation + 1) % 3] = y;
+      triangle[(rotation + 2) % 3] = z;
+
+      state.pushEdge(z, y);
+      state.pushEdge(x, z);
+    }
+    else {
+      if (code == codeEnd) {
+        return false;
+      }
+      unsigned char secondCode = *code++;
+      unsigned int a;
+      unsigned int b;
+      unsigned int c;
+      if (!decodeVertexRef(state, static_cast<uint8_t>(triangleCode >> 4), cursor, dataEnd, a) ||
+        !decodeVertexRef(state, static_cast<uint8_t>(secondCode & 0x0F), cursor, dataEnd, b) ||
+        !decodeVertexRef(state, static_cast<uint8_t>(secondCode >> 4), cursor, dataEnd, c)) {
+        return false;
+      }
+      triangle[0] = a;
+      triangle[1] = b;
+      triangle[2] = c;
+
+      state.pushEdge(b, a);
+      state.pushEdge(c, b);
+      state.pushEdge(a, c);
+    }
+  }
+  return code == codeEnd;
+}
+
+bool
+MeshCodec::encodeVertices(const void* vertices, size_t vertexCount, size_t stride, std::vector<unsigned char>& outData) {
+  if (stride == 0 || stride > kMaxStride) {
+    return false;
+  }
+  const unsigned char* source = static_cast<const unsigned char*>(vertices);
+  size_t headerBytes = (stride + 3) / 4;
+
+  outData.clear();
+  outData.reserve(kVertexHeaderSize + (vertexCount + kBlockSize - 1) / kBlockSize * (headerBytes + stride * kBlockSize));
+  outData.push_back(static_cast<unsigned char>(kVertexVersion));
+  outData.push_back(0);
+  outData.push_back(0);
+  outData.push_back(0);
+
+  unsigned char previous[kMaxStride] = {};
+  for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kBlockSize) {
+    size_t blockCount = std::min(kBlockSize, vertexCount - blockStart);
+    size_t header = outData.size();
+    outData.resize(header + headerBytes, 0);
+
+    for (size_t lane = 0; lane < stride; ++lane) {
+      // Short blocks repeat their last vertex, which costs nothing after delta coding
+      unsigned char encoded[kBlockSize];
+      unsigned char last = previous[lane];
+      unsigned char largest = 0;
+      for (size_t i = 0; i < kBlockSize; ++i) {
+        size_t vertex = blockStart + std::min(i, blockCount - 1);
+        unsigned char value = source[vertex * stride + lane];
+        unsigned char delta = static_cast<unsigned char>(value - last);
+        encoded[i] = static_cast<unsigned char>((delta << 1) ^ ((delta & 0x80) ? 0xFF : 0x00));
+        largest = std::max(largest, encoded[i]);
+        last = value;
+      }
+      previous[lane] = last;
+
+      int width = (largest == 0) ? 0 : (largest < 4) ? 1 : (largest < 16) ? 2 : 3;
+      outData[header + lane / 4] |= static_cast<unsigned char>(width << ((lane % 4) * 2));
+
+      if (width == 1) {
+        unsigned char packed[4] = {};
+        for (size_t i = 0; i < kBlockSize; ++i) {
+          packed[i % 4] |= static_cast<unsigned char>(encoded[i] << ((i / 4) * 2));
+        }
+        outData.insert(outData.end(), packed, packed + 4);
+      }
+      else if (width == 2) {
+        unsigned char packed[8] = {};
+        for (size_t i = 0; i < kBlockSize; ++i) {
+          packed[i % 8] |= static_cast<unsigned char>(encoded[i] << ((i / 8) * 4));
+        }
+        outData.insert(outData.end(), packed, packed + 8);
+      }
+      else if (width == 3) {
+        outData.insert(outData.end(), encoded, encoded + kBlockSize);
+      }
+    }
+  }
+  return true;
+}
+
+bool
+MeshCodec::decodeVertices(void* destination, size_t vertexCount, size_t stride, const unsigned char* data, size_t size) {
+  if (stride == 0 || stride > kMaxStride || size < kVertexHeaderSize || data[0] != kVertexVersion) {
+    return false;
+  }
+  unsigned char* output = static_cast<unsigned char*>(destination);
+  size_t headerBytes = (stride + 3) / 4;
+  const unsigned char* cursor = data + kVertexHeaderSize;
+  const unsigned char* end = data + size;
+
+  unsigned char previous[kMaxStride] = {};
+  alignas(16) unsigned char lanes[kMaxStride * kBlockSize];
+
+  for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kBlockSize) {
+    size_t blockCount = std::min(kBlockSize, vertexCount - blockStart);
+    if (static_cast<size_t>(end - cursor) < headerBytes) {
+      return false;
+    }
+    const unsigned char* header = cursor;
+    cursor += headerBytes;
+
+    for (size_t lane = 0; lane < stride; ++lane) {
+      int width = (header[lane / 4] >> ((lane % 4) * 2)) & 0x03;
+      size_t laneBytes = kLaneBytes[width];
+      if (static_cast<size_t>(end - cursor) < laneBytes) {
+        return false;
+      }
+      unsigned char* laneValues = lanes + lane * kBlockSize;
+#if MESHCODEC_SSE2
+      decodeLaneSse2(cursor, width, previous[lane], laneValues);
+#else
+      decodeLaneScalar(cursor, width, previous[lane], laneValues);
+#endif
+      previous[lane] = laneValues[kBlockSize - 1];
+      cursor += laneBytes;
+    }
+
+    unsigned char* blockOutput = output + blockStart * stride;
+#if MESHCODEC_SSE2
+    if (blockCount == kBlockSize && stride % 16 == 0) {
+      for (size_t group = 0; group < stride; group += 16) {
+        transpose16x16(lanes + group * kBlockSize, blockOutput + group, stride);
+      }
+      continue;
+    }
+#endif
+    for (size_t i = 0; i < blockCount; ++i) {
+      for (size_t lane = 0; lane < stride; ++lane) {
+        blockOutput[i * stride + lane] = lanes[lane * kBlockSize + i];
+      }
+    }
+  }
+  return cursor == end;
+}
+
+size_t
+MeshCodec::maxIndexCount(size_t size) {
+  return size < kIndexHeaderSize ? 0 : (size - kIndexHeaderSize) * 3;
+}
+
+size_t
+MeshCodec::maxVertexCount(size_t stride, size_t size) {
+  if (stride == 0 || stride > kMaxStride || size < kVertexHeaderSize) {
+    return 0;
+  }
+  return (size - kVertexHeaderSize) / ((stride + 3) / 4) * kBlockSize;
+}
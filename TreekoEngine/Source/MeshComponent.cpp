@@ -0,0 +1,48 @@
+#include "MeshComponent.h"
+
+bool
+MeshComponent::remapTexCoords(const std::vector<XMFLOAT4>& transforms) {
+  if (transforms.empty()) {
+    return false;
+  }
+
+  // Transform of every vertex; -1 for vertices no submesh draws
+  std::vector<int> vertexTransform(m_vertex.size(), m_submeshes.empty() ? 0 : -1);
+  for (const Submesh& submesh : m_submeshes) {
+    if (submesh.materialIndex >= transforms.size()) {
+      return false;
+    }
+    const XMFLOAT4& transform = transforms[submesh.materialIndex];
+    for (unsigned int i = submesh.indexOffset; i < submesh.indexOffset + submesh.indexCount; ++i) {
+      int& current = vertexTransform[m_index[i]];
+      if (current >= 0) {
+        const XMFLOAT4& other = transforms[current];
+        if (other.x != transform.x || other.y != transform.y ||
+          other.z != transform.z || other.w != transform.w) {
+          return false;
+        }
+      }
+      current = static_cast<int>(submesh.materialIndex);
+    }
+  }
+
+  const float tolerance = 1e-4f;
+  for (size_t vertex = 0; vertex < m_vertex.size(); ++vertex) {
+    const XMFLOAT2& uv = m_vertex[vertex].Tex;
+    if (vertexTransform[vertex] >= 0 &&
+      (uv.x < -tolerance || uv.x > 1.0f + tolerance || uv.y < -tolerance || uv.y > 1.0f + tolerance)) {
+      return false;
+    }
+  }
+
+  for (size_t vertex = 0; vertex < m_vertex.size(); ++vertex) {
+    if (vertexTransform[vertex] < 0) {
+      continue;
+    }
+    const XMFLOAT4& transform = transforms[vertexTransform[vertex]];
+    XMFLOAT2& uv = m_vertex[vertex].Tex;
+    uv.x = std::min(std::max(uv.x, 0.0f), 1.0f) * transform.x + transform.z;
+    uv.y = std::min(std::max(uv.y, 0.0f), 1.0f) * transform.y + transform.w;
+  }
+  return true;
+}
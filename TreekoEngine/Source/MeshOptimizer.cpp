@@ -0,0 +1,621 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace {
+  // Parameters from Forsyth, "Linear-Speed Vertex Cache Optimisation"
+  const int kScoreCacheSize = 32;
+  const float kCacheDecayPower = 1.5f;
+  const float kLastTriangleScore = 0.75f;
+  const float kValenceBoostScale = 2.0f;
+  const float kValenceBoostPower = 0.5f;
+  const unsigned int kValenceTableSize = 32;
+
+  const unsigned int kInvalidIndex = ~0u;
+
+  // Cache the overdraw clusters are measured against; matches analyzeVertexCache
+  const unsigned int kClusterCacheSize = MeshOptimizer::kAnalyzeCacheSize;
+
+  // Sub-pixel precision of the overdraw rasterizer (4 bits, like GPU snapping)
+  const int kSubPixelBits = 4;
+
+  struct ScoreTables {
+    float cache[kScoreCacheSize];
+    float valence[kValenceTableSize];
+
+    ScoreTables() {
+      for (int i = 0; i < kScoreCacheSize; ++i) {
+        if (i < 3) {
+          // The last triangle's vertices score the same whatever their order
+          cache[i] = kLastTriangleScore;
+        }
+        else {
+          float scaler = 1.0f / (kScoreCacheSize - 3);
+          cache[i] = std::pow(1.0f - (i - 3) * scaler, kCacheDecayPower);
+        }
+      }
+      valence[0] = 0.0f;
+      for (unsigned int i = 1; i < kValenceTableSize; ++i) {
+        valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+      }
+    }
+  };
+
+  const ScoreTables&
+  scoreTables() {
+    static const ScoreTables tables;
+    return tables;
+  }
+
+  // Twice the signed area of (a, b, p); positive when p is left of a->b
+  int64_t
+  edgeFunction(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t px, int64_t py) {
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+  }
+
+  // Top-left fill rule: a pixel centre exactly on a shared edge belongs to one triangle only
+  bool
+  isTopLeft(int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+    return (by - ay) < 0 || ((by - ay) == 0 && (bx - ax) > 0);
+  }
+
+  struct ScreenVertex {
+    int64_t x;
+    int64_t y;
+    float z;
+  };
+
+  // Twice the signed volume of the mesh; positive when its normals point outward
+  float
+  signedVolume(const unsigned int* indices, size_t indexCount, const SimpleVertex* vertices) {
+    float volume = 0.0f;
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+      const XMFLOAT3& a = vertices[indices[t]].Pos;
+      const XMFLOAT3& b = vertices[indices[t + 1]].Pos;
+      const XMFLOAT3& c = vertices[indices[t + 2]].Pos;
+      volume += a.x * (b.y * c.z - b.z * c.y) +
+        a.y * (b.z * c.x - b.x * c.z) +
+        a.z * (b.x * c.y - b.y * c.x);
+    }
+    return volume;
+  }
+
+  // Rasterizes one front-facing triangle with an early depth test
+  void
+  rasterizeTriangle(ScreenVertex a,
+    ScreenVertex b,
+    ScreenVertex c,
+    int viewport,
+    std::vector<float>& depth,
+    OverdrawStats& stats) {
+    int64_t area = edgeFunction(a.x, a.y, b.x, b.y, c.x, c.y);
+    if (area == 0) {
+      return;
+    }
+    if (area < 0) {
+      std::swap(b, c);
+      area = -area;
+    }
+
+    const int64_t pixel = int64_t(1) << kSubPixelBits;
+    int64_t minX = std::max<int64_t>(std::min(a.x, std::min(b.x, c.x)) >> kSubPixelBits, 0);
+    int64_t minY = std::max<int64_t>(std::min(a.y, std::min(b.y, c.y)) >> kSubPixelBits, 0);
+    int64_t maxX = std::min<int64_t>(std::max(a.x, std::max(b.x, c.x)) >> kSubPixelBits, viewport - 1);
+    int64_t maxY = std::min<int64_t>(std::max(a.y, std::max(b.y, c.y)) >> kSubPixelBits, viewport - 1);
+
+    int64_t biasA = isTopLeft(b.x, b.y, c.x, c.y) ? 0 : -1;
+    int64_t biasB = isTopLeft(c.x, c.y, a.x, a.y) ? 0 : -1;
+    int64_t biasC = isTopLeft(a.x, a.y, b.x, b.y) ? 0 : -1;
+    float invArea = 1.0f / static_cast<float>(area);
+
+    for (int64_t y = minY; y <= maxY; ++y) {
+      int64_t py = y * pixel + pixel / 2;
+      for (int64_t x = minX; x <= maxX; ++x) {
+        int64_t px = x * pixel + pixel / 2;
+        int64_t wa = edgeFunction(b.x, b.y, c.x, c.y, px, py);
+        int64_t wb = edgeFunction(c.x, c.y, a.x, a.y, px, py);
+        int64_t wc = edgeFunction(a.x, a.y, b.x, b.y, px, py);
+        if (wa + biasA < 0 || wb + biasB < 0 || wc + biasC < 0) {
+          continue;
+        }
+
+        float z = (wa * a.z + wb * b.z + wc * c.z) * invArea;
+        float& stored = depth[static_cast<size_t>(y) * viewport + static_cast<size_t>(x)];
+        if (z < stored) {
+          if (stored == std::numeric_limits<float>::max()) {
+            ++stats.pixelsCovered;
+          }
+          stored = z;
+          ++stats.pixelsShaded;
+        }
+      }
+    }
+  }
+}
+
+bool
+MeshOptimizer::optimize(MeshComponent& mesh) {
+  m_lastStats = OptimizeStats();
+
+  if (mesh.m_index.size() % 3 != 0) {
+    return false;
+  }
+  for (unsigned int index : mesh.m_index) {
+    if (index >= mesh.m_vertex.size()) {
+      return false;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  m_lastStats.before = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+  if (m_measureOverdraw) {
+    m_lastStats.overdrawBefore = analyzeOverdraw(mesh.m_index.data(), mesh.m_index.size(),
+      mesh.m_vertex.data(), mesh.m_vertex.size());
+  }
+
+  // Triangles only move inside their material range, so submeshes stay valid
+  Submesh wholeMesh = { 0, static_cast<unsigned int>(mesh.m_index.size()), 0 };
+  const Submesh* ranges = mesh.m_submeshes.empty() ? &wholeMesh : mesh.m_submeshes.data();
+  const size_t rangeCount = mesh.m_submeshes.empty() ? 1 : mesh.m_submeshes.size();
+  for (size_t i = 0; i < rangeCount; ++i) {
+    unsigned int* rangeIndices = mesh.m_index.data() + ranges[i].indexOffset;
+    optimizeVertexCache(rangeIndices, ranges[i].indexCount, mesh.m_vertex.size());
+    if (m_overdrawThreshold >= 1.0f) {
+      optimizeOverdraw(rangeIndices, ranges[i].indexCount,
+        mesh.m_vertex.data(), mesh.m_vertex.size(), m_overdrawThreshold);
+    }
+  }
+  optimizeVertexFetch(mesh.m_vertex, mesh.m_index);
+
+  m_lastStats.after = analyzeVertexCache(mesh.m_index.data(), mesh.m_index.size(), mesh.m_vertex.size());
+  if (m_measureOverdraw) {
+    m_lastStats.overdrawAfter = analyzeOverdraw(mesh.m_index.data(), mesh.m_index.size(),
+      mesh.m_vertex.data(), mesh.m_vertex.size());
+  }
+
+  mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+  mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+
+  auto end = std::chrono::steady_clock::now();
+  m_lastStats.optimizeMs = std::chrono::duration<double, std::milli>(end - start).count();
+  return true;
+}
+
+void
+MeshOptimizer::optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangle adjacency per vertex, packed into one array
+  m_activeTriangles.assign(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    ++m_activeTriangles[indices[i]];
+  }
+  m_adjacencyOffset.resize(vertexCount);
+  unsigned int offset = 0;
+  for (size_t v = 0; v < vertexCount; ++v) {
+    m_adjacencyOffset[v] = offset;
+    offset += m_activeTriangles[v];
+  }
+  m_adjacency.resize(offset);
+  std::fill(m_activeTriangles.begin(), m_activeTriangles.end(), 0u);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    for (int corner = 0; corner < 3; ++corner) {
+      unsigned int v = indices[t * 3 + corner];
+      m_adjacency[m_adjacencyOffset[v] + m_activeTriangles[v]++] = static_cast<unsigned int>(t);
+    }
+  }
+
+  m_cachePosition.assign(vertexCount, -1);
+  m_vertexScore.resize(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    m_vertexScore[v] = vertexScore(-1, m_activeTriangles[v]);
+  }
+
+  m_emitted.assign(triangleCount, 0);
+  m_sourceIndices.assign(indices, indices + triangleCount * 3);
+  const unsigned int* source = m_sourceIndices.data();
+
+  auto triangleScore = [this, source](unsigned int t) {
+    return m_vertexScore[source[t * 3]] +
+      m_vertexScore[source[t * 3 + 1]] +
+      m_vertexScore[source[t * 3 + 2]];
+  };
+
+  // Start from the best triangle of the whole mesh
+  unsigned int bestTriangle = 0;
+  float bestScore = -1.0f;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    float score = triangleScore(static_cast<unsigned int>(t));
+    if (score > bestScore) {
+      bestScore = score;
+      bestTriangle = static_cast<unsigned int>(t);
+    }
+  }
+
+  // LRU cache; three extra slots hold the vertices pushed out by the new triangle
+  unsigned int cache[kScoreCacheSize + 3];
+  unsigned int newCache[kScoreCacheSize + 3];
+  size_t cacheCount = 0;
+  size_t fallbackCursor = 0;
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+    if (bestTriangle == kInvalidIndex) {
+      // Nothing in the cache has work left: continue with the next triangle in input order
+      while (m_emitted[fallbackCursor]) {
+        ++fallbackCursor;
+      }
+      bestTriangle = static_cast<unsigned int>(fallbackCursor);
+    }
+
+    const unsigned int* triangle = source + bestTriangle * 3;
+    indices[emittedCount * 3] = triangle[0];
+    indices[emittedCount * 3 + 1] = triangle[1];
+    indices[emittedCount * 3 + 2] = triangle[2];
+    m_emitted[bestTriangle] = 1;
+
+    // Drop the triangle from the live adjacency of its vertices
+    for (int corner = 0; corner < 3; ++corner) {
+      unsigned int v = triangle[corner];
+      unsigned int* adjacency = m_adjacency.data() + m_adjacencyOffset[v];
+      unsigned int live = m_activeTriangles[v];
+      for (unsigned int i = 0; i < live; ++i) {
+        if (adjacency[i] == bestTriangle) {
+          adjacency[i] = adjacency[live - 1];
+          break;
+        }
+      }
+      --m_activeTriangles[v];
+    }
+
+    // The triangle's vertices move to the front of the cache
+    size_t newCount = 0;
+    for (int corner = 0; corner < 3; ++corner) {
+      newCache[newCount++] = triangle[corner];
+    }
+    for (size_t i = 0; i < cacheCount; ++i) {
+      unsigned int v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        newCache[newCount++] = v;
+      }
+    }
+
+    for (size_t i = 0; i < newCount; ++i) {
+      unsigned int v = newCache[i];
+      int position = (i < size_t(kScoreCacheSize)) ? static_cast<int>(i) : -1;
+      m_cachePosition[v] = position;
+      m_vertexScore[v] = vertexScore(position, m_activeTriangles[v]);
+    }
+    cacheCount = std::min(newCount, size_t(kScoreCacheSize));
+    std::copy(newCache, newCache + cacheCount, cache);
+
+    // The next triangle is the best one still touching the cache
+    bestTriangle = kInvalidIndex;
+    bestScore = -1.0f;
+    for (size_t i = 0; i < cacheCount; ++i) {
+      unsigned int v = cache[i];
+      const unsigned int* adjacency = m_adjacency.data() + m_adjacencyOffset[v];
+      for (unsigned int j = 0; j < m_activeTriangles[v]; ++j) {
+        float score = triangleScore(adjacency[j]);
+        if (score > bestScore) {
+          bestScore = score;
+          bestTriangle = adjacency[j];
+        }
+      }
+    }
+  }
+}
+
+void
+MeshOptimizer::optimizeOverdraw(unsigned int* indices,
+  size_t indexCount,
+  const SimpleVertex* vertices,
+  size_t vertexCount,
+  float threshold) {
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  buildClusters(indices, triangleCount, vertexCount, threshold, m_clusters);
+  size_t clusterCount = m_clusters.size();
+  if (clusterCount < 2) {
+    return;
+  }
+  m_clusters.push_back(static_cast<unsigned int>(triangleCount));
+
+  // Area-weighted centroid of the whole mesh
+  float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+  float meshArea = 0.0f;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    const XMFLOAT3& a = vertices[indices[t * 3]].Pos;
+    const XMFLOAT3& b = vertices[indices[t * 3 + 1]].Pos;
+    const XMFLOAT3& c = vertices[indices[t * 3 + 2]].Pos;
+    float nx = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+    float ny = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+    float nz = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    float area = std::sqrt(nx * nx + ny * ny + nz * nz);
+    meshCentroid[0] += (a.x + b.x + c.x) * area;
+    meshCentroid[1] += (a.y + b.y + c.y) * area;
+    meshCentroid[2] += (a.z + b.z + c.z) * area;
+    meshArea += area;
+  }
+  if (meshArea > 0.0f) {
+    for (float& coordinate : meshCentroid) {
+      coordinate /= meshArea * 3.0f;
+    }
+  }
+
+  // Closed meshes wound the other way have inward normals; flip so "outward" holds
+  float outward = (signedVolume(indices, indexCount, vertices) < 0.0f) ? -1.0f : 1.0f;
+
+  // Clusters far out along their own normal tend to occlude the rest of the mesh
+  // from most directions, so they are drawn first
+  m_clusterKey.resize(clusterCount);
+  for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+    float centroid[3] = { 0.0f, 0.0f, 0.0f };
+    float normal[3] = { 0.0f, 0.0f, 0.0f };
+    float clusterArea = 0.0f;
+    for (unsigned int t = m_clusters[cluster]; t < m_clusters[cluster + 1]; ++t) {
+      const XMFLOAT3& a = vertices[indices[t * 3]].Pos;
+      const XMFLOAT3& b = vertices[indices[t * 3 + 1]].Pos;
+      const XMFLOAT3& c = vertices[indices[t * 3 + 2]].Pos;
+      float nx = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+      float ny = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+      float nz = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+      float area = std::sqrt(nx * nx + ny * ny + nz * nz);
+      centroid[0] += (a.x + b.x + c.x) * area;
+      centroid[1] += (a.y + b.y + c.y) * area;
+      centroid[2] += (a.z + b.z + c.z) * area;
+      normal[0] += nx;
+      normal[1] += ny;
+      normal[2] += nz;
+      clusterArea += area;
+    }
+
+    float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (clusterArea <= 0.0f || normalLength <= 0.0f) {
+      m_clusterKey[cluster] = 0.0f;
+      continue;
+    }
+    float key = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+      float offset = centroid[axis] / (clusterArea * 3.0f) - meshCentroid[axis];
+      key += offset * normal[axis] / normalLength;
+    }
+    m_clusterKey[cluster] = key * outward;
+  }
+
+  m_clusterOrder.resize(clusterCount);
+  std::iota(m_clusterOrder.begin(), m_clusterOrder.end(), 0u);
+  std::stable_sort(m_clusterOrder.begin(), m_clusterOrder.end(), [this](unsigned int a, unsigned int b) {
+    return m_clusterKey[a] > m_clusterKey[b];
+  });
+
+  m_sourceIndices.assign(indices, indices + triangleCount * 3);
+  unsigned int* output = indices;
+  for (unsigned int cluster : m_clusterOrder) {
+    const unsigned int* begin = m_sourceIndices.data() + size_t(m_clusters[cluster]) * 3;
+    const unsigned int* end = m_sourceIndices.data() + size_t(m_clusters[cluster + 1]) * 3;
+    output = std::copy(begin, end, output);
+  }
+}
+
+void
+MeshOptimizer::optimizeVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices) {
+  m_remap.assign(vertices.size(), kInvalidIndex);
+
+  std::vector<SimpleVertex> reordered;
+  reordered.reserve(vertices.size());
+  for (unsigned int& index : indices) {
+    unsigned int& target = m_remap[index];
+    if (target == kInvalidIndex) {
+      target = static_cast<unsigned int>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = target;
+  }
+  vertices.swap(reordered);
+}
+
+VertexCacheStats
+MeshOptimizer::analyzeVertexCache(const unsigned int* indices,
+  size_t indexCount,
+  size_t vertexCount,
+  unsigned int cacheSize) {
+  VertexCacheStats stats;
+  if (indexCount < 3 || vertexCount == 0) {
+    return stats;
+  }
+
+  // FIFO: a vertex is cached while fewer than cacheSize misses happened since it was loaded
+  std::vector<unsigned int> loadedAt(vertexCount, 0);
+  unsigned int misses = 0;
+  for (size_t i = 0; i < indexCount; ++i) {
+    unsigned int v = indices[i];
+    if (loadedAt[v] == 0 || misses + 1 - loadedAt[v] > cacheSize) {
+      ++misses;
+      loadedAt[v] = misses;
+    }
+  }
+
+  stats.transformedVertices = misses;
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+  return stats;
+}
+
+OverdrawStats
+MeshOptimizer::analyzeOverdraw(const unsigned int* indices,
+  size_t indexCount,
+  const SimpleVertex* vertices,
+  size_t vertexCount) {
+  OverdrawStats stats;
+  if (indexCount < 3 || vertexCount == 0) {
+    return stats;
+  }
+
+  float boundsMin[3] = { vertices[0].Pos.x, vertices[0].Pos.y, vertices[0].Pos.z };
+  float boundsMax[3] = { vertices[0].Pos.x, vertices[0].Pos.y, vertices[0].Pos.z };
+  for (size_t v = 0; v < vertexCount; ++v) {
+    const float position[3] = { vertices[v].Pos.x, vertices[v].Pos.y, vertices[v].Pos.z };
+    for (int axis = 0; axis < 3; ++axis) {
+      boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+      boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+    }
+  }
+  float extent = std::max(boundsMax[0] - boundsMin[0],
+    std::max(boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]));
+  if (extent <= 0.0f) {
+    return stats;
+  }
+
+  // Uniform scale so every view keeps the mesh's proportions
+  const float subPixels = static_cast<float>(1 << kSubPixelBits);
+  float scale = (kOverdrawViewport - 1) * subPixels / extent;
+
+  // Front faces are the ones whose outward normal points at the viewer
+  float outward = (signedVolume(indices, indexCount, vertices) < 0.0f) ? -1.0f : 1.0f;
+
+  std::vector<float> depth(static_cast<size_t>(kOverdrawViewport) * kOverdrawViewport);
+
+  for (int axis = 0; axis < 3; ++axis) {
+    int uAxis = (axis + 1) % 3;
+    int vAxis = (axis + 2) % 3;
+    for (float direction = -1.0f; direction <= 1.0f; direction += 2.0f) {
+      std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+      for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const XMFLOAT3& a = vertices[indices[t]].Pos;
+        const XMFLOAT3& b = vertices[indices[t + 1]].Pos;
+        const XMFLOAT3& c = vertices[indices[t + 2]].Pos;
+        const float normal[3] = {
+          (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y),
+          (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z),
+          (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)
+        };
+        // The viewer looks along +direction on this axis
+        if (normal[axis] * outward * direction >= 0.0f) {
+          continue;
+        }
+
+        ScreenVertex corners[3];
+        for (int corner = 0; corner < 3; ++corner) {
+          const XMFLOAT3& p = vertices[indices[t + corner]].Pos;
+          const float position[3] = { p.x, p.y, p.z };
+          corners[corner].x = static_cast<int64_t>((position[uAxis] - boundsMin[uAxis]) * scale + 0.5f);
+          corners[corner].y = static_cast<int64_t>((position[vAxis] - boundsMin[vAxis]) * scale + 0.5f);
+          corners[corner].z = position[axis] * direction;
+        }
+        rasterizeTriangle(corners[0], corners[1], corners[2], kOverdrawViewport, depth, stats);
+      }
+    }
+  }
+
+  if (stats.pixelsCovered > 0) {
+    stats.overdraw = static_cast<float>(stats.pixelsShaded) / static_cast<float>(stats.pixelsCovered);
+  }
+  return stats;
+}
+
+void
+MeshOptimizer::buildClusters(const unsigned int* indices,
+  size_t triangleCount,
+  size_t vertexCount,
+  float threshold,
+  std::vector<unsigned int>& outClusters) {
+  outClusters.clear();
+
+  // FIFO simulation: a vertex is cached while fewer than kClusterCacheSize
+  // misses happened since it was loaded. Advancing the clock flushes the cache.
+  m_cacheTimestamp.assign(vertexCount, 0);
+  unsigned int timestamp = kClusterCacheSize + 1;
+  auto updateCache = [this, &timestamp](const unsigned int* triangle) {
+    unsigned int misses = 0;
+    for (int corner = 0; corner < 3; ++corner) {
+      unsigned int& loaded = m_cacheTimestamp[triangle[corner]];
+      if (timestamp - loaded > kClusterCacheSize) {
+        loaded = timestamp++;
+        ++misses;
+      }
+    }
+    return misses;
+  };
+  auto flushCache = [&timestamp]() {
+    timestamp += kClusterCacheSize + 1;
+  };
+
+  // Hard boundaries: a triangle missing all three vertices starts a new patch.
+  // m_clusterOrder is free until the clusters are sorted, so it holds them here.
+  std::vector<unsigned int>& patches = m_clusterOrder;
+  patches.clear();
+  for (size_t t = 0; t < triangleCount; ++t) {
+    if (updateCache(indices + t * 3) == 3 || t == 0) {
+      patches.push_back(static_cast<unsigned int>(t));
+    }
+  }
+  patches.push_back(static_cast<unsigned int>(triangleCount));
+
+  // Soft boundaries: split each patch as soon as the running ACMR of the
+  // current cluster is within threshold of the patch's own ACMR
+  for (size_t patch = 0; patch + 1 < patches.size(); ++patch) {
+    unsigned int begin = patches[patch];
+    unsigned int end = patches[patch + 1];
+
+    flushCache();
+    unsigned int patchMisses = 0;
+    for (unsigned int t = begin; t < end; ++t) {
+      patchMisses += updateCache(indices + size_t(t) * 3);
+    }
+    float targetAcmr = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+
+    size_t firstCluster = outClusters.size();
+    outClusters.push_back(begin);
+    flushCache();
+    unsigned int runningMisses = 0;
+    unsigned int runningTriangles = 0;
+    for (unsigned int t = begin; t < end; ++t) {
+      runningMisses += updateCache(indices + size_t(t) * 3);
+      ++runningTriangles;
+      if (t + 1 < end &&
+        static_cast<float>(runningMisses) <= targetAcmr * static_cast<float>(runningTriangles)) {
+        outClusters.push_back(t + 1);
+        flushCache();
+        runningMisses = 0;
+        runningTriangles = 0;
+      }
+    }
+
+    // A short tail never reaches the target; merge it into the previous cluster
+    if (runningTriangles > 0 &&
+      static_cast<float>(runningMisses) > targetAcmr * static_cast<float>(runningTriangles) &&
+      outClusters.size() > firstCluster + 1) {
+      outClusters.pop_back();
+    }
+  }
+}
+
+float
+MeshOptimizer::vertexScore(int cachePosition, unsigned int activeTriangles) {
+  if (activeTriangles == 0) {
+    // Nothing left to draw with this vertex
+    return -1.0f;
+  }
+
+  const ScoreTables& tables = scoreTables();
+  float score = (cachePosition >= 0) ? tables.cache[cachePosition] : 0.0f;
+  if (activeTriangles < kValenceTableSize) {
+    score += tables.valence[activeTriangles];
+  }
+  else {
+    score += kValenceBoostScale * std::pow(static_cast<float>(activeTriangles), -kValenceBoostPower);
+  }
+  return score;
+}
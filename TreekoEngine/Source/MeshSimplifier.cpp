@@ -0,0 +1,655 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+  const unsigned int kInvalidIndex = ~0u;
+
+  enum VertexKind : unsigned char {
+    KIND_MANIFOLD = 0,
+    KIND_BORDER = 1,
+    KIND_SEAM = 2,
+    KIND_LOCKED = 3
+  };
+
+  // Symmetric 3x3 matrix (6), vector (3), constant (1) and weight (1)
+  const unsigned int kQuadricSize = 11;
+
+  // Normal (3) and UV (2); each also stores a summed gradient (3) and offset (1)
+  const unsigned int kAttributeCount = 5;
+  const unsigned int kAttributeQuadricSize = kQuadricSize + kAttributeCount * 4;
+
+  // Scale of the attributes against positions in the unit cube
+  const float kNormalWeight = 0.5f;
+  const float kTexCoordWeight = 1.0f;
+
+  // Weight of the planes that hold borders and seams in place
+  const float kBorderWeight = 4.0f;
+
+  // Collapse no further than 1.5x the error of the pass goal, so cheap
+  // collapses are not starved by a few expensive ones early in the pass
+  const float kPassErrorBound = 1.5f;
+
+  // Stop the LOD chain below this many triangles or when a level saves little
+  const size_t kMinLodTriangles = 64;
+  const float kMinLodReduction = 0.9f;
+  // Smallest cosine between a triangle normal before and after a collapse
+  const float kFlipCosine = 0.25f;
+
+  XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  XMFLOAT3
+  add(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z);
+  }
+
+  float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  XMFLOAT3
+  cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+
+  // Adds w * (g.p + d)^2 to a quadric, without touching its weight
+  void
+  addQuadric(float* q, const XMFLOAT3& g, float d, float w) {
+    q[0] += w * g.x * g.x;
+    q[1] += w * g.y * g.y;
+    q[2] += w * g.z * g.z;
+    q[3] += w * g.x * g.y;
+    q[4] += w * g.x * g.z;
+    q[5] += w * g.y * g.z;
+    q[6] += w * g.x * d;
+    q[7] += w * g.y * d;
+    q[8] += w * g.z * d;
+    q[9] += w * d * d;
+  }
+
+  float
+  evaluateQuadric(const float* q, const XMFLOAT3& p) {
+    return q[0] * p.x * p.x + q[1] * p.y * p.y + q[2] * p.z * p.z +
+      2.0f * (q[3] * p.x * p.y + q[4] * p.x * p.z + q[5] * p.y * p.z) +
+      2.0f * (q[6] * p.x + q[7] * p.y + q[8] * p.z) + q[9];
+  }
+
+  void
+  mergeQuadric(float* target, const float* source, unsigned int size) {
+    for (unsigned int i = 0; i < size; ++i) {
+      target[i] += source[i];
+    }
+  }
+
+  void
+  vertexAttributes(const SimpleVertex& vertex, float outAttributes[kAttributeCount]) {
+    outAttributes[0] = vertex.Norm.x * kNormalWeight;
+    outAttributes[1] = vertex.Norm.y * kNormalWeight;
+    outAttributes[2] = vertex.Norm.z * kNormalWeight;
+    outAttributes[3] = vertex.Tex.x * kTexCoordWeight;
+    outAttributes[4] = vertex.Tex.y * kTexCoordWeight;
+  }
+
+  // Mean squared attribute error of an attribute quadric at position p with values s:
+  // sum of w * (g.p + d - s)^2 over the triangles it was built from
+  float
+  evaluateAttributeQuadric(const float* q, const XMFLOAT3& p, const float s[kAttributeCount]) {
+    float error = evaluateQuadric(q, p);
+    const float* gradients = q + kQuadricSize;
+    for (unsigned int j = 0; j < kAttributeCount; ++j) {
+      const float* g = gradients + j * 4;
+      error += -2.0f * s[j] * (g[0] * p.x + g[1] * p.y + g[2] * p.z + g[3]) + q[10] * s[j] * s[j];
+    }
+    return error;
+  }
+}
+
+size_t
+MeshSimplifier::simplify(const unsigned int* indices,
+  size_t indexCount,
+  const SimpleVertex* vertices,
+  size_t vertexCount,
+  size_t targetIndexCount,
+  float targetError,
+  std::vector<unsigned int>& outIndices) {
+  m_lastError = 0.0f;
+  outIndices.assign(indices, indices + indexCount);
+  m_triangleSource.resize(indexCount / 3);
+  for (size_t triangle = 0; triangle < m_triangleSource.size(); ++triangle) {
+    m_triangleSource[triangle] = static_cast<unsigned int>(triangle);
+  }
+  if (indexCount % 3 != 0 || indexCount <= targetIndexCount || vertexCount == 0) {
+    return outIndices.size();
+  }
+
+  // Work in the unit cube so errors are relative to the mesh extent
+  XMFLOAT3 minimum = vertices[0].Pos;
+  XMFLOAT3 maximum = vertices[0].Pos;
+  for (size_t v = 1; v < vertexCount; ++v) {
+    const XMFLOAT3& p = vertices[v].Pos;
+    minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+    maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+  }
+  float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+  float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+  m_positions.resize(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    m_positions[v] = XMFLOAT3((vertices[v].Pos.x - minimum.x) * scale,
+      (vertices[v].Pos.y - minimum.y) * scale,
+      (vertices[v].Pos.z - minimum.z) * scale);
+  }
+
+  // Vertices sharing a position: m_remap points at the first one, m_wedge links them in a ring
+  m_collapseOrder.resize(vertexCount);
+  std::iota(m_collapseOrder.begin(), m_collapseOrder.end(), 0u);
+  std::sort(m_collapseOrder.begin(), m_collapseOrder.end(), [&](unsigned int a, unsigned int b) {
+    const XMFLOAT3& pa = vertices[a].Pos;
+    const XMFLOAT3& pb = vertices[b].Pos;
+    if (pa.x != pb.x) return pa.x < pb.x;
+    if (pa.y != pb.y) return pa.y < pb.y;
+    if (pa.z != pb.z) return pa.z < pb.z;
+    return a < b;
+  });
+  m_remap.resize(vertexCount);
+  m_wedge.resize(vertexCount);
+  for (size_t i = 0; i < vertexCount;) {
+    size_t groupEnd = i + 1;
+    // Compared as floats, so seams exported as 0.0 on one side and -0.0 on
+    // the other still pair up
+    const XMFLOAT3& p = vertices[m_collapseOrder[i]].Pos;
+    while (groupEnd < vertexCount &&
+      vertices[m_collapseOrder[groupEnd]].Pos.x == p.x &&
+      vertices[m_collapseOrder[groupEnd]].Pos.y == p.y &&
+      vertices[m_collapseOrder[groupEnd]].Pos.z == p.z) {
+      ++groupEnd;
+    }
+    for (size_t j = i; j < groupEnd; ++j) {
+      m_remap[m_collapseOrder[j]] = m_collapseOrder[i];
+      m_wedge[m_collapseOrder[j]] = m_collapseOrder[(j + 1 < groupEnd) ? j + 1 : i];
+    }
+    i = groupEnd;
+  }
+
+  m_indices.assign(indices, indices + indexCount);
+
+  auto buildAdjacency = [&]() {
+    m_adjacencyOffset.assign(vertexCount + 1, 0);
+    for (unsigned int index : m_indices) {
+      ++m_adjacencyOffset[m_remap[index] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+      m_adjacencyOffset[v + 1] += m_adjacencyOffset[v];
+    }
+    m_adjacency.resize(m_indices.size());
+    m_collapseRemap.assign(m_adjacencyOffset.begin(), m_adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < m_indices.size(); ++i) {
+      m_adjacency[m_collapseRemap[m_remap[m_indices[i]]]++] = static_cast<unsigned int>(i / 3);
+    }
+  };
+
+  // True if a triangle has the directed edge a -> b (exact vertices)
+  auto hasEdge = [&](unsigned int a, unsigned int b) {
+    unsigned int position = m_remap[a];
+    for (unsigned int i = m_adjacencyOffset[position]; i < m_adjacencyOffset[position + 1]; ++i) {
+      const unsigned int* triangle = &m_indices[m_adjacency[i] * 3];
+      for (unsigned int k = 0; k < 3; ++k) {
+        if (triangle[k] == a && triangle[(k + 1) % 3] == b) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  buildAdjacency();
+
+  // Classify vertices from their open edges (edges without a reversed twin)
+  m_openOut.assign(vertexCount, kInvalidIndex);
+  m_openIn.assign(vertexCount, kInvalidIndex);
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    for (unsigned int k = 0; k < 3; ++k) {
+      unsigned int a = m_indices[i + k];
+      unsigned int b = m_indices[i + (k + 1) % 3];
+      if (hasEdge(b, a)) {
+        continue;
+      }
+      // Several open edges around one vertex: mark it with itself
+      m_openOut[a] = (m_openOut[a] == kInvalidIndex) ? b : a;
+      m_openIn[b] = (m_openIn[b] == kInvalidIndex) ? a : b;
+    }
+  }
+  m_kind.assign(vertexCount, KIND_LOCKED);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    unsigned int vertex = static_cast<unsigned int>(v);
+    bool singleOpen = m_openOut[v] != kInvalidIndex && m_openOut[v] != vertex &&
+      m_openIn[v] != kInvalidIndex && m_openIn[v] != vertex;
+    bool noOpen = m_openOut[v] == kInvalidIndex && m_openIn[v] == kInvalidIndex;
+
+    if (m_wedge[v] == vertex) {
+      m_kind[v] = noOpen ? KIND_MANIFOLD : (singleOpen ? KIND_BORDER : KIND_LOCKED);
+    }
+    else if (m_wedge[m_wedge[v]] == vertex) {
+      // Two attribute sets: a seam if each side's open edge mirrors the other's
+      unsigned int twin = m_wedge[v];
+      bool twinSingleOpen = m_openOut[twin] != kInvalidIndex && m_openOut[twin] != twin &&
+        m_openIn[twin] != kInvalidIndex && m_openIn[twin] != twin;
+      if (singleOpen && twinSingleOpen &&
+        m_remap[m_openOut[v]] == m_remap[m_openIn[twin]] &&
+        m_remap[m_openIn[v]] == m_remap[m_openOut[twin]]) {
+        m_kind[v] = KIND_SEAM;
+      }
+    }
+  }
+
+  // Position quadrics per position, attribute quadrics per vertex
+  m_positionQuadrics.assign(vertexCount * kQuadricSize, 0.0f);
+  m_attributeQuadrics.assign(vertexCount * kAttributeQuadricSize, 0.0f);
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    unsigned int corners[3] = { m_indices[i], m_indices[i + 1], m_indices[i + 2] };
+    const XMFLOAT3& p0 = m_positions[corners[0]];
+    XMFLOAT3 e1 = subtract(m_positions[corners[1]], p0);
+    XMFLOAT3 e2 = subtract(m_positions[corners[2]], p0);
+    XMFLOAT3 normal = cross(e1, e2);
+    float length = std::sqrt(dot(normal, normal));
+    if (length == 0.0f) {
+      continue;
+    }
+    normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+    float area = length * 0.5f;
+
+    for (unsigned int k = 0; k < 3; ++k) {
+      float* q = &m_positionQuadrics[m_remap[corners[k]] * kQuadricSize];
+      addQuadric(q, normal, -dot(normal, p0), area);
+      q[10] += area;
+    }
+
+    // Planes through open edges, perpendicular to the triangle, pin borders and seams
+    for (unsigned int k = 0; k < 3; ++k) {
+      unsigned int a = corners[k];
+      unsigned int b = corners[(k + 1) % 3];
+      if (m_openOut[a] == kInvalidIndex || hasEdge(b, a)) {
+        continue;
+      }
+      XMFLOAT3 edge = subtract(m_positions[b], m_positions[a]);
+      XMFLOAT3 side = cross(edge, normal);
+      float sideLength = std::sqrt(dot(side, side));
+      if (sideLength == 0.0f) {
+        continue;
+      }
+      side = XMFLOAT3(side.x / sideLength, side.y / sideLength, side.z / sideLength);
+      float weight = dot(edge, edge) * kBorderWeight;
+      float offset = -dot(side, m_positions[a]);
+      for (unsigned int end : { a, b }) {
+        float* q = &m_positionQuadrics[m_remap[end] * kQuadricSize];
+        addQuadric(q, side, offset, weight);
+        q[10] += weight;
+      }
+    }
+
+    // Attribute gradients over the triangle: s(p) = g.p + d
+    float d11 = dot(e1, e1);
+    float d12 = dot(e1, e2);
+    float d22 = dot(e2, e2);
+    float determinant = d11 * d22 - d12 * d12;
+    if (determinant <= 0.0f) {
+      continue;
+    }
+    float attributes[3][kAttributeCount];
+    for (unsigned int k = 0; k < 3; ++k) {
+      vertexAttributes(vertices[corners[k]], attributes[k]);
+    }
+    for (unsigned int k = 0; k < 3; ++k) {
+      float* q = &m_attributeQuadrics[corners[k] * kAttributeQuadricSize];
+      q[10] += area;
+    }
+    for (unsigned int j = 0; j < kAttributeCount; ++j) {
+      float s10 = attributes[1][j] - attributes[0][j];
+      float s20 = attributes[2][j] - attributes[0][j];
+      float alpha = (d22 * s10 - d12 * s20) / determinant;
+      float beta = (d11 * s20 - d12 * s10) / determinant;
+      XMFLOAT3 gradient(alpha * e1.x + beta * e2.x, alpha * e1.y + beta * e2.y, alpha * e1.z + beta * e2.z);
+      float offset = attributes[0][j] - dot(gradient, p0);
+      for (unsigned int k = 0; k < 3; ++k) {
+        float* q = &m_attributeQuadrics[corners[k] * kAttributeQuadricSize];
+        addQuadric(q, gradient, offset, area);
+        float* g = q + kQuadricSize + j * 4;
+        g[0] += area * gradient.x;
+        g[1] += area * gradient.y;
+        g[2] += area * gradient.z;
+        g[3] += area * offset;
+      }
+    }
+  }
+
+  // The twin of a seam vertex collapses to the twin of the target on its own side
+  auto seamTwinTarget = [&](unsigned int source, unsigned int target) {
+    unsigned int twin = m_wedge[source];
+    if (m_remap[m_openOut[twin]] == m_remap[target]) {
+      return m_openOut[twin];
+    }
+    if (m_remap[m_openIn[twin]] == m_remap[target]) {
+      return m_openIn[twin];
+    }
+    return kInvalidIndex;
+  };
+
+  auto attributeError = [&](unsigned int source, unsigned int target) {
+    const float* q = &m_attributeQuadrics[source * kAttributeQuadricSize];
+    if (q[10] <= 0.0f) {
+      return 0.0f;
+    }
+    float attributes[kAttributeCount];
+    vertexAttributes(vertices[target], attributes);
+    return std::max(0.0f, evaluateAttributeQuadric(q, m_positions[target], attributes) / q[10]);
+  };
+
+  // Error of moving source onto target, or infinity if the collapse is not allowed
+  auto collapseError = [&](unsigned int source, unsigned int target, float& outGeometric) {
+    const float infinity = std::numeric_limits<float>::infinity();
+    unsigned char kind = m_kind[source];
+    if (kind == KIND_LOCKED) {
+      return infinity;
+    }
+    if (kind != KIND_MANIFOLD) {
+      // Borders and seams only slide along their own open edges
+      if (m_kind[target] != kind || (m_openOut[source] != target && m_openIn[source] != target)) {
+        return infinity;
+      }
+    }
+
+    const float* q = &m_positionQuadrics[m_remap[source] * kQuadricSize];
+    outGeometric = q[10] > 0.0f ? std::max(0.0f, evaluateQuadric(q, m_positions[target]) / q[10]) : 0.0f;
+    float error = outGeometric + attributeError(source, target);
+    if (kind == KIND_SEAM) {
+      unsigned int twinTarget = seamTwinTarget(source, target);
+      if (twinTarget == kInvalidIndex) {
+        return infinity;
+      }
+      error += attributeError(m_wedge[source], twinTarget);
+    }
+    return error;
+  };
+
+  // Moving source onto target must not turn any remaining triangle around
+  auto flipsTriangle = [&](unsigned int source, unsigned int target) {
+    unsigned int sourcePosition = m_remap[source];
+    unsigned int targetPosition = m_remap[target];
+    for (unsigned int i = m_adjacencyOffset[sourcePosition]; i < m_adjacencyOffset[sourcePosition + 1]; ++i) {
+      const unsigned int* triangle = &m_indices[m_adjacency[i] * 3];
+      unsigned int k = 0;
+      bool touchesTarget = false;
+      for (unsigned int c = 0; c < 3; ++c) {
+        if (m_remap[triangle[c]] == sourcePosition) k = c;
+        if (m_remap[triangle[c]] == targetPosition) touchesTarget = true;
+      }
+      if (touchesTarget) {
+        continue;
+      }
+      const XMFLOAT3& p1 = m_positions[triangle[(k + 1) % 3]];
+      const XMFLOAT3& p2 = m_positions[triangle[(k + 2) % 3]];
+      XMFLOAT3 before = cross(subtract(p1, m_positions[triangle[k]]), subtract(p2, m_positions[triangle[k]]));
+      XMFLOAT3 after = cross(subtract(p1, m_positions[target]), subtract(p2, m_positions[target]));
+      // Turning by up to 90 degrees is not a flip, but a series of such
+      // collapses can stand a triangle on its edge; allow about 75 degrees
+      if (dot(before, after) <= kFlipCosine * std::sqrt(dot(before, before) * dot(after, after))) {
+        return true;
+      }
+      // Steps under that bound still add up, so the result must also face
+      // the way its corners are shaded, on the side the triangle faced
+      // before (either winding; meshes without normals skip this)
+      XMFLOAT3 others = add(vertices[triangle[(k + 1) % 3]].Norm, vertices[triangle[(k + 2) % 3]].Norm);
+      XMFLOAT3 shadingBefore = add(others, vertices[triangle[k]].Norm);
+      XMFLOAT3 shading = add(others, vertices[target].Norm);
+      float facing = dot(after, shading) * (dot(before, shadingBefore) < 0.0f ? -1.0f : 1.0f);
+      if (dot(shading, shading) > 0.0f &&
+        facing <= kFlipCosine * std::sqrt(dot(after, after) * dot(shading, shading))) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  const float errorLimit = targetError * targetError;
+  float maxGeometricError = 0.0f;
+  const size_t targetTriangles = targetIndexCount / 3;
+
+  while (m_indices.size() > targetIndexCount) {
+    size_t triangleCount = m_indices.size() / 3;
+
+    // Cheapest allowed direction of every edge
+    m_collapseSource.clear();
+    m_collapseTarget.clear();
+    m_collapseError.clear();
+    m_collapseGeometricError.clear();
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+      for (unsigned int k = 0; k < 3; ++k) {
+        unsigned int a = m_indices[i + k];
+        unsigned int b = m_indices[i + (k + 1) % 3];
+        if (m_remap[a] == m_remap[b]) {
+          continue;
+        }
+        float geometricAB = 0.0f;
+        float geometricBA = 0.0f;
+        float errorAB = collapseError(a, b, geometricAB);
+        float errorBA = collapseError(b, a, geometricBA);
+        bool forward = errorAB <= errorBA;
+        float error = forward ? errorAB : errorBA;
+        if (std::isinf(error) || error > errorLimit) {
+          continue;
+        }
+        m_collapseSource.push_back(forward ? a : b);
+        m_collapseTarget.push_back(forward ? b : a);
+        m_collapseError.push_back(error);
+        m_collapseGeometricError.push_back(forward ? geometricAB : geometricBA);
+      }
+    }
+    if (m_collapseSource.empty()) {
+      break;
+    }
+
+    m_collapseOrder.resize(m_collapseSource.size());
+    std::iota(m_collapseOrder.begin(), m_collapseOrder.end(), 0u);
+    std::sort(m_collapseOrder.begin(), m_collapseOrder.end(), [&](unsigned int a, unsigned int b) {
+      return m_collapseError[a] < m_collapseError[b];
+    });
+
+    // Each collapse removes about two triangles
+    size_t trianglesToRemove = triangleCount - targetTriangles;
+    size_t collapseGoal = std::max<size_t>(1, trianglesToRemove / 2);
+    float passLimit = errorLimit;
+    if (collapseGoal < m_collapseOrder.size()) {
+      passLimit = std::min(passLimit, m_collapseError[m_collapseOrder[collapseGoal]] * kPassErrorBound);
+    }
+
+    m_locked.assign(vertexCount, 0);
+    m_collapseRemap.resize(vertexCount);
+    std::iota(m_collapseRemap.begin(), m_collapseRemap.end(), 0u);
+
+    size_t removed = 0;
+    size_t applied = 0;
+    for (unsigned int order : m_collapseOrder) {
+      if (m_collapseError[order] > passLimit || removed >= trianglesToRemove) {
+        break;
+      }
+      unsigned int source = m_collapseSource[order];
+      unsigned int target = m_collapseTarget[order];
+      unsigned int sourcePosition = m_remap[source];
+      unsigned int targetPosition = m_remap[target];
+      if (m_locked[sourcePosition] || m_locked[targetPosition] || flipsTriangle(source, target)) {
+        continue;
+      }
+
+      mergeQuadric(&m_positionQuadrics[targetPosition * kQuadricSize],
+        &m_positionQuadrics[sourcePosition * kQuadricSize], kQuadricSize);
+      mergeQuadric(&m_attributeQuadrics[target * kAttributeQuadricSize],
+        &m_attributeQuadrics[source * kAttributeQuadricSize], kAttributeQuadricSize);
+      m_collapseRemap[source] = target;
+
+      if (m_kind[source] == KIND_SEAM) {
+        unsigned int twin = m_wedge[source];
+        unsigned int twinTarget = seamTwinTarget(source, target);
+        mergeQuadric(&m_attributeQuadrics[twinTarget * kAttributeQuadricSize],
+          &m_attributeQuadrics[twin * kAttributeQuadricSize], kAttributeQuadricSize);
+        m_collapseRemap[twin] = twinTarget;
+        removed += 2;
+      }
+      else {
+        removed += (m_kind[source] == KIND_BORDER) ? 1 : 2;
+      }
+
+      // The triangles around the source are only checked for flips against
+      // their current corners, so none of those corners may move in this pass
+      for (unsigned int i = m_adjacencyOffset[sourcePosition]; i < m_adjacencyOffset[sourcePosition + 1]; ++i) {
+        const unsigned int* triangle = &m_indices[m_adjacency[i] * 3];
+        for (unsigned int c = 0; c < 3; ++c) {
+          m_locked[m_remap[triangle[c]]] = 1;
+        }
+      }
+      m_locked[targetPosition] = 1;
+      maxGeometricError = std::max(maxGeometricError, m_collapseGeometricError[order]);
+      ++applied;
+    }
+    if (applied == 0) {
+      break;
+    }
+
+    // Apply the pass and drop the triangles that collapsed
+    size_t written = 0;
+    for (size_t i = 0; i < m_indices.size(); i += 3) {
+      unsigned int a = m_collapseRemap[m_indices[i]];
+      unsigned int b = m_collapseRemap[m_indices[i + 1]];
+      unsigned int c = m_collapseRemap[m_indices[i + 2]];
+      if (m_remap[a] == m_remap[b] || m_remap[b] == m_remap[c] || m_remap[a] == m_remap[c]) {
+        continue;
+      }
+      m_triangleSource[written / 3] = m_triangleSource[i / 3];
+      m_indices[written++] = a;
+      m_indices[written++] = b;
+      m_indices[written++] = c;
+    }
+    m_indices.resize(written);
+    m_triangleSource.resize(written / 3);
+
+    // Open edges now end at the collapse targets; a vertex that absorbed its
+    // neighbor along the edge continues to the neighbor's next vertex
+    m_previousOpenOut.assign(m_openOut.begin(), m_openOut.end());
+    m_previousOpenIn.assign(m_openIn.begin(), m_openIn.end());
+    for (size_t v = 0; v < vertexCount; ++v) {
+      unsigned int vertex = static_cast<unsigned int>(v);
+      unsigned int next = m_previousOpenOut[v];
+      if (next != kInvalidIndex && next != vertex) {
+        m_openOut[v] = m_collapseRemap[(m_collapseRemap[next] == vertex) ? m_previousOpenOut[next] : next];
+      }
+      unsigned int previous = m_previousOpenIn[v];
+      if (previous != kInvalidIndex && previous != vertex) {
+        m_openIn[v] = m_collapseRemap[(m_collapseRemap[previous] == vertex) ? m_previousOpenIn[previous] : previous];
+      }
+    }
+    buildAdjacency();
+  }
+
+  m_lastError = std::sqrt(maxGeometricError) * extent;
+  outIndices.assign(m_indices.begin(), m_indices.end());
+  return outIndices.size();
+}
+
+bool
+MeshSimplifier::buildLodChain(MeshComponent& mesh) {
+  m_lastStats = LodStats();
+  mesh.m_lods.clear();
+
+  if (mesh.m_index.size() % 3 != 0) {
+    return false;
+  }
+  for (unsigned int index : mesh.m_index) {
+    if (index >= mesh.m_vertex.size()) {
+      return false;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  MeshLod level = { 0, static_cast<unsigned int>(mesh.m_index.size()), 0.0f };
+  mesh.m_lods.push_back(level);
+
+  std::vector<unsigned int> simplified;
+  const size_t baseIndexCount = mesh.m_index.size();
+  // Material ranges of the level being simplified (at first, every submesh)
+  size_t previousSubmeshBegin = 0;
+  size_t previousSubmeshEnd = mesh.m_submeshes.size();
+  while (mesh.m_lods.size() < m_lodCount) {
+    const MeshLod previous = mesh.m_lods.back();
+    size_t targetIndexCount = static_cast<size_t>(previous.indexCount / 3 * m_lodRatio) * 3;
+    if (targetIndexCount / 3 < kMinLodTriangles) {
+      break;
+    }
+
+    size_t count = simplify(mesh.m_index.data() + previous.indexOffset, previous.indexCount,
+      mesh.m_vertex.data(), mesh.m_vertex.size(),
+      targetIndexCount, std::numeric_limits<float>::max(), simplified);
+    if (count == 0 || count > previous.indexCount * kMinLodReduction) {
+      break;
+    }
+
+    // Errors add up because every level is simplified from the previous one
+    level.indexOffset = static_cast<unsigned int>(mesh.m_index.size());
+    level.indexCount = static_cast<unsigned int>(count);
+    level.error = previous.error + m_lastError;
+    mesh.m_index.insert(mesh.m_index.end(), simplified.begin(), simplified.end());
+    mesh.m_lods.push_back(level);
+
+    // Surviving triangles keep their order, so each material range of the
+    // previous level maps to one contiguous range of the new one
+    const size_t levelSubmeshBegin = mesh.m_submeshes.size();
+    size_t source = 0;
+    for (size_t i = previousSubmeshBegin; i < previousSubmeshEnd; ++i) {
+      const Submesh previousSubmesh = mesh.m_submeshes[i];
+      const unsigned int endTriangle =
+        (previousSubmesh.indexOffset - previous.indexOffset + previousSubmesh.indexCount) / 3;
+      const size_t first = source;
+      while (source < m_triangleSource.size() && m_triangleSource[source] < endTriangle) {
+        ++source;
+      }
+      if (source > first) {
+        Submesh submesh;
+        submesh.indexOffset = level.indexOffset + static_cast<unsigned int>(first * 3);
+        submesh.indexCount = static_cast<unsigned int>((source - first) * 3);
+        submesh.materialIndex = previousSubmesh.materialIndex;
+        mesh.m_submeshes.push_back(submesh);
+      }
+    }
+    previousSubmeshBegin = levelSubmeshBegin;
+    previousSubmeshEnd = mesh.m_submeshes.size();
+  }
+
+  mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+  m_lastStats.levels = static_cast<unsigned int>(mesh.m_lods.size());
+  m_lastStats.addedIndices = mesh.m_index.size() - baseIndexCount;
+
+  auto end = std::chrono::steady_clock::now();
+  m_lastStats.buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+  return true;
+}
+
+unsigned int
+MeshSimplifier::selectLod(const std::vector<MeshLod>& lods,
+  float distance,
+  float pixelsPerUnit,
+  float maxPixelError) {
+  if (lods.empty() || distance <= 0.0f) {
+    return 0;
+  }
+  for (size_t i = lods.size() - 1; i > 0; --i) {
+    if (lods[i].error * pixelsPerUnit / distance <= maxPixelError) {
+      return static_cast<unsigned int>(i);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,312 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+  const unsigned int kInvalidIndex = ~0u;
+
+  // Hard limits: meshlet-local vertex and triangle ids must fit in a byte / 9 bits
+  const unsigned int kMaxMeshletVertices = 256;
+  const unsigned int kMaxMeshletTriangles = 512;
+
+  // Cones wider than acos(0.1) (~84 degrees) can never be rejected in practice
+  const float kMinConeDot = 0.1f;
+
+  XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  XMFLOAT3
+  normalize(const XMFLOAT3& v) {
+    float length = std::sqrt(dot(v, v));
+    if (length == 0.0f) {
+      return XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+    return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+  }
+
+  // Front-face normal for clockwise winding in a left-handed space
+  XMFLOAT3
+  triangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c) {
+    XMFLOAT3 ab = subtract(b, a);
+    XMFLOAT3 ac = subtract(c, a);
+    return normalize(XMFLOAT3(ab.y * ac.z - ab.z * ac.y,
+      ab.z * ac.x - ab.x * ac.z,
+      ab.x * ac.y - ab.y * ac.x));
+  }
+}
+
+bool
+MeshletBuilder::build(MeshComponent& mesh) {
+  m_lastStats = BuildStats();
+  mesh.m_meshlets.clear();
+
+  if (mesh.m_index.size() % 3 != 0) {
+    return false;
+  }
+  for (unsigned int index : mesh.m_index) {
+    if (index >= mesh.m_vertex.size()) {
+      return false;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  const unsigned int maxVertices = std::min(std::max(m_maxVertices, 3u), kMaxMeshletVertices);
+  const unsigned int maxTriangles = std::min(std::max(m_maxTriangles, 1u), kMaxMeshletTriangles);
+  const unsigned int* indices = mesh.m_index.data();
+  const SimpleVertex* vertices = mesh.m_vertex.data();
+  const size_t indexCount = mesh.m_index.size();
+  const size_t vertexCount = mesh.m_vertex.size();
+  const unsigned int triangleCount = static_cast<unsigned int>(indexCount / 3);
+
+  // Triangles using each vertex
+  m_adjacencyOffset.assign(vertexCount + 1, 0);
+  for (size_t i = 0; i < indexCount; ++i) {
+    ++m_adjacencyOffset[indices[i] + 1];
+  }
+  for (size_t v = 0; v < vertexCount; ++v) {
+    m_adjacencyOffset[v + 1] += m_adjacencyOffset[v];
+  }
+  m_adjacency.resize(indexCount);
+  m_vertexTag.assign(m_adjacencyOffset.begin(), m_adjacencyOffset.end() - 1);
+  for (unsigned int triangle = 0; triangle < triangleCount; ++triangle) {
+    for (unsigned int corner = 0; corner < 3; ++corner) {
+      m_adjacency[m_vertexTag[indices[triangle * 3 + corner]]++] = triangle;
+    }
+  }
+
+  m_triangleNormals.resize(triangleCount);
+  for (unsigned int triangle = 0; triangle < triangleCount; ++triangle) {
+    m_triangleNormals[triangle] = triangleNormal(vertices[indices[triangle * 3 + 0]].Pos,
+      vertices[indices[triangle * 3 + 1]].Pos,
+      vertices[indices[triangle * 3 + 2]].Pos);
+  }
+
+  // Clusters never mix materials. Seeds are taken in order, so every submesh
+  // is exhausted before the next one starts and the ranges stay the same.
+  m_triangleGroup.assign(triangleCount, kInvalidIndex);
+  for (size_t i = 0; i < mesh.m_submeshes.size(); ++i) {
+    const Submesh& submesh = mesh.m_submeshes[i];
+    for (unsigned int triangle = submesh.indexOffset / 3;
+      triangle < (submesh.indexOffset + submesh.indexCount) / 3 && triangle < triangleCount; ++triangle) {
+      m_triangleGroup[triangle] = static_cast<unsigned int>(i);
+    }
+  }
+
+  m_emitted.assign(triangleCount, 0);
+  m_liveTriangles.resize(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    m_liveTriangles[v] = m_adjacencyOffset[v + 1] - m_adjacencyOffset[v];
+  }
+  m_vertexTag.assign(vertexCount, kInvalidIndex);
+  m_candidateTag.assign(triangleCount, kInvalidIndex);
+  m_orderedIndices.clear();
+  m_orderedIndices.reserve(indexCount);
+
+  unsigned int seed = 0;
+  unsigned int totalVertices = 0;
+  for (;;) {
+    // New meshlets start from the earliest unused triangle, which keeps the
+    // cache order of the input as much as possible
+    while (seed < triangleCount && m_emitted[seed]) {
+      ++seed;
+    }
+    if (seed == triangleCount) {
+      break;
+    }
+
+    const unsigned int meshletId = static_cast<unsigned int>(mesh.m_meshlets.size());
+    Meshlet meshlet = {};
+    meshlet.indexOffset = static_cast<unsigned int>(m_orderedIndices.size());
+    unsigned int meshletVertices = 0;
+    unsigned int meshletTriangles = 0;
+    XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+    m_candidates.clear();
+
+    const unsigned int group = m_triangleGroup[seed];
+    unsigned int triangle = seed;
+    for (;;) {
+      m_emitted[triangle] = 1;
+      ++meshletTriangles;
+      const XMFLOAT3& normal = m_triangleNormals[triangle];
+      normalSum = XMFLOAT3(normalSum.x + normal.x, normalSum.y + normal.y, normalSum.z + normal.z);
+
+      for (unsigned int corner = 0; corner < 3; ++corner) {
+        unsigned int vertex = indices[triangle * 3 + corner];
+        m_orderedIndices.push_back(vertex);
+        --m_liveTriangles[vertex];
+        if (m_vertexTag[vertex] == meshletId) {
+          continue;
+        }
+        m_vertexTag[vertex] = meshletId;
+        ++meshletVertices;
+
+        for (unsigned int i = m_adjacencyOffset[vertex]; i < m_adjacencyOffset[vertex + 1]; ++i) {
+          unsigned int neighbor = m_adjacency[i];
+          if (!m_emitted[neighbor] && m_candidateTag[neighbor] != meshletId &&
+            m_triangleGroup[neighbor] == group) {
+            m_candidateTag[neighbor] = meshletId;
+            m_candidates.push_back(neighbor);
+          }
+        }
+      }
+
+      if (meshletTriangles == maxTriangles) {
+        break;
+      }
+
+      // Fewest new vertices first, then the triangle whose vertices have the
+      // fewest triangles left (so the cluster does not leave holes behind),
+      // then the normal closest to the cone axis
+      XMFLOAT3 axis = normalize(normalSum);
+      unsigned int best = kInvalidIndex;
+      unsigned int bestNewVertices = 4;
+      unsigned int bestLive = ~0u;
+      float bestDot = -2.0f;
+      for (size_t i = 0; i < m_candidates.size();) {
+        unsigned int candidate = m_candidates[i];
+        if (m_emitted[candidate]) {
+          m_candidates[i] = m_candidates.back();
+          m_candidates.pop_back();
+          continue;
+        }
+        ++i;
+
+        unsigned int newVertices = (m_vertexTag[indices[candidate * 3 + 0]] != meshletId) +
+          (m_vertexTag[indices[candidate * 3 + 1]] != meshletId) +
+          (m_vertexTag[indices[candidate * 3 + 2]] != meshletId);
+        if (meshletVertices + newVertices > maxVertices || newVertices > bestNewVertices) {
+          continue;
+        }
+        unsigned int live = m_liveTriangles[indices[candidate * 3 + 0]] +
+          m_liveTriangles[indices[candidate * 3 + 1]] +
+          m_liveTriangles[indices[candidate * 3 + 2]];
+        float candidateDot = dot(m_triangleNormals[candidate], axis);
+        if (newVertices < bestNewVertices ||
+          (newVertices == bestNewVertices && (live < bestLive || (live == bestLive && candidateDot > bestDot)))) {
+          best = candidate;
+          bestNewVertices = newVertices;
+          bestLive = live;
+          bestDot = candidateDot;
+        }
+      }
+
+      if (best == kInvalidIndex) {
+        break;
+      }
+      triangle = best;
+    }
+
+    meshlet.indexCount = meshletTriangles * 3;
+    meshlet.vertexCount = meshletVertices;
+    computeBounds(m_orderedIndices.data(), vertices, meshlet);
+    if (meshlet.coneCutoff >= 1.0f) {
+      ++m_lastStats.wideCones;
+    }
+    mesh.m_meshlets.push_back(meshlet);
+    totalVertices += meshletVertices;
+  }
+
+  mesh.m_index.assign(m_orderedIndices.begin(), m_orderedIndices.end());
+  mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+
+  m_lastStats.meshletCount = static_cast<unsigned int>(mesh.m_meshlets.size());
+  if (m_lastStats.meshletCount > 0) {
+    m_lastStats.averageTriangles = static_cast<float>(triangleCount) / m_lastStats.meshletCount;
+    m_lastStats.averageVertices = static_cast<float>(totalVertices) / m_lastStats.meshletCount;
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  m_lastStats.buildMs = std::chrono::duration<double, std::milli>(end - start).count();
+  return true;
+}
+
+void
+MeshletBuilder::computeBounds(const unsigned int* indices,
+  const SimpleVertex* vertices,
+  Meshlet& outMeshlet) {
+  const unsigned int* begin = indices + outMeshlet.indexOffset;
+  const unsigned int count = outMeshlet.indexCount;
+
+  outMeshlet.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+  outMeshlet.radius = 0.0f;
+  outMeshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 1.0f);
+  outMeshlet.coneCutoff = 1.0f;
+  if (count == 0) {
+    return;
+  }
+
+  // Ritter's sphere: start from the most distant pair of axis extremes, then
+  // grow the sphere to cover every corner
+  unsigned int extremes[6] = { begin[0], begin[0], begin[0], begin[0], begin[0], begin[0] };
+  for (unsigned int i = 1; i < count; ++i) {
+    const XMFLOAT3& p = vertices[begin[i]].Pos;
+    if (p.x < vertices[extremes[0]].Pos.x) extremes[0] = begin[i];
+    if (p.x > vertices[extremes[1]].Pos.x) extremes[1] = begin[i];
+    if (p.y < vertices[extremes[2]].Pos.y) extremes[2] = begin[i];
+    if (p.y > vertices[extremes[3]].Pos.y) extremes[3] = begin[i];
+    if (p.z < vertices[extremes[4]].Pos.z) extremes[4] = begin[i];
+    if (p.z > vertices[extremes[5]].Pos.z) extremes[5] = begin[i];
+  }
+  unsigned int widestAxis = 0;
+  float widestDistance = -1.0f;
+  for (unsigned int axis = 0; axis < 3; ++axis) {
+    XMFLOAT3 span = subtract(vertices[extremes[axis * 2 + 1]].Pos, vertices[extremes[axis * 2]].Pos);
+    float distance = dot(span, span);
+    if (distance > widestDistance) {
+      widestDistance = distance;
+      widestAxis = axis;
+    }
+  }
+  const XMFLOAT3& lo = vertices[extremes[widestAxis * 2]].Pos;
+  const XMFLOAT3& hi = vertices[extremes[widestAxis * 2 + 1]].Pos;
+  XMFLOAT3 center((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+  float radius = std::sqrt(widestDistance) * 0.5f;
+
+  for (unsigned int i = 0; i < count; ++i) {
+    const XMFLOAT3& p = vertices[begin[i]].Pos;
+    XMFLOAT3 offset = subtract(p, center);
+    float distance = std::sqrt(dot(offset, offset));
+    if (distance > radius) {
+      float grownRadius = (radius + distance) * 0.5f;
+      float shift = (grownRadius - radius) / distance;
+      center = XMFLOAT3(center.x + offset.x * shift, center.y + offset.y * shift, center.z + offset.z * shift);
+      radius = grownRadius;
+    }
+  }
+  // Absorb the rounding of the incremental updates
+  outMeshlet.center = center;
+  outMeshlet.radius = radius * 1.0001f + 1e-6f;
+
+  // Normal cone: average normal and the widest deviation from it
+  XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+  for (unsigned int i = 0; i < count; i += 3) {
+    XMFLOAT3 normal = triangleNormal(vertices[begin[i]].Pos, vertices[begin[i + 1]].Pos, vertices[begin[i + 2]].Pos);
+    normalSum = XMFLOAT3(normalSum.x + normal.x, normalSum.y + normal.y, normalSum.z + normal.z);
+  }
+  XMFLOAT3 axis = normalize(normalSum);
+  if (dot(axis, axis) == 0.0f) {
+    return;
+  }
+
+  float minDot = 1.0f;
+  for (unsigned int i = 0; i < count; i += 3) {
+    XMFLOAT3 normal = triangleNormal(vertices[begin[i]].Pos, vertices[begin[i + 1]].Pos, vertices[begin[i + 2]].Pos);
+    // Degenerate triangles are never rasterized, so they do not widen the cone
+    if (dot(normal, normal) == 0.0f) {
+      continue;
+    }
+    minDot = std::min(minDot, dot(normal, axis));
+  }
+
+  outMeshlet.coneAxis = axis;
+  outMeshlet.coneCutoff = (minDot <= kMinConeDot) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
@@ -0,0 +1,215 @@
+#include "MeshletCuller.h"
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESHLETCULLER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // Plane a*x + b*y + c*z + d >= 0 on the inside, with a unit normal
+  struct Plane {
+    float a, b, c, d;
+  };
+
+  // Gribb/Hartmann extraction for row vectors (clip = v * M) and the D3D depth
+  // range 0 <= z <= w: left, right, bottom, top, near, far
+  void
+  extractFrustumPlanes(const XMFLOAT4X4& m, Plane outPlanes[6]) {
+    for (int i = 0; i < 6; ++i) {
+      int column = i / 2;
+      float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+      Plane& plane = outPlanes[i];
+      if (i == 4) {
+        plane = { m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2] };
+      }
+      else {
+        plane = { m.m[0][3] + sign * m.m[0][column],
+          m.m[1][3] + sign * m.m[1][column],
+          m.m[2][3] + sign * m.m[2][column],
+          m.m[3][3] + sign * m.m[3][column] };
+      }
+
+      float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+      if (length > 0.0f) {
+        plane.a /= length;
+        plane.b /= length;
+        plane.c /= length;
+        plane.d /= length;
+      }
+    }
+  }
+}
+
+void
+MeshletCuller::init(const std::vector<Meshlet>& meshlets) {
+  m_meshletCount = meshlets.size();
+  size_t paddedCount = (m_meshletCount + 3) & ~size_t(3);
+
+  m_centerX.assign(paddedCount, 0.0f);
+  m_centerY.assign(paddedCount, 0.0f);
+  m_centerZ.assign(paddedCount, 0.0f);
+  m_radius.assign(paddedCount, 0.0f);
+  m_axisX.assign(paddedCount, 0.0f);
+  m_axisY.assign(paddedCount, 0.0f);
+  m_axisZ.assign(paddedCount, 0.0f);
+  m_cutoff.assign(paddedCount, 1.0f);
+  m_ranges.resize(m_meshletCount);
+  m_visible.assign(paddedCount, 0);
+
+  for (size_t i = 0; i < m_meshletCount; ++i) {
+    const Meshlet& meshlet = meshlets[i];
+    m_centerX[i] = meshlet.center.x;
+    m_centerY[i] = meshlet.center.y;
+    m_centerZ[i] = meshlet.center.z;
+    m_radius[i] = meshlet.radius;
+    m_axisX[i] = meshlet.coneAxis.x;
+    m_axisY[i] = meshlet.coneAxis.y;
+    m_axisZ[i] = meshlet.coneAxis.z;
+    m_cutoff[i] = meshlet.coneCutoff;
+    m_ranges[i] = { meshlet.indexOffset, meshlet.indexCount };
+  }
+  m_lastStats = CullStats();
+}
+
+void
+MeshletCuller::cull(const XMFLOAT4X4& worldViewProjection,
+  const XMFLOAT3& cameraPosition,
+  std::vector<MeshletDrawRange>& outRanges) {
+  auto start = std::chrono::steady_clock::now();
+
+  m_lastStats = CullStats();
+  m_lastStats.meshlets = static_cast<unsigned int>(m_meshletCount);
+  outRanges.clear();
+
+  Plane planes[6];
+  extractFrustumPlanes(worldViewProjection, planes);
+
+  size_t paddedCount = m_centerX.size();
+  unsigned int frustumCulled = 0;
+  unsigned int backfaceCulled = 0;
+
+  // A meshlet is outside when its sphere is behind any plane. It faces away
+  // when the whole sphere is inside the cone of view directions that see the
+  // back of every triangle:
+  //   dot(center - camera, axis) > cutoff * |center - camera| + radius
+#if MESHLETCULLER_SSE2
+  __m128 planeA[6], planeB[6], planeC[6], planeD[6];
+  for (int p = 0; p < 6; ++p) {
+    planeA[p] = _mm_set1_ps(planes[p].a);
+    planeB[p] = _mm_set1_ps(planes[p].b);
+    planeC[p] = _mm_set1_ps(planes[p].c);
+    planeD[p] = _mm_set1_ps(planes[p].d);
+  }
+  const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+  const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+  const __m128 cameraZ = _mm_set1_ps(cameraPosition.z);
+
+  for (size_t i = 0; i < paddedCount; i += 4) {
+    __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+    __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+    __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+    __m128 radius = _mm_loadu_ps(&m_radius[i]);
+    __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; ++p) {
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(planeA[p], centerX), _mm_mul_ps(planeB[p], centerY)),
+        _mm_add_ps(_mm_mul_ps(planeC[p], centerZ), planeD[p]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+    }
+
+    __m128 viewX = _mm_sub_ps(centerX, cameraX);
+    __m128 viewY = _mm_sub_ps(centerY, cameraY);
+    __m128 viewZ = _mm_sub_ps(centerZ, cameraZ);
+    __m128 viewDot = _mm_add_ps(_mm_add_ps(
+      _mm_mul_ps(viewX, _mm_loadu_ps(&m_axisX[i])),
+      _mm_mul_ps(viewY, _mm_loadu_ps(&m_axisY[i]))),
+      _mm_mul_ps(viewZ, _mm_loadu_ps(&m_axisZ[i])));
+    __m128 viewLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+      _mm_mul_ps(viewX, viewX), _mm_mul_ps(viewY, viewY)), _mm_mul_ps(viewZ, viewZ)));
+    __m128 backfacing = _mm_cmpgt_ps(viewDot,
+      _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_cutoff[i]), viewLength), radius));
+
+    int insideMask = _mm_movemask_ps(inside);
+    int visibleMask = _mm_movemask_ps(_mm_andnot_ps(backfacing, inside));
+
+    size_t lanes = (m_meshletCount - i < 4) ? m_meshletCount - i : 4;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      bool laneInside = (insideMask >> lane) & 1;
+      bool laneVisible = (visibleMask >> lane) & 1;
+      m_visible[i + lane] = laneVisible;
+      frustumCulled += !laneInside;
+      backfaceCulled += laneInside && !laneVisible;
+    }
+  }
+#else
+  for (size_t i = 0; i < m_meshletCount; ++i) {
+    bool inside = true;
+    for (int p = 0; p < 6; ++p) {
+      float distance = planes[p].a * m_centerX[i] + planes[p].b * m_centerY[i] +
+        planes[p].c * m_centerZ[i] + planes[p].d;
+      inside = inside && distance >= -m_radius[i];
+    }
+
+    float viewX = m_centerX[i] - cameraPosition.x;
+    float viewY = m_centerY[i] - cameraPosition.y;
+    float viewZ = m_centerZ[i] - cameraPosition.z;
+    float viewDot = viewX * m_axisX[i] + viewY * m_axisY[i] + viewZ * m_axisZ[i];
+    float viewLength = std::sqrt(viewX * viewX + viewY * viewY + viewZ * viewZ);
+    bool backfacing = viewDot > m_cutoff[i] * viewLength + m_radius[i];
+
+    m_visible[i] = inside && !backfacing;
+    frustumCulled += !inside;
+    backfaceCulled += inside && backfacing;
+  }
+#endif
+
+  // Meshlets are contiguous in the index buffer, so neighbors merge into one
+  // draw; short runs of culled meshlets are drawn through, since the GPU rejects
+  // their triangles for less than the cost of another draw call
+  const unsigned int mergeGap = m_mergeGapTriangles * 3;
+  unsigned int visibleIndices = 0;
+  for (size_t i = 0; i < m_meshletCount; ++i) {
+    if (!m_visible[i]) {
+      continue;
+    }
+    const MeshletDrawRange& range = m_ranges[i];
+    if (!outRanges.empty() &&
+      range.indexOffset - (outRanges.back().indexOffset + outRanges.back().indexCount) <= mergeGap) {
+      outRanges.back().indexCount = range.indexOffset + range.indexCount - outRanges.back().indexOffset;
+    }
+    else {
+      outRanges.push_back(range);
+    }
+  }
+  for (const MeshletDrawRange& range : outRanges) {
+    visibleIndices += range.indexCount;
+  }
+
+  m_lastStats.frustumCulled = frustumCulled;
+  m_lastStats.backfaceCulled = backfaceCulled;
+  m_lastStats.visibleTriangles = visibleIndices / 3;
+  m_lastStats.drawRanges = static_cast<unsigned int>(outRanges.size());
+
+  auto end = std::chrono::steady_clock::now();
+  m_lastStats.cullMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void
+MeshletCuller::destroy() {
+  m_meshletCount = 0;
+  m_centerX.clear();
+  m_centerY.clear();
+  m_centerZ.clear();
+  m_radius.clear();
+  m_axisX.clear();
+  m_axisY.clear();
+  m_axisZ.clear();
+  m_cutoff.clear();
+  m_ranges.clear();
+  m_visible.clear();
+  m_lastStats = CullStats();
+}
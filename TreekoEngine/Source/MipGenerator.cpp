@@ -0,0 +1,426 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPGENERATOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+  // Linear values are encoded through a table of this many entries, enough for
+  // decode followed by encode to give back every sRGB byte
+  const unsigned int kEncodeTableSize = 1u << 14;
+
+  // Texels per band: small enough to spread a level over the workers, large
+  // enough to amortize the queueing
+  const unsigned int kBandTexels = 32768;
+
+  // Levels with fewer texels (over all images) than this do not use the pool
+  const size_t kParallelTexels = 65536;
+
+  // Kaiser window: half width in destination texels and shape
+  const double kKaiserWidth = 3.0;
+  const double kKaiserAlpha = 4.0;
+  const double kPi = 3.14159265358979323846;
+
+  double
+  besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+      term *= (x * 0.5 / k) * (x * 0.5 / k);
+      sum += term;
+      if (term < sum * 1e-12) {
+        break;
+      }
+    }
+    return sum;
+  }
+
+  double
+  kaiserSinc(double t) {
+    if (std::fabs(t) >= kKaiserWidth) {
+      return 0.0;
+    }
+    double sinc = (t == 0.0) ? 1.0 : std::sin(kPi * t) / (kPi * t);
+    double window = t / kKaiserWidth;
+    return sinc * besselI0(kKaiserAlpha * std::sqrt(1.0 - window * window)) / besselI0(kKaiserAlpha);
+  }
+
+  // One RGBA texel in float. With SSE2 it lives in a single register.
+#if MIPGENERATOR_SSE2
+  typedef __m128 Texel;
+
+  inline Texel
+  texelZero() { return _mm_setzero_ps(); }
+
+  inline Texel
+  texelLoad(const float* source) { return _mm_loadu_ps(source); }
+
+  inline void
+  texelStore(float* destination, Texel texel) { _mm_storeu_ps(destination, texel); }
+
+  inline Texel
+  texelMulAdd(Texel sum, Texel texel, float weight) {
+    return _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weight)));
+  }
+
+  // Clamps to [0, 1] and scales to the encode table (RGB) or to a byte (alpha)
+  inline void
+  texelQuantize(Texel texel, int* outIndices) {
+    const __m128 scale = _mm_set_ps(255.0f, kEncodeTableSize - 1.0f, kEncodeTableSize - 1.0f, kEncodeTableSize - 1.0f);
+    __m128 clamped = _mm_min_ps(_mm_max_ps(texel, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    __m128i scaled = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), _mm_set1_ps(0.5f)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outIndices), scaled);
+  }
+#else
+  struct Texel {
+    float c[4];
+  };
+
+  inline Texel
+  texelZero() { return Texel{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+
+  inline Texel
+  texelLoad(const float* source) { return Texel{ { source[0], source[1], source[2], source[3] } }; }
+
+  inline void
+  texelStore(float* destination, Texel texel) { memcpy(destination, texel.c, sizeof(texel.c)); }
+
+  inline Texel
+  texelMulAdd(Texel sum, Texel texel, float weight) {
+    for (int i = 0; i < 4; ++i) {
+      sum.c[i] += texel.c[i] * weight;
+    }
+    return sum;
+  }
+
+  inline void
+  texelQuantize(Texel texel, int* outIndices) {
+    for (int i = 0; i < 4; ++i) {
+      float scale = (i == 3) ? 255.0f : kEncodeTableSize - 1.0f;
+      float clamped = std::min(std::max(texel.c[i], 0.0f), 1.0f);
+      outIndices[i] = static_cast<int>(clamped * scale + 0.5f);
+    }
+  }
+#endif
+}
+
+unsigned int
+MipGenerator::mipCount(unsigned int width, unsigned int height) {
+  unsigned int levels = 1;
+  unsigned int size = std::max(width, height);
+  while (size > 1) {
+    size >>= 1;
+    ++levels;
+  }
+  return levels;
+}
+
+bool
+MipGenerator::generate(const MipImage& image, MipChain& outChain, unsigned int threadCount) {
+  std::vector<MipChain> chains;
+  if (!generate(&image, 1, chains, threadCount)) {
+    return false;
+  }
+  outChain = std::move(chains[0]);
+  return true;
+}
+
+bool
+MipGenerator::generate(const MipImage* images,
+  size_t imageCount,
+  std::vector<MipChain>& outChains,
+  unsigned int threadCount) {
+  for (size_t i = 0; i < imageCount; ++i) {
+    if (!images[i].pixels || images[i].width == 0 || images[i].height == 0) {
+      return false;
+    }
+  }
+
+  auto generateStart = std::chrono::steady_clock::now();
+  m_lastStats = MipStats();
+  m_lastStats.images = static_cast<unsigned int>(imageCount);
+  if (m_tablesSrgb != static_cast<int>(m_srgb)) {
+    buildTables();
+  }
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Lay out every chain and copy level 0
+  outChains.assign(imageCount, MipChain());
+  m_jobs.resize(imageCount);
+  unsigned int maxLevels = 0;
+  size_t firstLevelTexels = 0;
+  for (size_t i = 0; i < imageCount; ++i) {
+    MipJob& job = m_jobs[i];
+    job.image = &images[i];
+    job.chain = &outChains[i];
+    unsigned int levelCount = mipCount(images[i].width, images[i].height);
+    size_t offset = 0;
+    for (unsigned int level = 0; level < levelCount; ++level) {
+      MipLevel mipLevel;
+      mipLevel.width = std::max(1u, images[i].width >> level);
+      mipLevel.height = std::max(1u, images[i].height >> level);
+      mipLevel.offset = offset;
+      offset += static_cast<size_t>(mipLevel.width) * mipLevel.height * 4;
+      job.chain->levels.push_back(mipLevel);
+    }
+    job.chain->pixels.resize(offset);
+    memcpy(job.chain->pixels.data(), images[i].pixels, static_cast<size_t>(images[i].width) * images[i].height * 4);
+    if (levelCount > 1) {
+      firstLevelTexels += static_cast<size_t>(job.chain->levels[1].width) * job.chain->levels[1].height;
+    }
+    maxLevels = std::max(maxLevels, levelCount);
+    m_lastStats.levels += levelCount;
+    m_lastStats.bytes += offset;
+  }
+
+  // Small images are faster without the pool
+  std::unique_ptr<ThreadPool> workers;
+  if (threadCount > 1 && firstLevelTexels >= kParallelTexels) {
+    workers.reset(new ThreadPool(threadCount));
+  }
+  m_lastStats.threads = workers ? workers->size() : 1;
+
+  // Levels depend on the previous one, so they are built in order; within a
+  // level the bands of every image run in parallel
+  std::vector<std::future<void>> pending;
+  for (unsigned int level = 1; level < maxLevels; ++level) {
+    pending.clear();
+    size_t levelTexels = 0;
+    for (MipJob& job : m_jobs) {
+      if (level >= job.chain->levels.size()) {
+        continue;
+      }
+      const MipLevel& source = job.chain->levels[level - 1];
+      const MipLevel& target = job.chain->levels[level];
+      buildKernel(source.width, target.width, job.horizontal);
+      buildKernel(source.height, target.height, job.vertical);
+      job.target.resize(static_cast<size_t>(target.width) * target.height * 4);
+      levelTexels += static_cast<size_t>(target.width) * target.height;
+    }
+
+    for (MipJob& job : m_jobs) {
+      if (level >= job.chain->levels.size()) {
+        continue;
+      }
+      const MipLevel& target = job.chain->levels[level];
+      unsigned int bandRows = std::max(1u, kBandTexels / target.width);
+      for (unsigned int row = 0; row < target.height; row += bandRows) {
+        unsigned int rowEnd = std::min(target.height, row + bandRows);
+        ++m_lastStats.bands;
+        if (workers && levelTexels >= kParallelTexels) {
+          MipJob* bandJob = &job;
+          pending.push_back(workers->submit([this, bandJob, level, row, rowEnd]() {
+            resampleBand(*bandJob, level, row, rowEnd);
+          }));
+        }
+        else {
+          resampleBand(job, level, row, rowEnd);
+        }
+      }
+    }
+    for (std::future<void>& bandDone : pending) {
+      bandDone.get();
+    }
+
+    for (MipJob& job : m_jobs) {
+      if (level < job.chain->levels.size()) {
+        job.source.swap(job.target);
+      }
+    }
+  }
+
+  // Keep the capacity of the float levels for the next call, not the pointers
+  for (MipJob& job : m_jobs) {
+    job.image = nullptr;
+    job.chain = nullptr;
+  }
+
+  auto generateEnd = std::chrono::steady_clock::now();
+  m_lastStats.generateMs = std::chrono::duration<double, std::milli>(generateEnd - generateStart).count();
+  return true;
+}
+
+void
+MipGenerator::buildKernel(unsigned int sourceSize, unsigned int targetSize, MipKernel& outKernel) const {
+  double ratio = static_cast<double>(sourceSize) / targetSize;
+  double radius = (m_filter == MIP_KAISER) ? kKaiserWidth * ratio : ratio * 0.5;
+  unsigned int taps = (sourceSize == targetSize) ? 1 : static_cast<unsigned int>(std::ceil(radius)) * 2 + 1;
+
+  outKernel.taps = taps;
+  outKernel.indices.assign(static_cast<size_t>(targetSize) * taps, 0);
+  outKernel.weights.assign(static_cast<size_t>(targetSize) * taps, 0.0f);
+
+  for (unsigned int x = 0; x < targetSize; ++x) {
+    unsigned int* indices = &outKernel.indices[static_cast<size_t>(x) * taps];
+    float* weights = &outKernel.weights[static_cast<size_t>(x) * taps];
+    if (sourceSize == targetSize) {
+      indices[0] = x;
+      weights[0] = 1.0f;
+      continue;
+    }
+
+    // Source texel s covers [s, s + 1); the target texel is centered on center
+    double center = (x + 0.5) * ratio;
+    int first = static_cast<int>(std::floor(center - radius));
+    double sum = 0.0;
+    for (unsigned int tap = 0; tap < taps; ++tap) {
+      int s = first + static_cast<int>(tap);
+      double weight;
+      if (m_filter == MIP_KAISER) {
+        weight = kaiserSinc((s + 0.5 - center) / ratio);
+      }
+      else {
+        // Area of the source texel under the target footprint
+        double overlap = std::min<double>(s + 1, center + radius) - std::max<double>(s, center - radius);
+        weight = std::max(0.0, overlap);
+      }
+      indices[tap] = static_cast<unsigned int>(std::min(std::max(s, 0), static_cast<int>(sourceSize) - 1));
+      weights[tap] = static_cast<float>(weight);
+      sum += weight;
+    }
+    for (unsigned int tap = 0; tap < taps; ++tap) {
+      weights[tap] = static_cast<float>(weights[tap] / sum);
+    }
+  }
+
+  // Drop the taps that are zero for every texel (the footprint rarely needs
+  // the full padded width, e.g. a 2:1 box only reads 2 texels)
+  unsigned int usedTaps = 0;
+  for (unsigned int x = 0; x < targetSize; ++x) {
+    unsigned int* indices = &outKernel.indices[static_cast<size_t>(x) * taps];
+    float* weights = &outKernel.weights[static_cast<size_t>(x) * taps];
+    unsigned int begin = 0;
+    unsigned int end = taps;
+    while (begin < end && weights[begin] == 0.0f) {
+      ++begin;
+    }
+    while (end > begin && weights[end - 1] == 0.0f) {
+      --end;
+    }
+    std::copy(indices + begin, indices + end, indices);
+    std::copy(weights + begin, weights + end, weights);
+    std::fill(weights + (end - begin), weights + taps, 0.0f);
+    std::fill(indices + (end - begin), indices + taps, indices[0]);
+    usedTaps = std::max(usedTaps, end - begin);
+  }
+  if (usedTaps < taps) {
+    for (unsigned int x = 0; x < targetSize; ++x) {
+      std::copy(outKernel.indices.begin() + static_cast<size_t>(x) * taps,
+        outKernel.indices.begin() + static_cast<size_t>(x) * taps + usedTaps,
+        outKernel.indices.begin() + static_cast<size_t>(x) * usedTaps);
+      std::copy(outKernel.weights.begin() + static_cast<size_t>(x) * taps,
+        outKernel.weights.begin() + static_cast<size_t>(x) * taps + usedTaps,
+        outKernel.weights.begin() + static_cast<size_t>(x) * usedTaps);
+    }
+    outKernel.taps = usedTaps;
+    outKernel.indices.resize(static_cast<size_t>(targetSize) * usedTaps);
+    outKernel.weights.resize(static_cast<size_t>(targetSize) * usedTaps);
+  }
+}
+
+void
+MipGenerator::resampleBand(MipJob& job, unsigned int level, unsigned int rowBegin, unsigned int rowEnd) const {
+  const MipLevel& source = job.chain->levels[level - 1];
+  const MipLevel& target = job.chain->levels[level];
+  const MipKernel& horizontal = job.horizontal;
+  const MipKernel& vertical = job.vertical;
+
+  // Source rows read by the band
+  unsigned int firstRow = source.height;
+  unsigned int lastRow = 0;
+  for (size_t i = static_cast<size_t>(rowBegin) * vertical.taps; i < static_cast<size_t>(rowEnd) * vertical.taps; ++i) {
+    if (vertical.weights[i] != 0.0f) {
+      firstRow = std::min(firstRow, vertical.indices[i]);
+      lastRow = std::max(lastRow, vertical.indices[i]);
+    }
+  }
+
+  // Horizontal pass: every source row once, into target-width rows
+  const size_t targetRowFloats = static_cast<size_t>(target.width) * 4;
+  std::vector<float> filteredRows((lastRow - firstRow + 1) * targetRowFloats);
+  std::vector<float> decodedRow;
+  for (unsigned int row = firstRow; row <= lastRow; ++row) {
+    const float* sourceRow;
+    if (level == 1) {
+      // Level 0 is only available as bytes: decode one row to linear float
+      const unsigned char* bytes = job.image->pixels + static_cast<size_t>(row) * source.width * 4;
+      decodedRow.resize(static_cast<size_t>(source.width) * 4);
+      for (size_t i = 0; i < decodedRow.size(); i += 4) {
+        decodedRow[i + 0] = m_decodeColor[bytes[i + 0]];
+        decodedRow[i + 1] = m_decodeColor[bytes[i + 1]];
+        decodedRow[i + 2] = m_decodeColor[bytes[i + 2]];
+        decodedRow[i + 3] = m_decodeAlpha[bytes[i + 3]];
+      }
+      sourceRow = decodedRow.data();
+    }
+    else {
+      sourceRow = job.source.data() + static_cast<size_t>(row) * source.width * 4;
+    }
+
+    float* filteredRow = filteredRows.data() + (row - firstRow) * targetRowFloats;
+    for (unsigned int x = 0; x < target.width; ++x) {
+      const unsigned int* indices = &horizontal.indices[static_cast<size_t>(x) * horizontal.taps];
+      const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.taps];
+      Texel sum = texelZero();
+      for (unsigned int tap = 0; tap < horizontal.taps; ++tap) {
+        sum = texelMulAdd(sum, texelLoad(sourceRow + indices[tap] * 4), weights[tap]);
+      }
+      texelStore(filteredRow + x * 4, sum);
+    }
+  }
+
+  // Vertical pass, then encode
+  unsigned char* targetBytes = job.chain->pixels.data() + target.offset;
+  int quantized[4];
+  for (unsigned int y = rowBegin; y < rowEnd; ++y) {
+    const unsigned int* indices = &vertical.indices[static_cast<size_t>(y) * vertical.taps];
+    const float* weights = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+    float* targetRow = job.target.data() + static_cast<size_t>(y) * targetRowFloats;
+    unsigned char* byteRow = targetBytes + static_cast<size_t>(y) * target.width * 4;
+    for (unsigned int x = 0; x < target.width; ++x) {
+      Texel sum = texelZero();
+      for (unsigned int tap = 0; tap < vertical.taps; ++tap) {
+        if (weights[tap] != 0.0f) {
+          const float* filtered = filteredRows.data() + (indices[tap] - firstRow) * targetRowFloats + x * 4;
+          sum = texelMulAdd(sum, texelLoad(filtered), weights[tap]);
+        }
+      }
+      texelStore(targetRow + x * 4, sum);
+      texelQuantize(sum, quantized);
+      byteRow[x * 4 + 0] = m_encodeColor[quantized[0]];
+      byteRow[x * 4 + 1] = m_encodeColor[quantized[1]];
+      byteRow[x * 4 + 2] = m_encodeColor[quantized[2]];
+      byteRow[x * 4 + 3] = static_cast<unsigned char>(quantized[3]);
+    }
+  }
+}
+
+void
+MipGenerator::buildTables() {
+  for (int i = 0; i < 256; ++i) {
+    double value = i / 255.0;
+    if (m_srgb) {
+      value = (value <= 0.04045) ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+    }
+    m_decodeColor[i] = static_cast<float>(value);
+    m_decodeAlpha[i] = static_cast<float>(i / 255.0);
+  }
+
+  m_encodeColor.resize(kEncodeTableSize);
+  for (unsigned int i = 0; i < kEncodeTableSize; ++i) {
+    double value = static_cast<double>(i) / (kEncodeTableSize - 1);
+    if (m_srgb) {
+      value = (value <= 0.0031308) ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+    }
+    m_encodeColor[i] = static_cast<unsigned char>(std::min(255.0, std::floor(value * 255.0 + 0.5)));
+  }
+  m_tablesSrgb = static_cast<int>(m_srgb);
+}
@@ -1,134 +1,443 @@
 #include "ModelLoader.h"
-#include <fstream>      
-#include <sstream>      
-#include <string>       
-#include <vector>       
-#include <map>          
-//#include <cstdio>       
+#include "MappedFile.h"
+#include "MaterialLibrary.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "VertexCache.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 bool
-ModelLoader::loadModel(const std::string& fileName, MeshComponent& outMesh) {
-  std::ifstream modelFile(fileName);
+ModelLoader::loadModel(const std::string& fileName, MeshComponent& outMesh, unsigned int threadCount) {
+  MappedFile modelFile;
 
-  if (!modelFile.is_open()) 
+  if (!modelFile.open(fileName))
   {
     ERROR("ModelLoader.cpp", "loadModel", "El archivo pudo abrirse.");
     return false;
   }
 
-  std::string currentLine;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
 
-  std::vector<XMFLOAT3> vertexPositions;
-  std::vector<XMFLOAT2> textureCoords;
-  std::vector<XMFLOAT3> vertexNormals;
+  m_lastStats = LoadStats();
+  m_lastStats.fileBytes = modelFile.size();
+
+  // Split the file into line-aligned chunks of roughly equal size
+  const char* fileBegin = modelFile.data();
+  const char* fileEnd = fileBegin + modelFile.size();
+  std::vector<const char*> chunkBounds;
+  chunkBounds.push_back(fileBegin);
+  for (unsigned int i = 1; i < threadCount; ++i) {
+    const char* split = fileBegin + modelFile.size() / threadCount * i;
+    split = std::max(split, chunkBounds.back());
+    split = ObjTokenizer::findLineEnd(split, fileEnd);
+    if (split < fileEnd) {
+      ++split;
+    }
+    if (split > chunkBounds.back() && split < fileEnd) {
+      chunkBounds.push_back(split);
+    }
+  }
+  chunkBounds.push_back(fileEnd);
+
+  std::vector<ObjChunk> chunks(chunkBounds.size() - 1);
+  m_lastStats.chunkCount = static_cast<unsigned int>(chunks.size());
+
+  auto parseStart = std::chrono::steady_clock::now();
+  if (chunks.size() == 1) {
+    parseChunk(chunkBounds[0], chunkBounds[1], chunks[0]);
+  }
+  else {
+    ThreadPool workers(static_cast<unsigned int>(chunks.size()));
+    std::vector<std::future<void>> pending;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      pending.push_back(workers.submit([this, &chunkBounds, &chunks, i]() {
+        parseChunk(chunkBounds[i], chunkBounds[i + 1], chunks[i]);
+      }));
+    }
+    for (std::future<void>& chunkDone : pending) {
+      chunkDone.get();
+    }
+  }
+  auto parseEnd = std::chrono::steady_clock::now();
+
+  bool assembled = assembleMesh(chunks, outMesh);
+  auto assembleEnd = std::chrono::steady_clock::now();
+
+  m_lastStats.parseMs = std::chrono::duration<double, std::milli>(parseEnd - parseStart).count();
+  m_lastStats.assembleMs = std::chrono::duration<double, std::milli>(assembleEnd - parseEnd).count();
+
+  modelFile.close();
+
+  if (assembled && !outMesh.m_materials.empty()) {
+    resolveMaterials(fileName, chunks, outMesh);
+  }
+
+  if (assembled && m_optimizeMesh) {
+    if (m_optimizer.optimize(outMesh)) {
+      m_lastStats.optimize = m_optimizer.getLastStats();
+    }
+  }
+
+  if (assembled && m_buildMeshlets) {
+    if (m_meshletBuilder.build(outMesh)) {
+      m_lastStats.meshlets = m_meshletBuilder.getLastStats();
+      // Meshlets regroup the triangles; restore the forward vertex fetch order
+      if (m_optimizeMesh) {
+        m_optimizer.optimizeVertexFetch(outMesh.m_vertex, outMesh.m_index);
+      }
+    }
+  }
+
+  if (assembled && m_buildLods) {
+    if (m_simplifier.buildLodChain(outMesh)) {
+      m_lastStats.lods = m_simplifier.getLastStats();
+      // Level 0 is already in cache order; the simplified levels are not.
+      // Material ranges are optimized one by one so they stay contiguous.
+      if (m_optimizeMesh && outMesh.m_submeshes.empty()) {
+        for (size_t i = 1; i < outMesh.m_lods.size(); ++i) {
+          m_optimizer.optimizeVertexCache(outMesh.m_index.data() + outMesh.m_lods[i].indexOffset,
+            outMesh.m_lods[i].indexCount, outMesh.m_vertex.size());
+        }
+      }
+      else if (m_optimizeMesh && outMesh.m_lods.size() > 1) {
+        for (const Submesh& submesh : outMesh.m_submeshes) {
+          if (submesh.indexOffset >= outMesh.m_lods[1].indexOffset) {
+            m_optimizer.optimizeVertexCache(outMesh.m_index.data() + submesh.indexOffset,
+              submesh.indexCount, outMesh.m_vertex.size());
+          }
+        }
+      }
+    }
+  }
+
+  if (assembled && m_writeMeshCache) {
+    if (!MeshCache::write(MeshCache::cachePathFor(fileName), fileName, outMesh, m_compressMeshCache)) {
+      ERROR("ModelLoader.cpp", "loadModel", "No se pudo escribir la cache .tmesh.");
+    }
+  }
+  return assembled;
+}
 
-  std::map<std::string, int> vertexCache;
+void
+ModelLoader::parseChunk(const char* begin, const char* end, ObjChunk& outChunk) {
+  ObjTokenizer tokenizer(begin, end);
+  const char* tokenBegin;
+  const char* tokenEnd;
 
-  while (std::getline(modelFile, currentLine)) {
-    std::stringstream lineStream(currentLine);
-    std::string lineHeader;
-    lineStream >> lineHeader;
+  while (tokenizer.nextLine()) {
+    if (!tokenizer.nextToken(tokenBegin, tokenEnd)) {
+      continue;
+    }
+    std::string_view lineHeader(tokenBegin, tokenEnd - tokenBegin);
 
     if (lineHeader == "vt") {
-      parseVec2(lineStream, textureCoords);
+      parseVec2(tokenizer, outChunk.texCoords);
     }
     else if (lineHeader == "vn") {
-      parseVec3(lineStream, vertexNormals);
+      parseVec3(tokenizer, outChunk.normals);
     }
     else if (lineHeader == "v") {
-      parseVec3(lineStream, vertexPositions);
+      parseVec3(tokenizer, outChunk.positions);
     }
     else if (lineHeader == "f") {
-      std::string vertexDataString;
-      std::vector<int> indicesForThisFace;
+      unsigned int faceSize = 0;
 
-      while (lineStream >> vertexDataString) {
+      while (tokenizer.nextToken(tokenBegin, tokenEnd)) {
+        ObjFaceCorner corner;
 
-        int finalIndex = 0;
+        int itemsRead = ObjTokenizer::parseFaceCorner(tokenBegin, tokenEnd,
+          corner.posIndex, corner.uvIndex, corner.normIndex);
+
+        if (itemsRead != 3) {
+          outChunk.error = "Datos no completados.";
+          return;
+        }
 
-        auto cacheEntry = vertexCache.find(vertexDataString);
+        corner.posIndex--;
+        corner.uvIndex--;
+        corner.normIndex--;
 
-        if (cacheEntry != vertexCache.end()) {
-         
-          finalIndex = cacheEntry->second;
+        if (corner.posIndex < 0 || corner.uvIndex < 0 || corner.normIndex < 0) {
+          outChunk.error = "ndice de vrtice fuera de rango.";
+          return;
         }
-        else {
-          
-          int posIndex, uvIndex, normIndex;
 
-          int itemsRead = sscanf(vertexDataString.c_str(), "%d/%d/%d",
-            &posIndex, &uvIndex, &normIndex);
+        // How far past the attributes read so far this corner points;
+        // resolved against the preceding chunks in assembleMesh
+        outChunk.maxPosExcess = std::max(outChunk.maxPosExcess,
+          corner.posIndex - static_cast<int>(outChunk.positions.size()));
+        outChunk.maxUVExcess = std::max(outChunk.maxUVExcess,
+          corner.uvIndex - static_cast<int>(outChunk.texCoords.size()));
+        outChunk.maxNormExcess = std::max(outChunk.maxNormExcess,
+          corner.normIndex - static_cast<int>(outChunk.normals.size()));
 
-          if (itemsRead != 3) {
-            ERROR("ModelLoader.cpp", "loadModel", "Datos no completados.");
-            return false;
-          }
+        outChunk.corners.push_back(corner);
+        ++faceSize;
+      }
+
+      outChunk.faceSizes.push_back(faceSize);
+    }
+    else if (lineHeader == "usemtl") {
+      ObjMaterialUse materialUse;
+      materialUse.faceIndex = static_cast<unsigned int>(outChunk.faceSizes.size());
+      if (tokenizer.restOfLine(tokenBegin, tokenEnd)) {
+        materialUse.name.assign(tokenBegin, tokenEnd);
+      }
+      outChunk.materialUses.push_back(std::move(materialUse));
+    }
+    else if (lineHeader == "mtllib") {
+      if (tokenizer.restOfLine(tokenBegin, tokenEnd)) {
+        outChunk.materialLibraries.emplace_back(tokenBegin, tokenEnd);
+      }
+    }
+  }
+}
 
-          posIndex--;
-          uvIndex--;
-          normIndex--;
+bool
+ModelLoader::assembleMesh(std::vector<ObjChunk>& chunks, MeshComponent& outMesh) {
+  size_t totalPositions = 0;
+  size_t totalTexCoords = 0;
+  size_t totalNormals = 0;
 
-          if (posIndex < 0 || posIndex >= vertexPositions.size() ||
-            uvIndex < 0 || uvIndex >= textureCoords.size() ||
-            normIndex < 0 || normIndex >= vertexNormals.size()) {
+  for (const ObjChunk& chunk : chunks) {
+    if (chunk.error) {
+      ERROR("ModelLoader.cpp", "loadModel", chunk.error);
+      return false;
+    }
+    if (chunk.maxPosExcess >= static_cast<int>(totalPositions) ||
+      chunk.maxUVExcess >= static_cast<int>(totalTexCoords) ||
+      chunk.maxNormExcess >= static_cast<int>(totalNormals)) {
+      ERROR("ModelLoader.cpp", "loadModel", "ndice de vrtice fuera de rango.");
+      return false;
+    }
+    totalPositions += chunk.positions.size();
+    totalTexCoords += chunk.texCoords.size();
+    totalNormals += chunk.normals.size();
+  }
 
-            ERROR("ModelLoader.cpp", "loadModel", "ndice de vrtice fuera de rango.");
-            return false;
-          }
+  std::vector<XMFLOAT3> vertexPositions;
+  std::vector<XMFLOAT2> textureCoords;
+  std::vector<XMFLOAT3> vertexNormals;
+  vertexPositions.reserve(totalPositions);
+  textureCoords.reserve(totalTexCoords);
+  vertexNormals.reserve(totalNormals);
+
+  for (ObjChunk& chunk : chunks) {
+    vertexPositions.insert(vertexPositions.end(), chunk.positions.begin(), chunk.positions.end());
+    textureCoords.insert(textureCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+    vertexNormals.insert(vertexNormals.end(), chunk.normals.begin(), chunk.normals.end());
+    chunk.positions = std::vector<XMFLOAT3>();
+    chunk.texCoords = std::vector<XMFLOAT2>();
+    chunk.normals = std::vector<XMFLOAT3>();
+  }
+
+  // Size everything from the first pass: a mesh has at least as many unique
+  // vertices as its largest attribute stream and at most one per face corner
+  size_t totalCorners = 0;
+  size_t totalIndices = 0;
+  unsigned int maxFaceSize = 0;
+  for (const ObjChunk& chunk : chunks) {
+    totalCorners += chunk.corners.size();
+    for (unsigned int faceSize : chunk.faceSizes) {
+      totalIndices += (faceSize >= 3) ? (faceSize - 2) * 3 : 0;
+      maxFaceSize = std::max(maxFaceSize, faceSize);
+    }
+  }
+  size_t expectedVertices = std::min(totalCorners,
+    std::max(totalPositions, std::max(totalTexCoords, totalNormals)));
+
+  VertexCache vertexCache;
+  vertexCache.reserve(expectedVertices);
+  outMesh.m_vertex.reserve(outMesh.m_vertex.size() + expectedVertices);
+  outMesh.m_index.reserve(outMesh.m_index.size() + totalIndices);
+
+  // Reused for every face, so the loop below does not allocate
+  std::vector<unsigned int> faceIndices;
+  faceIndices.reserve(maxFaceSize);
+
+  // Material of every triangle, numbered in order of first use. Faces before
+  // the first usemtl get an unnamed default material.
+  const size_t baseIndex = outMesh.m_index.size();
+  bool usesMaterials = false;
+  for (const ObjChunk& chunk : chunks) {
+    usesMaterials = usesMaterials || !chunk.materialUses.empty();
+  }
+  outMesh.m_submeshes.clear();
+  outMesh.m_materials.clear();
+  m_triangleMaterials.clear();
+  if (usesMaterials) {
+    m_triangleMaterials.reserve(totalIndices / 3);
+  }
+  std::unordered_map<std::string, unsigned int> materialIds;
+  const std::string defaultMaterialName;
+  const std::string* materialName = &defaultMaterialName;
+  const std::string* currentMaterialName = nullptr;
+  unsigned int currentMaterial = 0;
+
+  for (const ObjChunk& chunk : chunks) {
+    const ObjFaceCorner* corner = chunk.corners.data();
+    const ObjMaterialUse* materialUse = chunk.materialUses.data();
+    const ObjMaterialUse* materialUseEnd = materialUse + chunk.materialUses.size();
+    unsigned int faceIndex = 0;
+
+    for (unsigned int faceSize : chunk.faceSizes) {
+      faceIndices.clear();
+
+      for (; materialUse != materialUseEnd && materialUse->faceIndex == faceIndex; ++materialUse) {
+        materialName = &materialUse->name;
+      }
+      ++faceIndex;
+      // Registered on first use, so a usemtl without faces adds no material
+      if (usesMaterials && materialName != currentMaterialName) {
+        auto inserted = materialIds.emplace(*materialName, static_cast<unsigned int>(materialIds.size()));
+        if (inserted.second) {
+          outMesh.m_materials.emplace_back();
+          outMesh.m_materials.back().name = *materialName;
+        }
+        currentMaterial = inserted.first->second;
+        currentMaterialName = materialName;
+      }
+      const size_t faceIndexStart = outMesh.m_index.size();
+
+      for (unsigned int i = 0; i < faceSize; ++i, ++corner) {
+        bool isNewVertex = false;
+        int finalIndex = vertexCache.findOrInsert(corner->posIndex,
+          corner->uvIndex,
+          corner->normIndex,
+          static_cast<int>(outMesh.m_vertex.size()),
+          isNewVertex);
+
+        if (isNewVertex) {
 
           SimpleVertex newFinalVertex;
-          newFinalVertex.Pos = vertexPositions[posIndex];
-          newFinalVertex.Tex = textureCoords[uvIndex];
+          newFinalVertex.Pos = vertexPositions[corner->posIndex];
+          newFinalVertex.Tex = textureCoords[corner->uvIndex];
 
-          newFinalVertex.Norm = vertexNormals[normIndex];
+          newFinalVertex.Norm = vertexNormals[corner->normIndex];
 
           outMesh.m_vertex.push_back(newFinalVertex);
-
-          int newFinalIndex = static_cast<int>(outMesh.m_vertex.size()) - 1;
-          vertexCache[vertexDataString] = newFinalIndex;
-          finalIndex = newFinalIndex;
         }
 
-        indicesForThisFace.push_back(finalIndex);
+        faceIndices.push_back(static_cast<unsigned int>(finalIndex));
       }
 
-      if (indicesForThisFace.size() == 3) {
-       
-        outMesh.m_index.push_back(indicesForThisFace[0]);
-        outMesh.m_index.push_back(indicesForThisFace[1]);
-        outMesh.m_index.push_back(indicesForThisFace[2]);
+      if (faceSize == 3) {
+
+        outMesh.m_index.push_back(faceIndices[0]);
+        outMesh.m_index.push_back(faceIndices[1]);
+        outMesh.m_index.push_back(faceIndices[2]);
       }
-      else if (indicesForThisFace.size() == 4) {
-        
-        outMesh.m_index.push_back(indicesForThisFace[0]);
-        outMesh.m_index.push_back(indicesForThisFace[1]);
-        outMesh.m_index.push_back(indicesForThisFace[2]);
-
-        outMesh.m_index.push_back(indicesForThisFace[0]);
-        outMesh.m_index.push_back(indicesForThisFace[2]);
-        outMesh.m_index.push_back(indicesForThisFace[3]);
+      else if (faceSize > 3) {
+
+        m_triangulator.triangulate(faceIndices.data(),
+          faceSize,
+          outMesh.m_vertex,
+          m_triangulationMode,
+          outMesh.m_index);
+      }
+
+      if (usesMaterials) {
+        m_triangleMaterials.insert(m_triangleMaterials.end(),
+          (outMesh.m_index.size() - faceIndexStart) / 3, currentMaterial);
       }
     }
   }
 
+  // Group the triangles by material (stable, so each group keeps file order)
+  if (usesMaterials) {
+    std::vector<unsigned int> materialStart(outMesh.m_materials.size() + 1, 0);
+    for (unsigned int material : m_triangleMaterials) {
+      ++materialStart[material + 1];
+    }
+    for (size_t i = 0; i < outMesh.m_materials.size(); ++i) {
+      Submesh submesh;
+      submesh.indexOffset = static_cast<unsigned int>(baseIndex + materialStart[i] * 3);
+      submesh.indexCount = materialStart[i + 1] * 3;
+      submesh.materialIndex = static_cast<unsigned int>(i);
+      outMesh.m_submeshes.push_back(submesh);
+      materialStart[i + 1] += materialStart[i];
+    }
+
+    m_sortedIndices.resize(m_triangleMaterials.size() * 3);
+    const unsigned int* triangles = outMesh.m_index.data() + baseIndex;
+    for (size_t triangle = 0; triangle < m_triangleMaterials.size(); ++triangle) {
+      unsigned int* destination = &m_sortedIndices[materialStart[m_triangleMaterials[triangle]]++ * 3];
+      destination[0] = triangles[triangle * 3 + 0];
+      destination[1] = triangles[triangle * 3 + 1];
+      destination[2] = triangles[triangle * 3 + 2];
+    }
+    std::copy(m_sortedIndices.begin(), m_sortedIndices.end(), outMesh.m_index.begin() + baseIndex);
+  }
+
 
   outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
   outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
 
-  modelFile.close();
+  if (!outMesh.m_vertex.empty()) {
+    outMesh.m_boundsMin = outMesh.m_vertex[0].Pos;
+    outMesh.m_boundsMax = outMesh.m_vertex[0].Pos;
+    for (const SimpleVertex& vertex : outMesh.m_vertex) {
+      outMesh.m_boundsMin.x = std::min(outMesh.m_boundsMin.x, vertex.Pos.x);
+      outMesh.m_boundsMin.y = std::min(outMesh.m_boundsMin.y, vertex.Pos.y);
+      outMesh.m_boundsMin.z = std::min(outMesh.m_boundsMin.z, vertex.Pos.z);
+      outMesh.m_boundsMax.x = std::max(outMesh.m_boundsMax.x, vertex.Pos.x);
+      outMesh.m_boundsMax.y = std::max(outMesh.m_boundsMax.y, vertex.Pos.y);
+      outMesh.m_boundsMax.z = std::max(outMesh.m_boundsMax.z, vertex.Pos.z);
+    }
+  }
+  m_lastStats.vertexCacheBytes = vertexCache.memoryBytes();
+
   return true;
 }
 
 void
-ModelLoader::parseVec2(std::stringstream& lineData, std::vector<XMFLOAT2>& dataPool) {
+ModelLoader::resolveMaterials(const std::string& fileName,
+  const std::vector<ObjChunk>& chunks,
+  MeshComponent& outMesh) {
+  const std::filesystem::path directory = std::filesystem::path(fileName).parent_path();
+  MaterialLibrary library;
+  for (const ObjChunk& chunk : chunks) {
+    for (const std::string& libraryName : chunk.materialLibraries) {
+      if (!library.load((directory / libraryName).string())) {
+        ERROR("ModelLoader.cpp", "loadModel",
+          ("No se pudo abrir la biblioteca de materiales " + libraryName).c_str());
+      }
+    }
+  }
+
+  m_lastStats.materials = static_cast<unsigned int>(outMesh.m_materials.size());
+  for (Material& material : outMesh.m_materials) {
+    const Material* definition = library.findMaterial(material.name);
+    if (definition) {
+      material = *definition;
+    }
+    else if (!material.name.empty()) {
+      ++m_lastStats.missingMaterials;
+    }
+  }
+}
+
+void
+ModelLoader::parseVec2(ObjTokenizer& lineData, std::vector<XMFLOAT2>& dataPool) {
   XMFLOAT2 v2;
-  lineData >> v2.x >> v2.y;
+  lineData.readFloat(v2.x);
+  lineData.readFloat(v2.y);
   dataPool.push_back(v2);
 }
 
 void
-ModelLoader::parseVec3(std::stringstream& lineData, std::vector<XMFLOAT3>& dataPool) {
+ModelLoader::parseVec3(ObjTokenizer& lineData, std::vector<XMFLOAT3>& dataPool) {
   XMFLOAT3 v3;
-  lineData >> v3.x >> v3.y >> v3.z;
+  lineData.readFloat(v3.x);
+  lineData.readFloat(v3.y);
+  lineData.readFloat(v3.z);
   dataPool.push_back(v3);
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "PolygonTriangulator.h"
+#include <cmath>
+
+namespace {
+  float
+  cross2(const XMFLOAT2& origin, const XMFLOAT2& a, const XMFLOAT2& b) {
+    return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+  }
+}
+
+void
+PolygonTriangulator::triangulate(const unsigned int* corners,
+  unsigned int cornerCount,
+  const std::vector<SimpleVertex>& vertices,
+  TriangulationMode mode,
+  std::vector<unsigned int>& outIndices) {
+  if (cornerCount < 3) {
+    return;
+  }
+  if (cornerCount == 3 || mode == TRIANGULATE_FAN) {
+    triangulateFan(corners, cornerCount, outIndices);
+    return;
+  }
+
+  float orientation = projectCorners(corners, cornerCount, vertices);
+
+  // Degenerate (zero area) polygons have no meaningful ears
+  if (orientation == 0.0f ||
+    (mode == TRIANGULATE_AUTO && isConvex(cornerCount, orientation))) {
+    triangulateFan(corners, cornerCount, outIndices);
+    return;
+  }
+
+  triangulateEarClipping(corners, cornerCount, orientation, outIndices);
+}
+
+void
+PolygonTriangulator::triangulateFan(const unsigned int* corners,
+  unsigned int cornerCount,
+  std::vector<unsigned int>& outIndices) {
+  for (unsigned int i = 1; i + 1 < cornerCount; ++i) {
+    outIndices.push_back(corners[0]);
+    outIndices.push_back(corners[i]);
+    outIndices.push_back(corners[i + 1]);
+  }
+}
+
+void
+PolygonTriangulator::triangulateEarClipping(const unsigned int* corners,
+  unsigned int cornerCount,
+  float orientation,
+  std::vector<unsigned int>& outIndices) {
+  m_next.resize(cornerCount);
+  m_prev.resize(cornerCount);
+  for (unsigned int i = 0; i < cornerCount; ++i) {
+    m_next[i] = (i + 1) % cornerCount;
+    m_prev[i] = (i + cornerCount - 1) % cornerCount;
+  }
+
+  // A convex turn has the same sign as the polygon's area
+  float sign = (orientation > 0.0f) ? 1.0f : -1.0f;
+
+  unsigned int remaining = cornerCount;
+  unsigned int current = 0;
+  unsigned int misses = 0;
+
+  while (remaining > 3) {
+    unsigned int prev = m_prev[current];
+    unsigned int next = m_next[current];
+    const XMFLOAT2& a = m_projected[prev];
+    const XMFLOAT2& b = m_projected[current];
+    const XMFLOAT2& c = m_projected[next];
+
+    bool isEar = cross2(a, b, c) * sign > 0.0f;
+    for (unsigned int other = m_next[next]; isEar && other != prev; other = m_next[other]) {
+      const XMFLOAT2& p = m_projected[other];
+      if (cross2(a, b, p) * sign >= 0.0f &&
+        cross2(b, c, p) * sign >= 0.0f &&
+        cross2(c, a, p) * sign >= 0.0f) {
+        isEar = false;
+      }
+    }
+
+    // A full lap without an ear means the outline self-intersects; clip
+    // anyway so the face still produces cornerCount - 2 triangles
+    if (isEar || misses > remaining) {
+      outIndices.push_back(corners[prev]);
+      outIndices.push_back(corners[current]);
+      outIndices.push_back(corners[next]);
+      m_next[prev] = next;
+      m_prev[next] = prev;
+      --remaining;
+      misses = 0;
+      current = next;
+    }
+    else {
+      ++misses;
+      current = next;
+    }
+  }
+
+  outIndices.push_back(corners[m_prev[current]]);
+  outIndices.push_back(corners[current]);
+  outIndices.push_back(corners[m_next[current]]);
+}
+
+float
+PolygonTriangulator::projectCorners(const unsigned int* corners,
+  unsigned int cornerCount,
+  const std::vector<SimpleVertex>& vertices) {
+  // Newell's method gives a robust normal even for slightly non-planar faces
+  float nx = 0.0f;
+  float ny = 0.0f;
+  float nz = 0.0f;
+  for (unsigned int i = 0; i < cornerCount; ++i) {
+    const XMFLOAT3& a = vertices[corners[i]].Pos;
+    const XMFLOAT3& b = vertices[corners[(i + 1) % cornerCount]].Pos;
+    nx += (a.y - b.y) * (a.z + b.z);
+    ny += (a.z - b.z) * (a.x + b.x);
+    nz += (a.x - b.x) * (a.y + b.y);
+  }
+
+  // Drop the dominant axis of the normal
+  float ax = std::fabs(nx);
+  float ay = std::fabs(ny);
+  float az = std::fabs(nz);
+
+  m_projected.resize(cornerCount);
+  for (unsigned int i = 0; i < cornerCount; ++i) {
+    const XMFLOAT3& p = vertices[corners[i]].Pos;
+    if (az >= ax && az >= ay) {
+      m_projected[i] = XMFLOAT2(p.x, p.y);
+    }
+    else if (ax >= ay) {
+      m_projected[i] = XMFLOAT2(p.y, p.z);
+    }
+    else {
+      m_projected[i] = XMFLOAT2(p.z, p.x);
+    }
+  }
+
+  float area = 0.0f;
+  for (unsigned int i = 0; i < cornerCount; ++i) {
+    const XMFLOAT2& a = m_projected[i];
+    const XMFLOAT2& b = m_projected[(i + 1) % cornerCount];
+    area += a.x * b.y - a.y * b.x;
+  }
+  return area;
+}
+
+bool
+PolygonTriangulator::isConvex(unsigned int cornerCount, float orientation) const {
+  for (unsigned int i = 0; i < cornerCount; ++i) {
+    const XMFLOAT2& a = m_projected[(i + cornerCount - 1) % cornerCount];
+    const XMFLOAT2& b = m_projected[i];
+    const XMFLOAT2& c = m_projected[(i + 1) % cornerCount];
+    if (cross2(a, b, c) * orientation < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,105 @@
+#include "RenderQueue.h"
+#include "DeviceContext.h"
+#include "Texture.h"
+#include "SamplerState.h"
+#include <algorithm>
+
+void
+RenderQueue::add(unsigned int materialIndex, unsigned int indexOffset, unsigned int indexCount) {
+  if (indexCount == 0) {
+    return;
+  }
+  m_items.push_back({ materialIndex, indexOffset, indexCount });
+}
+
+void
+RenderQueue::addRanges(const std::vector<MeshletDrawRange>& ranges, const std::vector<Submesh>& submeshes) {
+  if (submeshes.empty()) {
+    for (const MeshletDrawRange& range : ranges) {
+      add(0, range.indexOffset, range.indexCount);
+    }
+    return;
+  }
+
+  for (const MeshletDrawRange& range : ranges) {
+    const unsigned int rangeEnd = range.indexOffset + range.indexCount;
+    // Last submesh starting at or before the range
+    auto submesh = std::upper_bound(submeshes.begin(), submeshes.end(), range.indexOffset,
+      [](unsigned int offset, const Submesh& candidate) { return offset < candidate.indexOffset; });
+    if (submesh != submeshes.begin()) {
+      --submesh;
+    }
+    for (; submesh != submeshes.end() && submesh->indexOffset < rangeEnd; ++submesh) {
+      unsigned int begin = std::max(range.indexOffset, submesh->indexOffset);
+      unsigned int end = std::min(rangeEnd, submesh->indexOffset + submesh->indexCount);
+      if (begin < end) {
+        add(submesh->materialIndex, begin, end - begin);
+      }
+    }
+  }
+}
+
+void
+RenderQueue::submit(DeviceContext& deviceContext, const std::vector<MaterialBinding>& materials) {
+  m_lastStats = SubmitStats();
+  m_lastStats.items = static_cast<unsigned int>(m_items.size());
+
+  // What binding in submission order would have cost
+  const Texture* boundTexture = nullptr;
+  const SamplerState* boundSampler = nullptr;
+  for (const DrawItem& item : m_items) {
+    if (item.materialIndex >= materials.size()) {
+      continue;
+    }
+    const MaterialBinding& binding = materials[item.materialIndex];
+    if (binding.texture && binding.texture != boundTexture) {
+      boundTexture = binding.texture;
+      ++m_lastStats.unsortedTextureBinds;
+    }
+    if (binding.sampler && binding.sampler != boundSampler) {
+      boundSampler = binding.sampler;
+      ++m_lastStats.unsortedSamplerBinds;
+    }
+  }
+
+  std::sort(m_items.begin(), m_items.end(), [](const DrawItem& a, const DrawItem& b) {
+    if (a.materialIndex != b.materialIndex) {
+      return a.materialIndex < b.materialIndex;
+    }
+    return a.indexOffset < b.indexOffset;
+  });
+
+  boundTexture = nullptr;
+  boundSampler = nullptr;
+  for (size_t i = 0; i < m_items.size();) {
+    const DrawItem& first = m_items[i];
+    unsigned int indexEnd = first.indexOffset + first.indexCount;
+    size_t next = i + 1;
+    while (next < m_items.size() && m_items[next].materialIndex == first.materialIndex &&
+      m_items[next].indexOffset == indexEnd) {
+      indexEnd += m_items[next].indexCount;
+      ++next;
+    }
+
+    if (i > 0 && m_items[i - 1].materialIndex != first.materialIndex) {
+      ++m_lastStats.materialChanges;
+    }
+    if (first.materialIndex < materials.size()) {
+      const MaterialBinding& binding = materials[first.materialIndex];
+      if (binding.texture && binding.texture != boundTexture) {
+        binding.texture->render(deviceContext, 0, 1);
+        boundTexture = binding.texture;
+        ++m_lastStats.textureBinds;
+      }
+      if (binding.sampler && binding.sampler != boundSampler) {
+        binding.sampler->render(deviceContext, 0, 1);
+        boundSampler = binding.sampler;
+        ++m_lastStats.samplerBinds;
+      }
+    }
+
+    deviceContext.DrawIndexed(indexEnd - first.indexOffset, first.indexOffset, 0);
+    ++m_lastStats.drawCalls;
+    i = next;
+  }
+}
@@ -0,0 +1,78 @@
+#include "RingAllocator.h"
+#include <algorithm>
+
+RingAllocator::RingAllocator(uint64_t capacity, uint64_t alignment) {
+  reset(capacity, alignment);
+}
+
+void
+RingAllocator::reset(uint64_t capacity, uint64_t alignment) {
+  m_alignment = alignment > 0 ? alignment : 1;
+  m_capacity = capacity / m_alignment * m_alignment;
+  m_allocated = 0;
+  m_released = 0;
+  m_frames.clear();
+  m_stats = RingStats();
+}
+
+bool
+RingAllocator::allocate(uint64_t size, Allocation& outAllocation) {
+  if (size == 0 || size > m_capacity) {
+    ++m_stats.failures;
+    return false;
+  }
+
+  // An empty ring starts over at offset 0, so a large range does not fail
+  // on the tail skipped by the previous ones
+  if (used() == 0) {
+    m_allocated = (m_allocated + m_capacity - 1) / m_capacity * m_capacity;
+    m_released = m_allocated;
+  }
+
+  const uint64_t head = m_allocated % m_capacity;
+  uint64_t offset = (head + m_alignment - 1) / m_alignment * m_alignment;
+  uint64_t padding = offset - head;
+  bool wrapped = head == 0 && m_allocated > 0;
+  // Never split a range across the end: skip the tail and start over
+  if (offset + size > m_capacity) {
+    padding = m_capacity - head;
+    offset = 0;
+    wrapped = true;
+  }
+  if (used() + padding + size > m_capacity) {
+    ++m_stats.failures;
+    return false;
+  }
+
+  m_allocated += padding + size;
+  outAllocation.offset = offset;
+  outAllocation.size = size;
+  outAllocation.wrapped = wrapped;
+
+  ++m_stats.allocations;
+  m_stats.wraps += wrapped;
+  if (used() > m_stats.peakUsed) {
+    m_stats.peakUsed = used();
+  }
+  return true;
+}
+
+void
+RingAllocator::endFrame(uint64_t fence) {
+  m_frames.push_back({ fence, m_allocated });
+}
+
+void
+RingAllocator::retire(uint64_t completedFence) {
+  while (!m_frames.empty() && m_frames.front().fence <= completedFence) {
+    // A frame ended before the ring started over holds nothing anymore
+    m_released = std::max(m_released, m_frames.front().allocatedEnd);
+    m_frames.pop_front();
+  }
+}
+
+void
+RingAllocator::releaseAll() {
+  m_released = m_allocated;
+  m_frames.clear();
+}
@@ -0,0 +1,250 @@
+#include "ShaderCache.h"
+#include "HashUtils.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace {
+  // Chains a string, with its length so "ab"+"c" differs from "a"+"bc"
+  uint64_t
+  hashString(const std::string& text, uint64_t seed) {
+    return hashBytes64(text.data(), text.size(), seed);
+  }
+}
+
+ShaderCache::ShaderCache(const std::string& directory)
+  : m_directory(directory) {}
+
+bool
+ShaderCache::computeKey(const CompileRequest& request, uint64_t& outKey) {
+  const std::string rootDirectory = std::filesystem::path(request.sourcePath).parent_path().string();
+  std::unordered_set<std::string> visited;
+  visited.insert(std::filesystem::path(request.sourcePath).lexically_normal().string());
+  uint64_t hash = kVersion;
+  if (!hashTree(request.sourcePath, rootDirectory, visited, hash)) {
+    return false;
+  }
+  hash = hashString(request.entryPoint, hash);
+  hash = hashString(request.profile, hash);
+  hash = hashBytes64(&request.flags, sizeof(request.flags), hash);
+  for (const ShaderDefine& define : request.defines) {
+    hash = hashString(define.name, hash);
+    hash = hashString(define.value, hash);
+  }
+  outKey = hash;
+  return true;
+}
+
+bool
+ShaderCache::hashTree(const std::string& fileName,
+  const std::string& rootDirectory,
+  std::unordered_set<std::string>& visited,
+  uint64_t& hash) {
+  FileHash fileHash;
+  if (!hashFile(fileName, fileHash)) {
+    return false;
+  }
+  hash = hashBytes64(&fileHash.hash, sizeof(fileHash.hash), hash);
+
+  // Same lookup as the compiler: next to the including file, then next to
+  // the source being compiled
+  const std::filesystem::path directory = std::filesystem::path(fileName).parent_path();
+  for (const std::string& include : fileHash.includes) {
+    hash = hashString(include, hash);
+    std::error_code error;
+    std::filesystem::path resolved = directory / include;
+    if (!std::filesystem::is_regular_file(resolved, error)) {
+      resolved = std::filesystem::path(rootDirectory) / include;
+    }
+    const std::string resolvedName = resolved.lexically_normal().string();
+    // An include guard makes the second inclusion a no-op, so each file
+    // counts once (which also stops include cycles)
+    if (!visited.insert(resolvedName).second) {
+      continue;
+    }
+    if (std::filesystem::is_regular_file(resolved, error)) {
+      hashTree(resolvedName, rootDirectory, visited, hash);
+    }
+  }
+  return true;
+}
+
+bool
+ShaderCache::hashFile(const std::string& fileName, FileHash& outHash) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(fileName, error);
+  if (error) {
+    return false;
+  }
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(fileName, error);
+  if (error) {
+    return false;
+  }
+  FileHash stamp;
+  stamp.size = static_cast<uint64_t>(size);
+  stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto known = m_fileHashes.find(fileName);
+    if (known != m_fileHashes.end() &&
+      known->second.size == stamp.size && known->second.time == stamp.time) {
+      outHash = known->second;
+      return true;
+    }
+  }
+
+  // Read outside the lock; two threads may hash the same changed file once each
+  if (size > 0) {
+    MappedFile file;
+    if (!file.open(fileName)) {
+      return false;
+    }
+    stamp.hash = hashBytes64(file.data(), file.size());
+    scanIncludes(file.data(), file.size(), stamp.includes);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fileHashes[fileName] = stamp;
+  }
+  outHash = stamp;
+  return true;
+}
+
+void
+ShaderCache::scanIncludes(const char* text, size_t size, std::vector<std::string>& outIncludes) {
+  // Directives inside comments or disabled #if blocks are listed too; they
+  // only make the key depend on one more file
+  size_t position = 0;
+  while (position < size) {
+    size_t lineEnd = position;
+    while (lineEnd < size && text[lineEnd] != '\n') {
+      ++lineEnd;
+    }
+    size_t cursor = position;
+    while (cursor < lineEnd && isspace(static_cast<unsigned char>(text[cursor]))) {
+      ++cursor;
+    }
+    if (cursor < lineEnd && text[cursor] == '#') {
+      ++cursor;
+      while (cursor < lineEnd && (text[cursor] == ' ' || text[cursor] == '\t')) {
+        ++cursor;
+      }
+      static const char kInclude[] = "include";
+      const size_t includeLength = sizeof(kInclude) - 1;
+      if (lineEnd - cursor > includeLength && std::string(text + cursor, includeLength) == kInclude) {
+        cursor += includeLength;
+        while (cursor < lineEnd && (text[cursor] == ' ' || text[cursor] == '\t')) {
+          ++cursor;
+        }
+        if (cursor < lineEnd && (text[cursor] == '"' || text[cursor] == '<')) {
+          const char close = (text[cursor] == '"') ? '"' : '>';
+          const size_t nameStart = ++cursor;
+          while (cursor < lineEnd && text[cursor] != close) {
+            ++cursor;
+          }
+          if (cursor < lineEnd && cursor > nameStart) {
+            outIncludes.emplace_back(text + nameStart, cursor - nameStart);
+          }
+        }
+      }
+    }
+    position = lineEnd + 1;
+  }
+}
+
+bool
+ShaderCache::load(uint64_t key, std::vector<char>& outBytecode) {
+  bool hit = false;
+  bool rejected = false;
+  {
+    std::ifstream file(pathFor(key), std::ios::binary);
+    EntryHeader header = {};
+    if (file && file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      rejected = true;
+      if (header.tag == kTag && header.version == kVersion && header.key == key &&
+        header.size > 0 && header.size < (64ull << 20)) {
+        outBytecode.resize(static_cast<size_t>(header.size));
+        // The entry must end right after the bytecode
+        if (file.read(outBytecode.data(), static_cast<std::streamsize>(header.size)) &&
+          file.peek() == std::ifstream::traits_type::eof() &&
+          hashBytes64(outBytecode.data(), outBytecode.size()) == header.bytecodeHash) {
+          hit = true;
+          rejected = false;
+        }
+      }
+    }
+  }
+  if (!hit) {
+    outBytecode.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (hit) {
+    ++m_stats.hits;
+  }
+  else {
+    ++m_stats.misses;
+    m_stats.rejected += rejected;
+  }
+  return hit;
+}
+
+bool
+ShaderCache::store(uint64_t key, const void* bytecode, size_t size) {
+  if (!bytecode || size == 0) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+
+  EntryHeader header = {};
+  header.tag = kTag;
+  header.version = kVersion;
+  header.key = key;
+  header.size = size;
+  header.bytecodeHash = hashBytes64(bytecode, size);
+
+  // Write next to the target and rename, so a crash never leaves a torn
+  // entry. The temporary name is per thread, for two compiles of one key.
+  const std::string cachePath = pathFor(key);
+  const std::string tempPath = cachePath + "." +
+    std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(static_cast<const char*>(bytecode), static_cast<std::streamsize>(size));
+    if (!file) {
+      return false;
+    }
+  }
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_stats.stores;
+  return true;
+}
+
+std::string
+ShaderCache::pathFor(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.tshc", static_cast<unsigned long long>(key));
+  return (std::filesystem::path(m_directory) / name).string();
+}
+
+ShaderCache::CacheStats
+ShaderCache::getStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
@@ -0,0 +1,144 @@
+#include "ShaderHotReload.h"
+#include "Device.h"
+#include "HashUtils.h"
+#include "ShaderPermutationProgram.h"
+#include "ShaderProgram.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+ShaderHotReload::ShaderHotReload(ShaderCache* shaderCache)
+  : m_shaderCache(shaderCache) {}
+
+std::string
+ShaderHotReload::directoryOf(const std::string& path) {
+  const std::string directory = std::filesystem::path(path).lexically_normal().parent_path().string();
+  return directory.empty() ? std::string(".") : directory;
+}
+
+bool
+ShaderHotReload::isShaderFile(const std::string& path) {
+  std::string extension = std::filesystem::path(path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+    [](unsigned char c) { return static_cast<char>(tolower(c)); });
+  return extension == ".fx" || extension == ".fxh" || extension == ".hlsl" || extension == ".hlsli";
+}
+
+bool
+ShaderHotReload::watch(ShaderProgram& program) {
+  if (program.getFileName().empty()) {
+    ERROR("ShaderHotReload", "watch", "Program is not initialized.");
+    return false;
+  }
+  std::unique_ptr<WatchedProgram> watched(new WatchedProgram());
+  watched->program = &program;
+  watched->directory = directoryOf(program.getFileName());
+  if (!m_watcher.watchDirectory(watched->directory)) {
+    ERROR("ShaderHotReload", "watch",
+      ("Failed to watch " + watched->directory).c_str());
+    return false;
+  }
+
+  // One worker per program: a reload compiles two stages, and the render
+  // thread never waits on it
+  watched->compiler.reset(new ShaderPermutationCompiler(program.getFileName(),
+    std::vector<std::string>(),
+    &ShaderPermutationProgram::compileStage,
+    m_shaderCache,
+    1));
+  DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined( DEBUG ) || defined( _DEBUG )
+  dwShaderFlags |= D3DCOMPILE_DEBUG;
+#endif
+  watched->compiler->setStages("VS", "vs_4_0", "PS", "ps_4_0", dwShaderFlags);
+  m_programs.push_back(std::move(watched));
+  return true;
+}
+
+bool
+ShaderHotReload::watch(ShaderPermutationProgram& program) {
+  if (program.getFileName().empty()) {
+    ERROR("ShaderHotReload", "watch", "Program is not initialized.");
+    return false;
+  }
+  WatchedPermutations watched;
+  watched.program = &program;
+  watched.directory = directoryOf(program.getFileName());
+  if (!m_watcher.watchDirectory(watched.directory)) {
+    ERROR("ShaderHotReload", "watch",
+      ("Failed to watch " + watched.directory).c_str());
+    return false;
+  }
+  m_permutationPrograms.push_back(watched);
+  return true;
+}
+
+void
+ShaderHotReload::clear() {
+  // Finishes the compiles in flight
+  m_programs.clear();
+  m_permutationPrograms.clear();
+}
+
+void
+ShaderHotReload::update(Device& device) {
+  m_changed.clear();
+  m_watcher.poll(m_changed);
+  m_changedDirectories.clear();
+  for (const std::string& path : m_changed) {
+    if (!isShaderFile(path)) {
+      continue;
+    }
+    ++m_stats.changes;
+    const std::string directory = directoryOf(path);
+    if (std::find(m_changedDirectories.begin(), m_changedDirectories.end(), directory) == m_changedDirectories.end()) {
+      m_changedDirectories.push_back(directory);
+    }
+  }
+
+  // Start the recompiles; the current shaders stay bound meanwhile
+  for (const std::string& directory : m_changedDirectories) {
+    for (auto& watched : m_programs) {
+      if (watched->directory == directory) {
+        // A compile still running from an older edit is dropped
+        watched->compiler->invalidate();
+        watched->compiler->request(0);
+        ++m_stats.recompiles;
+      }
+    }
+    for (WatchedPermutations& watched : m_permutationPrograms) {
+      if (watched.directory == directory) {
+        watched.program->reload();
+        ++m_stats.recompiles;
+      }
+    }
+  }
+
+  // Swap in the programs that finished
+  for (auto& watched : m_programs) {
+    m_completed.clear();
+    watched->compiler->takeCompleted(m_completed);
+    for (const ShaderPermutationCompiler::CompiledPermutation& compiled : m_completed) {
+      if (!compiled.succeeded) {
+        ++m_stats.failed;
+        ERROR("ShaderHotReload", "update",
+          ("Keeping the previous shaders of " + watched->program->getFileName() + ": " + compiled.errors).c_str());
+        continue;
+      }
+      uint64_t hash = hashBytes64(compiled.vertexBytecode.data(), compiled.vertexBytecode.size());
+      hash = hashBytes64(compiled.pixelBytecode.data(), compiled.pixelBytecode.size(), hash);
+      if (hash == watched->bytecodeHash) {
+        ++m_stats.unchanged;
+        continue;
+      }
+      if (FAILED(watched->program->reload(device, compiled.vertexBytecode, compiled.pixelBytecode))) {
+        ++m_stats.failed;
+        continue;
+      }
+      watched->bytecodeHash = hash;
+      ++m_stats.swaps;
+      MESSAGE("ShaderHotReload", "update", ("Reloaded " + watched->program->getFileName()).c_str());
+    }
+  }
+  m_completed.clear();
+}
@@ -0,0 +1,222 @@
+#include "ShaderPermutationProgram.h"
+#include "Device.h"
+#include "DeviceContext.h"
+
+HRESULT
+ShaderPermutationProgram::init(Device& device,
+  const std::string& fileName,
+  const std::vector<std::string>& keywords,
+  std::vector<D3D11_INPUT_ELEMENT_DESC> Layout,
+  ShaderCache* shaderCache,
+  unsigned int threadCount) {
+  if (!device.m_device) {
+    ERROR("ShaderPermutationProgram", "init", "Device is null.");
+    return E_POINTER;
+  }
+  if (fileName.empty()) {
+    ERROR("ShaderPermutationProgram", "init", "File name is empty.");
+    return E_INVALIDARG;
+  }
+  if (Layout.empty()) {
+    ERROR("ShaderPermutationProgram", "init", "Input layout is empty.");
+    return E_INVALIDARG;
+  }
+  if (keywords.size() > ShaderPermutationCompiler::kMaxKeywords) {
+    ERROR("ShaderPermutationProgram", "init", "Too many keywords.");
+    return E_INVALIDARG;
+  }
+
+  destroy();
+  m_layout = std::move(Layout);
+  m_compiler = std::make_unique<ShaderPermutationCompiler>(fileName,
+    keywords,
+    &ShaderPermutationProgram::compileStage,
+    shaderCache,
+    threadCount);
+
+  DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined( DEBUG ) || defined( _DEBUG )
+  dwShaderFlags |= D3DCOMPILE_DEBUG;
+#endif
+  m_compiler->setStages("VS", "vs_4_0", "PS", "ps_4_0", dwShaderFlags);
+  return S_OK;
+}
+
+PermutationKey
+ShaderPermutationProgram::keyFor(const std::vector<std::string>& enabledKeywords) const {
+  return m_compiler ? m_compiler->keyFor(enabledKeywords) : ShaderPermutationCompiler::kInvalidKey;
+}
+
+void
+ShaderPermutationProgram::request(PermutationKey key) {
+  if (m_compiler) {
+    m_compiler->request(key);
+  }
+}
+
+HRESULT
+ShaderPermutationProgram::prepare(Device& device, const std::vector<PermutationKey>& keys) {
+  if (!m_compiler) {
+    ERROR("ShaderPermutationProgram", "prepare", "Program is not initialized.");
+    return E_POINTER;
+  }
+  // Queue everything first so the keys compile in parallel
+  std::vector<std::shared_future<bool>> pending;
+  pending.reserve(keys.size());
+  for (PermutationKey key : keys) {
+    pending.push_back(m_compiler->request(key));
+  }
+  bool compiled = true;
+  for (std::shared_future<bool>& result : pending) {
+    compiled = result.get() && compiled;
+  }
+  update(device);
+  return compiled ? S_OK : E_FAIL;
+}
+
+void
+ShaderPermutationProgram::update(Device& device) {
+  if (!m_compiler) {
+    return;
+  }
+  m_completed.clear();
+  m_compiler->takeCompleted(m_completed);
+  for (const ShaderPermutationCompiler::CompiledPermutation& compiled : m_completed) {
+    if (!compiled.succeeded) {
+      ERROR("ShaderPermutationProgram", "update",
+        ("Failed to compile permutation " + std::to_string(compiled.key) + " of " +
+          m_compiler->sourcePath() + ": " + compiled.errors).c_str());
+      continue;
+    }
+    Variant variant;
+    if (FAILED(createVariant(device, compiled, variant))) {
+      continue;
+    }
+    Variant& slot = m_variants[compiled.key];
+    releaseVariant(slot);
+    slot = variant;
+  }
+  m_completed.clear();
+}
+
+HRESULT
+ShaderPermutationProgram::createVariant(Device& device,
+  const ShaderPermutationCompiler::CompiledPermutation& compiled,
+  Variant& outVariant) {
+  HRESULT hr = device.CreateVertexShader(compiled.vertexBytecode.data(),
+    static_cast<unsigned int>(compiled.vertexBytecode.size()),
+    nullptr,
+    &outVariant.vertexShader);
+  if (SUCCEEDED(hr)) {
+    hr = device.CreateInputLayout(m_layout.data(),
+      static_cast<unsigned int>(m_layout.size()),
+      compiled.vertexBytecode.data(),
+      static_cast<unsigned int>(compiled.vertexBytecode.size()),
+      &outVariant.inputLayout);
+  }
+  if (SUCCEEDED(hr)) {
+    hr = device.CreatePixelShader(compiled.pixelBytecode.data(),
+      static_cast<unsigned int>(compiled.pixelBytecode.size()),
+      nullptr,
+      &outVariant.pixelShader);
+  }
+  if (FAILED(hr)) {
+    ERROR("ShaderPermutationProgram", "createVariant",
+      ("Failed to create permutation " + std::to_string(compiled.key) + ". HRESULT: " + std::to_string(hr)).c_str());
+    releaseVariant(outVariant);
+  }
+  return hr;
+}
+
+void
+ShaderPermutationProgram::releaseVariant(Variant& variant) {
+  SAFE_RELEASE(variant.vertexShader);
+  SAFE_RELEASE(variant.pixelShader);
+  SAFE_RELEASE(variant.inputLayout);
+}
+
+bool
+ShaderPermutationProgram::render(DeviceContext& deviceContext, PermutationKey key) {
+  if (!deviceContext.m_deviceContext) {
+    ERROR("ShaderPermutationProgram", "render", "DeviceContext is nullptr.");
+    return false;
+  }
+  auto variant = m_variants.find(key);
+  if (variant == m_variants.end()) {
+    request(key);
+    return false;
+  }
+  deviceContext.m_deviceContext->IASetInputLayout(variant->second.inputLayout);
+  deviceContext.m_deviceContext->VSSetShader(variant->second.vertexShader, nullptr, 0);
+  deviceContext.m_deviceContext->PSSetShader(variant->second.pixelShader, nullptr, 0);
+  return true;
+}
+
+void
+ShaderPermutationProgram::reload() {
+  if (!m_compiler) {
+    return;
+  }
+  m_compiler->invalidate();
+  for (auto& variant : m_variants) {
+    m_compiler->request(variant.first);
+  }
+}
+
+void
+ShaderPermutationProgram::destroy() {
+  // Finish the compiles in flight before dropping their results
+  m_compiler.reset();
+  for (auto& variant : m_variants) {
+    releaseVariant(variant.second);
+  }
+  m_variants.clear();
+  m_completed.clear();
+}
+
+ShaderPermutationCompiler::CompilerStats
+ShaderPermutationProgram::getCompilerStats() const {
+  return m_compiler ? m_compiler->getStats() : ShaderPermutationCompiler::CompilerStats();
+}
+
+bool
+ShaderPermutationProgram::compileStage(const ShaderCache::CompileRequest& request,
+  std::vector<char>& outBytecode,
+  std::string& outErrors) {
+  // D3DX expects a null-terminated macro array
+  std::vector<D3D10_SHADER_MACRO> macros;
+  macros.reserve(request.defines.size() + 1);
+  for (const ShaderCache::ShaderDefine& define : request.defines) {
+    macros.push_back({ define.name.c_str(), define.value.c_str() });
+  }
+  macros.push_back({ nullptr, nullptr });
+
+  ID3DBlob* shaderBlob = nullptr;
+  ID3DBlob* errorBlob = nullptr;
+  HRESULT hr = D3DX11CompileFromFile(request.sourcePath.c_str(),
+    macros.data(),
+    nullptr,
+    request.entryPoint.c_str(),
+    request.profile.c_str(),
+    request.flags,
+    0,
+    nullptr,
+    &shaderBlob,
+    &errorBlob,
+    nullptr);
+  if (errorBlob) {
+    outErrors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+    errorBlob->Release();
+  }
+  if (FAILED(hr) || !shaderBlob) {
+    if (outErrors.empty()) {
+      outErrors = "HRESULT " + std::to_string(hr);
+    }
+    SAFE_RELEASE(shaderBlob);
+    return false;
+  }
+  const char* bytecode = static_cast<const char*>(shaderBlob->GetBufferPointer());
+  outBytecode.assign(bytecode, bytecode + shaderBlob->GetBufferSize());
+  shaderBlob->Release();
+  return true;
+}
@@ -0,0 +1,184 @@
+#include "ShaderPermutations.h"
+#include <algorithm>
+#include <chrono>
+
+ShaderPermutationCompiler::ShaderPermutationCompiler(const std::string& sourcePath,
+  const std::vector<std::string>& keywords,
+  CompileFunction compile,
+  ShaderCache* shaderCache,
+  unsigned int threadCount)
+  : m_sourcePath(sourcePath),
+    m_keywords(keywords.begin(), keywords.begin() + std::min<size_t>(keywords.size(), kMaxKeywords)),
+    m_compile(std::move(compile)),
+    m_shaderCache(shaderCache),
+    m_workers(threadCount) {}
+
+void
+ShaderPermutationCompiler::setStages(const std::string& vertexEntry,
+  const std::string& vertexProfile,
+  const std::string& pixelEntry,
+  const std::string& pixelProfile,
+  uint32_t flags) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_vertexEntry = vertexEntry;
+  m_vertexProfile = vertexProfile;
+  m_pixelEntry = pixelEntry;
+  m_pixelProfile = pixelProfile;
+  m_flags = flags;
+}
+
+PermutationKey
+ShaderPermutationCompiler::keyFor(const std::vector<std::string>& enabledKeywords) const {
+  PermutationKey key = 0;
+  for (const std::string& enabled : enabledKeywords) {
+    size_t bit = 0;
+    while (bit < m_keywords.size() && m_keywords[bit] != enabled) {
+      ++bit;
+    }
+    if (bit == m_keywords.size()) {
+      return kInvalidKey;
+    }
+    key |= PermutationKey(1) << bit;
+  }
+  return key;
+}
+
+std::vector<ShaderCache::ShaderDefine>
+ShaderPermutationCompiler::definesFor(PermutationKey key) const {
+  std::vector<ShaderCache::ShaderDefine> defines;
+  for (size_t bit = 0; bit < m_keywords.size(); ++bit) {
+    if (key & (PermutationKey(1) << bit)) {
+      defines.push_back({ m_keywords[bit], "1" });
+    }
+  }
+  return defines;
+}
+
+std::shared_future<bool>
+ShaderPermutationCompiler::request(PermutationKey key) {
+  std::shared_ptr<std::promise<bool>> done;
+  std::shared_future<bool> result;
+  uint32_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+    if (key != kInvalidKey && (key >> m_keywords.size()) == 0) {
+      auto known = m_requests.find(key);
+      if (known != m_requests.end()) {
+        ++m_stats.deduplicated;
+        return known->second;
+      }
+      done = std::make_shared<std::promise<bool>>();
+      result = done->get_future().share();
+      m_requests.emplace(key, result);
+      generation = m_generation;
+      ++m_inFlight;
+    }
+  }
+  if (!done) {
+    std::promise<bool> invalid;
+    invalid.set_value(false);
+    return invalid.get_future().share();
+  }
+  m_workers.enqueue([this, key, generation, done]() {
+    compilePermutation(key, generation, done);
+  });
+  return result;
+}
+
+void
+ShaderPermutationCompiler::compilePermutation(PermutationKey key,
+  uint32_t generation,
+  std::shared_ptr<std::promise<bool>> done) {
+  const auto start = std::chrono::steady_clock::now();
+  ShaderCache::CompileRequest vertexRequest;
+  ShaderCache::CompileRequest pixelRequest;
+  vertexRequest.sourcePath = m_sourcePath;
+  vertexRequest.defines = definesFor(key);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    vertexRequest.flags = m_flags;
+    pixelRequest = vertexRequest;
+    vertexRequest.entryPoint = m_vertexEntry;
+    vertexRequest.profile = m_vertexProfile;
+    pixelRequest.entryPoint = m_pixelEntry;
+    pixelRequest.profile = m_pixelProfile;
+  }
+
+  CompiledPermutation compiled;
+  compiled.key = key;
+  compiled.succeeded = compileStage(vertexRequest, compiled.vertexBytecode, compiled.errors) &&
+    compileStage(pixelRequest, compiled.pixelBytecode, compiled.errors);
+  const bool succeeded = compiled.succeeded;
+  const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.workerMs += elapsed;
+    m_stats.failed += !succeeded;
+    // A result from before invalidate may be older than the sources now
+    if (generation == m_generation) {
+      m_completed.push_back(std::move(compiled));
+    }
+    --m_inFlight;
+  }
+  m_idle.notify_all();
+  done->set_value(succeeded);
+}
+
+bool
+ShaderPermutationCompiler::compileStage(const ShaderCache::CompileRequest& request,
+  std::vector<char>& outBytecode,
+  std::string& outErrors) {
+  uint64_t cacheKey = 0;
+  const bool cacheable = m_shaderCache && m_shaderCache->computeKey(request, cacheKey);
+  if (cacheable && m_shaderCache->load(cacheKey, outBytecode)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.cacheHits;
+    return true;
+  }
+
+  std::string errors;
+  const bool compiled = m_compile && m_compile(request, outBytecode, errors);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.compiles;
+  }
+  if (!compiled) {
+    outErrors += request.entryPoint + ": " + errors;
+    return false;
+  }
+  if (cacheable) {
+    m_shaderCache->store(cacheKey, outBytecode.data(), outBytecode.size());
+  }
+  return true;
+}
+
+void
+ShaderPermutationCompiler::invalidate() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_generation;
+  m_requests.clear();
+  m_completed.clear();
+}
+
+void
+ShaderPermutationCompiler::takeCompleted(std::vector<CompiledPermutation>& outCompleted) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (CompiledPermutation& compiled : m_completed) {
+    outCompleted.push_back(std::move(compiled));
+  }
+  m_completed.clear();
+}
+
+void
+ShaderPermutationCompiler::idle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this]() { return m_inFlight == 0; });
+}
+
+ShaderPermutationCompiler::CompilerStats
+ShaderPermutationCompiler::getStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
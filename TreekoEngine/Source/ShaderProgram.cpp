@@ -1,6 +1,7 @@
 #include "ShaderProgram.h"
 #include "Device.h"
 #include "DeviceContext.h"
+#include "ShaderCache.h"
 
 
 HRESULT
@@ -20,6 +21,7 @@ ShaderProgram::init(Device& device,
 		return E_INVALIDARG;
 	}
 	m_shaderFileName = fileName;
+	m_layout = Layout;
 	// Create the Vertex Shader
 	HRESULT hr = CreateShader(device, ShaderType::VERTEX_SHADER);
 	if (FAILED(hr)) {
@@ -174,7 +176,25 @@ ShaderProgram::CompileShaderFromFile(char* szFileName,
 	// the release configuration of this program.
 	dwShaderFlags |= D3DCOMPILE_DEBUG;
 #endif
-	ID3DBlob* pErrorBlob;
+
+	// Buscar el bytecode en la cache antes de compilar
+	ShaderCache::CompileRequest request;
+	request.sourcePath = szFileName;
+	request.entryPoint = szEntryPoint;
+	request.profile = szShaderModel;
+	request.flags = dwShaderFlags;
+	uint64_t cacheKey = 0;
+	const bool cacheable = m_shaderCache && m_shaderCache->computeKey(request, cacheKey);
+	if (cacheable) {
+		std::vector<char> bytecode;
+		if (m_shaderCache->load(cacheKey, bytecode) &&
+			SUCCEEDED(D3DCreateBlob(bytecode.size(), ppBlobOut))) {
+			memcpy((*ppBlobOut)->GetBufferPointer(), bytecode.data(), bytecode.size());
+			return S_OK;
+		}
+	}
+
+	ID3DBlob* pErrorBlob = nullptr;
 	hr = D3DX11CompileFromFile(szFileName,
 		nullptr,
 		nullptr,
@@ -205,7 +225,64 @@ ShaderProgram::CompileShaderFromFile(char* szFileName,
 
 	SAFE_RELEASE(pErrorBlob)
 
-		return S_OK;
+	if (cacheable &&
+		!m_shaderCache->store(cacheKey, (*ppBlobOut)->GetBufferPointer(), (*ppBlobOut)->GetBufferSize())) {
+		ERROR("ShaderProgram", "CompileShaderFromFile",
+			("Failed to write the shader cache entry for " + std::string(szFileName)).c_str());
+	}
+	return S_OK;
+}
+
+HRESULT
+ShaderProgram::reload(Device& device,
+	const std::vector<char>& vertexBytecode,
+	const std::vector<char>& pixelBytecode) {
+	if (!device.m_device) {
+		ERROR("ShaderProgram", "reload", "Device is null.");
+		return E_POINTER;
+	}
+	if (vertexBytecode.empty() || pixelBytecode.empty() || m_layout.empty()) {
+		ERROR("ShaderProgram", "reload", "Bytecode or input layout is empty.");
+		return E_INVALIDARG;
+	}
+
+	// Create the new objects first; the current ones stay if any of them fails
+	ID3D11VertexShader* vertexShader = nullptr;
+	ID3D11PixelShader* pixelShader = nullptr;
+	ID3D11InputLayout* inputLayout = nullptr;
+	HRESULT hr = device.CreateVertexShader(vertexBytecode.data(),
+		static_cast<unsigned int>(vertexBytecode.size()),
+		nullptr,
+		&vertexShader);
+	if (SUCCEEDED(hr)) {
+		hr = device.CreateInputLayout(m_layout.data(),
+			static_cast<unsigned int>(m_layout.size()),
+			vertexBytecode.data(),
+			static_cast<unsigned int>(vertexBytecode.size()),
+			&inputLayout);
+	}
+	if (SUCCEEDED(hr)) {
+		hr = device.CreatePixelShader(pixelBytecode.data(),
+			static_cast<unsigned int>(pixelBytecode.size()),
+			nullptr,
+			&pixelShader);
+	}
+	if (FAILED(hr)) {
+		ERROR("ShaderProgram", "reload",
+			("Failed to recreate the shaders of " + m_shaderFileName + ". HRESULT: " + std::to_string(hr)).c_str());
+		SAFE_RELEASE(vertexShader);
+		SAFE_RELEASE(pixelShader);
+		SAFE_RELEASE(inputLayout);
+		return hr;
+	}
+
+	SAFE_RELEASE(m_VertexShader);
+	SAFE_RELEASE(m_PixelShader);
+	SAFE_RELEASE(m_inputLayout.m_inputLayout);
+	m_VertexShader = vertexShader;
+	m_PixelShader = pixelShader;
+	m_inputLayout.m_inputLayout = inputLayout;
+	return S_OK;
 }
 
 void
@@ -1,13 +1,31 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 #include "Texture.h"
 #include "Device.h"
 #include "DeviceContext.h"
+#include "MappedFile.h"
+
+namespace {
+  DXGI_FORMAT
+  blockFormatToDxgi(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1:
+      return DXGI_FORMAT_BC1_UNORM;
+    case BLOCK_BC3:
+      return DXGI_FORMAT_BC3_UNORM;
+    case BLOCK_BC5:
+      return DXGI_FORMAT_BC5_UNORM;
+    case BLOCK_BC7:
+      return DXGI_FORMAT_BC7_UNORM;
+    default:
+      return DXGI_FORMAT_UNKNOWN;
+    }
+  }
+}
 
 HRESULT
 Texture::init(Device& device,
   const std::string& textureName,
-  ExtensionType extensionType) {
+  ExtensionType extensionType,
+  unsigned int maxMipLevels) {
   if (!device.m_device) {
     ERROR("Texture", "init", "Device is null.");
     return E_POINTER;
@@ -38,103 +56,69 @@ Texture::init(Device& device,
         ("Failed to load DDS texture. Verify filepath: " + m_textureName).c_str());
       return hr;
     }
+
+    // D3DX creates the texture itself, so it is tracked from the view
+    ID3D11Resource* resource = nullptr;
+    ID3D11Texture2D* texture2D = nullptr;
+    m_textureFromImg->GetResource(&resource);
+    if (resource && SUCCEEDED(resource->QueryInterface(__uuidof(ID3D11Texture2D),
+      reinterpret_cast<void**>(&texture2D)))) {
+      GpuMemoryTracker::OwnerScope owner(m_textureName);
+      device.TrackTexture2D(texture2D);
+      SAFE_RELEASE(texture2D);
+    }
+    SAFE_RELEASE(resource);
     break;
   }
 
   case PNG: {
     m_textureName = textureName + ".png";
-    int width, height, channels;
-    unsigned char* data = stbi_load(m_textureName.c_str(), &width, &height, &channels, 4); // 4 bytes por pixel (RGBA)
-    if (!data) {
-      ERROR("Texture", "init",
-        ("Failed to load PNG texture: " + std::string(stbi_failure_reason())).c_str());
-      return E_FAIL;
-    }
-
-    // Crear descripcin de textura
-    D3D11_TEXTURE2D_DESC textureDesc = {};
-    textureDesc.Width = width;
-    textureDesc.Height = height;
-    textureDesc.MipLevels = 1;
-    textureDesc.ArraySize = 1;
-    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    textureDesc.SampleDesc.Count = 1;
-    textureDesc.Usage = D3D11_USAGE_DEFAULT;
-    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-    // Crear datos de subrecarga
-    D3D11_SUBRESOURCE_DATA initData = {};
-    initData.pSysMem = data;
-    initData.SysMemPitch = width * 4;
-
-    hr = device.CreateTexture2D(&textureDesc, &initData, &m_texture);
-    stbi_image_free(data); // Liberar los datos de imagen inmediatamente
 
-    if (FAILED(hr)) {
-      ERROR("Texture", "init", "Failed to create texture from PNG data");
-      return hr;
+    // The .ttex cache skips decoding, filtering and encoding
+    TextureDecoder::TextureData data;
+    if (!TextureDecoder::loadCached(m_textureName, data)) {
+      MappedFile file;
+      if (!file.open(m_textureName)) {
+        ERROR("Texture", "init", ("Failed to open PNG texture: " + m_textureName).c_str());
+        return E_FAIL;
+      }
+      if (!TextureDecoder::decode(m_textureName,
+        reinterpret_cast<const unsigned char*>(file.data()),
+        file.size(),
+        data)) {
+        return E_FAIL;
+      }
     }
 
-    // Crear vista del recurso de la textura
-    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Format = textureDesc.Format;
-    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = 1;
-
-    hr = device.m_device->CreateShaderResourceView(m_texture, &srvDesc, &m_textureFromImg);
-    SAFE_RELEASE(m_texture); // Liberar textura intermedia
-
+    hr = createFromLevels(device, static_cast<DXGI_FORMAT>(data.dxgiFormat), data.levels, maxMipLevels);
     if (FAILED(hr)) {
-      ERROR("Texture", "init", "Failed to create shader resource view for PNG texture");
+      ERROR("Texture", "init", "Failed to create texture from PNG data");
       return hr;
     }
     break;
   }
   case JPG: {
     m_textureName = textureName + ".jpg";
-    int width, height, channels;
-    unsigned char* data = stbi_load(m_textureName.c_str(), &width, &height, &channels, 4); // 4 bytes por pixel (RGBA)
-    if (!data) {
-      ERROR("Texture", "init",
-        ("Failed to load JPG texture: " + std::string(stbi_failure_reason())).c_str());
-      return E_FAIL;
-    }
-
-    // Crear descripcin de textura
-    D3D11_TEXTURE2D_DESC textureDesc = {};
-    textureDesc.Width = width;
-    textureDesc.Height = height;
-    textureDesc.MipLevels = 1;
-    textureDesc.ArraySize = 1;
-    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    textureDesc.SampleDesc.Count = 1;
-    textureDesc.Usage = D3D11_USAGE_DEFAULT;
-    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-    // Crear datos de subrecarga
-    D3D11_SUBRESOURCE_DATA initData = {};
-    initData.pSysMem = data;
-    initData.SysMemPitch = width * 4;
-
-    hr = device.CreateTexture2D(&textureDesc, &initData, &m_texture);
-    stbi_image_free(data); // Liberar los datos de imagen inmediatamente
 
-    if (FAILED(hr)) {
-      ERROR("Texture", "init", "Failed to create texture from PNG data");
-      return hr;
+    // The .ttex cache skips decoding, filtering and encoding
+    TextureDecoder::TextureData data;
+    if (!TextureDecoder::loadCached(m_textureName, data)) {
+      MappedFile file;
+      if (!file.open(m_textureName)) {
+        ERROR("Texture", "init", ("Failed to open JPG texture: " + m_textureName).c_str());
+        return E_FAIL;
+      }
+      if (!TextureDecoder::decode(m_textureName,
+        reinterpret_cast<const unsigned char*>(file.data()),
+        file.size(),
+        data)) {
+        return E_FAIL;
+      }
     }
 
-    // Crear vista del recurso de la textura
-    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Format = textureDesc.Format;
-    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = 1;
-
-    hr = device.m_device->CreateShaderResourceView(m_texture, &srvDesc, &m_textureFromImg);
-    SAFE_RELEASE(m_texture); // Liberar textura intermedia
-
+    hr = createFromLevels(device, static_cast<DXGI_FORMAT>(data.dxgiFormat), data.levels, maxMipLevels);
     if (FAILED(hr)) {
-      ERROR("Texture", "init", "Failed to create shader resource view for JPG texture");
+      ERROR("Texture", "init", "Failed to create texture from JPG data");
       return hr;
     }
     break;
@@ -147,6 +131,159 @@ Texture::init(Device& device,
   return hr;
 }
 
+HRESULT
+Texture::init(Device& device,
+  const std::string& fileName,
+  const TextureDecoder::TextureData& data,
+  unsigned int maxMipLevels) {
+  if (!device.m_device) {
+    ERROR("Texture", "init", "Device is null.");
+    return E_POINTER;
+  }
+  if (data.levels.empty()) {
+    ERROR("Texture", "init", "Texture data has no levels.");
+    return E_INVALIDARG;
+  }
+  m_textureName = fileName;
+  return createFromLevels(device, static_cast<DXGI_FORMAT>(data.dxgiFormat), data.levels, maxMipLevels);
+}
+
+HRESULT
+Texture::createFromLevels(Device& device,
+  DXGI_FORMAT format,
+  const std::vector<TextureCache::CacheLevel>& levels,
+  unsigned int maxMipLevels) {
+  const unsigned int firstLevel = TextureCache::firstLevelFor(levels,
+    maxMipLevels,
+    TextureCache::isBlockCompressed(format));
+
+  D3D11_TEXTURE2D_DESC textureDesc = {};
+  textureDesc.Width = levels[firstLevel].width;
+  textureDesc.Height = levels[firstLevel].height;
+  textureDesc.MipLevels = static_cast<UINT>(levels.size() - firstLevel);
+  textureDesc.ArraySize = 1;
+  textureDesc.Format = format;
+  textureDesc.SampleDesc.Count = 1;
+  textureDesc.Usage = D3D11_USAGE_DEFAULT;
+  textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+  // One subresource per level
+  std::vector<D3D11_SUBRESOURCE_DATA> initData(textureDesc.MipLevels);
+  for (UINT level = 0; level < textureDesc.MipLevels; ++level) {
+    initData[level].pSysMem = levels[firstLevel + level].data;
+    initData[level].SysMemPitch = levels[firstLevel + level].rowPitch;
+  }
+
+  GpuMemoryTracker::OwnerScope owner(m_textureName);
+  HRESULT hr = device.CreateTexture2D(&textureDesc, initData.data(), &m_texture);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+  srvDesc.Format = textureDesc.Format;
+  srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+  srvDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+
+  hr = device.m_device->CreateShaderResourceView(m_texture, &srvDesc, &m_textureFromImg);
+  SAFE_RELEASE(m_texture); // Liberar textura intermedia
+  return hr;
+}
+
+HRESULT
+Texture::initArray(Device& device,
+  const std::string& textureName,
+  const std::vector<const unsigned char*>& slices,
+  unsigned int width,
+  unsigned int height,
+  unsigned int levelCount) {
+  if (!device.m_device) {
+    ERROR("Texture", "initArray", "Device is null.");
+    return E_POINTER;
+  }
+  if (slices.empty() || width == 0 || height == 0) {
+    ERROR("Texture", "initArray", "Texture array has no slices.");
+    return E_INVALIDARG;
+  }
+  m_textureName = textureName;
+
+  std::vector<MipGenerator::MipImage> images(slices.size());
+  for (size_t slice = 0; slice < slices.size(); ++slice) {
+    images[slice].pixels = slices[slice];
+    images[slice].width = width;
+    images[slice].height = height;
+  }
+  MipGenerator mipGenerator;
+  std::vector<MipGenerator::MipChain> mipChains;
+  if (!mipGenerator.generate(images.data(), images.size(), mipChains)) {
+    ERROR("Texture", "initArray", "Failed to generate the mip chains");
+    return E_FAIL;
+  }
+  const size_t levels = (levelCount != 0) ?
+    std::min<size_t>(levelCount, mipChains[0].levels.size()) : mipChains[0].levels.size();
+
+  D3D11_TEXTURE2D_DESC textureDesc = {};
+  textureDesc.Width = width;
+  textureDesc.Height = height;
+  textureDesc.MipLevels = static_cast<UINT>(levels);
+  textureDesc.ArraySize = static_cast<UINT>(slices.size());
+  textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  textureDesc.SampleDesc.Count = 1;
+  textureDesc.Usage = D3D11_USAGE_DEFAULT;
+  textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+  // Subresource index is level + slice * MipLevels
+  std::vector<D3D11_SUBRESOURCE_DATA> initData(slices.size() * levels);
+  std::vector<BlockCompressor::BlockImage> blockImages(slices.size() * levels);
+  for (size_t slice = 0; slice < slices.size(); ++slice) {
+    for (size_t level = 0; level < levels; ++level) {
+      const MipGenerator::MipLevel& mipLevel = mipChains[slice].levels[level];
+      initData[slice * levels + level].pSysMem = mipChains[slice].pixels.data() + mipLevel.offset;
+      initData[slice * levels + level].SysMemPitch = mipLevel.width * 4;
+      blockImages[slice * levels + level].pixels = mipChains[slice].pixels.data() + mipLevel.offset;
+      blockImages[slice * levels + level].width = mipLevel.width;
+      blockImages[slice * levels + level].height = mipLevel.height;
+    }
+  }
+
+  // Every slice shares the format, so a slice with alpha moves all of them
+  // off BC1
+  BlockCompressor blockCompressor;
+  BlockCompressor::BlockChain blockChain;
+  if (width % 4 == 0 && height % 4 == 0) {
+    BlockFormat format = BLOCK_BC1;
+    for (size_t slice = 0; slice < slices.size(); ++slice) {
+      BlockFormat sliceFormat = BlockCompressor::chooseFormat(blockImages[slice * levels], BLOCK_FAST, true);
+      if (sliceFormat != BLOCK_BC1) {
+        format = sliceFormat;
+      }
+    }
+    if (blockCompressor.compress(blockImages.data(), blockImages.size(), format, blockChain)) {
+      textureDesc.Format = blockFormatToDxgi(blockChain.format);
+      for (size_t image = 0; image < blockChain.levels.size(); ++image) {
+        initData[image].pSysMem = blockChain.blocks.data() + blockChain.levels[image].offset;
+        initData[image].SysMemPitch = blockChain.levels[image].rowPitch;
+      }
+    }
+  }
+
+  GpuMemoryTracker::OwnerScope owner(m_textureName);
+  HRESULT hr = device.CreateTexture2D(&textureDesc, initData.data(), &m_texture);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+  srvDesc.Format = textureDesc.Format;
+  srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+  srvDesc.Texture2DArray.MipLevels = textureDesc.MipLevels;
+  srvDesc.Texture2DArray.ArraySize = textureDesc.ArraySize;
+
+  hr = device.m_device->CreateShaderResourceView(m_texture, &srvDesc, &m_textureFromImg);
+  SAFE_RELEASE(m_texture); // Liberar textura intermedia
+  return hr;
+}
+
 HRESULT
 Texture::init(Device& device,
   unsigned int width,
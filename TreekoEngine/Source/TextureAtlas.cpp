@@ -0,0 +1,158 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  unsigned int
+  alignUp(unsigned int value, unsigned int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+bool
+TextureAtlas::pack(const AtlasImage* images, size_t imageCount, AtlasLayout layout) {
+  m_lastStats = AtlasStats();
+  m_entries.clear();
+  m_pages.clear();
+  m_pageWidth = 0;
+  m_pageHeight = 0;
+  if (!images || imageCount == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < imageCount; ++i) {
+    if (!images[i].pixels || images[i].width == 0 || images[i].height == 0) {
+      return false;
+    }
+  }
+
+  if (layout == ATLAS_PAGES) {
+    if (!packPages(images, imageCount)) {
+      m_entries.clear();
+      m_pages.clear();
+      return false;
+    }
+  }
+  else {
+    // One slice per image, untouched
+    for (size_t i = 0; i < imageCount; ++i) {
+      if (images[i].width != images[0].width || images[i].height != images[0].height) {
+        return false;
+      }
+    }
+    m_pageWidth = images[0].width;
+    m_pageHeight = images[0].height;
+    const size_t sliceBytes = static_cast<size_t>(m_pageWidth) * m_pageHeight * 4;
+    m_entries.resize(imageCount);
+    m_pages.resize(imageCount);
+    for (size_t i = 0; i < imageCount; ++i) {
+      m_entries[i].page = static_cast<unsigned int>(i);
+      m_entries[i].width = m_pageWidth;
+      m_entries[i].height = m_pageHeight;
+      m_pages[i].assign(images[i].pixels, images[i].pixels + sliceBytes);
+    }
+  }
+
+  m_lastStats.images = imageCount;
+  m_lastStats.pages = m_pages.size();
+  for (size_t i = 0; i < imageCount; ++i) {
+    m_lastStats.imageTexels += static_cast<size_t>(images[i].width) * images[i].height;
+  }
+  m_lastStats.pageTexels = m_pages.size() * m_pageWidth * m_pageHeight;
+  return true;
+}
+
+bool
+TextureAtlas::packPages(const AtlasImage* images, size_t imageCount) {
+  // Level mipLevels - 1 shrinks the gutter and the alignment to one texel;
+  // at least a 4x4 block keeps block compression from mixing images
+  const unsigned int gutter = std::max(4u, 1u << (std::max(1u, m_mipLevels) - 1));
+  const unsigned int pageSize = alignUp(std::max(m_pageSize, gutter), gutter);
+  m_pageWidth = pageSize;
+  m_pageHeight = pageSize;
+
+  std::vector<unsigned int> order(imageCount);
+  std::vector<unsigned int> cellWidths(imageCount);
+  std::vector<unsigned int> cellHeights(imageCount);
+  for (unsigned int i = 0; i < imageCount; ++i) {
+    order[i] = i;
+    cellWidths[i] = alignUp(images[i].width, gutter) + 2 * gutter;
+    cellHeights[i] = alignUp(images[i].height, gutter) + 2 * gutter;
+    if (cellWidths[i] > pageSize || cellHeights[i] > pageSize) {
+      return false;
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    return cellHeights[a] != cellHeights[b] ? cellHeights[a] > cellHeights[b] : cellWidths[a] > cellWidths[b];
+  });
+
+  // First fit on the open shelves, else a new shelf on the first page with
+  // room, else a new page
+  m_shelves.clear();
+  std::vector<unsigned int> pageHeights;
+  m_entries.resize(imageCount);
+  for (unsigned int image : order) {
+    AtlasShelf* target = nullptr;
+    for (AtlasShelf& shelf : m_shelves) {
+      if (shelf.height >= cellHeights[image] && pageSize - shelf.usedWidth >= cellWidths[image]) {
+        target = &shelf;
+        break;
+      }
+    }
+    if (!target) {
+      unsigned int page = 0;
+      while (page < pageHeights.size() && pageHeights[page] + cellHeights[image] > pageSize) {
+        ++page;
+      }
+      if (page == pageHeights.size()) {
+        pageHeights.push_back(0);
+      }
+      m_shelves.push_back({ page, pageHeights[page], cellHeights[image], 0 });
+      pageHeights[page] += cellHeights[image];
+      target = &m_shelves.back();
+    }
+
+    AtlasEntry& entry = m_entries[image];
+    entry.page = target->page;
+    entry.x = target->usedWidth + gutter;
+    entry.y = target->y + gutter;
+    entry.width = images[image].width;
+    entry.height = images[image].height;
+    entry.scaleU = static_cast<float>(entry.width) / pageSize;
+    entry.scaleV = static_cast<float>(entry.height) / pageSize;
+    entry.offsetU = static_cast<float>(entry.x) / pageSize;
+    entry.offsetV = static_cast<float>(entry.y) / pageSize;
+    target->usedWidth += cellWidths[image];
+  }
+
+  m_pages.assign(pageHeights.size(), std::vector<unsigned char>(static_cast<size_t>(pageSize) * pageSize * 4, 0));
+  for (size_t image = 0; image < imageCount; ++image) {
+    blitCell(images[image], m_entries[image], gutter);
+  }
+  return true;
+}
+
+void
+TextureAtlas::blitCell(const AtlasImage& image, const AtlasEntry& entry, unsigned int gutter) {
+  std::vector<unsigned char>& page = m_pages[entry.page];
+  const unsigned int cellX = entry.x - gutter;
+  const unsigned int cellY = entry.y - gutter;
+  const unsigned int cellWidth = alignUp(image.width, gutter) + 2 * gutter;
+  const unsigned int cellHeight = alignUp(image.height, gutter) + 2 * gutter;
+  const unsigned int rightFill = cellWidth - gutter - image.width;
+
+  for (unsigned int row = 0; row < cellHeight; ++row) {
+    const unsigned int sourceRow = std::min(image.height - 1, row > gutter ? row - gutter : 0);
+    const unsigned char* source = image.pixels + static_cast<size_t>(sourceRow) * image.width * 4;
+    unsigned char* target = page.data() + (static_cast<size_t>(cellY + row) * m_pageWidth + cellX) * 4;
+
+    for (unsigned int column = 0; column < gutter; ++column, target += 4) {
+      memcpy(target, source, 4);
+    }
+    memcpy(target, source, static_cast<size_t>(image.width) * 4);
+    target += static_cast<size_t>(image.width) * 4;
+    const unsigned char* lastTexel = source + static_cast<size_t>(image.width - 1) * 4;
+    for (unsigned int column = 0; column < rightFill; ++column, target += 4) {
+      memcpy(target, lastTexel, 4);
+    }
+  }
+}
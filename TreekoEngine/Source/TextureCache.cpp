@@ -0,0 +1,245 @@
+#include "TextureCache.h"
+#include "HashUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+  // DXGI_FORMAT values of the levels the cache stores
+  const uint32_t kFormatRgba8 = 28;
+  const uint32_t kFormatBc1 = 71;
+  const uint32_t kFormatBc3 = 77;
+  const uint32_t kFormatBc5 = 83;
+  const uint32_t kFormatBc7 = 98;
+
+  // DDS constants
+  const uint32_t kDdsdCaps = 0x1;
+  const uint32_t kDdsdHeight = 0x2;
+  const uint32_t kDdsdWidth = 0x4;
+  const uint32_t kDdsdPitch = 0x8;
+  const uint32_t kDdsdPixelFormat = 0x1000;
+  const uint32_t kDdsdMipMapCount = 0x20000;
+  const uint32_t kDdsdLinearSize = 0x80000;
+  const uint32_t kDdpfFourCC = 0x4;
+  const uint32_t kFourCCDx10 = 0x30315844u;
+  const uint32_t kDdsCapsComplex = 0x8;
+  const uint32_t kDdsCapsTexture = 0x1000;
+  const uint32_t kDdsCapsMipMap = 0x400000;
+  const uint32_t kDimensionTexture2D = 3;
+
+  const size_t kDataOffset = sizeof(uint32_t) + sizeof(TextureCache::DdsHeader) + sizeof(TextureCache::DdsHeaderDx10);
+}
+
+static_assert(sizeof(TextureCache::DdsPixelFormat) == 32, "DDS_PIXELFORMAT is 32 bytes");
+static_assert(sizeof(TextureCache::DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+static_assert(sizeof(TextureCache::DdsHeaderDx10) == 20, "DDS_HEADER_DXT10 is 20 bytes");
+
+bool
+TextureCache::open(const std::string& cachePath, const std::string& sourcePath) {
+  close();
+
+  if (!m_file.open(cachePath)) {
+    return false;
+  }
+  if (m_file.size() < kDataOffset) {
+    close();
+    return false;
+  }
+
+  uint32_t magic;
+  memcpy(&magic, m_file.data(), sizeof(magic));
+  const DdsHeader* header = reinterpret_cast<const DdsHeader*>(m_file.data() + sizeof(uint32_t));
+  const DdsHeaderDx10* dx10 = reinterpret_cast<const DdsHeaderDx10*>(m_file.data() + sizeof(uint32_t) + sizeof(DdsHeader));
+  if (magic != kDdsMagic ||
+    header->size != sizeof(DdsHeader) ||
+    header->tag != kTag ||
+    header->version != kVersion ||
+    header->pixelFormat.fourCC != kFourCCDx10 ||
+    dx10->resourceDimension != kDimensionTexture2D ||
+    dx10->arraySize != 1 ||
+    header->width == 0 || header->height == 0 || header->mipMapCount == 0) {
+    close();
+    return false;
+  }
+
+  // A cache shipped without its source is trusted as is
+  uint64_t sourceSize = 0;
+  int64_t sourceTime = 0;
+  if (getSourceStamp(sourcePath, sourceSize, sourceTime)) {
+    if (sourceSize != header->sourceSize) {
+      close();
+      return false;
+    }
+    // Touched but possibly unchanged (e.g. a fresh checkout): compare content
+    if (sourceTime != header->sourceTime) {
+      uint64_t sourceHash = 0;
+      if (!hashSource(sourcePath, sourceHash) || sourceHash != header->sourceHash) {
+        close();
+        return false;
+      }
+    }
+  }
+
+  // Every level must fit the file
+  size_t offset = kDataOffset;
+  m_levels.resize(header->mipMapCount);
+  for (unsigned int i = 0; i < header->mipMapCount; ++i) {
+    CacheLevel& level = m_levels[i];
+    level.width = std::max(1u, header->width >> i);
+    level.height = std::max(1u, header->height >> i);
+    if (!levelLayout(dx10->dxgiFormat, level.width, level.height, level.rowPitch, level.size) ||
+      level.size > m_file.size() - offset) {
+      close();
+      return false;
+    }
+    level.data = m_file.data() + offset;
+    offset += level.size;
+  }
+
+  m_header = header;
+  m_dx10 = dx10;
+  return true;
+}
+
+void
+TextureCache::close() {
+  m_file.close();
+  m_header = nullptr;
+  m_dx10 = nullptr;
+  m_levels.clear();
+}
+
+bool
+TextureCache::write(const std::string& cachePath,
+  const std::string& sourcePath,
+  uint32_t dxgiFormat,
+  const std::vector<CacheLevel>& levels) {
+  if (levels.empty()) {
+    return false;
+  }
+  for (size_t i = 0; i < levels.size(); ++i) {
+    unsigned int rowPitch = 0;
+    size_t size = 0;
+    if (levels[i].width != std::max(1u, levels[0].width >> i) ||
+      levels[i].height != std::max(1u, levels[0].height >> i) ||
+      !levelLayout(dxgiFormat, levels[i].width, levels[i].height, rowPitch, size) ||
+      levels[i].rowPitch != rowPitch || levels[i].size != size || !levels[i].data) {
+      return false;
+    }
+  }
+
+  DdsHeader header = {};
+  header.size = sizeof(DdsHeader);
+  header.flags = kDdsdCaps | kDdsdHeight | kDdsdWidth | kDdsdPixelFormat | kDdsdMipMapCount |
+    (isBlockCompressed(dxgiFormat) ? kDdsdLinearSize : kDdsdPitch);
+  header.height = levels[0].height;
+  header.width = levels[0].width;
+  header.pitchOrLinearSize = isBlockCompressed(dxgiFormat) ?
+    static_cast<uint32_t>(levels[0].size) : levels[0].rowPitch;
+  header.mipMapCount = static_cast<uint32_t>(levels.size());
+  header.tag = kTag;
+  header.version = kVersion;
+  if (!getSourceStamp(sourcePath, header.sourceSize, header.sourceTime) ||
+    !hashSource(sourcePath, header.sourceHash)) {
+    return false;
+  }
+  header.pixelFormat.size = sizeof(DdsPixelFormat);
+  header.pixelFormat.flags = kDdpfFourCC;
+  header.pixelFormat.fourCC = kFourCCDx10;
+  header.caps = kDdsCapsTexture | (levels.size() > 1 ? kDdsCapsComplex | kDdsCapsMipMap : 0);
+
+  DdsHeaderDx10 dx10 = {};
+  dx10.dxgiFormat = dxgiFormat;
+  dx10.resourceDimension = kDimensionTexture2D;
+  dx10.arraySize = 1;
+
+  // Write next to the target and rename, so a crash never leaves a torn cache
+  std::string tempPath = cachePath + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return false;
+    }
+    const uint32_t magic = kDdsMagic;
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    for (const CacheLevel& level : levels) {
+      file.write(static_cast<const char*>(level.data), static_cast<std::streamsize>(level.size));
+    }
+    if (!file) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+  return true;
+}
+
+unsigned int
+TextureCache::firstLevelFor(const std::vector<CacheLevel>& levels, unsigned int maxLevels, bool blockCompressed) {
+  if (maxLevels == 0 || maxLevels >= levels.size()) {
+    return 0;
+  }
+  unsigned int firstLevel = static_cast<unsigned int>(levels.size()) - maxLevels;
+  while (blockCompressed && firstLevel > 0 &&
+    (levels[firstLevel].width % 4 != 0 || levels[firstLevel].height % 4 != 0)) {
+    --firstLevel;
+  }
+  return firstLevel;
+}
+
+bool
+TextureCache::isBlockCompressed(uint32_t dxgiFormat) {
+  return dxgiFormat == kFormatBc1 || dxgiFormat == kFormatBc3 ||
+    dxgiFormat == kFormatBc5 || dxgiFormat == kFormatBc7;
+}
+
+bool
+TextureCache::levelLayout(uint32_t dxgiFormat, unsigned int width, unsigned int height,
+  unsigned int& outRowPitch, size_t& outSize) {
+  if (dxgiFormat == kFormatRgba8) {
+    outRowPitch = width * 4;
+    outSize = static_cast<size_t>(outRowPitch) * height;
+    return true;
+  }
+  if (!isBlockCompressed(dxgiFormat)) {
+    return false;
+  }
+  unsigned int blockBytes = (dxgiFormat == kFormatBc1) ? 8 : 16;
+  outRowPitch = ((width + 3) / 4) * blockBytes;
+  outSize = static_cast<size_t>(outRowPitch) * ((height + 3) / 4);
+  return true;
+}
+
+bool
+TextureCache::getSourceStamp(const std::string& sourcePath, uint64_t& outSize, int64_t& outTime) {
+  std::error_code error;
+  uintmax_t size = std::filesystem::file_size(sourcePath, error);
+  if (error) {
+    return false;
+  }
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(sourcePath, error);
+  if (error) {
+    return false;
+  }
+  outSize = static_cast<uint64_t>(size);
+  outTime = static_cast<int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+bool
+TextureCache::hashSource(const std::string& sourcePath, uint64_t& outHash) {
+  MappedFile source;
+  if (!source.open(sourcePath)) {
+    return false;
+  }
+  outHash = hashBytes64(source.data(), source.size());
+  return true;
+}
@@ -0,0 +1,183 @@
+#include "TextureDecodeQueue.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+namespace {
+  // Peak bytes per texel while decoding: stbi output (4), the RGBA8 chain
+  // (4 * 4/3), the float copy of the level being filtered (4 for the next
+  // level at 16 bytes per texel) and the block chain, rounded up
+  const size_t kDecodeBytesPerTexel = 16;
+
+  double
+  millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+TextureDecodeQueue::TextureDecodeQueue(unsigned int threadCount, size_t memoryBudget)
+  : m_memoryBudget(memoryBudget),
+    m_workers(std::make_unique<ThreadPool>(threadCount)) {
+}
+
+TextureDecodeQueue::~TextureDecodeQueue() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_budgetFreed.notify_all();
+
+  // Queued requests see m_stopping and return right away
+  m_workers.reset();
+  m_decoded.clear();
+}
+
+void
+TextureDecodeQueue::submit(uint64_t ticket, const std::string& fileName) {
+  std::unique_ptr<DecodedTexture> request = std::make_unique<DecodedTexture>();
+  request->ticket = ticket;
+  request->fileName = fileName;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+  }
+  // std::function needs a copyable callable; the job owns the request again
+  DecodedTexture* queued = request.release();
+  m_workers->enqueue([this, queued]() {
+    decodeRequest(std::unique_ptr<DecodedTexture>(queued));
+  });
+}
+
+void
+TextureDecodeQueue::decodeRequest(std::unique_ptr<DecodedTexture> request) {
+  auto start = std::chrono::steady_clock::now();
+  bool aborted = false;
+
+  // A cache hit only maps the file; reserve its size before mapping it
+  std::error_code error;
+  const std::string cachePath = TextureCache::cachePathFor(request->fileName);
+  uintmax_t cacheSize = std::filesystem::file_size(cachePath, error);
+  if (!error) {
+    if (!reserve(static_cast<size_t>(cacheSize))) {
+      aborted = true;
+    }
+    else {
+      request->reservedBytes = static_cast<size_t>(cacheSize);
+      request->cacheHit = TextureDecoder::loadCached(request->fileName, request->data);
+      if (!request->cacheHit) {
+        releaseBytes(request->reservedBytes);
+        request->reservedBytes = 0;
+      }
+    }
+  }
+  request->succeeded = request->cacheHit;
+
+  if (!request->cacheHit && !aborted) {
+    MappedFile file;
+    const unsigned char* fileBytes = nullptr;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    if (file.open(request->fileName)) {
+      fileBytes = reinterpret_cast<const unsigned char*>(file.data());
+    }
+    if (!fileBytes || !TextureDecoder::readInfo(fileBytes, file.size(), width, height)) {
+      ERROR("TextureDecodeQueue", "decodeRequest", ("Failed to read " + request->fileName).c_str());
+    }
+    else {
+      const size_t estimate = static_cast<size_t>(width) * height * kDecodeBytesPerTexel;
+      if (!reserve(estimate)) {
+        aborted = true;
+      }
+      else {
+        request->reservedBytes = estimate;
+        request->succeeded = TextureDecoder::decode(request->fileName, fileBytes, file.size(), request->data);
+
+        // Keep only what waits for release reserved
+        const size_t resident = request->succeeded ? request->data.residentBytes() : 0;
+        if (resident < request->reservedBytes) {
+          releaseBytes(request->reservedBytes - resident);
+          request->reservedBytes = resident;
+        }
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.workerMs += millisecondsSince(start);
+  if (aborted) {
+    return;
+  }
+  if (request->cacheHit) {
+    ++m_stats.cacheHits;
+  }
+  else if (request->succeeded) {
+    ++m_stats.decoded;
+  }
+  else {
+    ++m_stats.failed;
+  }
+  m_decoded.push_back(std::move(request));
+}
+
+size_t
+TextureDecodeQueue::takeDecoded(std::vector<std::unique_ptr<DecodedTexture>>& outDecoded, size_t maxCount) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t count = (maxCount == 0) ? m_decoded.size() : std::min(maxCount, m_decoded.size());
+  for (size_t i = 0; i < count; ++i) {
+    outDecoded.push_back(std::move(m_decoded.front()));
+    m_decoded.pop_front();
+  }
+  return count;
+}
+
+void
+TextureDecodeQueue::release(DecodedTexture& decoded) {
+  decoded.data = TextureDecoder::TextureData();
+  releaseBytes(decoded.reservedBytes);
+  decoded.reservedBytes = 0;
+}
+
+void
+TextureDecodeQueue::setMemoryBudget(size_t memoryBudget) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryBudget = memoryBudget;
+  }
+  m_budgetFreed.notify_all();
+}
+
+TextureDecodeQueue::DecodeStats
+TextureDecodeQueue::getStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+bool
+TextureDecodeQueue::reserve(size_t bytes) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // An empty queue always admits one request, however large
+  m_budgetFreed.wait(lock, [this, bytes]() {
+    return m_stopping ||
+      m_stats.bytesInFlight == 0 ||
+      m_stats.bytesInFlight + bytes <= m_memoryBudget;
+  });
+  if (m_stopping) {
+    return false;
+  }
+  m_stats.bytesInFlight += bytes;
+  m_stats.peakBytesInFlight = std::max(m_stats.peakBytesInFlight, m_stats.bytesInFlight);
+  return true;
+}
+
+void
+TextureDecodeQueue::releaseBytes(size_t bytes) {
+  if (bytes == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.bytesInFlight -= bytes;
+  }
+  m_budgetFreed.notify_all();
+}
@@ -0,0 +1,157 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "TextureDecoder.h"
+
+namespace {
+  // DXGI_FORMAT values of the levels built here
+  const uint32_t kFormatRgba8 = 28;
+  const uint32_t kFormatBc1 = 71;
+  const uint32_t kFormatBc3 = 77;
+  const uint32_t kFormatBc5 = 83;
+  const uint32_t kFormatBc7 = 98;
+
+  uint32_t
+  blockFormatToDxgi(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1:
+      return kFormatBc1;
+    case BLOCK_BC3:
+      return kFormatBc3;
+    case BLOCK_BC5:
+      return kFormatBc5;
+    case BLOCK_BC7:
+      return kFormatBc7;
+    default:
+      return 0;
+    }
+  }
+}
+
+size_t
+TextureDecoder::TextureData::residentBytes() const {
+  size_t bytes = 0;
+  for (const TextureCache::CacheLevel& level : levels) {
+    bytes += level.size;
+  }
+  return bytes;
+}
+
+bool
+TextureDecoder::loadCached(const std::string& fileName, TextureData& outData) {
+  std::unique_ptr<TextureCache> textureCache = std::make_unique<TextureCache>();
+  if (!textureCache->open(TextureCache::cachePathFor(fileName), fileName)) {
+    return false;
+  }
+  outData.dxgiFormat = textureCache->dxgiFormat();
+  outData.levels = textureCache->levels();
+  outData.cache = std::move(textureCache);
+  return true;
+}
+
+bool
+TextureDecoder::readInfo(const unsigned char* fileBytes,
+  size_t fileSize,
+  unsigned int& outWidth,
+  unsigned int& outHeight) {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  if (!stbi_info_from_memory(fileBytes, static_cast<int>(fileSize), &width, &height, &channels)) {
+    return false;
+  }
+  outWidth = static_cast<unsigned int>(width);
+  outHeight = static_cast<unsigned int>(height);
+  return true;
+}
+
+bool
+TextureDecoder::decode(const std::string& fileName,
+  const unsigned char* fileBytes,
+  size_t fileSize,
+  TextureData& outData) {
+  int width, height, channels;
+  unsigned char* pixels = stbi_load_from_memory(fileBytes,
+    static_cast<int>(fileSize),
+    &width,
+    &height,
+    &channels,
+    4); // 4 bytes por pixel (RGBA)
+  if (!pixels) {
+    ERROR("TextureDecoder", "decode",
+      ("Failed to decode " + fileName + ": " + std::string(stbi_failure_reason())).c_str());
+    return false;
+  }
+
+  bool built = buildData(pixels,
+    static_cast<unsigned int>(width),
+    static_cast<unsigned int>(height),
+    outData);
+  stbi_image_free(pixels); // Liberar los datos de imagen inmediatamente
+  if (!built) {
+    return false;
+  }
+
+  // Bake the cache so the next load skips all of the above. A read-only
+  // asset folder only costs the bake on every load.
+  TextureCache::write(TextureCache::cachePathFor(fileName), fileName, outData.dxgiFormat, outData.levels);
+  return true;
+}
+
+bool
+TextureDecoder::buildData(const unsigned char* pixels,
+  unsigned int width,
+  unsigned int height,
+  TextureData& outData,
+  unsigned int levelCount) {
+  // Minified textures need the whole chain: level 1 and below are filtered
+  // on the CPU in linear light, then every level is block compressed
+  MipGenerator mipGenerator;
+  MipGenerator::MipImage image;
+  image.pixels = pixels;
+  image.width = width;
+  image.height = height;
+  if (!mipGenerator.generate(image, outData.mipChain)) {
+    ERROR("TextureDecoder", "buildData", "Failed to generate the mip chain");
+    return false;
+  }
+  if (levelCount != 0 && levelCount < outData.mipChain.levels.size()) {
+    outData.mipChain.levels.resize(levelCount);
+  }
+
+  const MipGenerator::MipChain& mipChain = outData.mipChain;
+  outData.dxgiFormat = kFormatRgba8;
+  outData.levels.resize(mipChain.levels.size());
+  for (size_t level = 0; level < mipChain.levels.size(); ++level) {
+    TextureCache::CacheLevel& target = outData.levels[level];
+    target.width = mipChain.levels[level].width;
+    target.height = mipChain.levels[level].height;
+    target.rowPitch = mipChain.levels[level].width * 4;
+    target.data = mipChain.pixels.data() + mipChain.levels[level].offset;
+    target.size = static_cast<size_t>(target.rowPitch) * target.height;
+  }
+
+  // Block compression cuts memory and bandwidth by 4x (BC1) or 2x. D3D11
+  // needs the top level of a BC texture to be a multiple of 4; other sizes
+  // stay uncompressed.
+  if (width % 4 == 0 && height % 4 == 0) {
+    std::vector<BlockCompressor::BlockImage> blockImages(mipChain.levels.size());
+    for (size_t level = 0; level < mipChain.levels.size(); ++level) {
+      blockImages[level].pixels = mipChain.pixels.data() + mipChain.levels[level].offset;
+      blockImages[level].width = mipChain.levels[level].width;
+      blockImages[level].height = mipChain.levels[level].height;
+    }
+    BlockCompressor blockCompressor;
+    BlockCompressor::BlockChain& blockChain = outData.blockChain;
+    if (blockCompressor.compress(blockImages.data(), blockImages.size(), BLOCK_AUTO, blockChain)) {
+      outData.dxgiFormat = blockFormatToDxgi(blockChain.format);
+      for (size_t level = 0; level < blockChain.levels.size(); ++level) {
+        outData.levels[level].rowPitch = blockChain.levels[level].rowPitch;
+        outData.levels[level].data = blockChain.blocks.data() + blockChain.levels[level].offset;
+        outData.levels[level].size = blockChain.levels[level].size;
+      }
+      std::vector<unsigned char>().swap(outData.mipChain.pixels);
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,160 @@
+#include "TextureLoader.h"
+#include "Device.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+  double
+  millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+TextureLoader::TextureLoader(unsigned int threadCount, size_t memoryBudget)
+  : m_decodeQueue(std::make_unique<TextureDecodeQueue>(threadCount, memoryBudget)) {
+}
+
+TextureLoader::~TextureLoader() {
+  // Joins the workers and drops the decodes nobody took
+  m_decodeQueue.reset();
+  for (auto& entry : m_decoding) {
+    entry.second->loaded.set_value(E_ABORT);
+  }
+  for (std::unique_ptr<LoadRequest>& request : m_direct) {
+    request->loaded.set_value(E_ABORT);
+  }
+  m_decoding.clear();
+  m_direct.clear();
+}
+
+std::future<HRESULT>
+TextureLoader::load(const std::string& textureName,
+  ExtensionType extensionType,
+  Texture& outTexture,
+  unsigned int maxMipLevels,
+  LoadedCallback onLoaded) {
+  std::unique_ptr<LoadRequest> request = std::make_unique<LoadRequest>();
+  request->textureName = textureName;
+  request->extensionType = extensionType;
+  request->texture = &outTexture;
+  request->maxMipLevels = maxMipLevels;
+  request->onLoaded = std::move(onLoaded);
+  switch (extensionType) {
+  case PNG:
+    request->fileName = textureName + ".png";
+    break;
+  case JPG:
+    request->fileName = textureName + ".jpg";
+    break;
+  default:
+    request->fileName = textureName + ".dds";
+    break;
+  }
+  std::future<HRESULT> loaded = request->loaded.get_future();
+  const std::string fileName = request->fileName;
+
+  uint64_t ticket = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+    if (extensionType != PNG && extensionType != JPG) {
+      // Nothing to decode up front; update() hands the file to Texture::init
+      m_direct.push_back(std::move(request));
+      return loaded;
+    }
+    ticket = m_nextTicket++;
+    m_decoding[ticket] = std::move(request);
+  }
+  // Submitted outside the lock: a fast worker may finish before this returns
+  m_decodeQueue->submit(ticket, fileName);
+  return loaded;
+}
+
+size_t
+TextureLoader::update(Device& device, size_t maxUploads) {
+  std::deque<std::unique_ptr<LoadRequest>> direct;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = (maxUploads == 0) ? m_direct.size() : std::min(maxUploads, m_direct.size());
+    for (size_t i = 0; i < count; ++i) {
+      direct.push_back(std::move(m_direct.front()));
+      m_direct.pop_front();
+    }
+  }
+  std::vector<std::unique_ptr<TextureDecodeQueue::DecodedTexture>> decoded;
+  if (maxUploads == 0 || direct.size() < maxUploads) {
+    m_decodeQueue->takeDecoded(decoded, maxUploads == 0 ? 0 : maxUploads - direct.size());
+  }
+  if (direct.empty() && decoded.empty()) {
+    return 0;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  size_t failed = 0;
+  for (std::unique_ptr<LoadRequest>& request : direct) {
+    failed += !completeRequest(device, *request, nullptr);
+  }
+  for (std::unique_ptr<TextureDecodeQueue::DecodedTexture>& result : decoded) {
+    std::unique_ptr<LoadRequest> request;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto found = m_decoding.find(result->ticket);
+      request = std::move(found->second);
+      m_decoding.erase(found);
+    }
+    failed += !completeRequest(device, *request, result.get());
+    // The texture holds its own copy now
+    m_decodeQueue->release(*result);
+  }
+
+  const size_t completed = direct.size() + decoded.size();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.uploadMs += millisecondsSince(start);
+  m_stats.uploaded += completed - failed;
+  m_stats.failed += failed;
+  return completed;
+}
+
+bool
+TextureLoader::completeRequest(Device& device, LoadRequest& request, TextureDecodeQueue::DecodedTexture* decoded) {
+  HRESULT hr = E_FAIL;
+  if (!decoded) {
+    hr = request.texture->init(device, request.textureName, request.extensionType);
+  }
+  else if (decoded->succeeded) {
+    hr = request.texture->init(device, request.fileName, decoded->data, request.maxMipLevels);
+  }
+  if (FAILED(hr)) {
+    ERROR("TextureLoader", "update", ("Failed to load " + request.fileName).c_str());
+  }
+
+  if (request.onLoaded) {
+    request.onLoaded(hr, *request.texture);
+  }
+  request.loaded.set_value(hr);
+  return SUCCEEDED(hr);
+}
+
+bool
+TextureLoader::idle() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_decoding.empty() && m_direct.empty();
+}
+
+void
+TextureLoader::setMemoryBudget(size_t memoryBudget) {
+  m_decodeQueue->setMemoryBudget(memoryBudget);
+}
+
+TextureLoader::LoaderStats
+TextureLoader::getStats() const {
+  const TextureDecodeQueue::DecodeStats decodeStats = m_decodeQueue->getStats();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  LoaderStats stats = m_stats;
+  stats.cacheHits = decodeStats.cacheHits;
+  stats.decoded = decodeStats.decoded;
+  stats.bytesInFlight = decodeStats.bytesInFlight;
+  stats.peakBytesInFlight = decodeStats.peakBytesInFlight;
+  stats.workerMs = decodeStats.workerMs;
+  return stats;
+}
@@ -0,0 +1,224 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(size_t memoryBudget, unsigned int tailSize)
+  : m_memoryBudget(memoryBudget),
+    m_tailSize(std::max(1u, tailSize)) {
+}
+
+unsigned int
+TextureStreamer::addTexture(const std::string& sourcePath) {
+  std::unique_ptr<TextureCache> cache = std::make_unique<TextureCache>();
+  if (!cache->open(TextureCache::cachePathFor(sourcePath), sourcePath)) {
+    return kInvalidTexture;
+  }
+
+  StreamedTexture texture;
+  const std::vector<TextureCache::CacheLevel>& levels = cache->levels();
+  const unsigned int levelCount = static_cast<unsigned int>(levels.size());
+  const bool blockCompressed = TextureCache::isBlockCompressed(cache->dxgiFormat());
+  for (unsigned int level = 0; level < levelCount; ++level) {
+    if (!blockCompressed || (levels[level].width % 4 == 0 && levels[level].height % 4 == 0)) {
+      texture.firstLevels.push_back(level);
+    }
+  }
+  if (texture.firstLevels.empty()) {
+    return kInvalidTexture;
+  }
+
+  texture.chainBytes.assign(levelCount + 1, 0);
+  for (unsigned int level = levelCount; level-- > 0;) {
+    texture.chainBytes[level] = texture.chainBytes[level + 1] + levels[level].size;
+  }
+
+  unsigned int tailLevel = levelCount - 1;
+  for (unsigned int level = 0; level < levelCount; ++level) {
+    if (std::max(levels[level].width, levels[level].height) <= m_tailSize) {
+      tailLevel = level;
+      break;
+    }
+  }
+  texture.cache = std::move(cache);
+  texture.tailLevel = validFirstLevel(texture, tailLevel);
+  texture.residentLevel = levelCount;
+  texture.wantedLevel = texture.tailLevel;
+  texture.targetLevel = texture.tailLevel;
+
+  m_textures.push_back(std::move(texture));
+  return static_cast<unsigned int>(m_textures.size() - 1);
+}
+
+void
+TextureStreamer::reportUsage(unsigned int textureId, float screenSize, float distance) {
+  if (textureId >= m_textures.size()) {
+    return;
+  }
+  StreamedTexture& texture = m_textures[textureId];
+  const TextureCache::CacheLevel& top = texture.cache->levels()[0];
+
+  // One texel per pixel: each halving of the screen size drops a level
+  const float topSize = static_cast<float>(std::max(top.width, top.height));
+  const float levelsBelowTop = std::floor(std::log2(topSize / std::max(1.0f, screenSize)));
+  const unsigned int wantedLevel = validFirstLevel(texture,
+    static_cast<unsigned int>(std::min(std::max(levelsBelowTop, 0.0f), static_cast<float>(texture.tailLevel))));
+  const float priority = std::max(0.0f, screenSize) / (1.0f + std::max(0.0f, distance));
+
+  if (!texture.reported) {
+    texture.reported = true;
+    texture.wantedLevel = wantedLevel;
+    texture.priority = priority;
+  }
+  else {
+    texture.wantedLevel = std::min(texture.wantedLevel, wantedLevel);
+    texture.priority = std::max(texture.priority, priority);
+  }
+}
+
+void
+TextureStreamer::update(StreamingDevice& device, unsigned int maxUploads) {
+  m_lastStats = StreamerStats();
+  m_lastStats.textures = m_textures.size();
+  m_lastStats.memoryBudget = m_memoryBudget;
+
+  // Tails are always resident
+  size_t targetBytes = 0;
+  for (StreamedTexture& texture : m_textures) {
+    texture.targetLevel = texture.tailLevel;
+    targetBytes += texture.chainBytes[texture.tailLevel];
+    m_lastStats.wantedBytes += texture.chainBytes[texture.wantedLevel];
+  }
+
+  m_order.resize(m_textures.size());
+  for (unsigned int id = 0; id < m_order.size(); ++id) {
+    m_order[id] = id;
+  }
+  std::stable_sort(m_order.begin(), m_order.end(), [this](unsigned int a, unsigned int b) {
+    return m_textures[a].priority > m_textures[b].priority;
+  });
+
+  // Grant the wanted levels by priority, then keep what is already resident
+  // while there is room left, so textures out of view are evicted lazily
+  for (int pass = 0; pass < 2; ++pass) {
+    for (unsigned int id : m_order) {
+      StreamedTexture& texture = m_textures[id];
+      const unsigned int goal = (pass == 0) ? texture.wantedLevel : texture.residentLevel;
+      while (texture.targetLevel > goal) {
+        const unsigned int finer = finerFirstLevel(texture, texture.targetLevel);
+        const size_t extraBytes = texture.chainBytes[finer] - texture.chainBytes[texture.targetLevel];
+        if (finer == texture.targetLevel || targetBytes + extraBytes > m_memoryBudget) {
+          break;
+        }
+        texture.targetLevel = finer;
+        targetBytes += extraBytes;
+      }
+    }
+  }
+
+  // Shrink first so the budget is free before anything is uploaded
+  for (unsigned int id = 0; id < m_textures.size(); ++id) {
+    StreamedTexture& texture = m_textures[id];
+    const unsigned int levelCount = static_cast<unsigned int>(texture.cache->levels().size());
+    if (texture.residentLevel < levelCount && texture.targetLevel > texture.residentLevel) {
+      if (makeResident(device, id, texture.targetLevel)) {
+        ++m_lastStats.streamedOut;
+      }
+    }
+  }
+
+  unsigned int uploads = 0;
+  for (unsigned int id : m_order) {
+    StreamedTexture& texture = m_textures[id];
+    if (texture.targetLevel >= texture.residentLevel) {
+      continue;
+    }
+    const unsigned int levelCount = static_cast<unsigned int>(texture.cache->levels().size());
+    if (maxUploads != 0 && uploads >= maxUploads) {
+      // A texture with nothing resident still gets its tail this frame
+      ++m_lastStats.deferred;
+      if (texture.residentLevel == levelCount) {
+        makeResident(device, id, texture.tailLevel);
+      }
+      continue;
+    }
+    if (makeResident(device, id, texture.targetLevel)) {
+      ++uploads;
+      ++m_lastStats.streamedIn;
+    }
+  }
+
+  for (StreamedTexture& texture : m_textures) {
+    if (texture.residentLevel < texture.cache->levels().size()) {
+      m_lastStats.residentBytes += texture.chainBytes[texture.residentLevel];
+    }
+    texture.reported = false;
+    texture.priority = 0.0f;
+    texture.wantedLevel = texture.tailLevel;
+  }
+}
+
+void
+TextureStreamer::releaseAll(StreamingDevice& device) {
+  for (unsigned int id = 0; id < m_textures.size(); ++id) {
+    StreamedTexture& texture = m_textures[id];
+    const unsigned int levelCount = static_cast<unsigned int>(texture.cache->levels().size());
+    if (texture.residentLevel < levelCount) {
+      device.releaseTexture(id);
+      texture.residentLevel = levelCount;
+    }
+  }
+}
+
+unsigned int
+TextureStreamer::residentLevel(unsigned int textureId) const {
+  if (textureId >= m_textures.size()) {
+    return 0;
+  }
+  return m_textures[textureId].residentLevel;
+}
+
+float
+TextureStreamer::projectedSize(float radius, float distance, float fovY, float viewportHeight) {
+  if (distance <= radius) {
+    return viewportHeight;
+  }
+  return radius / (distance * std::tan(fovY * 0.5f)) * viewportHeight;
+}
+
+unsigned int
+TextureStreamer::validFirstLevel(const StreamedTexture& texture, unsigned int level) {
+  unsigned int firstLevel = texture.firstLevels[0];
+  for (unsigned int candidate : texture.firstLevels) {
+    if (candidate > level) {
+      break;
+    }
+    firstLevel = candidate;
+  }
+  return firstLevel;
+}
+
+unsigned int
+TextureStreamer::finerFirstLevel(const StreamedTexture& texture, unsigned int level) {
+  unsigned int finer = level;
+  for (unsigned int candidate : texture.firstLevels) {
+    if (candidate >= level) {
+      break;
+    }
+    finer = candidate;
+  }
+  return finer;
+}
+
+bool
+TextureStreamer::makeResident(StreamingDevice& device, unsigned int textureId, unsigned int firstLevel) {
+  StreamedTexture& texture = m_textures[textureId];
+  const std::vector<TextureCache::CacheLevel>& levels = texture.cache->levels();
+  if (!device.setResidentLevels(textureId,
+    texture.cache->dxgiFormat(),
+    levels.data() + firstLevel,
+    static_cast<unsigned int>(levels.size()) - firstLevel)) {
+    return false;
+  }
+  texture.residentLevel = firstLevel;
+  return true;
+}
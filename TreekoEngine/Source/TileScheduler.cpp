@@ -0,0 +1,83 @@
+#include "TileScheduler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+void
+TileScheduler::run(size_t tileCount, unsigned int threadCount, const std::function<void(size_t)>& work) {
+  m_lastStats = ScheduleStats();
+  m_lastStats.tiles = tileCount;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t workerCount = std::min<size_t>(threadCount, tileCount);
+
+  if (workerCount <= 1) {
+    m_lastStats.threads = 1;
+    for (size_t tile = 0; tile < tileCount; ++tile) {
+      work(tile);
+    }
+    return;
+  }
+
+  // Contiguous ranges, so each worker starts on neighbouring tiles
+  std::vector<WorkerQueue> queues(workerCount);
+  m_queues.swap(queues);
+  for (size_t worker = 0; worker < workerCount; ++worker) {
+    size_t begin = tileCount * worker / workerCount;
+    size_t end = tileCount * (worker + 1) / workerCount;
+    for (size_t tile = begin; tile < end; ++tile) {
+      m_queues[worker].tiles.push_back(tile);
+    }
+  }
+
+  // The calling thread is worker 0
+  std::vector<std::future<size_t>> pending;
+  {
+    ThreadPool workers(static_cast<unsigned int>(workerCount - 1));
+    for (size_t worker = 1; worker < workerCount; ++worker) {
+      pending.push_back(workers.submit([this, worker, &work]() {
+        return workerLoop(worker, work);
+      }));
+    }
+    m_lastStats.steals = workerLoop(0, work);
+    for (std::future<size_t>& workerDone : pending) {
+      m_lastStats.steals += workerDone.get();
+    }
+  }
+  m_lastStats.threads = static_cast<unsigned int>(workerCount);
+  m_queues.clear();
+}
+
+size_t
+TileScheduler::workerLoop(size_t index, const std::function<void(size_t)>& work) {
+  size_t steals = 0;
+  WorkerQueue& own = m_queues[index];
+  for (;;) {
+    size_t tile = 0;
+    bool found = false;
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tiles.empty()) {
+        tile = own.tiles.front();
+        own.tiles.pop_front();
+        found = true;
+      }
+    }
+
+    // No tile is ever added, so once every queue is empty the work is done
+    for (size_t offset = 1; !found && offset < m_queues.size(); ++offset) {
+      WorkerQueue& victim = m_queues[(index + offset) % m_queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tiles.empty()) {
+        tile = victim.tiles.back();
+        victim.tiles.pop_back();
+        found = true;
+        ++steals;
+      }
+    }
+    if (!found) {
+      return steals;
+    }
+    work(tile);
+  }
+}
@@ -0,0 +1,77 @@
+#include "VertexCache.h"
+
+namespace {
+  // Keep the table at most 70% full so linear probe runs stay short
+  constexpr size_t kMaxLoadNumerator = 7;
+  constexpr size_t kMaxLoadDenominator = 10;
+  constexpr size_t kMinSlots = 64;
+}
+
+void
+VertexCache::reserve(size_t expectedVertices) {
+  size_t wanted = expectedVertices * kMaxLoadDenominator / kMaxLoadNumerator + 1;
+  size_t slotCount = kMinSlots;
+  while (slotCount < wanted) {
+    slotCount <<= 1;
+  }
+  if (slotCount > m_slots.size()) {
+    rehash(slotCount);
+  }
+}
+
+void
+VertexCache::rehash(size_t slotCount) {
+  std::vector<Slot> oldSlots;
+  oldSlots.swap(m_slots);
+  m_slots.assign(slotCount, Slot{ 0, 0, 0, -1 });
+  m_mask = slotCount - 1;
+  m_count = 0;
+
+  bool inserted;
+  for (const Slot& slot : oldSlots) {
+    if (slot.vertex >= 0) {
+      findOrInsert(slot.posIndex, slot.uvIndex, slot.normIndex, slot.vertex, inserted);
+    }
+  }
+}
+
+int
+VertexCache::findOrInsert(int posIndex, int uvIndex, int normIndex, int newVertex, bool& inserted) {
+  if ((m_count + 1) * kMaxLoadDenominator > m_slots.size() * kMaxLoadNumerator) {
+    grow();
+  }
+
+  size_t probe = hash(posIndex, uvIndex, normIndex) & m_mask;
+  for (;;) {
+    Slot& slot = m_slots[probe];
+    if (slot.vertex < 0) {
+      slot = Slot{ posIndex, uvIndex, normIndex, newVertex };
+      ++m_count;
+      inserted = true;
+      return newVertex;
+    }
+    if (slot.posIndex == posIndex && slot.uvIndex == uvIndex && slot.normIndex == normIndex) {
+      inserted = false;
+      return slot.vertex;
+    }
+    probe = (probe + 1) & m_mask;
+  }
+}
+
+void
+VertexCache::grow() {
+  rehash(m_slots.empty() ? kMinSlots : m_slots.size() * 2);
+}
+
+uint32_t
+VertexCache::hash(int posIndex, int uvIndex, int normIndex) {
+  // Indices are dense and highly correlated, so mix them thoroughly
+  uint32_t h = static_cast<uint32_t>(posIndex) * 0x9E3779B1u;
+  h ^= static_cast<uint32_t>(uvIndex) * 0x85EBCA77u;
+  h = (h << 13) | (h >> 19);
+  h ^= static_cast<uint32_t>(normIndex) * 0xC2B2AE3Du;
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  return h;
+}
@@ -0,0 +1,281 @@
+#include "VertexPacker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  const float kUnorm16Max = 65535.0f;
+  const float kSnorm16Max = 32767.0f;
+  const float kRadiansToDegrees = 57.2957795f;
+
+  uint16_t
+  quantizeUnorm16(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint16_t>(value * kUnorm16Max + 0.5f);
+  }
+
+  // SNORM16 conversion as done by the input assembler: -32768 also maps to -1
+  float
+  expandSnorm16(int16_t value) {
+    return std::max(static_cast<float>(value) / kSnorm16Max, -1.0f);
+  }
+}
+
+bool
+VertexPacker::pack(const MeshComponent& mesh,
+  std::vector<PackedVertex>& outVertices,
+  PackedVertexParams& outParams) {
+  m_lastError = PackedVertexError();
+  if (mesh.m_vertex.empty()) {
+    return false;
+  }
+
+  outParams = computeParams(mesh);
+  outVertices.resize(mesh.m_vertex.size());
+
+  double squaredErrorSum = 0.0;
+  for (size_t i = 0; i < mesh.m_vertex.size(); ++i) {
+    const SimpleVertex& source = mesh.m_vertex[i];
+    encode(source, outParams, outVertices[i]);
+
+    SimpleVertex decoded;
+    decode(outVertices[i], outParams, decoded);
+
+    float dx = decoded.Pos.x - source.Pos.x;
+    float dy = decoded.Pos.y - source.Pos.y;
+    float dz = decoded.Pos.z - source.Pos.z;
+    float squaredError = dx * dx + dy * dy + dz * dz;
+    squaredErrorSum += squaredError;
+    m_lastError.maxPositionError = std::max(m_lastError.maxPositionError, std::sqrt(squaredError));
+
+    m_lastError.maxTexCoordError = std::max(m_lastError.maxTexCoordError,
+      std::max(std::fabs(decoded.Tex.x - source.Tex.x), std::fabs(decoded.Tex.y - source.Tex.y)));
+
+    // atan2 of |cross| and dot stays accurate for the tiny angles involved,
+    // where acos of a float dot product would only measure rounding noise
+    const XMFLOAT3& n = source.Norm;
+    const XMFLOAT3& d = decoded.Norm;
+    if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f) {
+      double cx = double(n.y) * d.z - double(n.z) * d.y;
+      double cy = double(n.z) * d.x - double(n.x) * d.z;
+      double cz = double(n.x) * d.y - double(n.y) * d.x;
+      double dot = double(n.x) * d.x + double(n.y) * d.y + double(n.z) * d.z;
+      float angle = static_cast<float>(std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot));
+      m_lastError.maxNormalErrorDegrees = std::max(m_lastError.maxNormalErrorDegrees, angle * kRadiansToDegrees);
+    }
+  }
+
+  m_lastError.rmsPositionError = static_cast<float>(std::sqrt(squaredErrorSum / mesh.m_vertex.size()));
+  return true;
+}
+
+PackedVertexParams
+VertexPacker::computeParams(const MeshComponent& mesh) {
+  PackedVertexParams params;
+
+  XMFLOAT3 boundsMin = mesh.m_boundsMin;
+  XMFLOAT3 boundsMax = mesh.m_boundsMax;
+  bool texCoordsInUnitRange = true;
+  if (!mesh.m_vertex.empty()) {
+    // Recomputed so a mesh whose bounds were never filled in still packs correctly
+    boundsMin = mesh.m_vertex[0].Pos;
+    boundsMax = mesh.m_vertex[0].Pos;
+    for (const SimpleVertex& vertex : mesh.m_vertex) {
+      boundsMin.x = std::min(boundsMin.x, vertex.Pos.x);
+      boundsMin.y = std::min(boundsMin.y, vertex.Pos.y);
+      boundsMin.z = std::min(boundsMin.z, vertex.Pos.z);
+      boundsMax.x = std::max(boundsMax.x, vertex.Pos.x);
+      boundsMax.y = std::max(boundsMax.y, vertex.Pos.y);
+      boundsMax.z = std::max(boundsMax.z, vertex.Pos.z);
+      if (vertex.Tex.x < 0.0f || vertex.Tex.x > 1.0f || vertex.Tex.y < 0.0f || vertex.Tex.y > 1.0f) {
+        texCoordsInUnitRange = false;
+      }
+    }
+  }
+
+  params.positionMin = boundsMin;
+  params.positionExtent = XMFLOAT3(boundsMax.x - boundsMin.x,
+    boundsMax.y - boundsMin.y,
+    boundsMax.z - boundsMin.z);
+  params.texCoordFormat = texCoordsInUnitRange ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT;
+  return params;
+}
+
+void
+VertexPacker::encode(const SimpleVertex& vertex, const PackedVertexParams& params, PackedVertex& outVertex) {
+  const float position[3] = { vertex.Pos.x, vertex.Pos.y, vertex.Pos.z };
+  const float minimum[3] = { params.positionMin.x, params.positionMin.y, params.positionMin.z };
+  const float extent[3] = { params.positionExtent.x, params.positionExtent.y, params.positionExtent.z };
+  for (int axis = 0; axis < 3; ++axis) {
+    // A flat axis has a single valid value
+    outVertex.Pos[axis] = (extent[axis] > 0.0f)
+      ? quantizeUnorm16((position[axis] - minimum[axis]) / extent[axis])
+      : 0;
+  }
+  outVertex.Pos[3] = 0xFFFF;
+
+  octEncode(vertex.Norm, outVertex.Norm);
+
+  if (params.texCoordFormat == DXGI_FORMAT_R16G16_UNORM) {
+    outVertex.Tex[0] = quantizeUnorm16(vertex.Tex.x);
+    outVertex.Tex[1] = quantizeUnorm16(vertex.Tex.y);
+  }
+  else {
+    outVertex.Tex[0] = floatToHalf(vertex.Tex.x);
+    outVertex.Tex[1] = floatToHalf(vertex.Tex.y);
+  }
+}
+
+void
+VertexPacker::decode(const PackedVertex& vertex, const PackedVertexParams& params, SimpleVertex& outVertex) {
+  outVertex.Pos.x = params.positionMin.x + vertex.Pos[0] / kUnorm16Max * params.positionExtent.x;
+  outVertex.Pos.y = params.positionMin.y + vertex.Pos[1] / kUnorm16Max * params.positionExtent.y;
+  outVertex.Pos.z = params.positionMin.z + vertex.Pos[2] / kUnorm16Max * params.positionExtent.z;
+
+  outVertex.Norm = octDecode(vertex.Norm);
+
+  if (params.texCoordFormat == DXGI_FORMAT_R16G16_UNORM) {
+    outVertex.Tex.x = vertex.Tex[0] / kUnorm16Max;
+    outVertex.Tex.y = vertex.Tex[1] / kUnorm16Max;
+  }
+  else {
+    outVertex.Tex.x = halfToFloat(vertex.Tex[0]);
+    outVertex.Tex.y = halfToFloat(vertex.Tex[1]);
+  }
+}
+
+XMMATRIX
+VertexPacker::dequantizeMatrix(const PackedVertexParams& params) {
+  return XMMatrixMultiply(
+    XMMatrixScaling(params.positionExtent.x, params.positionExtent.y, params.positionExtent.z),
+    XMMatrixTranslation(params.positionMin.x, params.positionMin.y, params.positionMin.z));
+}
+
+void
+VertexPacker::octEncode(const XMFLOAT3& normal, int16_t outEncoded[2]) {
+  float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+  if (l1 <= 0.0f) {
+    outEncoded[0] = 0;
+    outEncoded[1] = 0;
+    return;
+  }
+
+  // Project onto the octahedron, then fold the lower half over the upper one
+  float x = normal.x / l1;
+  float y = normal.y / l1;
+  if (normal.z < 0.0f) {
+    float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+
+  // Rounding each axis independently is not always the closest code; try the
+  // four neighbours and keep the one that decodes nearest to the input
+  float scaledX = std::min(std::max(x, -1.0f), 1.0f) * kSnorm16Max;
+  float scaledY = std::min(std::max(y, -1.0f), 1.0f) * kSnorm16Max;
+  float baseX = std::floor(scaledX);
+  float baseY = std::floor(scaledY);
+  float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+  float bestDistance = 5.0f;
+  for (int i = 0; i < 4; ++i) {
+    float candidateX = std::min(std::max(baseX + (i & 1), -kSnorm16Max), kSnorm16Max);
+    float candidateY = std::min(std::max(baseY + (i >> 1), -kSnorm16Max), kSnorm16Max);
+    int16_t candidate[2] = { static_cast<int16_t>(candidateX), static_cast<int16_t>(candidateY) };
+    XMFLOAT3 decoded = octDecode(candidate);
+    float dx = decoded.x - normal.x / length;
+    float dy = decoded.y - normal.y / length;
+    float dz = decoded.z - normal.z / length;
+    float distance = dx * dx + dy * dy + dz * dz;
+    if (distance < bestDistance) {
+      bestDistance = distance;
+      outEncoded[0] = candidate[0];
+      outEncoded[1] = candidate[1];
+    }
+  }
+}
+
+XMFLOAT3
+VertexPacker::octDecode(const int16_t encoded[2]) {
+  float x = expandSnorm16(encoded[0]);
+  float y = expandSnorm16(encoded[1]);
+  float z = 1.0f - std::fabs(x) - std::fabs(y);
+  float t = std::max(-z, 0.0f);
+  x += (x >= 0.0f) ? -t : t;
+  y += (y >= 0.0f) ? -t : t;
+
+  float length = std::sqrt(x * x + y * y + z * z);
+  return XMFLOAT3(x / length, y / length, z / length);
+}
+
+uint16_t
+VertexPacker::floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+  uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+  if (magnitude >= 0x7F800000u) {
+    // Inf stays inf, NaN stays a (quiet) NaN
+    return sign | 0x7C00u | ((magnitude > 0x7F800000u) ? 0x0200u : 0u);
+  }
+  if (magnitude >= 0x477FF000u) {
+    // Rounds to a value beyond the largest half
+    return sign | 0x7C00u;
+  }
+  if (magnitude < 0x38800000u) {
+    // Subnormal half (or zero): shift the implicit-one mantissa into place
+    if (magnitude < 0x33000000u) {
+      return sign;
+    }
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x007FFFFFu) | 0x00800000u;
+    uint32_t shift = 126 - exponent;
+    uint32_t halfMantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (halfMantissa & 1u))) {
+      ++halfMantissa;
+    }
+    return sign | static_cast<uint16_t>(halfMantissa);
+  }
+
+  // Normal range: rebias the exponent and round the mantissa to nearest even
+  uint32_t rounded = magnitude - 0x38000000u + 0x0FFFu + ((magnitude >> 13) & 1u);
+  return sign | static_cast<uint16_t>(rounded >> 13);
+}
+
+float
+VertexPacker::halfToFloat(uint16_t value) {
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+  uint32_t exponent = (value >> 10) & 0x1Fu;
+  uint32_t mantissa = value & 0x03FFu;
+
+  uint32_t bits;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    }
+    else {
+      // Normalize the subnormal
+      exponent = 127 - 15 + 1;
+      while ((mantissa & 0x0400u) == 0) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      mantissa &= 0x03FFu;
+      bits = sign | (exponent << 23) | (mantissa << 13);
+    }
+  }
+  else if (exponent == 0x1F) {
+    bits = sign | 0x7F800000u | (mantissa << 13);
+  }
+  else {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
@@ -0,0 +1,172 @@
+#include "BlockCompressor.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+// Times BlockCompressor on generated color, alpha and normal map images for
+// every format and quality, with the PSNR of the decoded result, then times
+// one format from 1 to N threads on the TileScheduler and checks every
+// thread count writes the same blocks.
+//   BlockCompressorBenchmark [size] [maxThreads]
+
+namespace {
+  unsigned char
+  toByte(float value) {
+    return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+  }
+
+  /*
+    *  @brief Gradients, a few frequencies of detail and some noise, like a
+    *         photo; with alpha, a soft radial mask.
+  */
+  std::vector<unsigned char>
+  makeColorImage(unsigned int size, bool alpha) {
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    std::mt19937 random(9);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        float u = float(x) / size;
+        float v = float(y) / size;
+        float detail = 0.15f * std::sin(40.0f * u) * std::cos(25.0f * v) + 0.05f * std::sin(180.0f * (u + v));
+        unsigned char* texel = &pixels[(size_t(y) * size + x) * 4];
+        texel[0] = toByte(0.2f + 0.6f * u + detail + noise(random));
+        texel[1] = toByte(0.7f - 0.4f * v + 0.5f * detail + noise(random));
+        texel[2] = toByte(0.4f + 0.3f * std::sin(6.0f * u * v) + noise(random));
+        float distance = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+        texel[3] = alpha ? toByte(1.5f - 3.0f * distance) : 255;
+      }
+    }
+    return pixels;
+  }
+
+  /*
+    *  @brief Tangent-space normals of a bumpy height field, X and Y only.
+  */
+  std::vector<unsigned char>
+  makeNormalMap(unsigned int size) {
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        float u = 30.0f * x / size;
+        float v = 30.0f * y / size;
+        float dx = 0.6f * std::cos(u) * std::cos(0.7f * v) + 0.3f * std::cos(7.0f * u + 3.0f * v);
+        float dy = -0.42f * std::sin(u) * std::sin(0.7f * v) + 0.3f * std::sin(5.0f * v - 2.0f * u);
+        float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+        unsigned char* texel = &pixels[(size_t(y) * size + x) * 4];
+        texel[0] = toByte(0.5f - 0.5f * dx / length);
+        texel[1] = toByte(0.5f - 0.5f * dy / length);
+        texel[2] = 255;
+        texel[3] = 255;
+      }
+    }
+    return pixels;
+  }
+
+  const char*
+  formatName(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1: return "BC1";
+    case BLOCK_BC3: return "BC3";
+    case BLOCK_BC5: return "BC5";
+    case BLOCK_BC7: return "BC7";
+    default: return "auto";
+    }
+  }
+
+  double
+  decodedPsnr(const BlockCompressor::BlockChain& chain, const BlockCompressor::BlockImage& image) {
+    std::vector<unsigned char> decoded;
+    if (!BlockCompressor::decompress(chain.blocks.data(), image.width, image.height, chain.format, decoded)) {
+      return 0.0;
+    }
+    return BlockCompressor::psnr(image.pixels, decoded.data(), size_t(image.width) * image.height, chain.format);
+  }
+}
+
+int
+main(int argc, char** argv) {
+  unsigned int size = argc > 1 ? std::atoi(argv[1]) : 2048;
+  unsigned int maxThreads = argc > 2 ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+  const std::vector<unsigned char> color = makeColorImage(size, false);
+  const std::vector<unsigned char> alpha = makeColorImage(size, true);
+  const std::vector<unsigned char> normals = makeNormalMap(size);
+  struct Case {
+    const char* name;
+    const std::vector<unsigned char>* pixels;
+    BlockFormat format;
+    bool colorData;
+    double minPsnr;
+  };
+  const Case cases[] = {
+    { "color", &color, BLOCK_BC1, true, 30.0 },
+    { "color", &color, BLOCK_BC7, true, 36.0 },
+    { "alpha", &alpha, BLOCK_BC3, true, 30.0 },
+    { "alpha", &alpha, BLOCK_BC7, true, 36.0 },
+    { "normal", &normals, BLOCK_BC5, false, 36.0 },
+  };
+  const double megapixels = double(size) * size / 1e6;
+
+  std::printf("%ux%u, %u threads\n", size, size, maxThreads);
+  std::printf("image   format quality   encode ms   MPix/s   PSNR dB  auto\n");
+  BlockCompressor compressor;
+  for (const Case& test : cases) {
+    BlockCompressor::BlockImage image;
+    image.pixels = test.pixels->data();
+    image.width = size;
+    image.height = size;
+    double fastPsnr = 0.0;
+    for (BlockQuality quality : { BLOCK_FAST, BLOCK_HIGH }) {
+      compressor.setQuality(quality);
+      compressor.setColorData(test.colorData);
+      BlockCompressor::BlockChain chain;
+      CHECK(compressor.compress(image, test.format, chain, maxThreads));
+      double ms = compressor.getLastStats().encodeMs;
+      double psnr = decodedPsnr(chain, image);
+      BlockFormat automatic = BlockCompressor::chooseFormat(image, quality, test.colorData);
+      std::printf("%-7s %-6s %-7s %11.1f %8.1f %9.2f  %s\n", test.name, formatName(test.format),
+        quality == BLOCK_FAST ? "fast" : "high", ms, megapixels / (ms / 1000.0), psnr, formatName(automatic));
+
+      CHECK(chain.format == test.format);
+      CHECK(chain.blocks.size() == size_t((size + 3) / 4) * ((size + 3) / 4) * BlockCompressor::blockBytes(test.format));
+      CHECK(psnr >= test.minPsnr);
+      // Refinement keeps the best candidate, so it never loses to the fast fit
+      if (quality == BLOCK_FAST) {
+        fastPsnr = psnr;
+      }
+      else {
+        CHECK(psnr >= fastPsnr - 0.01);
+      }
+    }
+  }
+
+  // Scaling of the slowest case; the blocks must not depend on the schedule
+  std::printf("\nBC7 high, color\n");
+  std::printf("threads  tiles  steals   encode ms   MPix/s  speedup\n");
+  BlockCompressor::BlockImage image;
+  image.pixels = color.data();
+  image.width = size;
+  image.height = size;
+  compressor.setQuality(BLOCK_HIGH);
+  compressor.setColorData(true);
+  BlockCompressor::BlockChain serial;
+  double serialMs = 0.0;
+  for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+    BlockCompressor::BlockChain chain;
+    CHECK(compressor.compress(image, BLOCK_BC7, chain, threads));
+    const BlockCompressor::CompressStats& stats = compressor.getLastStats();
+    if (threads == 1) {
+      serial = chain;
+      serialMs = stats.encodeMs;
+    }
+    CHECK(chain.blocks == serial.blocks);
+    std::printf("%7u %6zu %7zu %11.1f %8.1f %7.2fx\n", stats.threads, stats.tiles, stats.steals,
+      stats.encodeMs, megapixels / (stats.encodeMs / 1000.0), serialMs / stats.encodeMs);
+  }
+
+  return TestUtils::result();
+}
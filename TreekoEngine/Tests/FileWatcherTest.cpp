@@ -0,0 +1,105 @@
+#include "FileWatcher.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <fstream>
+
+// Writes files in a watched directory the way editors save them and checks
+// what FileWatcher reports: several writes inside the settle time give
+// exactly one change, nothing before the file has settled, a save through a
+// temporary file reports the saved name, and files in subdirectories or
+// unwatched directories are not reported.
+
+namespace {
+  const unsigned int kSettleMs = 100;
+
+  void
+  appendFile(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << text;
+  }
+
+  std::string
+  pathString(const std::filesystem::path& path) {
+    return path.lexically_normal().string();
+  }
+
+  /*
+    *  @brief Polls like a frame loop for a while and returns everything reported.
+  */
+  std::vector<std::string>
+  pollFor(FileWatcher& watcher, unsigned int ms) {
+    std::vector<std::string> changed;
+    TestUtils::Timer timer;
+    while (timer.elapsedMs() < ms) {
+      watcher.poll(changed);
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    watcher.poll(changed);
+    return changed;
+  }
+
+  size_t
+  countOf(const std::vector<std::string>& changed, const std::filesystem::path& path) {
+    return std::count(changed.begin(), changed.end(), pathString(path));
+  }
+}
+
+int
+main() {
+  const std::filesystem::path directory = TestUtils::scratchDirectory("FileWatcher");
+  const std::filesystem::path other = directory / "Other";
+  std::filesystem::create_directories(directory / "Sub");
+  std::filesystem::create_directories(other);
+
+  FileWatcher watcher(kSettleMs);
+  CHECK(!watcher.isRunning());
+  CHECK(!watcher.watchDirectory((directory / "Missing").string()));
+  CHECK(watcher.watchDirectory(directory.string()));
+  CHECK(watcher.watchDirectory(directory.string() + "/"));
+  CHECK(watcher.isRunning());
+
+  // Five writes 10 ms apart: nothing while they go on, then exactly one change
+  const std::filesystem::path shader = directory / "Shader.fx";
+  std::vector<std::string> changed;
+  for (int write = 0; write < 5; ++write) {
+    appendFile(shader, "float4 PS() : SV_Target { return 0; }\n");
+    watcher.poll(changed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  watcher.poll(changed);
+  CHECK(changed.empty());
+  changed = pollFor(watcher, 4 * kSettleMs);
+  CHECK(changed.size() == 1);
+  CHECK(countOf(changed, shader) == 1);
+
+  // Nothing more once reported
+  CHECK(pollFor(watcher, 2 * kSettleMs).empty());
+
+  // Two files written together are reported once each
+  const std::filesystem::path material = directory / "Material.mtl";
+  appendFile(shader, "// edit\n");
+  appendFile(material, "newmtl Stone\n");
+  appendFile(shader, "// edit\n");
+  changed = pollFor(watcher, 4 * kSettleMs);
+  CHECK(changed.size() == 2);
+  CHECK(countOf(changed, shader) == 1 && countOf(changed, material) == 1);
+
+  // A save through a temporary file reports the saved name once
+  const std::filesystem::path temporary = directory / "Shader.fx.tmp";
+  appendFile(temporary, "float4 PS() : SV_Target { return 1; }\n");
+  std::filesystem::rename(temporary, shader);
+  changed = pollFor(watcher, 4 * kSettleMs);
+  CHECK(countOf(changed, shader) == 1);
+
+  // Subdirectories and other directories are not watched, until added
+  appendFile(directory / "Sub" / "Nested.fx", "\n");
+  appendFile(other / "Elsewhere.fx", "\n");
+  CHECK(pollFor(watcher, 3 * kSettleMs).empty());
+  CHECK(watcher.watchDirectory(other.string()));
+  appendFile(other / "Elsewhere.fx", "\n");
+  changed = pollFor(watcher, 4 * kSettleMs);
+  CHECK(changed.size() == 1 && countOf(changed, other / "Elsewhere.fx") == 1);
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
@@ -0,0 +1,139 @@
+#include "MeshCache.h"
+#include "TestUtils.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// Writes .tmesh caches of a small grid and checks which ones open() accepts.
+
+namespace {
+  MeshComponent
+  makeGrid(unsigned int size) {
+    MeshComponent mesh;
+    for (unsigned int y = 0; y <= size; ++y) {
+      for (unsigned int x = 0; x <= size; ++x) {
+        SimpleVertex vertex;
+        vertex.Pos = XMFLOAT3(float(x), float(y), 0.0f);
+        vertex.Tex = XMFLOAT2(float(x) / size, float(y) / size);
+        vertex.Norm = XMFLOAT3(0.0f, 0.0f, -1.0f);
+        mesh.m_vertex.push_back(vertex);
+      }
+    }
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        unsigned int a = y * (size + 1) + x;
+        unsigned int b = a + size + 1;
+        mesh.m_index.insert(mesh.m_index.end(), { a, b, b + 1, a, b + 1, a + 1 });
+      }
+    }
+    mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+    mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+    mesh.m_boundsMax = XMFLOAT3(float(size), float(size), 0.0f);
+    return mesh;
+  }
+
+  std::vector<char>
+  readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  void
+  writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  /*
+    *  @brief Section of a cache held in memory, or nullptr.
+  */
+  MeshCache::TMeshSection*
+  findSection(std::vector<char>& bytes, uint32_t type) {
+    MeshCache::TMeshHeader* header = reinterpret_cast<MeshCache::TMeshHeader*>(bytes.data());
+    MeshCache::TMeshSection* sections = reinterpret_cast<MeshCache::TMeshSection*>(bytes.data() + sizeof(MeshCache::TMeshHeader));
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+      if (sections[i].type == type) {
+        return &sections[i];
+      }
+    }
+    return nullptr;
+  }
+
+  bool
+  matches(const MeshCache& cache, const MeshComponent& mesh) {
+    return cache.vertexCount() == mesh.m_vertex.size() &&
+      cache.indexCount() == mesh.m_index.size() &&
+      std::memcmp(cache.vertexData(), mesh.m_vertex.data(), mesh.m_vertex.size() * sizeof(SimpleVertex)) == 0 &&
+      std::memcmp(cache.indexData(), mesh.m_index.data(), mesh.m_index.size() * sizeof(unsigned int)) == 0;
+  }
+}
+
+int
+main() {
+  std::filesystem::path directory = TestUtils::scratchDirectory("MeshCache");
+  std::string source = (directory / "grid.obj").string();
+  std::string cachePath = MeshCache::cachePathFor(source);
+  writeFile(source, std::vector<char>(100, '#'));
+  MeshComponent grid = makeGrid(16);
+
+  // Raw and compressed caches round-trip
+  for (bool compress : { false, true }) {
+    CHECK(MeshCache::write(cachePath, source, grid, compress));
+    MeshCache cache;
+    CHECK(cache.open(cachePath, source));
+    CHECK(matches(cache, grid));
+  }
+
+  // An index equal to the vertex count is rejected
+  CHECK(MeshCache::write(cachePath, source, grid));
+  std::vector<char> valid = readFile(cachePath);
+  {
+    std::vector<char> bytes = valid;
+    MeshCache::TMeshSection* indices = findSection(bytes, MeshCache::SECTION_INDICES);
+    CHECK(indices != nullptr);
+    if (indices) {
+      uint32_t* data = reinterpret_cast<uint32_t*>(bytes.data() + indices->offset);
+      data[indices->elementCount - 1] = static_cast<uint32_t>(grid.m_vertex.size());
+    }
+    writeFile(cachePath, bytes);
+    MeshCache cache;
+    CHECK(!cache.open(cachePath, source));
+  }
+
+  // Corrupt counts in a compressed cache fail without allocating for them
+  CHECK(MeshCache::write(cachePath, source, grid, true));
+  std::vector<char> compressed = readFile(cachePath);
+  for (uint32_t type : { MeshCache::SECTION_VERTICES_ENCODED, MeshCache::SECTION_INDICES_ENCODED }) {
+    for (uint32_t count : { 0xFFFFFFFFu, 0x7FFFFFFEu }) {
+      std::vector<char> bytes = compressed;
+      MeshCache::TMeshSection* section = findSection(bytes, type);
+      CHECK(section != nullptr);
+      if (section) {
+        section->elementCount = count;
+      }
+      writeFile(cachePath, bytes);
+      MeshCache cache;
+      CHECK(!cache.open(cachePath, source));
+    }
+  }
+
+  // A changed source makes the cache stale
+  writeFile(cachePath, valid);
+  writeFile(source, std::vector<char>(101, '#'));
+  {
+    MeshCache cache;
+    CHECK(!cache.open(cachePath, source));
+  }
+
+  // Without its source the cache is only trusted on request
+  std::filesystem::remove(source);
+  {
+    MeshCache cache;
+    CHECK(!cache.open(cachePath, source));
+    CHECK(cache.open(cachePath, source, true));
+    CHECK(matches(cache, grid));
+  }
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
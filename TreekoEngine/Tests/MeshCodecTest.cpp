@@ -0,0 +1,149 @@
+#include "MeshCodec.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+// Round-trips index and vertex buffers of several shapes and strides through
+// MeshCodec, and checks truncated or damaged streams are rejected.
+
+namespace {
+  std::vector<unsigned int>
+  gridIndices(unsigned int size) {
+    std::vector<unsigned int> indices;
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        unsigned int a = y * (size + 1) + x;
+        unsigned int b = a + size + 1;
+        indices.insert(indices.end(), { a, b, b + 1, a, b + 1, a + 1 });
+      }
+    }
+    return indices;
+  }
+
+  bool
+  roundTripIndices(const std::vector<unsigned int>& indices) {
+    std::vector<unsigned char> encoded;
+    if (!MeshCodec::encodeIndices(indices.data(), indices.size(), encoded)) {
+      return false;
+    }
+    if (indices.size() > MeshCodec::maxIndexCount(encoded.size())) {
+      return false;
+    }
+    std::vector<unsigned int> decoded(indices.size() + 1, 0xDEADBEEF);
+    return MeshCodec::decodeIndices(decoded.data(), indices.size(), encoded.data(), encoded.size()) &&
+      std::equal(indices.begin(), indices.end(), decoded.begin()) &&
+      decoded.back() == 0xDEADBEEF;
+  }
+
+  bool
+  roundTripVertices(const std::vector<unsigned char>& vertices, size_t stride) {
+    size_t count = vertices.size() / stride;
+    std::vector<unsigned char> encoded;
+    if (!MeshCodec::encodeVertices(vertices.data(), count, stride, encoded)) {
+      return false;
+    }
+    if (count > MeshCodec::maxVertexCount(stride, encoded.size())) {
+      return false;
+    }
+    std::vector<unsigned char> decoded(vertices.size() + 1, 0xCD);
+    return MeshCodec::decodeVertices(decoded.data(), count, stride, encoded.data(), encoded.size()) &&
+      std::memcmp(decoded.data(), vertices.data(), vertices.size()) == 0 &&
+      decoded.back() == 0xCD;
+  }
+
+  /*
+    *  @brief Vertices whose bytes change slowly, like positions on a surface,
+    *         mixed with random ones so every lane width gets used.
+  */
+  std::vector<unsigned char>
+  makeVertices(size_t count, size_t stride, std::mt19937& random) {
+    std::vector<unsigned char> vertices(count * stride);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> step(-3, 3);
+    for (size_t i = 0; i < count; ++i) {
+      for (size_t lane = 0; lane < stride; ++lane) {
+        unsigned char& value = vertices[i * stride + lane];
+        if (lane % 3 == 2 || i == 0) {
+          value = static_cast<unsigned char>(byte(random));
+        }
+        else {
+          value = static_cast<unsigned char>(vertices[(i - 1) * stride + lane] + step(random));
+        }
+      }
+    }
+    return vertices;
+  }
+}
+
+int
+main() {
+  std::mt19937 random(11);
+
+  // Index buffers: empty, one triangle, a grid, shuffled and far-apart indices
+  CHECK(roundTripIndices({}));
+  CHECK(roundTripIndices({ 0, 1, 2 }));
+  CHECK(roundTripIndices({ 7, 7, 7, 0xFFFFFFFF, 0, 0x80000000 }));
+  std::vector<unsigned int> grid = gridIndices(64);
+  CHECK(roundTripIndices(grid));
+  {
+    std::vector<unsigned int> shuffled = grid;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+    CHECK(roundTripIndices(shuffled));
+  }
+  {
+    std::vector<unsigned int> scattered(3000);
+    std::uniform_int_distribution<unsigned int> any(0, 0xFFFFFFFF);
+    for (unsigned int& index : scattered) {
+      index = any(random);
+    }
+    CHECK(roundTripIndices(scattered));
+  }
+  {
+    std::vector<unsigned char> encoded;
+    unsigned int indices[4] = { 0, 1, 2, 3 };
+    CHECK(!MeshCodec::encodeIndices(indices, 4, encoded));
+  }
+
+  // Vertex buffers: strides not multiple of 16 take the scalar transpose,
+  // counts not multiple of 16 leave a partial last block
+  for (size_t stride : { 1, 3, 4, 12, 16, 20, 32, 48, 256 }) {
+    for (size_t count : { 0, 1, 15, 16, 17, 1000 }) {
+      CHECK(roundTripVertices(makeVertices(count, stride, random), stride));
+    }
+  }
+  {
+    std::vector<unsigned char> encoded;
+    unsigned char vertex[4] = {};
+    CHECK(!MeshCodec::encodeVertices(vertex, 1, 0, encoded));
+    CHECK(!MeshCodec::encodeVertices(vertex, 1, 257, encoded));
+  }
+
+  // Every truncation and a wrong version byte are rejected
+  {
+    std::vector<unsigned int> indices(grid.begin(), grid.begin() + 600);
+    std::vector<unsigned char> encoded;
+    CHECK(MeshCodec::encodeIndices(indices.data(), indices.size(), encoded));
+    std::vector<unsigned int> decoded(indices.size());
+    for (size_t size = 0; size < encoded.size(); ++size) {
+      CHECK(!MeshCodec::decodeIndices(decoded.data(), indices.size(), encoded.data(), size));
+    }
+    encoded[0] ^= 0xFF;
+    CHECK(!MeshCodec::decodeIndices(decoded.data(), indices.size(), encoded.data(), encoded.size()));
+  }
+  {
+    const size_t stride = 32;
+    std::vector<unsigned char> vertices = makeVertices(100, stride, random);
+    std::vector<unsigned char> encoded;
+    CHECK(MeshCodec::encodeVertices(vertices.data(), 100, stride, encoded));
+    std::vector<unsigned char> decoded(vertices.size());
+    for (size_t size = 0; size < encoded.size(); ++size) {
+      CHECK(!MeshCodec::decodeVertices(decoded.data(), 100, stride, encoded.data(), size));
+    }
+    CHECK(!MeshCodec::decodeVertices(decoded.data(), 100, 16, encoded.data(), encoded.size()));
+    encoded[0] ^= 0xFF;
+    CHECK(!MeshCodec::decodeVertices(decoded.data(), 100, stride, encoded.data(), encoded.size()));
+  }
+
+  return TestUtils::result();
+}
@@ -0,0 +1,351 @@
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <tuple>
+
+// Builds the LOD chain of a UV sphere with a texture seam and of a box with
+// hard edges, open at the top, and checks every level: no crack opens (each
+// open edge of the index buffer is either on the rim of the box or has a seam
+// twin with other attributes), the rim keeps its length, box corners stay,
+// no triangle flips, the levels are back to back with fewer indices and a
+// growing error, and the chain round-trips through MeshCache.
+//   MeshSimplifierTest [rings] [boxCells]
+
+namespace {
+  const float kPi = 3.14159265f;
+
+  XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  XMFLOAT3
+  cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+
+  void
+  appendVertex(MeshComponent& mesh, XMFLOAT3 position, XMFLOAT2 uv, XMFLOAT3 normal) {
+    SimpleVertex vertex;
+    vertex.Pos = position;
+    vertex.Tex = uv;
+    vertex.Norm = normal;
+    mesh.m_vertex.push_back(vertex);
+  }
+
+  void
+  finish(MeshComponent& mesh) {
+    mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+    mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+    mesh.m_boundsMin = mesh.m_boundsMax = mesh.m_vertex[0].Pos;
+    for (const SimpleVertex& vertex : mesh.m_vertex) {
+      mesh.m_boundsMin = XMFLOAT3(std::min(mesh.m_boundsMin.x, vertex.Pos.x),
+        std::min(mesh.m_boundsMin.y, vertex.Pos.y), std::min(mesh.m_boundsMin.z, vertex.Pos.z));
+      mesh.m_boundsMax = XMFLOAT3(std::max(mesh.m_boundsMax.x, vertex.Pos.x),
+        std::max(mesh.m_boundsMax.y, vertex.Pos.y), std::max(mesh.m_boundsMax.z, vertex.Pos.z));
+    }
+  }
+
+  /*
+    *  @brief Unit sphere with one vertex per pole. The column at u = 1 repeats
+    *         the positions of u = 0 with other texture coordinates: the seam.
+  */
+  MeshComponent
+  makeSeamedSphere(unsigned int rings, unsigned int segments) {
+    MeshComponent mesh;
+    appendVertex(mesh, XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.5f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+    for (unsigned int r = 1; r < rings; ++r) {
+      float theta = kPi * r / rings;
+      for (unsigned int s = 0; s <= segments; ++s) {
+        float phi = 2.0f * kPi * (s % segments) / segments;
+        XMFLOAT3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        appendVertex(mesh, normal, XMFLOAT2(float(s) / segments, float(r) / rings), normal);
+      }
+    }
+    const unsigned int south = static_cast<unsigned int>(mesh.m_vertex.size());
+    appendVertex(mesh, XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.5f, 1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f));
+
+    const unsigned int columns = segments + 1;
+    for (unsigned int s = 0; s < segments; ++s) {
+      mesh.m_index.insert(mesh.m_index.end(), { 0, 1 + s + 1, 1 + s });
+    }
+    for (unsigned int r = 1; r + 1 < rings; ++r) {
+      for (unsigned int s = 0; s < segments; ++s) {
+        unsigned int a = 1 + (r - 1) * columns + s;
+        unsigned int d = a + columns;
+        mesh.m_index.insert(mesh.m_index.end(), { a, a + 1, d, a + 1, d + 1, d });
+      }
+    }
+    for (unsigned int s = 0; s < segments; ++s) {
+      unsigned int a = 1 + (rings - 2) * columns + s;
+      mesh.m_index.insert(mesh.m_index.end(), { a, a + 1, south });
+    }
+    finish(mesh);
+    return mesh;
+  }
+
+  /*
+    *  @brief Box from -1 to 1 without its top face. Every face is a grid of
+    *         cells x cells quads with vertices of its own, so the edges between
+    *         faces are normal seams and the top rim is an open border.
+  */
+  MeshComponent
+  makeOpenBox(unsigned int cells) {
+    MeshComponent mesh;
+    // Normal axis and sign, then the two axes spanning the face
+    const int faces[5][4] = { { 0, 1, 1, 2 }, { 0, -1, 1, 2 }, { 1, -1, 0, 2 }, { 2, 1, 0, 1 }, { 2, -1, 0, 1 } };
+    for (const int* face : faces) {
+      const unsigned int first = static_cast<unsigned int>(mesh.m_vertex.size());
+      float normal[3] = { 0.0f, 0.0f, 0.0f };
+      normal[face[0]] = float(face[1]);
+      for (unsigned int j = 0; j <= cells; ++j) {
+        for (unsigned int i = 0; i <= cells; ++i) {
+          float position[3];
+          position[face[0]] = float(face[1]);
+          position[face[2]] = -1.0f + 2.0f * i / cells;
+          position[face[3]] = -1.0f + 2.0f * j / cells;
+          appendVertex(mesh, XMFLOAT3(position[0], position[1], position[2]),
+            XMFLOAT2(float(i) / cells, float(j) / cells), XMFLOAT3(normal[0], normal[1], normal[2]));
+        }
+      }
+      const XMFLOAT3 outward(normal[0], normal[1], normal[2]);
+      for (unsigned int j = 0; j < cells; ++j) {
+        for (unsigned int i = 0; i < cells; ++i) {
+          unsigned int a = first + j * (cells + 1) + i;
+          unsigned int d = a + cells + 1;
+          unsigned int quad[6] = { a, a + 1, d, a + 1, d + 1, d };
+          // Clockwise seen from outside, like the sphere
+          for (int t = 0; t < 6; t += 3) {
+            const XMFLOAT3& p = mesh.m_vertex[quad[t]].Pos;
+            XMFLOAT3 n = cross(subtract(mesh.m_vertex[quad[t + 1]].Pos, p), subtract(mesh.m_vertex[quad[t + 2]].Pos, p));
+            if (dot(n, outward) > 0.0f) {
+              std::swap(quad[t + 1], quad[t + 2]);
+            }
+          }
+          mesh.m_index.insert(mesh.m_index.end(), quad, quad + 6);
+        }
+      }
+    }
+    finish(mesh);
+    return mesh;
+  }
+
+  struct LevelReport {
+    size_t triangles = 0;
+    size_t openEdges = 0;
+    size_t seamEdges = 0;
+    float rimLength = 0.0f;
+  };
+
+  /*
+    *  @brief Checks the edges and faces of one level against level 0.
+    *  @param position Welded position of every vertex.
+    *  @param wedgePositions Positions shared by several vertices at level 0.
+    *  @param frontSign Sign of dot(face normal, corner normals) at level 0.
+  */
+  LevelReport
+  checkLevel(const MeshComponent& mesh, const MeshLod& lod, const std::vector<unsigned int>& position,
+    const std::vector<unsigned char>& wedgePositions, float frontSign) {
+    LevelReport report;
+    const unsigned int* indices = mesh.m_index.data() + lod.indexOffset;
+    report.triangles = lod.indexCount / 3;
+
+    std::set<std::pair<unsigned int, unsigned int>> indexEdges;
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int> positionEdges;
+    for (size_t t = 0; t < report.triangles; ++t) {
+      const unsigned int* triangle = indices + t * 3;
+      const SimpleVertex& a = mesh.m_vertex[triangle[0]];
+      const SimpleVertex& b = mesh.m_vertex[triangle[1]];
+      const SimpleVertex& c = mesh.m_vertex[triangle[2]];
+
+      // Not flipped and not degenerate: same side as the corner normals
+      XMFLOAT3 normal = cross(subtract(b.Pos, a.Pos), subtract(c.Pos, a.Pos));
+      XMFLOAT3 cornerNormal(a.Norm.x + b.Norm.x + c.Norm.x, a.Norm.y + b.Norm.y + c.Norm.y,
+        a.Norm.z + b.Norm.z + c.Norm.z);
+      float facing = dot(normal, cornerNormal) * frontSign;
+      CHECK(facing > 1e-4f * std::sqrt(dot(normal, normal) * dot(cornerNormal, cornerNormal)));
+
+      for (int corner = 0; corner < 3; ++corner) {
+        unsigned int from = triangle[corner];
+        unsigned int to = triangle[(corner + 1) % 3];
+        CHECK(indexEdges.insert({ from, to }).second);
+        ++positionEdges[{ position[from], position[to] }];
+      }
+    }
+
+    // Manifold: every directed position edge is used once
+    for (const auto& edge : positionEdges) {
+      CHECK(edge.second == 1);
+    }
+    for (const std::pair<unsigned int, unsigned int>& edge : indexEdges) {
+      if (indexEdges.count({ edge.second, edge.first })) {
+        continue;
+      }
+      const SimpleVertex& from = mesh.m_vertex[edge.first];
+      const SimpleVertex& to = mesh.m_vertex[edge.second];
+      if (!positionEdges.count({ position[edge.second], position[edge.first] })) {
+        // Open by position: only the rim of the box, which lies at y = 1
+        ++report.openEdges;
+        CHECK(from.Pos.y == 1.0f && to.Pos.y == 1.0f);
+        XMFLOAT3 side = subtract(to.Pos, from.Pos);
+        report.rimLength += std::sqrt(dot(side, side));
+        continue;
+      }
+      // Open by index only: a seam, whose twin runs the other way over the
+      // same positions. Where the twin uses other vertices (everywhere but
+      // the poles), they carry other attributes and were seams at level 0.
+      ++report.seamEdges;
+      bool twinFound = false;
+      for (const std::pair<unsigned int, unsigned int>& twin : indexEdges) {
+        if (position[twin.first] != position[edge.second] || position[twin.second] != position[edge.first]) {
+          continue;
+        }
+        twinFound = true;
+        const std::pair<unsigned int, unsigned int> ends[2] = { { edge.first, twin.second }, { edge.second, twin.first } };
+        for (const std::pair<unsigned int, unsigned int>& end : ends) {
+          if (end.first == end.second) {
+            continue;
+          }
+          const SimpleVertex& vertex = mesh.m_vertex[end.first];
+          const SimpleVertex& twinVertex = mesh.m_vertex[end.second];
+          CHECK(wedgePositions[position[end.first]]);
+          CHECK(std::memcmp(&vertex.Tex, &twinVertex.Tex, sizeof(XMFLOAT2)) != 0 ||
+            std::memcmp(&vertex.Norm, &twinVertex.Norm, sizeof(XMFLOAT3)) != 0);
+        }
+      }
+      CHECK(twinFound);
+    }
+    return report;
+  }
+
+  /*
+    *  @brief Builds the chain of a mesh and checks every level.
+    *  @param corners Positions that must be used by every level.
+  */
+  void
+  checkChain(const char* name, MeshComponent mesh, const std::vector<XMFLOAT3>& corners, bool strictErrors,
+    const std::filesystem::path& directory) {
+    const size_t baseIndexCount = mesh.m_index.size();
+    const unsigned int baseTriangles = static_cast<unsigned int>(baseIndexCount / 3);
+
+    // Weld exact positions
+    std::map<std::tuple<float, float, float>, unsigned int> positionIds;
+    std::vector<unsigned int> position(mesh.m_vertex.size());
+    std::vector<unsigned int> verticesAtPosition;
+    for (size_t v = 0; v < mesh.m_vertex.size(); ++v) {
+      const XMFLOAT3& p = mesh.m_vertex[v].Pos;
+      auto inserted = positionIds.insert({ std::make_tuple(p.x, p.y, p.z), static_cast<unsigned int>(positionIds.size()) });
+      position[v] = inserted.first->second;
+      verticesAtPosition.resize(positionIds.size(), 0);
+      ++verticesAtPosition[position[v]];
+    }
+    std::vector<unsigned char> wedgePositions(positionIds.size(), 0);
+    for (size_t p = 0; p < verticesAtPosition.size(); ++p) {
+      wedgePositions[p] = verticesAtPosition[p] > 1;
+    }
+
+    MeshSimplifier simplifier;
+    CHECK(simplifier.buildLodChain(mesh));
+    const std::vector<MeshLod>& lods = mesh.m_lods;
+    CHECK(lods.size() >= 3);
+    CHECK(simplifier.getLastStats().levels == lods.size());
+    CHECK(simplifier.getLastStats().addedIndices == mesh.m_index.size() - baseIndexCount);
+    CHECK(mesh.m_numIndex == static_cast<int>(mesh.m_index.size()));
+
+    // Levels are back to back, each smaller, with a growing error
+    CHECK(!lods.empty() && lods[0].indexOffset == 0 && lods[0].indexCount == baseIndexCount && lods[0].error == 0.0f);
+    for (size_t i = 1; i < lods.size(); ++i) {
+      CHECK(lods[i].indexOffset == lods[i - 1].indexOffset + lods[i - 1].indexCount);
+      CHECK(lods[i].indexCount % 3 == 0 && lods[i].indexCount < lods[i - 1].indexCount);
+      CHECK(lods[i].error >= lods[i - 1].error);
+      CHECK(!strictErrors || lods[i].error > lods[i - 1].error);
+    }
+    CHECK(!lods.empty() && lods.back().indexOffset + lods.back().indexCount == mesh.m_index.size());
+    for (unsigned int index : mesh.m_index) {
+      CHECK(index < mesh.m_vertex.size());
+    }
+
+    // Winding of the full-resolution level
+    const SimpleVertex& a = mesh.m_vertex[mesh.m_index[0]];
+    const SimpleVertex& b = mesh.m_vertex[mesh.m_index[1]];
+    const SimpleVertex& c = mesh.m_vertex[mesh.m_index[2]];
+    const float frontSign = dot(cross(subtract(b.Pos, a.Pos), subtract(c.Pos, a.Pos)), a.Norm) > 0.0f ? 1.0f : -1.0f;
+
+    std::printf("%s: %u triangles, %zu levels\n", name, baseTriangles, lods.size());
+    std::printf("level  triangles      error  open edges  rim length  seam edges\n");
+    LevelReport base;
+    for (size_t i = 0; i < lods.size(); ++i) {
+      LevelReport report = checkLevel(mesh, lods[i], position, wedgePositions, frontSign);
+      if (i == 0) {
+        base = report;
+      }
+      // The rim keeps its shape and its length; the seams do not close
+      CHECK((report.openEdges == 0) == (base.openEdges == 0));
+      CHECK(std::fabs(report.rimLength - base.rimLength) < 1e-4f);
+      CHECK((report.seamEdges > 0) == (base.seamEdges > 0));
+
+      std::set<unsigned int> used;
+      for (unsigned int j = 0; j < lods[i].indexCount; ++j) {
+        used.insert(position[mesh.m_index[lods[i].indexOffset + j]]);
+      }
+      for (const XMFLOAT3& corner : corners) {
+        CHECK(used.count(positionIds[std::make_tuple(corner.x, corner.y, corner.z)]) == 1);
+      }
+      std::printf("%5zu %10zu %10.5f %11zu %11.3f %11zu\n", i, report.triangles, lods[i].error,
+        report.openEdges, report.rimLength, report.seamEdges);
+    }
+
+    // The chain round-trips through the cache, raw and compressed
+    const std::string source = (directory / (std::string(name) + ".obj")).string();
+    std::FILE* file = std::fopen(source.c_str(), "wb");
+    CHECK(file != nullptr);
+    if (file) {
+      std::fputs("# source\n", file);
+      std::fclose(file);
+    }
+    for (bool compress : { false, true }) {
+      const std::string cachePath = MeshCache::cachePathFor(source);
+      CHECK(MeshCache::write(cachePath, source, mesh, compress));
+      MeshCache cache;
+      CHECK(cache.open(cachePath, source));
+      CHECK(cache.lodCount() == lods.size());
+      CHECK(cache.lodData() != nullptr &&
+        std::memcmp(cache.lodData(), lods.data(), lods.size() * sizeof(MeshLod)) == 0);
+      CHECK(cache.indexCount() == mesh.m_index.size());
+      CHECK(cache.indexData() != nullptr &&
+        std::memcmp(cache.indexData(), mesh.m_index.data(), mesh.m_index.size() * sizeof(unsigned int)) == 0);
+    }
+  }
+}
+
+int
+main(int argc, char** argv) {
+  const unsigned int rings = argc > 1 ? std::atoi(argv[1]) : 24;
+  const unsigned int boxCells = argc > 2 ? std::atoi(argv[2]) : 12;
+  const std::filesystem::path directory = TestUtils::scratchDirectory("MeshSimplifier");
+
+  // The poles are the only points the sphere must keep
+  checkChain("sphere", makeSeamedSphere(rings, rings * 2),
+    { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) }, true, directory);
+
+  // Flat faces simplify without error, so the box only needs it not to shrink
+  std::vector<XMFLOAT3> corners;
+  for (int corner = 0; corner < 8; ++corner) {
+    corners.push_back(XMFLOAT3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f));
+  }
+  checkChain("box", makeOpenBox(boxCells), corners, false, directory);
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
@@ -0,0 +1,350 @@
+#include "MeshletBuilder.h"
+#include "MeshletCuller.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+// Flies synthetic camera paths over a field of spheres on a ground grid and
+// checks, every frame, that MeshletCuller only drops triangles that are
+// back-facing or outside the frustum, and that its SIMD test agrees with a
+// scalar one up to rounding. Prints how much each path culls.
+//   MeshletCullerTest [frames]
+
+namespace {
+  const float kPi = 3.14159265f;
+
+  XMFLOAT3
+  subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+  }
+
+  float
+  dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+  }
+
+  XMFLOAT3
+  cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+  }
+
+  XMFLOAT3
+  normalize(const XMFLOAT3& v) {
+    float length = std::sqrt(dot(v, v));
+    return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+  }
+
+  void
+  appendVertex(MeshComponent& mesh, XMFLOAT3 position, XMFLOAT3 normal) {
+    SimpleVertex vertex;
+    vertex.Pos = position;
+    vertex.Tex = XMFLOAT2(0.0f, 0.0f);
+    vertex.Norm = normal;
+    mesh.m_vertex.push_back(vertex);
+  }
+
+  // Clockwise front faces seen from outside, like the D3D11 default
+  void
+  appendSphere(MeshComponent& mesh, XMFLOAT3 center, float radius, unsigned int rings, unsigned int segments) {
+    unsigned int first = static_cast<unsigned int>(mesh.m_vertex.size());
+    for (unsigned int r = 0; r <= rings; ++r) {
+      float theta = kPi * r / rings;
+      for (unsigned int s = 0; s <= segments; ++s) {
+        float phi = 2.0f * kPi * s / segments;
+        XMFLOAT3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        appendVertex(mesh, XMFLOAT3(center.x + radius * normal.x, center.y + radius * normal.y,
+          center.z + radius * normal.z), normal);
+      }
+    }
+    for (unsigned int r = 0; r < rings; ++r) {
+      for (unsigned int s = 0; s < segments; ++s) {
+        unsigned int a = first + r * (segments + 1) + s;
+        unsigned int d = a + segments + 1;
+        mesh.m_index.insert(mesh.m_index.end(), { a, a + 1, d, a + 1, d + 1, d });
+      }
+    }
+  }
+
+  // Facing up
+  void
+  appendGround(MeshComponent& mesh, float halfSize, unsigned int cells) {
+    unsigned int first = static_cast<unsigned int>(mesh.m_vertex.size());
+    for (unsigned int z = 0; z <= cells; ++z) {
+      for (unsigned int x = 0; x <= cells; ++x) {
+        appendVertex(mesh, XMFLOAT3(-halfSize + 2.0f * halfSize * x / cells, 0.0f,
+          -halfSize + 2.0f * halfSize * z / cells), XMFLOAT3(0.0f, 1.0f, 0.0f));
+      }
+    }
+    for (unsigned int z = 0; z < cells; ++z) {
+      for (unsigned int x = 0; x < cells; ++x) {
+        unsigned int a = first + z * (cells + 1) + x;
+        unsigned int d = a + cells + 1;
+        mesh.m_index.insert(mesh.m_index.end(), { a, d, a + 1, a + 1, d, d + 1 });
+      }
+    }
+  }
+
+  /*
+    *  @brief Row-vector view * projection, as XMMatrixLookAtLH * XMMatrixPerspectiveFovLH.
+  */
+  XMFLOAT4X4
+  viewProjection(const XMFLOAT3& eye, const XMFLOAT3& target) {
+    XMFLOAT3 zAxis = normalize(subtract(target, eye));
+    XMFLOAT3 xAxis = normalize(cross(XMFLOAT3(0.0f, 1.0f, 0.0f), zAxis));
+    XMFLOAT3 yAxis = cross(zAxis, xAxis);
+    const float nearZ = 0.1f;
+    const float farZ = 100.0f;
+    float yScale = 1.0f / std::tan(kPi / 6.0f);
+    float xScale = yScale / (16.0f / 9.0f);
+    float depthScale = farZ / (farZ - nearZ);
+
+    XMFLOAT4X4 view = {};
+    const XMFLOAT3 axes[3] = { xAxis, yAxis, zAxis };
+    for (int c = 0; c < 3; ++c) {
+      view.m[0][c] = axes[c].x;
+      view.m[1][c] = axes[c].y;
+      view.m[2][c] = axes[c].z;
+      view.m[3][c] = -dot(axes[c], eye);
+    }
+    view.m[3][3] = 1.0f;
+
+    // Multiplying by the sparse projection
+    XMFLOAT4X4 result = {};
+    for (int r = 0; r < 4; ++r) {
+      result.m[r][0] = view.m[r][0] * xScale;
+      result.m[r][1] = view.m[r][1] * yScale;
+      result.m[r][2] = view.m[r][2] * depthScale - view.m[r][3] * nearZ * depthScale;
+      result.m[r][3] = view.m[r][2];
+    }
+    return result;
+  }
+
+  /*
+    *  @brief Meshlet visibility computed one at a time in scalar code, with the
+    *         bounding sphere grown (slack > 0) or shrunk (slack < 0) so rounding
+    *         differences with the culler fall between the two answers.
+  */
+  bool
+  referenceVisible(const Meshlet& meshlet, const XMFLOAT4X4& m, const XMFLOAT3& eye, float slack) {
+    float radius = meshlet.radius * (1.0f + slack) + slack;
+    for (int i = 0; i < 6; ++i) {
+      int column = i / 2;
+      float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+      float plane[4];
+      for (int r = 0; r < 4; ++r) {
+        plane[r] = (i == 4) ? m.m[r][2] : m.m[r][3] + sign * m.m[r][column];
+      }
+      float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+      float distance = (plane[0] * meshlet.center.x + plane[1] * meshlet.center.y +
+        plane[2] * meshlet.center.z + plane[3]) / length;
+      if (distance < -radius) {
+        return false;
+      }
+    }
+    XMFLOAT3 view = subtract(meshlet.center, eye);
+    return !(dot(view, meshlet.coneAxis) > meshlet.coneCutoff * std::sqrt(dot(view, view)) + radius);
+  }
+
+  /*
+    *  @brief Whether a triangle can reach the screen: clearly front-facing and
+    *         not entirely behind one clip plane.
+  */
+  bool
+  triangleMustDraw(const SimpleVertex* vertices, const unsigned int* triangle, const XMFLOAT4X4& m, const XMFLOAT3& eye) {
+    const XMFLOAT3& a = vertices[triangle[0]].Pos;
+    XMFLOAT3 normal = cross(subtract(vertices[triangle[1]].Pos, a), subtract(vertices[triangle[2]].Pos, a));
+    XMFLOAT3 view = subtract(a, eye);
+    // Degenerate triangles are never rasterized either
+    if (!(dot(view, normal) < -1e-3f * std::sqrt(dot(normal, normal) * dot(view, view)))) {
+      return false;
+    }
+
+    float clip[3][4];
+    for (int v = 0; v < 3; ++v) {
+      const XMFLOAT3& p = vertices[triangle[v]].Pos;
+      for (int c = 0; c < 4; ++c) {
+        clip[v][c] = p.x * m.m[0][c] + p.y * m.m[1][c] + p.z * m.m[2][c] + m.m[3][c];
+      }
+    }
+    for (int plane = 0; plane < 6; ++plane) {
+      bool allOutside = true;
+      for (int v = 0; v < 3 && allOutside; ++v) {
+        const float* c = clip[v];
+        float value;
+        switch (plane) {
+        case 0: value = c[3] + c[0]; break;
+        case 1: value = c[3] - c[0]; break;
+        case 2: value = c[3] + c[1]; break;
+        case 3: value = c[3] - c[1]; break;
+        case 4: value = c[2]; break;
+        default: value = c[3] - c[2]; break;
+        }
+        allOutside = value < -1e-4f * (std::fabs(c[3]) + 1.0f);
+      }
+      if (allOutside) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  struct PathTotals {
+    double meshlets = 0.0;
+    double frustumCulled = 0.0;
+    double backfaceCulled = 0.0;
+    double mustDraw = 0.0;
+    double drawnTight = 0.0;
+    double drawnMerged = 0.0;
+    double rangesTight = 0.0;
+    double rangesMerged = 0.0;
+    double cullMs = 0.0;
+    unsigned int undecided = 0;
+  };
+
+  /*
+    *  @brief Culls one frame with a merge gap of 0 and of the default, and
+    *         checks both against the references.
+  */
+  void
+  cullFrame(const MeshComponent& mesh, MeshletCuller& culler, const XMFLOAT3& eye, const XMFLOAT3& target,
+    PathTotals& totals) {
+    XMFLOAT4X4 m = viewProjection(eye, target);
+    std::vector<MeshletDrawRange> tight;
+    std::vector<MeshletDrawRange> merged;
+
+    culler.setMergeGap(0);
+    culler.cull(m, eye, tight);
+    MeshletCuller::CullStats stats = culler.getLastStats();
+    culler.setMergeGap(MeshletCuller::kDefaultMergeGap);
+    culler.cull(m, eye, merged);
+
+    // Meshlet by meshlet against the scalar test
+    std::vector<unsigned char> drawn(mesh.m_index.size() / 3, 0);
+    std::vector<unsigned char> drawnMerged(mesh.m_index.size() / 3, 0);
+    for (const MeshletDrawRange& range : tight) {
+      std::fill(drawn.begin() + range.indexOffset / 3, drawn.begin() + (range.indexOffset + range.indexCount) / 3, 1);
+    }
+    for (const MeshletDrawRange& range : merged) {
+      std::fill(drawnMerged.begin() + range.indexOffset / 3,
+        drawnMerged.begin() + (range.indexOffset + range.indexCount) / 3, 1);
+    }
+    for (const Meshlet& meshlet : mesh.m_meshlets) {
+      bool visible = drawn[meshlet.indexOffset / 3] != 0;
+      bool strict = referenceVisible(meshlet, m, eye, -1e-4f);
+      bool loose = referenceVisible(meshlet, m, eye, 1e-4f);
+      CHECK(!strict || visible);
+      CHECK(!visible || loose);
+      totals.undecided += strict != loose;
+    }
+
+    // Triangle by triangle: nothing that can reach the screen is dropped
+    unsigned int mustDraw = 0;
+    for (size_t t = 0; t < drawn.size(); ++t) {
+      if (triangleMustDraw(mesh.m_vertex.data(), &mesh.m_index[t * 3], m, eye)) {
+        ++mustDraw;
+        CHECK(drawn[t] && drawnMerged[t]);
+      }
+      CHECK(!drawn[t] || drawnMerged[t]);
+    }
+
+    // Ranges are sorted, disjoint and not touching, so each one is a needed draw call
+    for (const std::vector<MeshletDrawRange>* ranges : { &tight, &merged }) {
+      for (size_t i = 1; i < ranges->size(); ++i) {
+        CHECK((*ranges)[i].indexOffset > (*ranges)[i - 1].indexOffset + (*ranges)[i - 1].indexCount);
+      }
+    }
+    CHECK(merged.size() <= tight.size());
+
+    totals.meshlets += stats.meshlets;
+    totals.frustumCulled += stats.frustumCulled;
+    totals.backfaceCulled += stats.backfaceCulled;
+    totals.mustDraw += mustDraw;
+    totals.drawnTight += stats.visibleTriangles;
+    totals.drawnMerged += culler.getLastStats().visibleTriangles;
+    totals.rangesTight += stats.drawRanges;
+    totals.rangesMerged += culler.getLastStats().drawRanges;
+    totals.cullMs += stats.cullMs;
+  }
+
+  void
+  report(const char* name, unsigned int frames, size_t triangles, const PathTotals& totals) {
+    double meshlets = totals.meshlets;
+    std::printf("%-12s %6.1f%% %6.1f%% %7.1f%% %7.1f%% %7.1f%% %7.1f %7.1f %8.1f %4u\n", name,
+      100.0 * totals.frustumCulled / meshlets, 100.0 * totals.backfaceCulled / meshlets,
+      100.0 * totals.mustDraw / (double(triangles) * frames),
+      100.0 * totals.drawnTight / (double(triangles) * frames),
+      100.0 * totals.drawnMerged / (double(triangles) * frames),
+      totals.rangesTight / frames, totals.rangesMerged / frames,
+      1000.0 * totals.cullMs / frames, totals.undecided);
+  }
+}
+
+int
+main(int argc, char** argv) {
+  unsigned int frames = argc > 1 ? std::atoi(argv[1]) : 360;
+
+  // A 4x4 field of spheres of random sizes on a ground grid
+  MeshComponent mesh;
+  appendGround(mesh, 12.0f, 64);
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> size(0.6f, 1.6f);
+  std::vector<XMFLOAT3> centers;
+  for (int z = 0; z < 4; ++z) {
+    for (int x = 0; x < 4; ++x) {
+      float radius = size(random);
+      centers.push_back(XMFLOAT3(-6.0f + 4.0f * x, radius, -6.0f + 4.0f * z));
+      appendSphere(mesh, centers.back(), radius, 24, 36);
+    }
+  }
+  mesh.m_numVertex = static_cast<int>(mesh.m_vertex.size());
+  mesh.m_numIndex = static_cast<int>(mesh.m_index.size());
+  MeshletBuilder builder;
+  CHECK(builder.build(mesh));
+  MeshletCuller culler;
+  culler.init(mesh.m_meshlets);
+  CHECK(culler.getMeshletCount() == mesh.m_meshlets.size());
+  const size_t triangles = mesh.m_index.size() / 3;
+
+  std::printf("%zu triangles, %zu meshlets, %u frames per path\n", triangles, mesh.m_meshlets.size(), frames);
+  std::printf("path         frustum backface must-draw   drawn  merged  ranges  merged  cull us  und\n");
+
+  // Orbit around the field, bobbing up and down
+  PathTotals orbit;
+  for (unsigned int frame = 0; frame < frames; ++frame) {
+    float t = 2.0f * kPi * frame / frames;
+    XMFLOAT3 eye(16.0f * std::cos(t), 3.0f + 2.5f * std::sin(3.0f * t), 16.0f * std::sin(t));
+    cullFrame(mesh, culler, eye, XMFLOAT3(0.0f, 0.5f, 0.0f), orbit);
+  }
+  report("orbit", frames, triangles, orbit);
+
+  // Low fly-through between the rows, sweeping the view from side to side
+  PathTotals flight;
+  for (unsigned int frame = 0; frame < frames; ++frame) {
+    float t = float(frame) / frames;
+    XMFLOAT3 eye(-14.0f + 28.0f * t, 0.8f, -0.1f);
+    float yaw = 1.2f * std::sin(6.0f * kPi * t);
+    XMFLOAT3 target(eye.x + std::cos(yaw), eye.y - 0.1f, eye.z + std::sin(yaw));
+    cullFrame(mesh, culler, eye, target, flight);
+  }
+  report("fly-through", frames, triangles, flight);
+
+  // Standing inside the first sphere, whose triangles all face away, and
+  // turning around
+  PathTotals inside;
+  for (unsigned int frame = 0; frame < frames; ++frame) {
+    float yaw = 2.0f * kPi * frame / frames;
+    XMFLOAT3 eye(centers[0].x + 0.1f, centers[0].y, centers[0].z);
+    cullFrame(mesh, culler, eye, XMFLOAT3(eye.x + std::cos(yaw), eye.y + 0.3f * std::sin(2.0f * yaw),
+      eye.z + std::sin(yaw)), inside);
+  }
+  report("inside", frames, triangles, inside);
+
+  // Something has to be culled on every path, or the test proves nothing
+  CHECK(orbit.backfaceCulled > 0.0 && flight.frustumCulled > 0.0 && inside.backfaceCulled > 0.0);
+
+  culler.destroy();
+  CHECK(culler.getMeshletCount() == 0);
+  return TestUtils::result();
+}
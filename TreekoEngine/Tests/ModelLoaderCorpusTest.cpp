@@ -0,0 +1,157 @@
+#include "ModelLoader.h"
+#include "ObjCorpus.h"
+#include "TestUtils.h"
+#include <cstring>
+#include <fstream>
+#include <map>
+
+// Compares ModelLoader::loadModel against the std::getline/std::stringstream
+// parser it replaced, on every .obj of the directories passed on the command
+// line plus a generated corpus covering the syntax variations.
+//   ModelLoaderCorpusTest [directory...]
+
+namespace {
+  /*
+    *  @brief The loader before the memory-mapped parser: triangles and quads
+    *         of v/vt/vn corners, deduplicated by corner text.
+  */
+  bool
+  loadReference(const std::string& fileName, MeshComponent& outMesh) {
+    std::ifstream modelFile(fileName);
+    if (!modelFile.is_open()) {
+      return false;
+    }
+
+    std::vector<XMFLOAT3> positions;
+    std::vector<XMFLOAT2> texCoords;
+    std::vector<XMFLOAT3> normals;
+    std::map<std::string, int> vertexCache;
+    std::string line;
+    while (std::getline(modelFile, line)) {
+      std::stringstream lineStream(line);
+      std::string header;
+      lineStream >> header;
+      if (header == "v" || header == "vn") {
+        XMFLOAT3 v;
+        lineStream >> v.x >> v.y >> v.z;
+        (header == "v" ? positions : normals).push_back(v);
+      }
+      else if (header == "vt") {
+        XMFLOAT2 v;
+        lineStream >> v.x >> v.y;
+        texCoords.push_back(v);
+      }
+      else if (header == "f") {
+        std::string corner;
+        std::vector<int> face;
+        while (lineStream >> corner) {
+          auto cached = vertexCache.find(corner);
+          if (cached != vertexCache.end()) {
+            face.push_back(cached->second);
+            continue;
+          }
+          int pos, uv, norm;
+          if (std::sscanf(corner.c_str(), "%d/%d/%d", &pos, &uv, &norm) != 3 ||
+            pos < 1 || pos > static_cast<int>(positions.size()) ||
+            uv < 1 || uv > static_cast<int>(texCoords.size()) ||
+            norm < 1 || norm > static_cast<int>(normals.size())) {
+            return false;
+          }
+          SimpleVertex vertex;
+          vertex.Pos = positions[pos - 1];
+          vertex.Tex = texCoords[uv - 1];
+          vertex.Norm = normals[norm - 1];
+          outMesh.m_vertex.push_back(vertex);
+          vertexCache[corner] = static_cast<int>(outMesh.m_vertex.size()) - 1;
+          face.push_back(static_cast<int>(outMesh.m_vertex.size()) - 1);
+        }
+        if (face.size() == 3 || face.size() == 4) {
+          outMesh.m_index.insert(outMesh.m_index.end(), { unsigned(face[0]), unsigned(face[1]), unsigned(face[2]) });
+        }
+        if (face.size() == 4) {
+          outMesh.m_index.insert(outMesh.m_index.end(), { unsigned(face[0]), unsigned(face[2]), unsigned(face[3]) });
+        }
+      }
+    }
+    outMesh.m_numVertex = static_cast<int>(outMesh.m_vertex.size());
+    outMesh.m_numIndex = static_cast<int>(outMesh.m_index.size());
+    return true;
+  }
+
+  /*
+    *  @brief Loads a file with both parsers and checks the meshes are identical.
+  */
+  void
+  compareFile(const std::string& fileName) {
+    MeshComponent expected;
+    if (!loadReference(fileName, expected)) {
+      std::printf("skip %s: not a triangle/quad v/vt/vn mesh\n", fileName.c_str());
+      return;
+    }
+
+    // The defaults run only the parser, so the reference output still
+    // holds; the later passes would reorder what it produces
+    ModelLoader loader;
+    loader.setTriangulationMode(TRIANGULATE_FAN);
+    MeshComponent actual;
+    TestUtils::Timer timer;
+    bool loaded = loader.loadModel(fileName, actual);
+    double ms = timer.elapsedMs();
+
+    CHECK(loaded);
+    CHECK(actual.m_numVertex == expected.m_numVertex);
+    CHECK(actual.m_numIndex == expected.m_numIndex);
+    CHECK(actual.m_vertex.size() == expected.m_vertex.size() &&
+      std::memcmp(actual.m_vertex.data(), expected.m_vertex.data(),
+        expected.m_vertex.size() * sizeof(SimpleVertex)) == 0);
+    CHECK(actual.m_index == expected.m_index);
+
+    double megabytes = loader.getLastLoadStats().fileBytes / (1024.0 * 1024.0);
+    std::printf("%-48s %8d vertices %9d indices %8.1f MB/s\n",
+      std::filesystem::path(fileName).filename().string().c_str(),
+      actual.m_numVertex, actual.m_numIndex, ms > 0.0 ? megabytes / (ms / 1000.0) : 0.0);
+  }
+}
+
+int
+main(int argc, char** argv) {
+  std::filesystem::path corpus = TestUtils::scratchDirectory("ObjCorpus");
+
+  struct Generated {
+    const char* name;
+    unsigned int rings;
+    unsigned int segments;
+    ObjCorpus::Style style;
+  };
+  std::vector<Generated> generated(6);
+  generated[0] = { "plain.obj", 32, 48, {} };
+  generated[1] = { "crlf.obj", 16, 16, {} };
+  generated[1].style.crlf = true;
+  generated[2] = { "exponent.obj", 20, 30, {} };
+  generated[2].style.exponent = true;
+  generated[3] = { "annotated.obj", 40, 24, {} };
+  generated[3].style.annotations = true;
+  generated[3].style.extraWhitespace = true;
+  generated[4] = { "mixed.obj", 24, 40, {} };
+  generated[4].style.mixTriangles = true;
+  generated[4].style.crlf = true;
+  generated[5] = { "large.obj", 400, 600, {} };
+  generated[5].style.mixTriangles = true;
+
+  for (const Generated& file : generated) {
+    std::string path = (corpus / file.name).string();
+    CHECK(ObjCorpus::writeSphere(path, file.rings, file.segments, file.style));
+    compareFile(path);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[i])) {
+      if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+        compareFile(entry.path().string());
+      }
+    }
+  }
+
+  std::filesystem::remove_all(corpus);
+  return TestUtils::result();
+}
@@ -0,0 +1,71 @@
+#include "ModelLoader.h"
+#include "ObjCorpus.h"
+#include "TestUtils.h"
+#include <cstring>
+
+// Checks that loadModel produces the same mesh, bit for bit, whatever the
+// number of threads, with and without the passes that run after parsing.
+
+namespace {
+  bool
+  sameMesh(const MeshComponent& a, const MeshComponent& b) {
+    return a.m_numVertex == b.m_numVertex &&
+      a.m_numIndex == b.m_numIndex &&
+      a.m_vertex.size() == b.m_vertex.size() &&
+      std::memcmp(a.m_vertex.data(), b.m_vertex.data(), a.m_vertex.size() * sizeof(SimpleVertex)) == 0 &&
+      a.m_index == b.m_index &&
+      a.m_meshlets.size() == b.m_meshlets.size() &&
+      std::memcmp(a.m_meshlets.data(), b.m_meshlets.data(), a.m_meshlets.size() * sizeof(Meshlet)) == 0 &&
+      a.m_lods.size() == b.m_lods.size() &&
+      std::memcmp(a.m_lods.data(), b.m_lods.data(), a.m_lods.size() * sizeof(MeshLod)) == 0;
+  }
+
+  void
+  compareThreadCounts(const std::string& path, bool fullPipeline) {
+    ModelLoader loader;
+    loader.setOptimizeMesh(fullPipeline);
+    loader.setBuildMeshlets(fullPipeline);
+    loader.setBuildLods(fullPipeline);
+
+    MeshComponent serial;
+    CHECK(loader.loadModel(path, serial, 1));
+    CHECK(loader.getLastLoadStats().chunkCount == 1);
+
+    const unsigned int threadCounts[] = { 2, 3, 4, 7, 8, 16, 64 };
+    for (unsigned int threads : threadCounts) {
+      MeshComponent parallel;
+      CHECK(loader.loadModel(path, parallel, threads));
+      CHECK(loader.getLastLoadStats().chunkCount > 1);
+      if (!sameMesh(serial, parallel)) {
+        std::fprintf(stderr, "%s: %u threads differ from the serial load (full pipeline: %d)\n",
+          path.c_str(), threads, fullPipeline);
+        ++TestUtils::failureCount();
+      }
+    }
+  }
+}
+
+int
+main() {
+  std::filesystem::path directory = TestUtils::scratchDirectory("ModelLoaderParallel");
+
+  ObjCorpus::Style mixed;
+  mixed.mixTriangles = true;
+  mixed.crlf = true;
+  mixed.annotations = true;
+  std::string sphere = (directory / "sphere.obj").string();
+  CHECK(ObjCorpus::writeSphere(sphere, 120, 160, mixed));
+
+  ObjCorpus::Style polygons;
+  polygons.polygonSides = 8;
+  std::string strips = (directory / "strips.obj").string();
+  CHECK(ObjCorpus::writeSphere(strips, 90, 120, polygons));
+
+  for (const std::string& path : { sphere, strips }) {
+    compareThreadCounts(path, false);
+    compareThreadCounts(path, true);
+  }
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
@@ -0,0 +1,62 @@
+#include "ModelLoader.h"
+#include "ObjCorpus.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Times the parse and assembly of loadModel from 1 to N threads on a
+// generated OBJ, and checks every thread count gives the serial mesh.
+//   ModelLoaderScalingBenchmark [rings] [maxThreads] [repeats]
+// 1000 rings is a ~90 MB file; maxThreads defaults to the hardware threads.
+
+int
+main(int argc, char** argv) {
+  unsigned int rings = argc > 1 ? std::atoi(argv[1]) : 1000;
+  unsigned int maxThreads = argc > 2 ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+  unsigned int repeats = argc > 3 ? std::atoi(argv[3]) : 3;
+
+  std::filesystem::path directory = TestUtils::scratchDirectory("ModelLoaderScaling");
+  std::string path = (directory / "scan.obj").string();
+  ObjCorpus::Style style;
+  style.mixTriangles = true;
+  CHECK(ObjCorpus::writeSphere(path, rings, rings * 3 / 2, style));
+
+  // Parsing only, the default: the passes after it are single-threaded
+  ModelLoader loader;
+
+  MeshComponent serial;
+  CHECK(loader.loadModel(path, serial, 1));
+  double megabytes = loader.getLastLoadStats().fileBytes / (1024.0 * 1024.0);
+  std::printf("%.1f MB, %d vertices, %d indices\n", megabytes, serial.m_numVertex, serial.m_numIndex);
+  std::printf("threads  chunks   parse ms  assemble ms   total ms     MB/s  speedup\n");
+
+  double serialMs = 0.0;
+  for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+    // Best of the repeats, so page-cache and scheduler noise do not dominate
+    double bestMs = 0.0;
+    ModelLoader::LoadStats best;
+    for (unsigned int repeat = 0; repeat < repeats; ++repeat) {
+      MeshComponent mesh;
+      TestUtils::Timer timer;
+      CHECK(loader.loadModel(path, mesh, threads));
+      double ms = timer.elapsedMs();
+      CHECK(mesh.m_vertex.size() == serial.m_vertex.size() &&
+        std::memcmp(mesh.m_vertex.data(), serial.m_vertex.data(), mesh.m_vertex.size() * sizeof(SimpleVertex)) == 0);
+      CHECK(mesh.m_index == serial.m_index);
+      if (repeat == 0 || ms < bestMs) {
+        bestMs = ms;
+        best = loader.getLastLoadStats();
+      }
+    }
+    if (threads == 1) {
+      serialMs = bestMs;
+    }
+    std::printf("%7u %7u %10.1f %12.1f %10.1f %8.1f %7.2fx\n",
+      threads, best.chunkCount, best.parseMs, best.assembleMs, bestMs,
+      megabytes / (bestMs / 1000.0), serialMs / bestMs);
+  }
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
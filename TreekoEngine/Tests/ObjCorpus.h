@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+/*
+  *  @brief Writes synthetic OBJ files for the loader tests and benchmarks.
+  *  @note The meshes are UV spheres of rings x segments cells with v/vt/vn
+  *        corners. Texture coordinates and normals are written in a
+  *        different order than positions, so the three indices of a corner
+  *        differ. The style options cover the syntax real exporters produce.
+*/
+namespace ObjCorpus {
+  /*
+    *  @brief Syntax variations of a generated file.
+  */
+  struct Style {
+    /*
+      *  @brief End lines with \r\n.
+    */
+    bool crlf = false;
+    /*
+      *  @brief Write floats in scientific notation.
+    */
+    bool exponent = false;
+    /*
+      *  @brief Add comments, object, group and smoothing lines.
+    */
+    bool annotations = false;
+    /*
+      *  @brief Separate tokens with runs of spaces and tabs.
+    */
+    bool extraWhitespace = false;
+    /*
+      *  @brief Split every other cell into two triangles instead of a quad.
+    */
+    bool mixTriangles = false;
+    /*
+      *  @brief Corners per face when above 4: cells of a row are merged into
+      *         polygons of this many sides (a strip of cells sharing edges).
+    */
+    unsigned int polygonSides = 4;
+  };
+
+  /*
+    *  @brief Writes a sphere. Returns false if the file cannot be created.
+  */
+  inline bool
+  writeSphere(const std::string& path, unsigned int rings, unsigned int segments, const Style& style = Style()) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+    const char* eol = style.crlf ? "\r\n" : "\n";
+    const char* gap = style.extraWhitespace ? " \t  " : " ";
+    const char* number = style.exponent ? "%.8e" : "%.6f";
+    const unsigned int columns = segments + 1;
+    const unsigned int count = (rings + 1) * columns;
+
+    auto writeFloat = [&](float value) {
+      std::fputs(gap, file);
+      std::fprintf(file, number, value);
+    };
+
+    if (style.annotations) {
+      std::fprintf(file, "# synthetic sphere %u x %u%s", rings, segments, eol);
+      std::fprintf(file, "o Sphere%s", eol);
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+      float theta = 3.14159265f * static_cast<float>(i / columns) / rings;
+      float phi = 6.28318531f * static_cast<float>(i % columns) / segments;
+      std::fputs("v", file);
+      writeFloat(std::sin(theta) * std::cos(phi));
+      writeFloat(std::cos(theta));
+      writeFloat(-std::sin(theta) * std::sin(phi));
+      std::fputs(eol, file);
+    }
+    // Texture coordinates in reverse order, normals rotated by one row
+    for (unsigned int i = 0; i < count; ++i) {
+      unsigned int source = count - 1 - i;
+      std::fputs("vt", file);
+      writeFloat(static_cast<float>(source % columns) / segments);
+      writeFloat(1.0f - static_cast<float>(source / columns) / rings);
+      std::fputs(eol, file);
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+      unsigned int source = (i + columns) % count;
+      float theta = 3.14159265f * static_cast<float>(source / columns) / rings;
+      float phi = 6.28318531f * static_cast<float>(source % columns) / segments;
+      std::fputs("vn", file);
+      writeFloat(std::sin(theta) * std::cos(phi));
+      writeFloat(std::cos(theta));
+      writeFloat(-std::sin(theta) * std::sin(phi));
+      std::fputs(eol, file);
+    }
+    if (style.annotations) {
+      std::fprintf(file, "g body%ss 1%s", eol, eol);
+    }
+
+    auto writeCorner = [&](unsigned int vertex) {
+      unsigned int uv = count - vertex;
+      unsigned int normal = (vertex + count - columns) % count + 1;
+      std::fprintf(file, "%s%u/%u/%u", gap, vertex + 1, uv, normal);
+    };
+
+    for (unsigned int ring = 0; ring < rings; ++ring) {
+      if (style.polygonSides > 4) {
+        // A strip of k cells has 2k + 2 corners: top row forward, bottom row back
+        unsigned int cells = (style.polygonSides - 2) / 2;
+        for (unsigned int first = 0; first < segments; first += cells) {
+          unsigned int last = std::min(first + cells, segments);
+          std::fputs("f", file);
+          for (unsigned int s = first; s <= last; ++s) {
+            writeCorner(ring * columns + s);
+          }
+          for (unsigned int s = last + 1; s-- > first;) {
+            writeCorner((ring + 1) * columns + s);
+          }
+          std::fputs(eol, file);
+        }
+        continue;
+      }
+      for (unsigned int s = 0; s < segments; ++s) {
+        unsigned int a = ring * columns + s;
+        unsigned int b = a + columns;
+        unsigned int c = b + 1;
+        unsigned int d = a + 1;
+        if (style.mixTriangles && (ring + s) % 2 == 1) {
+          std::fputs("f", file);
+          writeCorner(a);
+          writeCorner(b);
+          writeCorner(c);
+          std::fputs(eol, file);
+          std::fputs("f", file);
+          writeCorner(a);
+          writeCorner(c);
+          writeCorner(d);
+          std::fputs(eol, file);
+        }
+        else {
+          std::fputs("f", file);
+          writeCorner(a);
+          writeCorner(b);
+          writeCorner(c);
+          writeCorner(d);
+          std::fputs(eol, file);
+        }
+      }
+      if (style.annotations && ring % 16 == 15) {
+        std::fprintf(file, "# ring %u%s", ring, eol);
+      }
+    }
+    return std::fclose(file) == 0;
+  }
+}
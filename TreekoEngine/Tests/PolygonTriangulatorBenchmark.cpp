@@ -0,0 +1,235 @@
+#include "ModelLoader.h"
+#include "PolygonTriangulator.h"
+#include "TestUtils.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations per million faces, and times them, for the
+// triangulator on its own and for loadModel on a file of n-gons. Half the
+// polygons or more are concave stars and L shapes, so TRIANGULATE_AUTO sends them
+// through ear clipping; the triangles are checked to cover each polygon
+// exactly, which a fan over those shapes does not.
+//   PolygonTriangulatorBenchmark [faces] [objFaces]
+
+namespace {
+  std::atomic<size_t> g_allocations{ 0 };
+}
+
+void*
+operator new(size_t size) {
+  ++g_allocations;
+  if (void* memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void
+operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+  /*
+    *  @brief A polygon of the test set: corners into the shared vertex pool.
+  */
+  struct Shape {
+    const char* name;
+    std::vector<unsigned int> corners;
+    bool concave;
+    float area;
+  };
+
+  float
+  signedArea(const std::vector<SimpleVertex>& vertices, const unsigned int* corners, unsigned int count) {
+    float area = 0.0f;
+    for (unsigned int i = 0; i < count; ++i) {
+      const XMFLOAT3& a = vertices[corners[i]].Pos;
+      const XMFLOAT3& b = vertices[corners[(i + 1) % count]].Pos;
+      area += a.x * b.y - a.y * b.x;
+    }
+    return area * 0.5f;
+  }
+
+  void
+  addShape(const char* name, const std::vector<XMFLOAT2>& points, bool concave,
+    std::vector<SimpleVertex>& vertices, std::vector<Shape>& shapes) {
+    Shape shape = { name, {}, concave, 0.0f };
+    for (const XMFLOAT2& point : points) {
+      SimpleVertex vertex = {};
+      vertex.Pos = XMFLOAT3(point.x, point.y, 0.0f);
+      vertex.Norm = XMFLOAT3(0.0f, 0.0f, 1.0f);
+      shape.corners.push_back(static_cast<unsigned int>(vertices.size()));
+      vertices.push_back(vertex);
+    }
+    shape.area = signedArea(vertices, shape.corners.data(), static_cast<unsigned int>(shape.corners.size()));
+    shapes.push_back(shape);
+  }
+
+  std::vector<XMFLOAT2>
+  star(unsigned int points, float inner, float outer) {
+    std::vector<XMFLOAT2> corners;
+    for (unsigned int i = 0; i < points * 2; ++i) {
+      float angle = 3.14159265f * i / points;
+      float radius = (i % 2 == 0) ? outer : inner;
+      corners.push_back(XMFLOAT2(radius * std::cos(angle), radius * std::sin(angle)));
+    }
+    return corners;
+  }
+
+  std::vector<XMFLOAT2>
+  regular(unsigned int sides) {
+    return star(sides / 2, 1.0f, 1.0f);
+  }
+
+  /*
+    *  @brief Whether triangles cover a polygon exactly: every triangle keeps
+    *         the polygon winding and their areas add up to its area.
+  */
+  bool
+  coversPolygon(const std::vector<SimpleVertex>& vertices, const Shape& shape,
+    const unsigned int* triangles, size_t indexCount) {
+    if (indexCount != (shape.corners.size() - 2) * 3) {
+      return false;
+    }
+    float total = 0.0f;
+    for (size_t i = 0; i < indexCount; i += 3) {
+      float area = signedArea(vertices, triangles + i, 3);
+      if (area * shape.area < 0.0f) {
+        return false;
+      }
+      total += area;
+    }
+    return std::fabs(total - shape.area) <= 1e-4f * std::fabs(shape.area);
+  }
+
+  void
+  benchmarkTriangulator(unsigned int faces) {
+    std::vector<SimpleVertex> vertices;
+    std::vector<Shape> shapes;
+    addShape("triangle", { XMFLOAT2(0, 0), XMFLOAT2(1, 0), XMFLOAT2(0, 1) }, false, vertices, shapes);
+    addShape("quad", { XMFLOAT2(0, 0), XMFLOAT2(1, 0), XMFLOAT2(1, 1), XMFLOAT2(0, 1) }, false, vertices, shapes);
+    addShape("hexagon", regular(6), false, vertices, shapes);
+    addShape("star10", star(5, 0.4f, 1.0f), true, vertices, shapes);
+    // Starts next to the reflex corner, so a fan leaves the polygon
+    addShape("L6", { XMFLOAT2(2, 1), XMFLOAT2(1, 1), XMFLOAT2(1, 2), XMFLOAT2(0, 2), XMFLOAT2(0, 0), XMFLOAT2(2, 0) },
+      true, vertices, shapes);
+    addShape("star24", star(12, 0.7f, 1.0f), true, vertices, shapes);
+
+    std::vector<unsigned int> triangles;
+    PolygonTriangulator triangulator;
+
+    // Fan is only a baseline: it must get the concave shapes wrong
+    for (const Shape& shape : shapes) {
+      triangles.clear();
+      triangulator.triangulate(shape.corners.data(), static_cast<unsigned int>(shape.corners.size()),
+        vertices, TRIANGULATE_FAN, triangles);
+      CHECK(coversPolygon(vertices, shape, triangles.data(), triangles.size()) != shape.concave);
+    }
+
+    std::printf("triangulator, %u faces per mode (half concave)\n", faces);
+    std::printf("mode            allocations  allocs/1M faces   ns/face\n");
+    const TriangulationMode modes[] = { TRIANGULATE_AUTO, TRIANGULATE_EAR_CLIPPING, TRIANGULATE_FAN };
+    const char* modeNames[] = { "auto", "ear clipping", "fan" };
+    for (int m = 0; m < 3; ++m) {
+      // Warm up the scratch storage and the output list on the largest polygon
+      triangles.clear();
+      triangulator.triangulate(shapes.back().corners.data(), static_cast<unsigned int>(shapes.back().corners.size()),
+        vertices, modes[m], triangles);
+      triangles.reserve(4096 * 3 * 22);
+
+      size_t allocationsBefore = g_allocations;
+      TestUtils::Timer timer;
+      for (unsigned int face = 0; face < faces; ++face) {
+        if (face % 4096 == 0) {
+          triangles.clear();
+        }
+        const Shape& shape = shapes[face % shapes.size()];
+        size_t first = triangles.size();
+        triangulator.triangulate(shape.corners.data(), static_cast<unsigned int>(shape.corners.size()),
+          vertices, modes[m], triangles);
+        if (modes[m] != TRIANGULATE_FAN && face < shapes.size()) {
+          CHECK(coversPolygon(vertices, shape, triangles.data() + first, triangles.size() - first));
+        }
+      }
+      double ms = timer.elapsedMs();
+      size_t allocations = g_allocations - allocationsBefore;
+      std::printf("%-14s %12zu %16.1f %9.1f\n", modeNames[m], allocations,
+        allocations * 1e6 / faces, ms * 1e6 / faces);
+      CHECK(allocations == 0);
+    }
+  }
+
+  /*
+    *  @brief Writes a file of concave stars, L shapes and hexagons.
+  */
+  bool
+  writePolygonObj(const std::string& path, unsigned int faces) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+    std::fputs("vt 0 0\nvn 0 0 1\n", file);
+    const std::vector<XMFLOAT2> shapes[] = { star(5, 0.4f, 1.0f), regular(6),
+      { XMFLOAT2(2, 1), XMFLOAT2(1, 1), XMFLOAT2(1, 2), XMFLOAT2(0, 2), XMFLOAT2(0, 0), XMFLOAT2(2, 0) } };
+    unsigned int nextVertex = 1;
+    for (unsigned int face = 0; face < faces; ++face) {
+      const std::vector<XMFLOAT2>& shape = shapes[face % 3];
+      float x = static_cast<float>(face % 1000) * 3.0f;
+      float y = static_cast<float>(face / 1000) * 3.0f;
+      for (const XMFLOAT2& point : shape) {
+        std::fprintf(file, "v %.4f %.4f 0\n", x + point.x, y + point.y);
+      }
+      std::fputs("f", file);
+      for (size_t i = 0; i < shape.size(); ++i) {
+        std::fprintf(file, " %u/1/1", nextVertex++);
+      }
+      std::fputs("\n", file);
+    }
+    return std::fclose(file) == 0;
+  }
+
+  void
+  benchmarkLoader(unsigned int faces) {
+    std::filesystem::path directory = TestUtils::scratchDirectory("PolygonTriangulator");
+    std::string path = (directory / "polygons.obj").string();
+    CHECK(writePolygonObj(path, faces));
+
+    // The defaults time only the parser and the triangulator
+    ModelLoader loader;
+
+    std::printf("\nloadModel, %u faces of 6-10 corners (2/3 concave)\n", faces);
+    std::printf("threads  allocations  allocs/1M faces   total ms   triangles\n");
+    for (unsigned int threads : { 1u, 4u }) {
+      MeshComponent mesh;
+      size_t allocationsBefore = g_allocations;
+      TestUtils::Timer timer;
+      CHECK(loader.loadModel(path, mesh, threads));
+      double ms = timer.elapsedMs();
+      size_t allocations = g_allocations - allocationsBefore;
+      std::printf("%7u %12zu %16.1f %10.1f %11d\n", threads, allocations,
+        allocations * 1e6 / faces, ms, mesh.m_numIndex / 3);
+      // Star (8 triangles), hexagon (4), L (4)
+      CHECK(mesh.m_numIndex == static_cast<int>((faces / 3) * 48 + (faces % 3 > 0 ? 24 : 0) + (faces % 3 > 1 ? 12 : 0)));
+      // Only containers growing geometrically; nothing per face
+      CHECK(allocations < faces / 100 + 1000);
+    }
+    std::filesystem::remove_all(directory);
+  }
+}
+
+int
+main(int argc, char** argv) {
+  unsigned int faces = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  unsigned int objFaces = argc > 2 ? std::atoi(argv[2]) : 1000000;
+  benchmarkTriangulator(faces);
+  benchmarkLoader(objFaces);
+  return TestUtils::result();
+}
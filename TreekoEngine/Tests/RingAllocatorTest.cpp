@@ -0,0 +1,194 @@
+#include "RingAllocator.h"
+#include "TestUtils.h"
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Checks the RingAllocator bookkeeping: alignment, wrapping at the end of the
+// ring, failing while frames in flight hold the space, and retiring by fence.
+// Then runs randomized frames with a GPU lagging a random number of frames
+// behind and checks that no allocation ever overlaps a range still in flight.
+//   RingAllocatorTest [frames] [seed]
+
+namespace {
+  struct LiveRange {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t frame;
+  };
+
+  bool
+  overlaps(const LiveRange& range, const RingAllocator::Allocation& allocation) {
+    return allocation.offset < range.offset + range.size && range.offset < allocation.offset + allocation.size;
+  }
+
+  void
+  testBasics() {
+    RingAllocator ring(1024, 256);
+    CHECK(ring.capacity() == 1024);
+    RingAllocator::Allocation a;
+    RingAllocator::Allocation b;
+    CHECK(ring.allocate(100, a) && a.offset == 0 && !a.wrapped);
+    CHECK(ring.allocate(100, b) && b.offset == 256 && !b.wrapped);
+    CHECK(ring.used() == 356);
+
+    // Zero and larger than the ring always fail
+    RingAllocator::Allocation c;
+    CHECK(!ring.allocate(0, c));
+    CHECK(!ring.allocate(1025, c));
+    CHECK(ring.getStats().failures == 2);
+
+    // The capacity is rounded down to the alignment
+    RingAllocator rounded(1000, 256);
+    CHECK(rounded.capacity() == 768);
+  }
+
+  void
+  testWrapAndFail() {
+    RingAllocator ring(1024, 256);
+    RingAllocator::Allocation allocation;
+    CHECK(ring.allocate(600, allocation) && allocation.offset == 0);
+    ring.endFrame(1);
+
+    // The next aligned offset is 768; 500 bytes do not fit before the end
+    // and the start is held by frame 1
+    CHECK(ring.allocate(200, allocation) && allocation.offset == 768 && !allocation.wrapped);
+    CHECK(!ring.allocate(500, allocation));
+    ring.endFrame(2);
+
+    // A fence older than frame 1 releases nothing
+    ring.retire(0);
+    CHECK(ring.framesInFlight() == 2);
+    CHECK(!ring.allocate(500, allocation));
+
+    // Once frame 1 is done the head wraps; the skipped tail counts as used
+    ring.retire(1);
+    CHECK(ring.framesInFlight() == 1);
+    CHECK(ring.used() == 368);
+    CHECK(ring.allocate(500, allocation) && allocation.offset == 0 && allocation.wrapped);
+    CHECK(ring.used() == 368 + 56 + 500);
+    CHECK(ring.getStats().wraps == 1);
+    ring.endFrame(3);
+
+    // Frame 2 holds 768..1024, frame 3 holds 0..500
+    CHECK(!ring.allocate(100, allocation));
+    ring.retire(2);
+    CHECK(ring.used() == 556);
+    ring.retire(3);
+    CHECK(ring.used() == 0 && ring.framesInFlight() == 0);
+
+    // An empty ring takes a range as large as itself, wherever the head was
+    CHECK(ring.allocate(1024, allocation) && allocation.offset == 0);
+    CHECK(!ring.allocate(1, allocation));
+    ring.releaseAll();
+    CHECK(ring.used() == 0);
+    CHECK(ring.allocate(1024, allocation) && allocation.offset == 0);
+    CHECK(ring.getStats().peakUsed == 1024);
+  }
+
+  void
+  testRetireOrder() {
+    RingAllocator ring(4096, 16);
+    RingAllocator::Allocation allocation;
+    for (uint64_t frame = 1; frame <= 4; ++frame) {
+      CHECK(ring.allocate(1000, allocation));
+      ring.endFrame(frame * 10);
+    }
+    CHECK(ring.framesInFlight() == 4);
+    CHECK(!ring.allocate(200, allocation));
+
+    // Frames retire oldest first, up to the completed fence
+    ring.retire(25);
+    CHECK(ring.framesInFlight() == 2);
+    CHECK(ring.used() == 2 * 1008);
+    ring.retire(40);
+    CHECK(ring.framesInFlight() == 0 && ring.used() == 0);
+
+    // A frame with no allocations is a valid fence
+    ring.endFrame(50);
+    ring.retire(50);
+    CHECK(ring.used() == 0);
+  }
+
+  /*
+    *  @brief Random frames of random allocations, retired with a random lag.
+  */
+  void
+  testRandomFrames(unsigned int frames, unsigned int seed) {
+    const uint64_t capacity = 64 * 1024;
+    const uint64_t alignment = 256;
+    RingAllocator ring(capacity, alignment);
+    std::mt19937 random(seed);
+    std::vector<LiveRange> live;
+    uint64_t completed = 0;
+    uint64_t allocations = 0;
+    uint64_t failures = 0;
+
+    for (uint64_t frame = 1; frame <= frames; ++frame) {
+      // Mostly small draws, sometimes a range a quarter of the ring
+      const unsigned int draws = random() % 40;
+      for (unsigned int draw = 0; draw < draws; ++draw) {
+        const uint64_t size = (random() % 8 == 0) ? 1 + random() % (capacity / 4) : 1 + random() % 512;
+        RingAllocator::Allocation allocation;
+        if (!ring.allocate(size, allocation)) {
+          // Only when the frames in flight hold most of the ring
+          CHECK(ring.used() + 2 * size + alignment > capacity);
+          ++failures;
+          continue;
+        }
+        CHECK(allocation.size == size);
+        CHECK(allocation.offset % alignment == 0);
+        CHECK(allocation.offset + allocation.size <= capacity);
+        for (const LiveRange& range : live) {
+          if (overlaps(range, allocation)) {
+            std::fprintf(stderr, "frame %llu: [%llu, +%llu) overlaps frame %llu\n",
+              (unsigned long long)frame, (unsigned long long)allocation.offset,
+              (unsigned long long)allocation.size, (unsigned long long)range.frame);
+            CHECK(false);
+          }
+        }
+        live.push_back({ allocation.offset, allocation.size, frame });
+        ++allocations;
+        CHECK(ring.used() <= capacity);
+      }
+      ring.endFrame(frame);
+
+      // The GPU finishes in order, zero to four frames behind
+      const uint64_t lag = random() % 5;
+      if (frame > lag && frame - lag > completed) {
+        completed = frame - lag;
+        ring.retire(completed);
+        std::vector<LiveRange> stillLive;
+        for (const LiveRange& range : live) {
+          if (range.frame > completed) {
+            stillLive.push_back(range);
+          }
+        }
+        live.swap(stillLive);
+      }
+      CHECK(ring.framesInFlight() == frame - completed);
+      if (live.empty()) {
+        CHECK(ring.used() == 0);
+      }
+    }
+    CHECK(ring.getStats().allocations == allocations);
+    CHECK(ring.getStats().wraps > 0);
+    CHECK(failures > 0);
+    std::printf("%u frames: %llu allocations, %llu failures, %llu wraps, peak %llu of %llu bytes\n",
+      frames, (unsigned long long)allocations, (unsigned long long)failures,
+      (unsigned long long)ring.getStats().wraps, (unsigned long long)ring.getStats().peakUsed,
+      (unsigned long long)capacity);
+  }
+}
+
+int
+main(int argc, char** argv) {
+  const unsigned int frames = argc > 1 ? std::atoi(argv[1]) : 5000;
+  const unsigned int seed = argc > 2 ? std::atoi(argv[2]) : 1;
+
+  testBasics();
+  testWrapAndFail();
+  testRetireOrder();
+  testRandomFrames(frames, seed);
+  return TestUtils::result();
+}
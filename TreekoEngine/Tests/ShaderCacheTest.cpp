@@ -0,0 +1,206 @@
+#include "ShaderCache.h"
+#include "TestUtils.h"
+#include <fstream>
+#include <iterator>
+
+// Drives ShaderCache the way ShaderProgram does (key, load, compile and store
+// on a miss) over a shader with nested includes, and checks what hits and
+// what misses: a hit on an unchanged request, also after a restart, and a
+// miss after editing the source, an include, a define or the flags.
+
+namespace {
+  void
+  writeFile(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+  }
+
+  std::string
+  readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  /*
+    *  @brief Rewrites a file with text of the same size, moving its time
+    *         forward so the edit cannot hide inside the timestamp resolution.
+  */
+  void
+  editInPlace(const std::filesystem::path& path, const std::string& text) {
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path);
+    writeFile(path, text);
+    std::filesystem::last_write_time(path, time + std::chrono::seconds(2));
+  }
+
+  /*
+    *  @brief Loads the bytecode of a request, or "compiles" and stores it.
+    *  @return bool True on a cache hit.
+  */
+  bool
+  compileOrLoad(ShaderCache& cache, const ShaderCache::CompileRequest& request, std::vector<char>& outBytecode) {
+    uint64_t key = 0;
+    CHECK(cache.computeKey(request, key));
+    if (cache.load(key, outBytecode)) {
+      return true;
+    }
+    // Stand-in bytecode that depends on the key, so hits can be verified
+    const std::string bytecode = "DXBC " + request.entryPoint + " " + std::to_string(key);
+    outBytecode.assign(bytecode.begin(), bytecode.end());
+    CHECK(cache.store(key, outBytecode.data(), outBytecode.size()));
+    return false;
+  }
+
+  bool
+  isHit(ShaderCache& cache, const ShaderCache::CompileRequest& request) {
+    std::vector<char> bytecode;
+    return compileOrLoad(cache, request, bytecode);
+  }
+
+  uint64_t
+  keyOf(ShaderCache& cache, const ShaderCache::CompileRequest& request) {
+    uint64_t key = 0;
+    CHECK(cache.computeKey(request, key));
+    return key;
+  }
+}
+
+int
+main() {
+  const std::filesystem::path directory = TestUtils::scratchDirectory("ShaderCache");
+  const std::filesystem::path cacheDirectory = directory / "Cache";
+  std::filesystem::create_directories(directory / "Include");
+
+  // Shader.fx -> Include/Common.hlsli -> Lighting.hlsli, found next to
+  // Shader.fx because it is not next to Common.hlsli
+  const std::string shaderText =
+    "#include \"Include/Common.hlsli\"\n"
+    "float4 PS(float4 p : SV_POSITION) : SV_Target { return Shade(p); }\n";
+  const std::string commonText =
+    "  #  include <Lighting.hlsli>\n"
+    "float4 Shade(float4 p) { return Light(p) * 0.5; }\n";
+  const std::string lightingText =
+    "float4 Light(float4 p) { return p; }\n";
+  writeFile(directory / "Shader.fx", shaderText);
+  writeFile(directory / "Include" / "Common.hlsli", commonText);
+  writeFile(directory / "Lighting.hlsli", lightingText);
+
+  ShaderCache::CompileRequest request;
+  request.sourcePath = (directory / "Shader.fx").string();
+  request.entryPoint = "PS";
+  request.profile = "ps_4_0";
+  request.flags = 0x800;
+  request.defines = { { "USE_FOG", "1" } };
+
+  {
+    ShaderCache cache(cacheDirectory.string());
+    std::vector<char> compiled;
+    std::vector<char> loaded;
+    CHECK(!compileOrLoad(cache, request, compiled));
+    CHECK(compileOrLoad(cache, request, loaded));
+    CHECK(loaded == compiled);
+    CHECK(cache.getStats().hits == 1 && cache.getStats().misses == 1 && cache.getStats().stores == 1);
+  }
+
+  // A new cache over the same directory, as after a restart
+  ShaderCache cache(cacheDirectory.string());
+  CHECK(isHit(cache, request));
+  const uint64_t baseKey = keyOf(cache, request);
+
+  // Source: a longer edit misses; reverting to the old text hits the old entry
+  writeFile(directory / "Shader.fx", shaderText + "// tweak\n");
+  CHECK(!isHit(cache, request));
+  CHECK(isHit(cache, request));
+  writeFile(directory / "Shader.fx", shaderText);
+  CHECK(isHit(cache, request));
+  CHECK(keyOf(cache, request) == baseKey);
+
+  // Source: an edit that keeps the size still misses
+  std::string sameSize = shaderText;
+  sameSize[sameSize.find("PS")] = 'Q';
+  editInPlace(directory / "Shader.fx", sameSize);
+  CHECK(!isHit(cache, request));
+  editInPlace(directory / "Shader.fx", shaderText);
+  CHECK(isHit(cache, request));
+
+  // Includes: the direct one, and the nested one it names
+  writeFile(directory / "Include" / "Common.hlsli", commonText + "#define EXTRA 1\n");
+  CHECK(!isHit(cache, request));
+  writeFile(directory / "Include" / "Common.hlsli", commonText);
+  CHECK(isHit(cache, request));
+
+  std::string lightingEdit = lightingText;
+  lightingEdit[lightingEdit.find("return p")] = 'R';
+  editInPlace(directory / "Lighting.hlsli", lightingEdit);
+  CHECK(!isHit(cache, request));
+  editInPlace(directory / "Lighting.hlsli", lightingText);
+  CHECK(isHit(cache, request));
+
+  // An include next to the including file shadows the one next to the root;
+  // an identical copy builds the same bytecode, so only a different one misses
+  writeFile(directory / "Include" / "Lighting.hlsli", lightingText);
+  CHECK(isHit(cache, request));
+  writeFile(directory / "Include" / "Lighting.hlsli", "float4 Light(float4 p) { return p * p; }\n");
+  CHECK(!isHit(cache, request));
+  std::filesystem::remove(directory / "Include" / "Lighting.hlsli");
+  CHECK(isHit(cache, request));
+
+  // Defines: value, name, an extra one, and the split between name and value
+  ShaderCache::CompileRequest changed = request;
+  changed.defines[0].value = "0";
+  CHECK(!isHit(cache, changed));
+  changed = request;
+  changed.defines[0].name = "USE_FOGS";
+  CHECK(!isHit(cache, changed));
+  changed = request;
+  changed.defines.push_back({ "SHADOWS", "" });
+  CHECK(!isHit(cache, changed));
+  changed = request;
+  changed.defines = { { "USE_FOG1", "" } };
+  CHECK(keyOf(cache, changed) != baseKey);
+
+  // Flags, entry point and profile
+  changed = request;
+  changed.flags |= 0x1;
+  CHECK(!isHit(cache, changed));
+  changed = request;
+  changed.entryPoint = "PS2";
+  CHECK(!isHit(cache, changed));
+  changed = request;
+  changed.profile = "ps_5_0";
+  CHECK(!isHit(cache, changed));
+
+  // Every variant above now has its own entry, and the original still hits
+  CHECK(isHit(cache, request));
+  changed = request;
+  changed.flags |= 0x1;
+  CHECK(isHit(cache, changed));
+
+  // Damaged entries are rejected and recompiled
+  const std::string entryPath = cache.pathFor(baseKey);
+  std::string entry = readFile(entryPath);
+  entry.back() ^= 0x20;
+  writeFile(entryPath, entry);
+  unsigned int rejected = cache.getStats().rejected;
+  CHECK(!isHit(cache, request));
+  CHECK(cache.getStats().rejected == rejected + 1);
+  CHECK(isHit(cache, request));
+  entry = readFile(entryPath);
+  writeFile(entryPath, entry.substr(0, entry.size() - 1));
+  CHECK(!isHit(cache, request));
+  CHECK(cache.getStats().rejected == rejected + 2);
+
+  // An include cycle terminates; a missing include still gives a key, which
+  // changes once the file appears
+  writeFile(directory / "Lighting.hlsli", lightingText + "#include \"Shader.fx\"\n#include \"Missing.hlsli\"\n");
+  const uint64_t missingKey = keyOf(cache, request);
+  writeFile(directory / "Missing.hlsli", "\n");
+  CHECK(keyOf(cache, request) != missingKey);
+
+  ShaderCache::CompileRequest missing = request;
+  missing.sourcePath = (directory / "NoSuchShader.fx").string();
+  uint64_t key = 0;
+  CHECK(!cache.computeKey(missing, key));
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
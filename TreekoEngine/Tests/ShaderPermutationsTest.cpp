@@ -0,0 +1,222 @@
+#include "ShaderPermutations.h"
+#include "TestUtils.h"
+#include <fstream>
+
+// Drives ShaderPermutationCompiler with a fake compiler that can be held
+// mid-compile, and checks the scheduling: keys and defines, the same key
+// requested twice shares one compile and one future, a compile finished
+// after invalidate has its result dropped (and the key compiles again), a
+// failed stage is reported, and a second compiler over the same ShaderCache
+// reads every stage back instead of compiling it.
+
+namespace {
+  /*
+    *  @brief Compiles "bytecode" naming the entry point and defines; while
+    *         held, every compile waits for release.
+  */
+  struct FakeCompiler {
+    bool
+    compile(const ShaderCache::CompileRequest& request, std::vector<char>& outBytecode, std::string& outErrors) {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++started;
+      changed.notify_all();
+      changed.wait(lock, [this]() { return !held; });
+      std::string bytecode = request.entryPoint;
+      for (const ShaderCache::ShaderDefine& define : request.defines) {
+        if (define.name == "BROKEN") {
+          outErrors = "error X3000: broken";
+          return false;
+        }
+        bytecode += " " + define.name + "=" + define.value;
+      }
+      outBytecode.assign(bytecode.begin(), bytecode.end());
+      return true;
+    }
+
+    void
+    hold() {
+      std::lock_guard<std::mutex> lock(mutex);
+      held = true;
+    }
+
+    void
+    release() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        held = false;
+      }
+      changed.notify_all();
+    }
+
+    unsigned int
+    startedCount() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return started;
+    }
+
+    void
+    waitForStarted(unsigned int count) {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return started >= count; });
+    }
+
+    ShaderPermutationCompiler::CompileFunction
+    function() {
+      return [this](const ShaderCache::CompileRequest& request, std::vector<char>& outBytecode, std::string& outErrors) {
+        return compile(request, outBytecode, outErrors);
+      };
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    unsigned int started = 0;
+    bool held = false;
+  };
+
+  bool
+  isReady(const std::shared_future<bool>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  std::vector<ShaderPermutationCompiler::CompiledPermutation>
+  takeAll(ShaderPermutationCompiler& compiler) {
+    std::vector<ShaderPermutationCompiler::CompiledPermutation> completed;
+    compiler.idle();
+    compiler.takeCompleted(completed);
+    return completed;
+  }
+
+  void
+  testKeys(ShaderPermutationCompiler& compiler) {
+    CHECK(compiler.keyFor({}) == 0);
+    CHECK(compiler.keyFor({ "FOG", "SKINNING" }) == 0x5);
+    CHECK(compiler.keyFor({ "SKINNING", "FOG", "FOG" }) == 0x5);
+    CHECK(compiler.keyFor({ "FOG", "SPECULAR" }) == ShaderPermutationCompiler::kInvalidKey);
+
+    const std::vector<ShaderCache::ShaderDefine> defines = compiler.definesFor(0x6);
+    CHECK(defines.size() == 2);
+    CHECK(defines[0].name == "NORMAL_MAP" && defines[0].value == "1" && defines[1].name == "SKINNING");
+
+    // Invalid keys and keys past the declared keywords fail at once
+    std::shared_future<bool> invalid = compiler.request(ShaderPermutationCompiler::kInvalidKey);
+    CHECK(isReady(invalid) && !invalid.get());
+    std::shared_future<bool> tooWide = compiler.request(0x10);
+    CHECK(isReady(tooWide) && !tooWide.get());
+  }
+
+  void
+  testDeduplication(ShaderPermutationCompiler& compiler, FakeCompiler& fake) {
+    const ShaderPermutationCompiler::CompilerStats before = compiler.getStats();
+    fake.hold();
+    const unsigned int started = fake.startedCount();
+    std::shared_future<bool> first = compiler.request(0x3);
+    fake.waitForStarted(started + 1);
+    std::shared_future<bool> second = compiler.request(0x3);
+    CHECK(!isReady(first) && !isReady(second));
+    fake.release();
+
+    // Both futures share the one compile: ready together, with one result
+    CHECK(first.get() && second.get());
+    const std::vector<ShaderPermutationCompiler::CompiledPermutation> completed = takeAll(compiler);
+    CHECK(completed.size() == 1 && completed[0].key == 0x3 && completed[0].succeeded);
+    const std::string pixel(completed[0].pixelBytecode.begin(), completed[0].pixelBytecode.end());
+    CHECK(pixel == "PS FOG=1 NORMAL_MAP=1");
+    const ShaderPermutationCompiler::CompilerStats after = compiler.getStats();
+    CHECK(after.compiles == before.compiles + 2);
+    CHECK(after.deduplicated == before.deduplicated + 1);
+
+    // Still the same request once finished
+    std::shared_future<bool> third = compiler.request(0x3);
+    CHECK(isReady(third) && third.get());
+    CHECK(takeAll(compiler).empty());
+    CHECK(compiler.getStats().compiles == after.compiles);
+  }
+
+  void
+  testInvalidate(ShaderPermutationCompiler& compiler, FakeCompiler& fake) {
+    const unsigned int compiles = compiler.getStats().compiles;
+    fake.hold();
+    const unsigned int started = fake.startedCount();
+    std::shared_future<bool> stale = compiler.request(0x4);
+    fake.waitForStarted(started + 1);
+    compiler.invalidate();
+    fake.release();
+
+    // The compile still finishes and resolves its future, but its result is
+    // older than the sources and is not queued
+    CHECK(stale.get());
+    CHECK(takeAll(compiler).empty());
+    CHECK(compiler.getStats().compiles == compiles + 2);
+
+    // The key is forgotten: requesting it again compiles it again
+    std::shared_future<bool> fresh = compiler.request(0x4);
+    CHECK(fresh.get());
+    const std::vector<ShaderPermutationCompiler::CompiledPermutation> completed = takeAll(compiler);
+    CHECK(completed.size() == 1 && completed[0].key == 0x4);
+    CHECK(compiler.getStats().compiles == compiles + 4);
+
+    // Finished results not yet taken are dropped as well
+    CHECK(compiler.request(0x1).get());
+    compiler.idle();
+    compiler.invalidate();
+    CHECK(takeAll(compiler).empty());
+  }
+
+  void
+  testFailure(ShaderPermutationCompiler& compiler) {
+    const unsigned int failed = compiler.getStats().failed;
+    std::shared_future<bool> broken = compiler.request(compiler.keyFor({ "BROKEN" }));
+    CHECK(!broken.get());
+    const std::vector<ShaderPermutationCompiler::CompiledPermutation> completed = takeAll(compiler);
+    CHECK(completed.size() == 1 && !completed[0].succeeded);
+    CHECK(completed[0].errors.find("VS: error X3000") == 0);
+    CHECK(compiler.getStats().failed == failed + 1);
+  }
+}
+
+int
+main() {
+  const std::filesystem::path directory = TestUtils::scratchDirectory("ShaderPermutations");
+  const std::string sourcePath = (directory / "Lit.fx").string();
+  std::ofstream(sourcePath, std::ios::binary) << "float4 PS() : SV_Target { return 1; }\n";
+  const std::vector<std::string> keywords = { "FOG", "NORMAL_MAP", "SKINNING", "BROKEN" };
+
+  FakeCompiler fake;
+  {
+    ShaderPermutationCompiler compiler(sourcePath, keywords, fake.function(), nullptr, 4);
+    testKeys(compiler);
+    testDeduplication(compiler, fake);
+    testInvalidate(compiler, fake);
+    testFailure(compiler);
+  }
+
+  // Every key at once, each requested twice, through a cache; a second
+  // compiler over the same cache reads every stage back
+  ShaderCache cache((directory / "Cache").string());
+  for (unsigned int run = 0; run < 2; ++run) {
+    const unsigned int started = fake.startedCount();
+    ShaderPermutationCompiler compiler(sourcePath, keywords, fake.function(), &cache, 4);
+    std::vector<std::shared_future<bool>> futures;
+    for (PermutationKey key = 0; key < 8; ++key) {
+      futures.push_back(compiler.request(key));
+      futures.push_back(compiler.request(key));
+    }
+    for (std::shared_future<bool>& future : futures) {
+      CHECK(future.get());
+    }
+    const std::vector<ShaderPermutationCompiler::CompiledPermutation> completed = takeAll(compiler);
+    CHECK(completed.size() == 8);
+    unsigned int seen = 0;
+    for (const ShaderPermutationCompiler::CompiledPermutation& permutation : completed) {
+      seen |= 1u << permutation.key;
+    }
+    CHECK(seen == 0xFF);
+    const ShaderPermutationCompiler::CompilerStats stats = compiler.getStats();
+    CHECK(stats.deduplicated == 8);
+    CHECK(stats.compiles == (run == 0 ? 16u : 0u) && stats.cacheHits == (run == 0 ? 0u : 16u));
+    CHECK(fake.startedCount() == started + stats.compiles);
+  }
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+/*
+  *  @brief Shared helpers of the Linux test programs in this directory.
+  *  @note Every test is a small executable run by CTest: a failed CHECK
+  *        prints where it failed, and TestUtils::result() turns the failure
+  *        count into the exit code. Benchmarks print their numbers and only
+  *        fail on wrong output, never on timings.
+*/
+namespace TestUtils {
+  /*
+    *  @brief Number of failed checks so far.
+  */
+  inline int&
+  failureCount() {
+    static int count = 0;
+    return count;
+  }
+
+  /*
+    *  @brief Exit code of the test: 0 when every check passed.
+  */
+  inline int
+  result() {
+    if (failureCount() > 0) {
+      std::fprintf(stderr, "%d check(s) failed\n", failureCount());
+      return 1;
+    }
+    return 0;
+  }
+
+  /*
+    *  @brief Empty directory under the system temp directory, created anew.
+  */
+  inline std::filesystem::path
+  scratchDirectory(const std::string& name) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / ("TreekoTests_" + name);
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+  }
+
+  /*
+    *  @brief Wall-clock stopwatch started on construction.
+  */
+  class
+    Timer {
+  public:
+    Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+    double
+      elapsedMs() const {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start;
+  };
+}
+
+/*
+  *  @brief Records a failure, with its location, when condition is false.
+*/
+#define CHECK(condition)                                                      \
+  do {                                                                        \
+    if (!(condition)) {                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      ++TestUtils::failureCount();                                            \
+    }                                                                         \
+  } while (0)
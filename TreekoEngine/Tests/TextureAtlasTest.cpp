@@ -0,0 +1,201 @@
+#include "MipGenerator.h"
+#include "TextureAtlas.h"
+#include "TestUtils.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Packs images of random sizes, each a single color, into ATLAS_PAGES and
+// checks the layout: cells aligned, inside their page and never overlapping,
+// with UVs that map onto the image rectangles. Then builds the mips of every
+// page and checks that no level up to mipLevels - 1 bleeds another color into
+// an image rectangle or its one-texel border. Also checks ATLAS_ARRAY and the
+// inputs pack refuses.
+//   TextureAtlasTest [images] [pageSize] [seed]
+
+namespace {
+  struct SolidImage {
+    std::vector<unsigned char> pixels;
+    unsigned char color[4];
+  };
+
+  SolidImage
+  makeImage(unsigned int id, unsigned int width, unsigned int height, std::mt19937& random) {
+    SolidImage image;
+    // The red channel alone tells the images apart
+    image.color[0] = static_cast<unsigned char>(id + 1);
+    image.color[1] = static_cast<unsigned char>(random() % 256);
+    image.color[2] = static_cast<unsigned char>(random() % 256);
+    image.color[3] = 255;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (size_t texel = 0; texel < size_t(width) * height; ++texel) {
+      std::memcpy(&image.pixels[texel * 4], image.color, 4);
+    }
+    return image;
+  }
+
+  /*
+    *  @brief True if the rectangles [x, x + width) x [y, y + height) overlap.
+  */
+  bool
+  overlaps(unsigned int ax, unsigned int ay, unsigned int aw, unsigned int ah,
+    unsigned int bx, unsigned int by, unsigned int bw, unsigned int bh) {
+    return ax < bx + bw && bx < ax + aw && ay < by + bh && by < ay + ah;
+  }
+
+  /*
+    *  @brief Counts the texels of one level of a page, inside an entry's
+    *         rectangle grown by a texel, that are not the entry's color.
+  */
+  size_t
+  countBleeding(const MipGenerator::MipChain& chain, unsigned int level,
+    const TextureAtlas::AtlasEntry& entry, const unsigned char color[4]) {
+    const MipGenerator::MipLevel& mip = chain.levels[level];
+    const unsigned int scale = 1u << level;
+    const unsigned int x0 = entry.x / scale - 1;
+    const unsigned int y0 = entry.y / scale - 1;
+    const unsigned int x1 = (entry.x + entry.width + scale - 1) / scale + 1;
+    const unsigned int y1 = (entry.y + entry.height + scale - 1) / scale + 1;
+    CHECK(entry.x % scale == 0 && entry.y % scale == 0);
+    CHECK(entry.x >= scale && entry.y >= scale && x1 <= mip.width && y1 <= mip.height);
+
+    size_t bleeding = 0;
+    for (unsigned int y = y0; y < y1; ++y) {
+      for (unsigned int x = x0; x < x1; ++x) {
+        const unsigned char* texel = &chain.pixels[mip.offset + (size_t(y) * mip.width + x) * 4];
+        if (std::memcmp(texel, color, 4) != 0) {
+          ++bleeding;
+        }
+      }
+    }
+    return bleeding;
+  }
+
+  void
+  testPages(unsigned int imageCount, unsigned int pageSize, unsigned int seed) {
+    std::mt19937 random(seed);
+    std::vector<SolidImage> solids;
+    std::vector<TextureAtlas::AtlasImage> images(imageCount);
+    for (unsigned int i = 0; i < imageCount; ++i) {
+      // Mostly small, every fourth up to a third of the page, sizes not multiples of 4
+      const unsigned int limit = (i % 4 == 0) ? pageSize / 3 : pageSize / 6;
+      const unsigned int width = 1 + random() % limit;
+      const unsigned int height = 1 + random() % limit;
+      solids.push_back(makeImage(i, width, height, random));
+      images[i].width = width;
+      images[i].height = height;
+    }
+    for (unsigned int i = 0; i < imageCount; ++i) {
+      images[i].pixels = solids[i].pixels.data();
+    }
+
+    TextureAtlas atlas;
+    atlas.setPageSize(pageSize);
+    CHECK(atlas.pack(images.data(), images.size(), ATLAS_PAGES));
+    const std::vector<TextureAtlas::AtlasEntry>& entries = atlas.entries();
+    const unsigned int mipLevels = atlas.mipLevels();
+    const unsigned int gutter = std::max(4u, 1u << (mipLevels - 1));
+    CHECK(entries.size() == imageCount);
+    CHECK(atlas.pageWidth() == pageSize && atlas.pageHeight() == pageSize);
+    CHECK(atlas.getLastStats().pages == atlas.pages().size());
+
+    // Every cell (the image and its gutter) is aligned, inside its page, and
+    // clear of every other cell; the UVs land on the image rectangle
+    for (unsigned int i = 0; i < imageCount; ++i) {
+      const TextureAtlas::AtlasEntry& entry = entries[i];
+      CHECK(entry.page < atlas.pages().size());
+      CHECK(entry.width == images[i].width && entry.height == images[i].height);
+      CHECK(entry.x % gutter == 0 && entry.y % gutter == 0);
+      CHECK(entry.x >= gutter && entry.y >= gutter);
+      CHECK(entry.x + entry.width + gutter <= pageSize && entry.y + entry.height + gutter <= pageSize);
+      CHECK(entry.offsetU * pageSize == entry.x && entry.offsetV * pageSize == entry.y);
+      CHECK(entry.scaleU * pageSize == entry.width && entry.scaleV * pageSize == entry.height);
+      for (unsigned int j = 0; j < i; ++j) {
+        const TextureAtlas::AtlasEntry& other = entries[j];
+        if (other.page == entry.page &&
+          overlaps(entry.x - gutter, entry.y - gutter, entry.width + 2 * gutter, entry.height + 2 * gutter,
+            other.x - gutter, other.y - gutter, other.width + 2 * gutter, other.height + 2 * gutter)) {
+          std::fprintf(stderr, "images %u and %u overlap on page %u\n", i, j, entry.page);
+          CHECK(false);
+        }
+      }
+    }
+
+    // Linear RGB, so averaging texels of one color gives back that color
+    MipGenerator generator;
+    generator.setSrgb(false);
+    std::vector<MipGenerator::MipChain> chains(atlas.pages().size());
+    for (size_t page = 0; page < atlas.pages().size(); ++page) {
+      MipGenerator::MipImage image;
+      image.pixels = atlas.pages()[page].data();
+      image.width = pageSize;
+      image.height = pageSize;
+      generator.generate(image, chains[page]);
+      CHECK(chains[page].levels.size() >= mipLevels);
+    }
+    size_t bleeding = 0;
+    for (unsigned int i = 0; i < imageCount; ++i) {
+      for (unsigned int level = 0; level < mipLevels; ++level) {
+        bleeding += countBleeding(chains[entries[i].page], level, entries[i], solids[i].color);
+      }
+    }
+    CHECK(bleeding == 0);
+
+    // One level further the gutter is gone: the check above can see bleeding
+    size_t beyond = 0;
+    for (unsigned int i = 0; i < imageCount; ++i) {
+      const MipGenerator::MipChain& chain = chains[entries[i].page];
+      const MipGenerator::MipLevel& mip = chain.levels[mipLevels + 1];
+      const unsigned int scale = 1u << (mipLevels + 1);
+      const unsigned int x = entries[i].x / scale;
+      const unsigned int y = entries[i].y / scale;
+      if (std::memcmp(&chain.pixels[mip.offset + (size_t(y) * mip.width + x) * 4], solids[i].color, 4) != 0) {
+        ++beyond;
+      }
+    }
+    CHECK(beyond > 0);
+
+    const TextureAtlas::AtlasStats& stats = atlas.getLastStats();
+    std::printf("%u images on %zu pages of %ux%u, %.1f%% of the page texels used, %u mip levels checked\n",
+      imageCount, stats.pages, pageSize, pageSize, 100.0 * stats.imageTexels / stats.pageTexels, mipLevels);
+  }
+
+  void
+  testArrayAndErrors() {
+    std::mt19937 random(7);
+    SolidImage a = makeImage(0, 64, 32, random);
+    SolidImage b = makeImage(1, 64, 32, random);
+    SolidImage c = makeImage(2, 32, 64, random);
+    TextureAtlas::AtlasImage images[3] = {
+      { a.pixels.data(), 64, 32 }, { b.pixels.data(), 64, 32 }, { c.pixels.data(), 32, 64 } };
+
+    // One slice per image, untouched; every image must have the same size
+    TextureAtlas atlas;
+    CHECK(atlas.pack(images, 2, ATLAS_ARRAY));
+    CHECK(atlas.pages().size() == 2 && atlas.pageWidth() == 64 && atlas.pageHeight() == 32);
+    CHECK(atlas.pages()[1] == b.pixels);
+    CHECK(atlas.entries()[1].page == 1 && atlas.entries()[1].scaleU == 1.0f && atlas.entries()[1].offsetU == 0.0f);
+    CHECK(!atlas.pack(images, 3, ATLAS_ARRAY));
+    CHECK(atlas.entries().empty() && atlas.pages().empty());
+
+    // An image larger than a page with its gutter, or an empty one
+    atlas.setPageSize(64);
+    CHECK(!atlas.pack(images, 1, ATLAS_PAGES));
+    atlas.setPageSize(128);
+    CHECK(atlas.pack(images, 1, ATLAS_PAGES));
+    TextureAtlas::AtlasImage empty = { a.pixels.data(), 0, 32 };
+    CHECK(!atlas.pack(&empty, 1, ATLAS_PAGES));
+    CHECK(!atlas.pack(images, 0, ATLAS_PAGES));
+  }
+}
+
+int
+main(int argc, char** argv) {
+  const unsigned int imageCount = argc > 1 ? std::atoi(argv[1]) : 60;
+  const unsigned int pageSize = argc > 2 ? std::atoi(argv[2]) : 1024;
+  const unsigned int seed = argc > 3 ? std::atoi(argv[3]) : 1;
+
+  testPages(imageCount, pageSize, seed);
+  testArrayAndErrors();
+  return TestUtils::result();
+}
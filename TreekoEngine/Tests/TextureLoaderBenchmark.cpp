@@ -0,0 +1,224 @@
+#include "HashUtils.h"
+#include "TextureDecodeQueue.h"
+#include "TestUtils.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+// Times the worker half of TextureLoader (TextureDecodeQueue) on a folder of
+// generated PNGs from 1 to N threads: a cold pass that decodes, builds the
+// mips, block compresses and bakes the .ttex caches, then a warm pass that
+// only maps the caches. The calling thread plays the render thread, taking
+// results once per millisecond. Checks every texture loads, the warm levels
+// match the cold ones for every thread count, and the bytes in flight stay
+// within the budget.
+//   TextureLoaderBenchmark [textures] [size] [maxThreads] [budgetMB]
+
+namespace {
+  uint32_t
+  crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+      }
+    }
+    return ~crc;
+  }
+
+  void
+  appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+  }
+
+  void
+  appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+  }
+
+  /*
+    *  @brief Writes an RGBA8 PNG whose zlib stream uses stored blocks, so no
+    *         deflate encoder is needed; stb_image still inflates it.
+  */
+  bool
+  writePng(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height) {
+    std::vector<unsigned char> raw;
+    raw.reserve(size_t(width * 4 + 1) * height);
+    for (unsigned int y = 0; y < height; ++y) {
+      raw.push_back(0);
+      raw.insert(raw.end(), pixels + size_t(y) * width * 4, pixels + size_t(y + 1) * width * 4);
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535) {
+      size_t length = std::min<size_t>(65535, raw.size() - offset);
+      zlib.push_back(offset + length == raw.size() ? 1 : 0);
+      zlib.push_back(static_cast<unsigned char>(length));
+      zlib.push_back(static_cast<unsigned char>(length >> 8));
+      zlib.push_back(static_cast<unsigned char>(~length));
+      zlib.push_back(static_cast<unsigned char>(~length >> 8));
+      zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (unsigned char byte : raw) {
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    std::vector<unsigned char> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+    bool written = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    return std::fclose(file) == 0 && written;
+  }
+
+  /*
+    *  @brief Smooth color with some detail; odd textures get an alpha mask,
+    *         so both BC1 and BC3 are produced.
+  */
+  std::vector<unsigned char>
+  makeImage(unsigned int size, unsigned int seed) {
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    float phase = 0.7f * seed;
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        float u = float(x) / size;
+        float v = float(y) / size;
+        float detail = 0.5f + 0.25f * std::sin(30.0f * u + phase) * std::cos(20.0f * v - phase);
+        unsigned char* texel = &pixels[(size_t(y) * size + x) * 4];
+        texel[0] = static_cast<unsigned char>(255.0f * u * detail);
+        texel[1] = static_cast<unsigned char>(255.0f * detail);
+        texel[2] = static_cast<unsigned char>(255.0f * v * (1.0f - detail));
+        texel[3] = (seed % 2 == 1) ? static_cast<unsigned char>(255.0f * std::min(1.0f, 2.0f * u)) : 255;
+      }
+    }
+    return pixels;
+  }
+
+  uint64_t
+  hashLevels(const TextureDecoder::TextureData& data) {
+    uint64_t hash = data.dxgiFormat;
+    for (const TextureCache::CacheLevel& level : data.levels) {
+      hash = hashBytes64(level.data, level.size, hash);
+    }
+    return hash;
+  }
+
+  struct PassResult {
+    double ms = 0.0;
+    size_t residentBytes = 0;
+    TextureDecodeQueue::DecodeStats stats;
+  };
+
+  /*
+    *  @brief Submits every file and takes the results like a render loop.
+    *  @param hashes Level hashes by ticket: filled when empty, compared otherwise.
+  */
+  PassResult
+  runPass(const std::vector<std::string>& files, unsigned int threads, size_t budget, std::vector<uint64_t>& hashes) {
+    PassResult result;
+    TextureDecodeQueue queue(threads, budget);
+    const bool record = hashes.empty();
+    hashes.resize(files.size(), 0);
+
+    TestUtils::Timer timer;
+    for (size_t i = 0; i < files.size(); ++i) {
+      queue.submit(i, files[i]);
+    }
+    size_t done = 0;
+    std::vector<std::unique_ptr<TextureDecodeQueue::DecodedTexture>> decoded;
+    while (done < files.size()) {
+      decoded.clear();
+      if (queue.takeDecoded(decoded) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      for (std::unique_ptr<TextureDecodeQueue::DecodedTexture>& texture : decoded) {
+        CHECK(texture->succeeded);
+        uint64_t hash = hashLevels(texture->data);
+        if (record) {
+          hashes[texture->ticket] = hash;
+        }
+        else {
+          CHECK(hashes[texture->ticket] == hash);
+        }
+        result.residentBytes += texture->data.residentBytes();
+        queue.release(*texture);
+        ++done;
+      }
+    }
+    result.ms = timer.elapsedMs();
+    result.stats = queue.getStats();
+    CHECK(result.stats.bytesInFlight == 0);
+    return result;
+  }
+}
+
+int
+main(int argc, char** argv) {
+  unsigned int textureCount = argc > 1 ? std::atoi(argv[1]) : 32;
+  unsigned int size = argc > 2 ? std::atoi(argv[2]) : 1024;
+  unsigned int maxThreads = argc > 3 ? std::atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+  size_t budget = (argc > 4 ? std::atoi(argv[4]) : 64) * size_t(1024 * 1024);
+
+  std::filesystem::path directory = TestUtils::scratchDirectory("TextureLoader");
+  std::vector<std::string> files;
+  size_t fileBytes = 0;
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    files.push_back((directory / ("texture" + std::to_string(i) + ".png")).string());
+    std::vector<unsigned char> pixels = makeImage(size, i);
+    CHECK(writePng(files.back(), pixels.data(), size, size));
+    fileBytes += std::filesystem::file_size(files.back());
+  }
+  const double megapixels = double(size) * size * textureCount / 1e6;
+  // A decode reserves 16 bytes per texel; one always runs, whatever the budget
+  const size_t allowedPeak = std::max(budget, size_t(size) * size * 16);
+
+  std::printf("%u textures of %ux%u, %.1f MB of PNG, budget %zu MB\n",
+    textureCount, size, size, fileBytes / (1024.0 * 1024.0), budget / (1024 * 1024));
+  std::printf("         |        cold: decode + mips + BC + bake         |      warm: .ttex cache\n");
+  std::printf("threads  |  total ms   tex/s  MPix/s  peak MB  worker ms  |  total ms    tex/s   GB/s\n");
+
+  std::vector<uint64_t> hashes;
+  for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+    for (const std::string& file : files) {
+      std::filesystem::remove(TextureCache::cachePathFor(file));
+    }
+    PassResult cold = runPass(files, threads, budget, hashes);
+    PassResult warm = runPass(files, threads, budget, hashes);
+
+    CHECK(cold.stats.decoded == textureCount && cold.stats.cacheHits == 0);
+    CHECK(warm.stats.cacheHits == textureCount && warm.stats.decoded == 0);
+    CHECK(cold.stats.peakBytesInFlight <= allowedPeak);
+    CHECK(warm.stats.peakBytesInFlight <= allowedPeak);
+    CHECK(cold.residentBytes == warm.residentBytes);
+
+    std::printf("%7u  | %9.1f %7.1f %7.1f %8.1f %10.1f  | %9.1f %8.1f %6.2f\n", threads,
+      cold.ms, textureCount / (cold.ms / 1000.0), megapixels / (cold.ms / 1000.0),
+      cold.stats.peakBytesInFlight / (1024.0 * 1024.0), cold.stats.workerMs,
+      warm.ms, textureCount / (warm.ms / 1000.0), warm.residentBytes / (warm.ms * 1e6));
+  }
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
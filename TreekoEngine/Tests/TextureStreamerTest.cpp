@@ -0,0 +1,226 @@
+#include "TextureDecoder.h"
+#include "TextureStreamer.h"
+#include "TestUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+// Runs TextureStreamer against a device that only counts bytes: a camera
+// flies past a row of BC1 textures under a tight budget, then the budget is
+// dropped to zero, raised, and uploads are made to fail. After every update
+// the device must hold exactly the bytes the streamer reports, within the
+// budget (tails excepted), and every texture must keep at least its tail.
+//   TextureStreamerTest [textureCount] [size] [budgetKB]
+
+namespace {
+  /*
+    *  @brief StreamingDevice that keeps the byte count of each texture.
+  */
+  class
+    CountingDevice : public StreamingDevice {
+  public:
+    bool
+      setResidentLevels(unsigned int textureId,
+        uint32_t dxgiFormat,
+        const TextureCache::CacheLevel* levels,
+        unsigned int levelCount) override {
+      ++calls;
+      if (failUploads) {
+        return false;
+      }
+      if (textureId >= bytes.size()) {
+        bytes.resize(textureId + 1, 0);
+        levelCounts.resize(textureId + 1, 0);
+      }
+      size_t chainBytes = 0;
+      for (unsigned int level = 0; level < levelCount; ++level) {
+        chainBytes += levels[level].size;
+      }
+      // GpuStreamingDevice builds the new chain before it frees the old one
+      peakBytes = std::max(peakBytes, totalBytes + chainBytes);
+      totalBytes = totalBytes - bytes[textureId] + chainBytes;
+      bytes[textureId] = chainBytes;
+      levelCounts[textureId] = levelCount;
+      return true;
+    }
+
+    void
+      releaseTexture(unsigned int textureId) override {
+      if (textureId < bytes.size()) {
+        totalBytes -= bytes[textureId];
+        bytes[textureId] = 0;
+        levelCounts[textureId] = 0;
+      }
+    }
+
+    std::vector<size_t> bytes;
+    std::vector<unsigned int> levelCounts;
+    size_t totalBytes = 0;
+    size_t peakBytes = 0;
+    size_t calls = 0;
+    bool failUploads = false;
+  };
+
+  std::vector<unsigned char>
+  makeImage(unsigned int size) {
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        unsigned char* texel = &pixels[(size_t(y) * size + x) * 4];
+        texel[0] = static_cast<unsigned char>(x * 255 / size);
+        texel[1] = static_cast<unsigned char>(y * 255 / size);
+        texel[2] = static_cast<unsigned char>(((x / 16) ^ (y / 16)) & 1 ? 200 : 40);
+        texel[3] = 255;
+      }
+    }
+    return pixels;
+  }
+
+  /*
+    *  @brief Checks the device against the streamer after an update.
+    *  @param tailBytes Bytes of every tail, resident whatever the budget.
+  */
+  void
+  checkResidency(const TextureStreamer& streamer, const CountingDevice& device,
+    unsigned int textureCount, unsigned int levelCount, size_t tailBytes) {
+    const TextureStreamer::StreamerStats& stats = streamer.getLastStats();
+    CHECK(device.totalBytes == stats.residentBytes);
+    CHECK(stats.residentBytes <= std::max(stats.memoryBudget, tailBytes));
+    for (unsigned int id = 0; id < textureCount; ++id) {
+      const unsigned int resident = streamer.residentLevel(id);
+      CHECK(resident < levelCount);
+      CHECK(id < device.levelCounts.size() && device.levelCounts[id] == levelCount - resident);
+    }
+  }
+}
+
+int
+main(int argc, char** argv) {
+  const unsigned int textureCount = argc > 1 ? std::atoi(argv[1]) : 8;
+  const unsigned int size = argc > 2 ? std::atoi(argv[2]) : 1024;
+  const size_t budget = (argc > 3 ? std::atoi(argv[3]) : 1536) * size_t(1024);
+
+  // One chain baked into a cache per texture; each source only needs to exist
+  std::filesystem::path directory = TestUtils::scratchDirectory("TextureStreamer");
+  std::vector<unsigned char> pixels = makeImage(size);
+  TextureDecoder::TextureData data;
+  CHECK(TextureDecoder::buildData(pixels.data(), size, size, data));
+  CHECK(TextureCache::isBlockCompressed(data.dxgiFormat));
+  const unsigned int levelCount = static_cast<unsigned int>(data.levels.size());
+  unsigned int tailLevel = 0;
+  while (std::max(data.levels[tailLevel].width, data.levels[tailLevel].height) > 64) {
+    ++tailLevel;
+  }
+
+  std::vector<std::string> sources;
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    sources.push_back((directory / ("texture" + std::to_string(i) + ".png")).string());
+    std::ofstream(sources.back(), std::ios::binary) << "source " << i;
+    CHECK(TextureCache::write(TextureCache::cachePathFor(sources.back()), sources.back(), data.dxgiFormat, data.levels));
+  }
+
+  TextureStreamer streamer(budget);
+  CountingDevice device;
+  CHECK(streamer.addTexture((directory / "missing.png").string()) == TextureStreamer::kInvalidTexture);
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    CHECK(streamer.addTexture(sources[i]) == i);
+  }
+
+  // First update with nothing reported: tails only
+  streamer.update(device);
+  const size_t tailBytes = streamer.getLastStats().residentBytes;
+  CHECK(tailBytes > 0 && tailBytes < budget);
+  checkResidency(streamer, device, textureCount, levelCount, tailBytes);
+
+  // Textures on a line at x = 10 * i, one unit across; the camera flies
+  // along the row, so the finest levels follow it
+  const float fovY = 0.785f;
+  const float viewportHeight = 1080.0f;
+  const unsigned int frames = 60;
+  size_t streamedIn = 0;
+  size_t streamedOut = 0;
+  size_t peakResident = 0;
+  for (unsigned int frame = 0; frame < frames; ++frame) {
+    const float cameraX = -5.0f + (10.0f * textureCount + 10.0f) * frame / (frames - 1);
+    unsigned int nearest = 0;
+    float nearestSize = 0.0f;
+    for (unsigned int i = 0; i < textureCount; ++i) {
+      const float distance = 2.0f + std::abs(cameraX - 10.0f * i);
+      const float screenSize = TextureStreamer::projectedSize(0.5f, distance, fovY, viewportHeight);
+      streamer.reportUsage(i, screenSize, distance);
+      if (screenSize > nearestSize) {
+        nearest = i;
+        nearestSize = screenSize;
+      }
+    }
+    streamer.update(device);
+    checkResidency(streamer, device, textureCount, levelCount, tailBytes);
+
+    // The closest texture has the highest priority and its whole chain fits,
+    // so it gets its wanted level (one texel per pixel) in the same frame, or
+    // keeps a finer one from earlier frames
+    const float levelsBelowTop = std::floor(std::log2(float(size) / nearestSize));
+    const unsigned int wantedLevel = std::min(tailLevel, static_cast<unsigned int>(std::max(0.0f, levelsBelowTop)));
+    CHECK(streamer.residentLevel(nearest) <= wantedLevel);
+    const TextureStreamer::StreamerStats& stats = streamer.getLastStats();
+    streamedIn += stats.streamedIn;
+    streamedOut += stats.streamedOut;
+    peakResident = std::max(peakResident, stats.residentBytes);
+  }
+  CHECK(streamedIn > 0 && streamedOut > 0);
+  std::printf("%u BC1 %ux%u textures, budget %zu KB, tails %zu KB\n",
+    textureCount, size, size, budget / 1024, tailBytes / 1024);
+  std::printf("fly-by: %zu streamed in, %zu out, peak resident %zu KB, peak during a swap %zu KB\n",
+    streamedIn, streamedOut, peakResident / 1024, device.peakBytes / 1024);
+
+  // A zero budget leaves only the tails, even for textures in use
+  streamer.setMemoryBudget(0);
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    streamer.reportUsage(i, viewportHeight, 0.0f);
+  }
+  streamer.update(device);
+  checkResidency(streamer, device, textureCount, levelCount, tailBytes);
+  CHECK(device.totalBytes == tailBytes);
+
+  // An unlimited budget reaches the top level, at most maxUploads per frame
+  streamer.setMemoryBudget(~size_t(0));
+  const unsigned int maxUploads = 3;
+  for (unsigned int frame = 0; frame <= textureCount / maxUploads; ++frame) {
+    for (unsigned int i = 0; i < textureCount; ++i) {
+      streamer.reportUsage(i, viewportHeight, 0.0f);
+    }
+    streamer.update(device, maxUploads);
+    CHECK(streamer.getLastStats().streamedIn <= maxUploads);
+    checkResidency(streamer, device, textureCount, levelCount, tailBytes);
+  }
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    CHECK(streamer.residentLevel(i) == 0);
+  }
+
+  // Unreported textures stay resident while they fit: eviction is lazy
+  streamer.update(device);
+  CHECK(streamer.getLastStats().streamedOut == 0);
+  CHECK(device.totalBytes == streamer.getLastStats().residentBytes);
+
+  // A device that refuses uploads keeps the previous levels in place
+  streamer.setMemoryBudget(tailBytes);
+  device.failUploads = true;
+  const size_t bytesBefore = device.totalBytes;
+  streamer.update(device);
+  CHECK(device.totalBytes == bytesBefore);
+  CHECK(streamer.getLastStats().streamedOut == 0);
+  for (unsigned int i = 0; i < textureCount; ++i) {
+    CHECK(streamer.residentLevel(i) == 0);
+  }
+  device.failUploads = false;
+  streamer.update(device);
+  checkResidency(streamer, device, textureCount, levelCount, tailBytes);
+  CHECK(device.totalBytes == tailBytes);
+
+  streamer.releaseAll(device);
+  CHECK(device.totalBytes == 0);
+
+  std::filesystem::remove_all(directory);
+  return TestUtils::result();
+}
@@ -0,0 +1,281 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+
+/*
+  *  @brief Shares loaded meshes and textures between every object that uses them.
+  *  @note Assets are keyed by a hash of the file content combined with the load
+  *        parameters, so two paths to identical files also share one copy.
+  *        Handles are std::shared_ptr: the GPU resources are released when the
+  *        last handle goes away, and the registry only keeps weak references.
+  *        A request for an asset that is still loading waits for that load
+  *        instead of starting a second one, whichever thread it comes from.
+  *        Resources are created on the loading thread, which relies on the
+  *        D3D11 device being free-threaded (the default).
+  *        Handles must not outlive the device.
+  *        With setRetainUnused, the registry also keeps assets nobody holds
+  *        and lets the device's GpuMemoryTracker evict them under its budget.
+*/
+class
+  AssetRegistry {
+public:
+
+  /*
+    *  @brief A mesh uploaded to the GPU.
+    *  @note mesh keeps the metadata (bounds, meshlets, LODs, submeshes,
+    *        materials); its vertex and index arrays are released after upload.
+  */
+  struct MeshAsset {
+    MeshComponent mesh;
+    Buffer vertexBuffer;
+    Buffer indexBuffer;
+  };
+
+  /*
+    *  @brief A texture and its shader resource view.
+  */
+  struct TextureAsset {
+    Texture texture;
+  };
+
+  using MeshHandle = std::shared_ptr<MeshAsset>;
+  using TextureHandle = std::shared_ptr<TextureAsset>;
+
+  /*
+    *  @brief Parameters that change how a mesh is built, part of its key.
+    *  @note Unlike ModelLoader, every pass is on by default. The .tmesh cache
+    *        is only read, and only written, with these defaults.
+  */
+  struct MeshOptions {
+    MeshOptions() : optimize(true), buildMeshlets(true), buildLods(true) {}
+
+    bool optimize;
+    bool buildMeshlets;
+    bool buildLods;
+  };
+
+  /*
+    *  @brief Counters since the registry was created.
+  */
+  struct RegistryStats {
+    /*
+      *  @brief Calls to load / request.
+    */
+    unsigned int requests = 0;
+    /*
+      *  @brief Requests served by an asset that was already loaded.
+    */
+    unsigned int hits = 0;
+    /*
+      *  @brief Requests that joined a load already in flight.
+    */
+    unsigned int joinedLoads = 0;
+    /*
+      *  @brief Loads actually performed, and how many of them failed.
+    */
+    unsigned int loads = 0;
+    unsigned int failedLoads = 0;
+  };
+
+  /*
+    *  @brief Creates an empty registry.
+    *  @param device Device the resources are created on.
+    *  @param workerCount Threads used by the request* functions.
+  */
+  explicit
+    AssetRegistry(Device& device, unsigned int workerCount = 2);
+
+  /*
+    *  @brief Waits for the loads in flight. Handles already given out stay valid.
+  */
+  ~AssetRegistry();
+
+  AssetRegistry(const AssetRegistry&) = delete;
+  AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+  /*
+    *  @brief Returns the mesh of an OBJ file, loading and uploading it if needed.
+    *  @param fileName Path of the .obj file.
+    *  @param options Build parameters.
+    *  @return MeshHandle The shared mesh, or nullptr if it could not be loaded.
+  */
+  MeshHandle
+    loadMesh(const std::string& fileName, const MeshOptions& options = MeshOptions());
+
+  /*
+    *  @brief Same as loadMesh, on one of the registry's worker threads.
+  */
+  std::shared_future<MeshHandle>
+    requestMesh(const std::string& fileName, const MeshOptions& options = MeshOptions());
+
+  /*
+    *  @brief Returns a texture, loading it if needed.
+    *  @param textureName Path without extension, as passed to Texture::init.
+    *  @param extensionType Type of the file.
+    *  @return TextureHandle The shared texture, or nullptr if it could not be loaded.
+  */
+  TextureHandle
+    loadTexture(const std::string& textureName, ExtensionType extensionType);
+
+  /*
+    *  @brief Same as loadTexture, on one of the registry's worker threads.
+  */
+  std::shared_future<TextureHandle>
+    requestTexture(const std::string& textureName, ExtensionType extensionType);
+
+  /*
+    *  @brief Keeps loaded assets after their last handle is released, so a
+    *         later request reuses them, and registers each one as evictable
+    *         with the device's GpuMemoryTracker (off by default).
+    *  @note Turning it off releases the assets nobody holds.
+  */
+  void
+    setRetainUnused(bool retainUnused);
+
+  /*
+    *  @brief Forgets the assets whose last handle was released.
+  */
+  void
+    purge();
+
+  /*
+    *  @brief Number of meshes and textures currently alive.
+  */
+  size_t
+    liveMeshCount() const;
+  size_t
+    liveTextureCount() const;
+
+  /*
+    *  @brief Returns the request counters.
+  */
+  RegistryStats
+    getStats() const;
+
+private:
+  /*
+    *  @brief One asset of the registry: its weak handle once loaded, or the
+    *         future of the load in flight.
+  */
+  template<typename Asset>
+  struct Entry {
+    std::weak_ptr<Asset> asset;
+    std::shared_future<std::shared_ptr<Asset>> pending;
+    /*
+      *  @brief Strong reference kept by setRetainUnused.
+    */
+    std::shared_ptr<Asset> retained;
+    /*
+      *  @brief Owner name of the asset's GPU memory.
+    */
+    std::string owner;
+  };
+
+  /*
+    *  @brief Content hash of a file seen before, with the stamp it was taken at.
+  */
+  struct ContentHash {
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint64_t hash = 0;
+  };
+
+  /*
+    *  @brief Hashes a file, reusing the previous hash while its size and
+    *         modification time are unchanged.
+    *  @return bool False if the file cannot be read.
+  */
+  bool
+    contentHash(const std::string& fileName, uint64_t& outHash);
+
+  /*
+    *  @brief Returns the asset of a key, joining a load in flight or running
+    *         load on this thread if the key is unknown.
+  */
+  template<typename Asset, typename Load>
+  std::shared_ptr<Asset>
+    acquire(std::unordered_map<uint64_t, Entry<Asset>>& entries,
+      uint64_t key,
+      const std::string& owner,
+      Load&& load);
+
+  /*
+    *  @brief Eviction callback of a retained asset: drops the registry's
+    *         reference if nobody else holds the asset.
+    *  @return bool False if the asset is in use or already released.
+  */
+  template<typename Asset>
+  bool
+    evictUnused(std::unordered_map<uint64_t, Entry<Asset>>& entries, uint64_t key);
+
+  /*
+    *  @brief Moves the retained references out of the entries and forgets
+    *         their eviction callbacks. Called with m_mutex held.
+  */
+  template<typename Asset>
+  void
+    releaseRetained(std::unordered_map<uint64_t, Entry<Asset>>& entries,
+      std::vector<std::shared_ptr<Asset>>& outReleased);
+
+  /*
+    *  @brief Loads and uploads a mesh (cache first, then the OBJ).
+  */
+  MeshHandle
+    createMesh(const std::string& fileName, const MeshOptions& options);
+
+  /*
+    *  @brief Loads a texture.
+  */
+  TextureHandle
+    createTexture(const std::string& textureName, ExtensionType extensionType);
+
+private:
+  /*
+    *  @brief Device the resources are created on.
+  */
+  Device& m_device;
+
+  /*
+    *  @brief Guards every member below.
+  */
+  mutable std::mutex m_mutex;
+
+  /*
+    *  @brief Meshes and textures by key.
+  */
+  std::unordered_map<uint64_t, Entry<MeshAsset>> m_meshes;
+  std::unordered_map<uint64_t, Entry<TextureAsset>> m_textures;
+
+  /*
+    *  @brief Content hashes by path, so unchanged files are only read once.
+  */
+  std::unordered_map<std::string, ContentHash> m_contentHashes;
+
+  /*
+    *  @brief Request counters.
+  */
+  RegistryStats m_stats;
+
+  /*
+    *  @brief Set by setRetainUnused; m_closing stops new eviction callbacks
+    *         once the destructor has started.
+  */
+  bool m_retainUnused = false;
+  bool m_closing = false;
+
+  /*
+    *  @brief Workers running request* calls. Declared last so it is destroyed
+    *         (and its jobs finished) before the maps they use.
+  */
+  ThreadPool m_workers;
+};
@@ -12,7 +12,13 @@
 #include "MeshComponent.h"
 #include "Buffer.h"
 #include "SamplerState.h"
-#include "ModelLoader.h"
+#include "AssetRegistry.h"
+#include "MeshSimplifier.h"
+#include "MeshletCuller.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderHotReload.h"
+#include "DynamicConstantAllocator.h"
 
 /*
  *  @brief Main application class for managing window, device, rendering, and resources.
@@ -113,20 +119,26 @@ private:
 	Viewport m_viewport;
 	/** @brief The vertex and pixel shader program. */
 	ShaderProgram m_shaderProgram;
-	/** @brief The CPU-side mesh data (vertices/indices). */
-	MeshComponent m_mesh;
-	/** @brief The GPU-side vertex buffer. */
-	Buffer m_vertexBuffer;
-	/** @brief The GPU-side index buffer. */
-	Buffer m_indexBuffer;
+	/** @brief Compiled shader bytecode, reused while the sources are unchanged. */
+	ShaderCache m_shaderCache;
+	/** @brief Recompiles the shader program in the background when its source is edited. */
+	ShaderHotReload m_shaderHotReload{ &m_shaderCache };
+	/** @brief Shared meshes and textures, keyed by content. */
+	std::unique_ptr<AssetRegistry> m_assetRegistry;
+	/** @brief The mesh metadata and its GPU-side vertex and index buffers. */
+	AssetRegistry::MeshHandle m_meshAsset;
 	/** @brief GPU constant buffer for data updated once (e.g., View matrix). */
 	Buffer m_cbNeverChanges;
 	/** @brief GPU constant buffer for data updated on resize (e.g., Projection matrix). */
 	Buffer m_cbChangeOnResize;
-	/** @brief GPU constant buffer for data updated every frame (e.g., World matrix). */
+	/** @brief Dynamic GPU constant buffer for data updated every draw, used when the ring cannot be. */
 	Buffer m_cbChangesEveryFrame;
+	/** @brief Hands out per-draw ranges of a ring constant buffer (World matrix, mesh color). */
+	DynamicConstantAllocator m_constantAllocator;
+	/** @brief Where the constants of this frame's draw were written. */
+	DynamicConstantAllocator::ConstantRange m_changesEveryFrameRange;
 	/** @brief A sample texture for the mesh. */
-	Texture m_textureCube;
+	AssetRegistry::TextureHandle m_textureCube;
 	/** @brief The sampler state for texture sampling. */
 	SamplerState m_samplerState;
 
@@ -146,6 +158,18 @@ private:
 	/** @brief CPU-side struct for the 'ChangesEveryFrame' constant buffer. */
 	CBChangesEveryFrame cb;
 
-	/** @brief Utility class for loading 3D model data from files into mesh components. */
-	ModelLoader m_modelLoader;
+	/** @brief Frustum and normal cone culling of the mesh's meshlets. */
+	MeshletCuller m_meshletCuller;
+	/** @brief Index ranges of the mesh left to draw this frame. */
+	std::vector<MeshletDrawRange> m_drawRanges;
+	/** @brief Level of detail of the mesh selected this frame. */
+	unsigned int m_lod = 0;
+	/** @brief Diffuse textures of the mesh materials (null without a loadable map). */
+	std::vector<AssetRegistry::TextureHandle> m_materialTextures;
+	/** @brief Texture and sampler of every material (a single default one without materials). */
+	std::vector<RenderQueue::MaterialBinding> m_materialBindings;
+	/** @brief Draws of the frame, sorted by material so state is bound once per material. */
+	RenderQueue m_renderQueue;
+	/** @brief Frames rendered, used to report the queue statistics periodically. */
+	unsigned int m_frameCount = 0;
 };
\ No newline at end of file
@@ -0,0 +1,266 @@
+#pragma once
+#include "TileScheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+  *  @brief Block-compressed formats written by BlockCompressor (the value is
+  *         the BCn number).
+*/
+enum BlockFormat {
+  /*
+    *  @brief Picks one of the formats below from the image content.
+  */
+  BLOCK_AUTO = 0,
+  /*
+    *  @brief Opaque RGB, 4 bits per texel.
+  */
+  BLOCK_BC1 = 1,
+  /*
+    *  @brief RGB plus interpolated alpha, 8 bits per texel.
+  */
+  BLOCK_BC3 = 3,
+  /*
+    *  @brief Two independent channels (R, G), 8 bits per texel: normal maps.
+  */
+  BLOCK_BC5 = 5,
+  /*
+    *  @brief High quality RGBA, 8 bits per texel.
+  */
+  BLOCK_BC7 = 7
+};
+
+/*
+  *  @brief Speed / quality trade-off of BlockCompressor.
+*/
+enum BlockQuality {
+  /*
+    *  @brief Endpoints from the principal axis only; meant for load time.
+  */
+  BLOCK_FAST = 0,
+  /*
+    *  @brief Least-squares endpoint refinement and extra candidate encodings;
+    *         meant for offline baking.
+  */
+  BLOCK_HIGH = 1
+};
+
+/*
+  *  @brief Compresses RGBA8 images to BC1, BC3, BC5 or BC7 on the CPU.
+  *  @note Every 4x4 block is fitted independently: endpoints come from the
+  *        principal axis of its texels, and indices are chosen against the
+  *        decoded palette with SSE2 (four palette entries per register, scalar
+  *        fallback otherwise). BLOCK_HIGH refines the endpoints by least squares
+  *        and keeps the best candidate. BC7 uses mode 6 (one subset, RGBA
+  *        endpoints with p-bits and 4-bit indices) for every block.
+  *        Images are split into tiles of block rows that run on a
+  *        TileScheduler, so all the levels of a chain are balanced together.
+  *        Edge blocks of sizes that are not a multiple of 4 repeat the last
+  *        row / column. Only depends on the standard library.
+*/
+class
+  BlockCompressor {
+public:
+
+  /*
+    *  @brief An RGBA8 image with tightly packed rows.
+  */
+  struct BlockImage {
+    const unsigned char* pixels = nullptr;
+    unsigned int width = 0;
+    unsigned int height = 0;
+  };
+
+  /*
+    *  @brief One compressed image: rowPitch bytes per row of blocks, starting
+    *         at offset.
+  */
+  struct BlockLevel {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int rowPitch = 0;
+    size_t offset = 0;
+    size_t size = 0;
+  };
+
+  /*
+    *  @brief Compressed images in a single allocation.
+  */
+  struct BlockChain {
+    BlockFormat format = BLOCK_AUTO;
+    std::vector<unsigned char> blocks;
+    std::vector<BlockLevel> levels;
+  };
+
+  /*
+    *  @brief Results of the last call to compress.
+  */
+  struct CompressStats {
+    /*
+      *  @brief Format written (resolved when BLOCK_AUTO was requested).
+    */
+    BlockFormat format = BLOCK_AUTO;
+    /*
+      *  @brief Blocks encoded, and tiles, workers and steals of the scheduler.
+    */
+    size_t blocks = 0;
+    size_t tiles = 0;
+    unsigned int threads = 0;
+    size_t steals = 0;
+    /*
+      *  @brief Wall time of the encoding, in milliseconds.
+    */
+    double encodeMs = 0.0;
+    /*
+      *  @brief Peak signal to noise ratio over the channels the format stores,
+      *         in dB (only with setMeasureError; infinite for a lossless result).
+    */
+    double psnr = 0.0;
+  };
+
+  /*
+    *  @brief Default constructor for BlockCompressor.
+  */
+  BlockCompressor() = default;
+
+  /*
+    *  @brief Default destructor for BlockCompressor.
+  */
+  ~BlockCompressor() = default;
+
+  /*
+    *  @brief Compresses one image.
+    *  @param image Source image.
+    *  @param format Format to write, or BLOCK_AUTO.
+    *  @param outChain Receives one level (replaces its content).
+    *  @param threadCount Worker threads. Zero picks one per hardware thread.
+    *  @return bool False if the image is empty.
+  */
+  bool
+    compress(const BlockImage& image, BlockFormat format, BlockChain& outChain, unsigned int threadCount = 0);
+
+  /*
+    *  @brief Compresses several images (e.g. the levels of a mip chain) to the
+    *         same format.
+    *  @param images Source images; BLOCK_AUTO decides from the first one.
+    *  @param imageCount Number of images.
+    *  @param format Format to write, or BLOCK_AUTO.
+    *  @param outChain Receives one level per image (replaces its content).
+    *  @param threadCount Worker threads. Zero picks one per hardware thread.
+    *  @return bool False if any image is empty.
+  */
+  bool
+    compress(const BlockImage* images,
+      size_t imageCount,
+      BlockFormat format,
+      BlockChain& outChain,
+      unsigned int threadCount = 0);
+
+  /*
+    *  @brief Sets the quality (default BLOCK_FAST).
+  */
+  void
+    setQuality(BlockQuality quality) { m_quality = quality; }
+
+  /*
+    *  @brief Sets whether the image holds colors (default true) or data such
+    *         as a normal map, which BLOCK_AUTO may store as BC5.
+  */
+  void
+    setColorData(bool colorData) { m_colorData = colorData; }
+
+  /*
+    *  @brief Decodes the result after every call to report its PSNR (default false).
+  */
+  void
+    setMeasureError(bool measureError) { m_measureError = measureError; }
+
+  /*
+    *  @brief Returns the statistics of the last call to compress.
+  */
+  const CompressStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Format BLOCK_AUTO resolves to for an image.
+    *  @note Opaque color goes to BC1 (fast) or BC7 (high), color with alpha to
+    *        BC3 or BC7, and opaque data whose blue channel is constant (a
+    *        two-channel normal map) to BC5.
+  */
+  static BlockFormat
+    chooseFormat(const BlockImage& image, BlockQuality quality, bool colorData);
+
+  /*
+    *  @brief Bytes of one 4x4 block of a format (0 for BLOCK_AUTO).
+  */
+  static unsigned int
+    blockBytes(BlockFormat format);
+
+  /*
+    *  @brief Decodes a compressed image written by compress back to RGBA8.
+    *  @return bool False for BLOCK_AUTO or for BC7 blocks in modes other than 6.
+  */
+  static bool
+    decompress(const unsigned char* blocks,
+      unsigned int width,
+      unsigned int height,
+      BlockFormat format,
+      std::vector<unsigned char>& outPixels);
+
+  /*
+    *  @brief PSNR between two RGBA8 images over the channels a format stores.
+  */
+  static double
+    psnr(const unsigned char* reference,
+      const unsigned char* decoded,
+      size_t texelCount,
+      BlockFormat format);
+
+private:
+  /*
+    *  @brief A band of block rows of one image.
+  */
+  struct BlockTile {
+    unsigned int image = 0;
+    unsigned int blockRowBegin = 0;
+    unsigned int blockRowEnd = 0;
+  };
+
+  /*
+    *  @brief Encodes the blocks of a tile.
+  */
+  void
+    encodeTile(const BlockImage* images, const BlockTile& tile, BlockFormat format, BlockChain& chain) const;
+
+private:
+  /*
+    *  @brief Quality of the next calls.
+  */
+  BlockQuality m_quality = BLOCK_FAST;
+
+  /*
+    *  @brief Whether the images hold colors.
+  */
+  bool m_colorData = true;
+
+  /*
+    *  @brief Whether compress measures its error.
+  */
+  bool m_measureError = false;
+
+  /*
+    *  @brief Tiles of the current call.
+  */
+  std::vector<BlockTile> m_tiles;
+
+  /*
+    *  @brief Work-stealing scheduler running the tiles.
+  */
+  TileScheduler m_scheduler;
+
+  /*
+    *  @brief Statistics of the last call to compress.
+  */
+  CompressStats m_lastStats;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+/*
+  *  @brief Platform-neutral part of Prerequisites.h: the standard headers,
+  *         the XNA Math value types, SimpleVertex and the logging macros.
+  *  @note Geometry code that never talks to Direct3D (OBJ loading, mesh
+  *        optimization, meshlets, the .tmesh cache) includes this header
+  *        instead of Prerequisites.h, so it also builds on Linux, where the
+  *        tests in Tests/ run. On Windows the types come from xnamath.h;
+  *        elsewhere the storage types the geometry code uses are declared
+  *        here with the same layout, and the macros write to stderr.
+*/
+
+/*
+  *  @brief Standard C++ libraries used in the project
+*/
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+
+#ifdef _WIN32
+// Keep <windows.h> from defining min/max macros that break std::min/std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <xnamath.h>
+
+/*
+  *  @brief Writes a wide string to the debugger output.
+*/
+#define DEBUG_OUTPUT(text) OutputDebugStringW(text)
+#else
+#include <cstdio>
+#include <cwchar>
+
+/*
+  *  @brief 2D vector for storage, laid out like the XNA Math XMFLOAT2.
+*/
+struct XMFLOAT2
+{
+  float x;
+  float y;
+
+  XMFLOAT2() = default;
+  XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+/*
+  *  @brief 3D vector for storage, laid out like the XNA Math XMFLOAT3.
+*/
+struct XMFLOAT3
+{
+  float x;
+  float y;
+  float z;
+
+  XMFLOAT3() = default;
+  XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+/*
+  *  @brief 4D vector for storage, laid out like the XNA Math XMFLOAT4.
+*/
+struct XMFLOAT4
+{
+  float x;
+  float y;
+  float z;
+  float w;
+
+  XMFLOAT4() = default;
+  XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+/*
+  *  @brief Row-major 4x4 matrix for storage, laid out like the XNA Math XMFLOAT4X4.
+*/
+struct XMFLOAT4X4
+{
+  float m[4][4];
+
+  float operator()(unsigned int row, unsigned int column) const { return m[row][column]; }
+  float& operator()(unsigned int row, unsigned int column) { return m[row][column]; }
+};
+
+/*
+  *  @brief Writes a wide string to stderr.
+*/
+#define DEBUG_OUTPUT(text) std::fputws(text, stderr)
+#endif
+
+/*
+  *  @brief Macro to output a debug message about resource creation
+*/
+#define MESSAGE( classObj, method, state )   \
+{                                            \
+   std::wostringstream os_;                  \
+   os_ << classObj << "::" << method << " : " << "[CREATION OF RESOURCE " << ": " << state << "] \n"; \
+   DEBUG_OUTPUT( os_.str().c_str() );        \
+}
+
+/*
+  *  @brief Macro to output an error message to the debug output
+*/
+#define ERROR(classObj, method, errorMSG)                     \
+{                                                             \
+    try {                                                     \
+        std::wostringstream os_;                              \
+        os_ << L"ERROR : " << classObj << L"::" << method     \
+            << L" : " << errorMSG << L"\n";                   \
+        DEBUG_OUTPUT(os_.str().c_str());                      \
+    } catch (...) {                                           \
+        DEBUG_OUTPUT(L"Failed to log error message.\n");      \
+    }                                                         \
+}
+
+/*
+  *  @brief Structure representing a simple vertex with position and texture coordinates
+*/
+struct SimpleVertex
+{
+  /*
+    *  @brief 3D position of the vertex
+  */
+  XMFLOAT3 Pos;
+  /*
+    *  @brief 2D texture coordinates of the vertex
+  */
+  XMFLOAT2 Tex;
+
+  XMFLOAT3 Norm;
+
+};
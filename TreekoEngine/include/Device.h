@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "Prerequisites.h"
+#include "GpuMemoryTracker.h"
+#include <memory>
 
 /*
   *  @brief Represents a Direct3D 11 device and provides methods for resource creation and management.
@@ -53,7 +55,8 @@ public:
       ID3D11RenderTargetView** ppRTView);
 
   /*
-    *  @brief Creates a 2D texture.
+    *  @brief Creates a 2D texture and tracks its memory under the current
+    *         GpuMemoryTracker::OwnerScope.
     *  @param pDesc The texture description.
     *  @param pInitialData The initial data for the texture.
     *  @param ppTexture2D The address of a pointer to the texture.
@@ -64,6 +67,14 @@ public:
       const D3D11_SUBRESOURCE_DATA* pInitialData,
       ID3D11Texture2D** ppTexture2D);
 
+  /*
+    *  @brief Tracks a 2D texture created outside CreateTexture2D (by D3DX),
+    *         under the current GpuMemoryTracker::OwnerScope.
+    *  @param texture The texture, already created on this device.
+  */
+  void
+    TrackTexture2D(ID3D11Texture2D* texture);
+
   /*
     *  @brief Creates a depth stencil view for a resource.
     *  @param pResource The resource to create the view for.
@@ -121,7 +132,8 @@ public:
       ID3D11PixelShader** ppPixelShader);
 
   /*
-    *  @brief Creates a buffer resource.
+    *  @brief Creates a buffer resource and tracks its memory under the
+    *         current GpuMemoryTracker::OwnerScope.
     *  @param pDesc The buffer description.
     *  @param pInitialData The initial data for the buffer.
     *  @param ppBuffer The address of a pointer to the buffer.
@@ -147,4 +159,10 @@ public:
     *  @brief Pointer to the underlying ID3D11Device.
   */
   ID3D11Device* m_device = nullptr;
+
+  /*
+    *  @brief Accounts for every texture and buffer created through this
+    *         device; an allocation is forgotten when D3D destroys its resource.
+  */
+  std::shared_ptr<GpuMemoryTracker> m_memoryTracker = std::make_shared<GpuMemoryTracker>();
 };
@@ -0,0 +1,205 @@
+#pragma once
+#include "Prerequisites.h"
+#include "RingAllocator.h"
+
+class Device;
+class DeviceContext;
+class Buffer;
+
+/*
+  *  @brief Hands out per-draw ranges of constant data from one large
+  *         USAGE_DYNAMIC constant buffer.
+  *  @note Each draw takes a 256-byte aligned range from a RingAllocator and
+  *        writes it through a Map of the ring: WRITE_DISCARD the first time,
+  *        NO_OVERWRITE afterwards, so the driver neither copies nor renames
+  *        the buffer. The draw then binds the ring at its range with
+  *        VSSetConstantBuffers1/PSSetConstantBuffers1. endFrame ends an event
+  *        query that serves as the fence of the frame, and beginFrame retires
+  *        the frames the GPU finished, so the ring only wraps over constants
+  *        already consumed.
+  *        Offset binding and NO_OVERWRITE on a constant buffer need a
+  *        Direct3D 11.1 runtime that reports both in D3D11_FEATURE_D3D11_OPTIONS.
+  *        Without them (11.0, e.g. Windows 7 without the platform update), and
+  *        for a draw that finds the ring full, update falls back to the
+  *        caller's dynamic Buffer, rewritten with WRITE_DISCARD and bound whole.
+  *        Render thread only.
+*/
+class
+  DynamicConstantAllocator {
+public:
+  /*
+    *  @brief Most frames whose fence can be pending at once.
+  */
+  static const unsigned int kMaxFramesInFlight = 4;
+
+  /*
+    *  @brief Offset and size granularity of offset binding (16 constants).
+  */
+  static const unsigned int kAlignment = 256;
+
+  /*
+    *  @brief Constants of one draw, as update wrote them.
+  */
+  struct ConstantRange {
+    /*
+      *  @brief First 16-byte constant of the range in the ring.
+    */
+    unsigned int firstConstant = 0;
+
+    /*
+      *  @brief Number of 16-byte constants, a multiple of 16.
+    */
+    unsigned int numConstants = 0;
+
+    /*
+      *  @brief False if the data went to the fallback buffer instead.
+    */
+    bool inRing = false;
+  };
+
+  /*
+    *  @brief Default constructor for DynamicConstantAllocator.
+  */
+  DynamicConstantAllocator() = default;
+
+  /*
+    *  @brief Default destructor. Call destroy to release the ring.
+  */
+  ~DynamicConstantAllocator() = default;
+
+  DynamicConstantAllocator(const DynamicConstantAllocator&) = delete;
+  DynamicConstantAllocator& operator=(const DynamicConstantAllocator&) = delete;
+
+  /*
+    *  @brief Creates the ring and the fence queries when the runtime can bind
+    *         constant buffers at an offset; otherwise only the fallback is used.
+    *  @param device Reference to the Device object.
+    *  @param deviceContext Reference to the immediate DeviceContext.
+    *  @param capacity Size of the ring in bytes.
+    *  @return HRESULT S_OK also when the runtime has no offset binding.
+  */
+  HRESULT
+    init(Device& device, DeviceContext& deviceContext, unsigned int capacity = 1024 * 1024);
+
+  /*
+    *  @brief Releases the space of the frames the GPU has finished.
+  */
+  void
+    beginFrame(DeviceContext& deviceContext);
+
+  /*
+    *  @brief Writes the constants of a draw into the ring, or into
+    *         constantBuffer if there is no ring or it is full.
+    *  @param constantBuffer Fallback, created with Buffer::init(device, size, true).
+    *  @return ConstantRange To pass to bind before the draw.
+  */
+  ConstantRange
+    update(DeviceContext& deviceContext, Buffer& constantBuffer, const void* data, unsigned int size);
+
+  /*
+    *  @brief Binds the constants written by update to a slot of the vertex
+    *         shader, and of the pixel shader if asked.
+    *  @param constantBuffer The fallback buffer given to update.
+  */
+  void
+    bind(DeviceContext& deviceContext,
+      Buffer& constantBuffer,
+      const ConstantRange& range,
+      unsigned int slot,
+      bool setPixelShader = false);
+
+  /*
+    *  @brief Unmaps the ring and signals the fence of the frame.
+  */
+  void
+    endFrame(DeviceContext& deviceContext);
+
+  /*
+    *  @brief Releases the ring and the queries.
+  */
+  void
+    destroy();
+
+  /*
+    *  @brief True if draws get ranges of the ring, false if only the fallback runs.
+  */
+  bool
+    usesOffsetBinding() const { return m_buffer != nullptr; }
+
+  /*
+    *  @brief Returns the ring counters.
+  */
+  const RingAllocator::RingStats&
+    getStats() const { return m_ring.getStats(); }
+
+  /*
+    *  @brief Bytes held by the frames in flight.
+  */
+  uint64_t
+    getUsedBytes() const { return m_ring.used(); }
+
+private:
+  /*
+    *  @brief The part of ID3D11DeviceContext1 this class calls.
+  */
+  struct DeviceContext1;
+
+  /*
+    *  @brief Maps the ring if it is not mapped.
+  */
+  bool
+    map(DeviceContext& deviceContext);
+
+  /*
+    *  @brief Unmaps the ring if it is mapped.
+  */
+  void
+    unmap(DeviceContext& deviceContext);
+
+private:
+  /*
+    *  @brief Ring buffer (USAGE_DYNAMIC, CPU write), or nullptr on 11.0.
+  */
+  ID3D11Buffer* m_buffer = nullptr;
+
+  /*
+    *  @brief 11.1 interface of the immediate context, for offset binding.
+  */
+  DeviceContext1* m_context1 = nullptr;
+
+  /*
+    *  @brief Bookkeeping of the ring.
+  */
+  RingAllocator m_ring;
+
+  /*
+    *  @brief Mapped ring, or nullptr while unmapped.
+  */
+  char* m_mapped = nullptr;
+
+  /*
+    *  @brief The next Map discards: nothing was written since init.
+  */
+  bool m_discardNext = true;
+
+  /*
+    *  @brief Event queries used as fences, in a ring of their own.
+  */
+  ID3D11Query* m_fences[kMaxFramesInFlight] = {};
+
+  /*
+    *  @brief Frame number signalled by each pending query.
+  */
+  uint64_t m_fenceFrames[kMaxFramesInFlight] = {};
+
+  /*
+    *  @brief Oldest pending query and number of pending queries.
+  */
+  unsigned int m_oldestFence = 0;
+  unsigned int m_pendingFences = 0;
+
+  /*
+    *  @brief Frames ended so far.
+  */
+  uint64_t m_frame = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+  *  @brief Reports the files written in a set of directories.
+  *  @note A background thread blocks on the operating system
+  *        (ReadDirectoryChangesW on Windows, inotify elsewhere) and records
+  *        the path of every file written, created or renamed into a watched
+  *        directory. poll hands them out once they have been quiet for a
+  *        short settle time, since editors save in several writes (or write
+  *        a temporary file and rename it). Subdirectories are not watched.
+  *        Paths are reported as the watched directory joined with the file
+  *        name, lexically normalized. Thread-safe; poll is cheap enough to
+  *        call every frame.
+*/
+class
+  FileWatcher {
+public:
+  /*
+    *  @brief Creates a watcher with no directory. The thread starts with the
+    *         first watch.
+    *  @param settleMs Quiet time before a change is reported.
+  */
+  explicit
+    FileWatcher(unsigned int settleMs = 100);
+
+  /*
+    *  @brief Stops and joins the watcher thread.
+  */
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  /*
+    *  @brief Starts watching a directory ("" is the working directory).
+    *  @return bool False if the directory cannot be watched.
+  */
+  bool
+    watchDirectory(const std::string& directory);
+
+  /*
+    *  @brief Moves the files that changed and settled since the last call
+    *         into outChanged, each once.
+  */
+  void
+    poll(std::vector<std::string>& outChanged);
+
+  /*
+    *  @brief Whether the watcher thread is running.
+  */
+  bool
+    isRunning() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /*
+    *  @brief Starts the thread and the platform state on the first watch.
+  */
+  bool
+    start();
+
+  /*
+    *  @brief Stops the thread and releases the platform state.
+  */
+  void
+    stop();
+
+  /*
+    *  @brief Loop run by the watcher thread.
+  */
+  void
+    watchLoop();
+
+  /*
+    *  @brief Records a change of a file of a watched directory.
+  */
+  void
+    recordChange(const std::string& directory, const std::string& fileName);
+
+private:
+  /*
+    *  @brief Quiet time before a change is reported.
+  */
+  Clock::duration m_settle;
+
+  /*
+    *  @brief Guards every member below.
+  */
+  mutable std::mutex m_mutex;
+
+  /*
+    *  @brief Normalized watched directories.
+  */
+  std::vector<std::string> m_directories;
+
+  /*
+    *  @brief Changed files and the time of their last change.
+  */
+  std::unordered_map<std::string, Clock::time_point> m_pending;
+
+  /*
+    *  @brief Set by stop; read by the watcher thread.
+  */
+  bool m_stopping = false;
+
+  std::thread m_thread;
+
+#ifdef _WIN32
+  /*
+    *  @brief Manual-reset event that wakes the thread to stop or to pick up
+    *         a new directory.
+  */
+  void* m_wakeEvent = nullptr;
+
+  /*
+    *  @brief Directories opened by watchDirectory and not yet picked up by
+    *         the thread, with their handle.
+  */
+  std::vector<std::pair<std::string, void*>> m_addedDirectories;
+#else
+  /*
+    *  @brief inotify descriptor.
+  */
+  int m_inotify = -1;
+
+  /*
+    *  @brief Pipe written by stop to wake the thread.
+  */
+  int m_wakePipe[2] = { -1, -1 };
+
+  /*
+    *  @brief Watched directory of every inotify watch descriptor.
+  */
+  std::unordered_map<int, std::string> m_watches;
+#endif
+};
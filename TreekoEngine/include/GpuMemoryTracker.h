@@ -0,0 +1,224 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+  *  @brief Kind of GPU allocation, for the per-category totals.
+*/
+enum MemoryCategory {
+  MEMORY_TEXTURE = 0,
+  MEMORY_RENDER_TARGET = 1,
+  MEMORY_DEPTH_STENCIL = 2,
+  MEMORY_VERTEX_BUFFER = 3,
+  MEMORY_INDEX_BUFFER = 4,
+  MEMORY_CONSTANT_BUFFER = 5,
+  MEMORY_OTHER_BUFFER = 6,
+  MEMORY_CATEGORY_COUNT = 7
+};
+
+/*
+  *  @brief Accounts for every GPU allocation by size, category and owning
+  *         asset, and evicts the least recently used evictable owners when the
+  *         total goes over a budget.
+  *  @note Device reports each texture and buffer it creates; the owner is the
+  *        name set by the innermost OwnerScope on the creating thread. Owners
+  *        become evictable by registering a callback that releases them (and
+  *        returns false while they are still in use); enforceBudget calls the
+  *        callbacks oldest first until the total fits. Sizes are computed from
+  *        the resource descriptions, so they ignore driver padding.
+  *        Thread-safe. Only depends on the standard library.
+*/
+class
+  GpuMemoryTracker {
+public:
+  /*
+    *  @brief Releases the owner's resources.
+    *  @return bool False if the owner is in use and cannot be evicted now.
+  */
+  using EvictCallback = std::function<bool()>;
+
+  /*
+    *  @brief Names the owner of the allocations made on this thread while it
+    *         is alive. Scopes nest; the innermost one wins.
+  */
+  class
+    OwnerScope {
+  public:
+    explicit
+      OwnerScope(const std::string& owner);
+    ~OwnerScope();
+
+    OwnerScope(const OwnerScope&) = delete;
+    OwnerScope& operator=(const OwnerScope&) = delete;
+
+  private:
+    std::string m_previous;
+  };
+
+  /*
+    *  @brief Bytes and allocation count of each category.
+  */
+  struct CategoryTotals {
+    size_t bytes[MEMORY_CATEGORY_COUNT] = {};
+    size_t allocations[MEMORY_CATEGORY_COUNT] = {};
+    size_t totalBytes = 0;
+  };
+
+  /*
+    *  @brief One owner in a report.
+  */
+  struct OwnerReport {
+    std::string name;
+    size_t bytes = 0;
+    size_t allocations = 0;
+    uint64_t lastUsedFrame = 0;
+    bool evictable = false;
+  };
+
+  /*
+    *  @brief Default constructor. No budget is enforced.
+  */
+  GpuMemoryTracker() = default;
+
+  /*
+    *  @brief Default destructor for GpuMemoryTracker.
+  */
+  ~GpuMemoryTracker() = default;
+
+  GpuMemoryTracker(const GpuMemoryTracker&) = delete;
+  GpuMemoryTracker& operator=(const GpuMemoryTracker&) = delete;
+
+  /*
+    *  @brief Records an allocation.
+    *  @return uint64_t Id to pass to release.
+  */
+  uint64_t
+    track(size_t bytes, MemoryCategory category, const std::string& owner);
+
+  /*
+    *  @brief Forgets an allocation.
+  */
+  void
+    release(uint64_t allocationId);
+
+  /*
+    *  @brief Starts a new frame for the LRU order.
+  */
+  void
+    beginFrame();
+
+  /*
+    *  @brief Marks an owner as used in the current frame.
+  */
+  void
+    touch(const std::string& owner);
+
+  /*
+    *  @brief Makes an owner evictable (replaces a previous callback).
+  */
+  void
+    setEvictable(const std::string& owner, EvictCallback evict);
+
+  /*
+    *  @brief Makes an owner no longer evictable.
+  */
+  void
+    clearEvictable(const std::string& owner);
+
+  /*
+    *  @brief Sets the budget in bytes (0 disables eviction).
+  */
+  void
+    setBudget(size_t budget);
+
+  /*
+    *  @brief Evicts owners not used this frame, least recently used first,
+    *         until the total fits the budget.
+    *  @return size_t Bytes released.
+  */
+  size_t
+    enforceBudget();
+
+  /*
+    *  @brief Returns the per-category totals.
+  */
+  CategoryTotals
+    getCategoryTotals() const;
+
+  /*
+    *  @brief Returns every owner, largest first.
+  */
+  std::vector<OwnerReport>
+    getOwnerReport() const;
+
+  /*
+    *  @brief Writes the totals, budget and owners as JSON.
+  */
+  void
+    writeJson(std::ostream& stream) const;
+
+  /*
+    *  @brief Writes writeJson's output to a file.
+    *  @return bool False if the file cannot be written.
+  */
+  bool
+    dumpJson(const std::string& fileName) const;
+
+  /*
+    *  @brief Name of a category, as used in the JSON.
+  */
+  static const char*
+    categoryName(MemoryCategory category);
+
+  /*
+    *  @brief Owner named by the innermost OwnerScope of this thread.
+  */
+  static const std::string&
+    currentOwner();
+
+private:
+  /*
+    *  @brief A tracked allocation.
+  */
+  struct Allocation {
+    size_t bytes;
+    MemoryCategory category;
+    std::string owner;
+  };
+
+  /*
+    *  @brief Allocations and LRU state of one owner.
+  */
+  struct Owner {
+    size_t bytes = 0;
+    size_t allocations = 0;
+    uint64_t lastUsedFrame = 0;
+    EvictCallback evict;
+  };
+
+private:
+  /*
+    *  @brief Guards every member below.
+  */
+  mutable std::mutex m_mutex;
+
+  std::unordered_map<uint64_t, Allocation> m_allocations;
+  std::unordered_map<std::string, Owner> m_owners;
+  CategoryTotals m_totals;
+
+  uint64_t m_nextId = 1;
+  uint64_t m_frame = 0;
+  size_t m_budget = 0;
+
+  /*
+    *  @brief Owners evicted and bytes released since construction.
+  */
+  size_t m_evictions = 0;
+  size_t m_evictedBytes = 0;
+};
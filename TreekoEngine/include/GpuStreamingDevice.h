@@ -0,0 +1,57 @@
+#pragma once
+#include "Prerequisites.h"
+#include "TextureStreamer.h"
+
+class Device;
+class Texture;
+
+/*
+  *  @brief StreamingDevice that creates the streamed textures with D3D11.
+  *  @note Each streamed id is bound to a Texture. A residency change builds a
+  *        new texture and view from the mapped levels and swaps the view into
+  *        the bound Texture, so materials pointing at it pick up the new
+  *        levels without rebinding; on failure the old view stays.
+*/
+class
+  GpuStreamingDevice : public StreamingDevice {
+public:
+  /*
+    *  @brief Creates the streaming device.
+    *  @param device Device used for resource creation.
+  */
+  explicit
+    GpuStreamingDevice(Device& device) : m_device(device) {}
+
+  /*
+    *  @brief Default destructor. Bound textures are not released.
+  */
+  ~GpuStreamingDevice() override = default;
+
+  /*
+    *  @brief Binds a streamed texture id to the Texture that receives its levels.
+    *  @param textureId Id returned by TextureStreamer::addTexture.
+    *  @param texture Texture kept alive by the caller while it is bound.
+  */
+  void
+    bindTexture(unsigned int textureId, Texture& texture);
+
+  bool
+    setResidentLevels(unsigned int textureId,
+      uint32_t dxgiFormat,
+      const TextureCache::CacheLevel* levels,
+      unsigned int levelCount) override;
+
+  void
+    releaseTexture(unsigned int textureId) override;
+
+private:
+  /*
+    *  @brief Device used for resource creation.
+  */
+  Device& m_device;
+
+  /*
+    *  @brief Bound textures, indexed by streamed texture id.
+  */
+  std::vector<Texture*> m_textures;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/*
+  *  @brief Fast non-cryptographic 64-bit hash of a byte range.
+  *  @note Consumes 8 bytes per step with a multiply/xor-shift mix, which keeps
+  *        hashing large asset files well above memory-read speed. The result is
+  *        stable across runs and platforms (little-endian), so it can be
+  *        stored in on-disk caches.
+  *  @param data First byte to hash.
+  *  @param size Number of bytes to hash.
+  *  @param seed Optional seed, e.g. a previous hash to chain several ranges.
+  *  @return uint64_t The hash value.
+*/
+inline uint64_t
+hashBytes64(const void* data, size_t size, uint64_t seed = 0) {
+  const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t h = seed ^ (size * kMul);
+
+  while (size >= 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    word *= 0xBF58476D1CE4E5B9ull;
+    word ^= word >> 31;
+    h = (h ^ word) * kMul;
+    h ^= h >> 29;
+    bytes += 8;
+    size -= 8;
+  }
+
+  uint64_t tail = 0;
+  if (size > 0) {
+    std::memcpy(&tail, bytes, size);
+  }
+  h = (h ^ (tail * 0x94D049BB133111EBull)) * kMul;
+  h ^= h >> 32;
+  return h;
+}
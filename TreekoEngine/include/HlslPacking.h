@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <windows.h>
+#include <xnamath.h>
+
+/*
+  *  @brief Compile-time check that a C++ constant-buffer struct is laid out
+  *         the way HLSL packs the matching cbuffer.
+  *  @note HLSL packs cbuffer members into 16-byte registers: a member never
+  *        straddles a register boundary, matrices, arrays and structs start
+  *        a new register, and the buffer is a whole number of registers.
+  *        C++ aligns each member to its own alignment instead, so a float3
+  *        after a float2 lands at offset 8 in C++ but 16 in HLSL. A CB struct
+  *        lists every member, in order, with HLSL_MEMBER in a static_assert
+  *        on HlslPacking::matches, which fails to compile as soon as a member
+  *        sits where HLSL would not put it. Compact layouts, like a float
+  *        right after a float3, need no padding; the padding HLSL inserts
+  *        has to be spelled out as members, with scalar or vector types
+  *        (float, XMFLOAT2) since an HLSL array pads every element to a
+  *        register.
+*/
+namespace HlslPacking {
+  /*
+    *  @brief Size of a cbuffer register.
+  */
+  const size_t kRegisterSize = 16;
+
+  /*
+    *  @brief How HLSL places a member of a given C++ type.
+    *  @note Scalars and vectors pack into the current register; anything
+    *        else (matrices, structs) starts a new one. bool is 4 bytes in
+    *        HLSL and 1 in C++, so it never matches.
+  */
+  template<typename T>
+  struct MemberTraits {
+    static const bool kStartsRegister = !std::is_arithmetic<T>::value;
+    static const bool kValid = !std::is_same<T, bool>::value;
+  };
+
+  template<>
+  struct MemberTraits<XMFLOAT2> {
+    static const bool kStartsRegister = false;
+    static const bool kValid = true;
+  };
+
+  template<>
+  struct MemberTraits<XMFLOAT3> {
+    static const bool kStartsRegister = false;
+    static const bool kValid = true;
+  };
+
+  template<>
+  struct MemberTraits<XMFLOAT4> {
+    static const bool kStartsRegister = false;
+    static const bool kValid = true;
+  };
+
+  template<>
+  struct MemberTraits<XMVECTOR> {
+    static const bool kStartsRegister = false;
+    static const bool kValid = true;
+  };
+
+  /*
+    *  @brief Every element of an HLSL array starts a register, so an array
+    *         only matches C++ when its elements are whole registers.
+  */
+  template<typename T, size_t N>
+  struct MemberTraits<T[N]> {
+    static const bool kStartsRegister = true;
+    static const bool kValid = sizeof(T) % kRegisterSize == 0 && MemberTraits<T>::kValid;
+  };
+
+  /*
+    *  @brief Placement of one C++ member, filled in by HLSL_MEMBER.
+  */
+  struct Member {
+    size_t offset;
+    size_t size;
+    bool startsRegister;
+    bool valid;
+  };
+
+  /*
+    *  @brief Rounds an offset up to the next register.
+  */
+  constexpr size_t
+  alignToRegister(size_t offset) {
+    return (offset + kRegisterSize - 1) / kRegisterSize * kRegisterSize;
+  }
+
+  /*
+    *  @brief Offset HLSL gives a member that follows one ending at end.
+  */
+  constexpr size_t
+  placeMember(size_t end, const Member& member) {
+    return (member.startsRegister || end % kRegisterSize + member.size > kRegisterSize) ?
+      alignToRegister(end) : end;
+  }
+
+  /*
+    *  @brief Whether every member is where HLSL puts it and the struct is a
+    *         whole number of registers with no extra one.
+    *  @param structSize sizeof the struct.
+    *  @param members Every member, in declaration order.
+  */
+  constexpr bool
+  matches(size_t structSize, std::initializer_list<Member> members) {
+    size_t end = 0;
+    for (const Member& member : members) {
+      if (!member.valid || member.offset != placeMember(end, member)) {
+        return false;
+      }
+      end = member.offset + member.size;
+    }
+    return structSize % kRegisterSize == 0 && alignToRegister(end) == structSize;
+  }
+}
+
+/*
+  *  @brief Describes a member of a CB struct for HlslPacking::matches.
+*/
+#define HLSL_MEMBER(Struct, member)                                        \
+  HlslPacking::Member{ offsetof(Struct, member), sizeof(Struct::member),   \
+    HlslPacking::MemberTraits<decltype(Struct::member)>::kStartsRegister,  \
+    HlslPacking::MemberTraits<decltype(Struct::member)>::kValid }
@@ -1,5 +1,7 @@
 #pragma once
 #include "Prerequisites.h"
+#include "VertexPacker.h"
+#include "VertexLayout.h"
 
 class Device;
 class DeviceContext;
@@ -33,6 +35,22 @@ public:
       std::vector<D3D11_INPUT_ELEMENT_DESC>& Layout,
       ID3DBlob* VertexShaderData);
 
+  /*
+    *  @brief Builds the input layout description matching SimpleVertex.
+    *  @return SimpleVertexLayout: POSITION (float3), TEXCOORD (float2) and NORMAL (float3).
+  */
+  static std::vector<D3D11_INPUT_ELEMENT_DESC>
+    simpleVertexLayout();
+
+  /*
+    *  @brief Builds the input layout description matching PackedVertex.
+    *  @param params Packing constants of the mesh; they select the TEXCOORD format.
+    *  @return PackedVertexLayout or PackedVertexHalfLayout: POSITION (unorm16 x4),
+    *          NORMAL (snorm16 x2, octahedral) and TEXCOORD (unorm16 or half x2).
+  */
+  static std::vector<D3D11_INPUT_ELEMENT_DESC>
+    packedVertexLayout(const PackedVertexParams& params);
+
   /*
     *  @brief Updates the input layout state if necessary.
   */
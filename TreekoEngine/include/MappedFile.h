@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/*
+  *  @brief Read-only memory mapping of a whole file.
+  *  @note Kept free of Windows/DirectX headers so the asset parsers that use it
+  *        can also be built and exercised on Linux (mmap path).
+*/
+class
+  MappedFile {
+public:
+
+  /*
+    *  @brief Default constructor. The file starts unmapped.
+  */
+  MappedFile() = default;
+
+  /*
+    *  @brief Destructor. Unmaps the file if it is still open.
+  */
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /*
+    *  @brief Maps the given file into memory for reading.
+    *  @param fileName Path of the file to map.
+    *  @return bool True if the file was opened and mapped. Empty files open
+    *          successfully with a null data pointer and a size of zero.
+  */
+  bool
+    open(const std::string& fileName);
+
+  /*
+    *  @brief Unmaps the file and releases the OS handles.
+  */
+  void
+    close();
+
+  /*
+    *  @brief Returns true while a file is open.
+  */
+  bool
+    isOpen() const { return m_isOpen; }
+
+  /*
+    *  @brief Pointer to the first byte of the mapped file.
+  */
+  const char*
+    data() const { return m_data; }
+
+  /*
+    *  @brief Size of the mapped file in bytes.
+  */
+  size_t
+    size() const { return m_size; }
+
+private:
+  /*
+    *  @brief Start of the mapped view (nullptr for empty files).
+  */
+  const char* m_data = nullptr;
+
+  /*
+    *  @brief Size of the mapped view in bytes.
+  */
+  size_t m_size = 0;
+
+  /*
+    *  @brief True while a file is open.
+  */
+  bool m_isOpen = false;
+
+#ifdef _WIN32
+  /*
+    *  @brief File handle returned by CreateFile.
+  */
+  void* m_file = nullptr;
+
+  /*
+    *  @brief Mapping handle returned by CreateFileMapping.
+  */
+  void* m_mapping = nullptr;
+#else
+  /*
+    *  @brief POSIX file descriptor.
+  */
+  int m_fd = -1;
+#endif
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include "CorePrerequisites.h"
+
+/*
+  *  @brief Surface description read from a Wavefront .mtl library.
+  *  @note Only the diffuse terms are kept; the other MTL statements are skipped.
+*/
+struct Material
+{
+  /*
+    *  @brief Name given by "newmtl" and referenced by "usemtl".
+  */
+  std::string name;
+  /*
+    *  @brief Diffuse color ("Kd") with the opacity ("d") in w.
+  */
+  XMFLOAT4 diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+  /*
+    *  @brief Path of the diffuse texture ("map_Kd"), relative to the working
+    *         directory, or empty if the material has none.
+  */
+  std::string diffuseMap;
+};
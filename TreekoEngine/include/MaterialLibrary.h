@@ -0,0 +1,57 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "Material.h"
+
+/*
+  *  @brief Parser for Wavefront .mtl material libraries.
+  *  @note Reads newmtl, Kd, d / Tr and map_Kd (skipping map options such as
+  *        "-s 1 1 1"); other statements are ignored. Texture paths are resolved
+  *        against the directory of the library, as OBJ exporters write them.
+*/
+class
+  MaterialLibrary {
+public:
+
+  /*
+    *  @brief Default constructor. The library starts empty.
+  */
+  MaterialLibrary() = default;
+
+  /*
+    *  @brief Default destructor for MaterialLibrary.
+  */
+  ~MaterialLibrary() = default;
+
+  /*
+    *  @brief Parses a .mtl file and adds its materials to the library.
+    *  @param fileName Path of the .mtl file.
+    *  @return bool False if the file could not be opened.
+    *  @note A material defined again replaces the earlier definition.
+  */
+  bool
+    load(const std::string& fileName);
+
+  /*
+    *  @brief Returns the material with the given name, or nullptr.
+  */
+  const Material*
+    findMaterial(const std::string& name) const;
+
+  /*
+    *  @brief Returns every material loaded so far, in definition order.
+  */
+  const std::vector<Material>&
+    getMaterials() const { return m_materials; }
+
+  /*
+    *  @brief Removes every material.
+  */
+  void
+    clear() { m_materials.clear(); }
+
+private:
+  /*
+    *  @brief Materials loaded so far.
+  */
+  std::vector<Material> m_materials;
+};
@@ -0,0 +1,352 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "MeshComponent.h"
+#include "MappedFile.h"
+#include <cstdint>
+
+/*
+  *  @brief Versioned binary mesh cache (.tmesh) written next to the source model.
+  *  @note The file stores the final SimpleVertex and index arrays exactly as they
+  *        are uploaded to the GPU, so a valid cache is memory-mapped and its
+  *        sections are handed to Buffer::init without any parsing or copying.
+  *        Offline tools should run MeshOptimizer on the mesh before write(), as
+  *        ModelLoader does when setOptimizeMesh is enabled, so the cached arrays
+  *        are already in cache order.
+  *        Caches written with compression hold MeshCodec streams instead; open()
+  *        decodes them once into memory owned by the MeshCache.
+  *
+  *        Layout (little-endian, every section 16-byte aligned):
+  *          TMeshHeader
+  *          TMeshSection[sectionCount]
+  *          section payloads
+*/
+class
+  MeshCache {
+public:
+  /*
+    *  @brief "TMSH" read as a little-endian uint32.
+  */
+  static const uint32_t kMagic = 0x48534D54u;
+
+  /*
+    *  @brief Bumped whenever the layout or the meaning of a section changes.
+  */
+  static const uint32_t kVersion = 5;
+
+  /*
+    *  @brief Identifies the payload of a section.
+  */
+  enum SectionType : uint32_t {
+    /*
+      *  @brief SimpleVertex array.
+    */
+    SECTION_VERTICES = 1,
+    /*
+      *  @brief 32-bit index array.
+    */
+    SECTION_INDICES = 2,
+    /*
+      *  @brief SimpleVertex array compressed with MeshCodec::encodeVertices.
+    */
+    SECTION_VERTICES_ENCODED = 3,
+    /*
+      *  @brief Index array compressed with MeshCodec::encodeIndices.
+    */
+    SECTION_INDICES_ENCODED = 4,
+    /*
+      *  @brief Meshlet array; the first level of the index section is then in
+      *         meshlet order.
+    */
+    SECTION_MESHLETS = 5,
+    /*
+      *  @brief MeshLod array; the index section then holds every level back to back.
+    */
+    SECTION_LODS = 6,
+    /*
+      *  @brief Submesh array (per-material index ranges).
+    */
+    SECTION_SUBMESHES = 7,
+    /*
+      *  @brief TMeshMaterial array referenced by the submeshes.
+      *  @note Materials are stored as resolved when the cache was written; the
+      *        cache is only checked against the model, not its .mtl files.
+    */
+    SECTION_MATERIALS = 8
+  };
+
+  /*
+    *  @brief Fixed-size record of a Material in the materials section.
+    *  @note Names and paths are zero-terminated; write() fails rather than
+    *        truncate one that does not fit.
+  */
+  struct TMeshMaterial {
+    float diffuse[4];
+    char name[64];
+    char diffuseMap[192];
+  };
+
+  /*
+    *  @brief Fixed header at the start of the file.
+  */
+  struct TMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t sectionCount;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    float boundsMin[3];
+    float boundsMax[3];
+  };
+
+  /*
+    *  @brief Directory entry describing one section of the file.
+  */
+  struct TMeshSection {
+    uint32_t type;
+    uint32_t elementCount;
+    uint64_t offset;
+    uint64_t byteSize;
+  };
+
+  /*
+    *  @brief Default constructor. No cache is mapped.
+  */
+  MeshCache() = default;
+
+  /*
+    *  @brief Default destructor. Unmaps the cache file.
+  */
+  ~MeshCache() = default;
+
+  /*
+    *  @brief Returns the cache path used for a source model ("model.obj.tmesh").
+  */
+  static std::string
+    cachePathFor(const std::string& sourcePath) { return sourcePath + ".tmesh"; }
+
+  /*
+    *  @brief Maps a cache file and checks it against its source model.
+    *  @param cachePath Path of the .tmesh file.
+    *  @param sourcePath Path of the model the cache was built from.
+    *  @param allowMissingSource Accepts the cache when the source model does not
+    *         exist, e.g. in a build shipped without its .obj files. The cache
+    *         cannot be checked for staleness then, so this is logged.
+    *  @return bool True if the cache is valid and up to date. A cache whose source
+    *          timestamp changed is still accepted when the source content hash matches.
+    *          Caches with an index outside the vertex array are rejected.
+  */
+  bool
+    open(const std::string& cachePath,
+      const std::string& sourcePath,
+      bool allowMissingSource = false);
+
+  /*
+    *  @brief Unmaps the cache file. Pointers returned earlier become invalid.
+  */
+  void
+    close();
+
+  /*
+    *  @brief Writes the mesh to a cache file tagged with its source model.
+    *  @param cachePath Path of the .tmesh file to create or replace.
+    *  @param sourcePath Path of the model the mesh was built from.
+    *  @param mesh Mesh holding the final vertex and index arrays.
+    *  @param compress Stores MeshCodec streams instead of the raw arrays. The file
+    *         is about half the size (2-2.3x smaller on an optimized sphere), but
+    *         open() has to decode it instead of mapping it. Off by default, and
+    *         ModelLoader only compresses when setCompressMeshCache asks for it.
+    *  @return bool True if the file was written.
+  */
+  static bool
+    write(const std::string& cachePath,
+      const std::string& sourcePath,
+      const MeshComponent& mesh,
+      bool compress = false);
+
+  /*
+    *  @brief Returns the mapped vertex array.
+  */
+  const SimpleVertex*
+    vertexData() const { return m_vertices; }
+
+  /*
+    *  @brief Returns the mapped index array.
+  */
+  const unsigned int*
+    indexData() const { return m_indices; }
+
+  /*
+    *  @brief Returns the mapped meshlet array, or nullptr if the cache has none.
+  */
+  const Meshlet*
+    meshletData() const { return m_meshlets; }
+
+  /*
+    *  @brief Number of meshlets in the mapped cache.
+  */
+  unsigned int
+    meshletCount() const { return m_meshletCount; }
+
+  /*
+    *  @brief Returns the mapped LOD array, or nullptr if the cache has none.
+  */
+  const MeshLod*
+    lodData() const { return m_lods; }
+
+  /*
+    *  @brief Number of levels in the mapped cache.
+  */
+  unsigned int
+    lodCount() const { return m_lodCount; }
+
+  /*
+    *  @brief Returns the mapped submesh array, or nullptr if the cache has none.
+  */
+  const Submesh*
+    submeshData() const { return m_submeshes; }
+
+  /*
+    *  @brief Number of submeshes in the mapped cache.
+  */
+  unsigned int
+    submeshCount() const { return m_submeshCount; }
+
+  /*
+    *  @brief Copies the materials of the mapped cache.
+    *  @param outMaterials Receives one Material per record (replaces its content).
+  */
+  void
+    readMaterials(std::vector<Material>& outMaterials) const;
+
+  /*
+    *  @brief Number of vertices in the mapped cache.
+  */
+  unsigned int
+    vertexCount() const { return m_vertexCount; }
+
+  /*
+    *  @brief Number of indices in the mapped cache.
+  */
+  unsigned int
+    indexCount() const { return m_indexCount; }
+
+  /*
+    *  @brief Returns the header of the mapped cache, or nullptr when closed.
+  */
+  const TMeshHeader*
+    header() const { return m_header; }
+
+private:
+  /*
+    *  @brief Reads size and last write time of the source model.
+    *  @return bool False if the source does not exist.
+  */
+  static bool
+    getSourceStamp(const std::string& sourcePath, uint64_t& outSize, int64_t& outTime);
+
+  /*
+    *  @brief Hashes the whole content of the source model.
+  */
+  static bool
+    hashSource(const std::string& sourcePath, uint64_t& outHash);
+
+  /*
+    *  @brief Returns the payload of a section after checking it fits the file.
+    *  @param elementSize Expected size of one element, or 0 for encoded sections
+    *         whose byte size is unrelated to their element count.
+    *  @param outByteSize Optionally receives the size of the payload.
+  */
+  const void*
+    findSection(uint32_t type, uint64_t elementSize, uint32_t& outCount,
+      uint64_t* outByteSize = nullptr) const;
+
+  /*
+    *  @brief Decodes the compressed sections into m_decodedVertices / m_decodedIndices.
+    *  @return bool False if the file has no compressed sections or they are malformed.
+  */
+  bool
+    decodeSections();
+
+private:
+  /*
+    *  @brief Mapping of the cache file.
+  */
+  MappedFile m_file;
+
+  /*
+    *  @brief Header of the mapped file.
+  */
+  const TMeshHeader* m_header = nullptr;
+
+  /*
+    *  @brief Vertex section of the mapped file.
+  */
+  const SimpleVertex* m_vertices = nullptr;
+
+  /*
+    *  @brief Index section of the mapped file.
+  */
+  const unsigned int* m_indices = nullptr;
+
+  /*
+    *  @brief Meshlet section of the mapped file (optional).
+  */
+  const Meshlet* m_meshlets = nullptr;
+
+  /*
+    *  @brief Number of meshlets in the meshlet section.
+  */
+  unsigned int m_meshletCount = 0;
+
+  /*
+    *  @brief LOD section of the mapped file (optional).
+  */
+  const MeshLod* m_lods = nullptr;
+
+  /*
+    *  @brief Number of levels in the LOD section.
+  */
+  unsigned int m_lodCount = 0;
+
+  /*
+    *  @brief Submesh section of the mapped file (optional).
+  */
+  const Submesh* m_submeshes = nullptr;
+
+  /*
+    *  @brief Number of submeshes in the submesh section.
+  */
+  unsigned int m_submeshCount = 0;
+
+  /*
+    *  @brief Materials section of the mapped file (required with submeshes).
+  */
+  const TMeshMaterial* m_materials = nullptr;
+
+  /*
+    *  @brief Number of records in the materials section.
+  */
+  unsigned int m_materialCount = 0;
+
+  /*
+    *  @brief Decoded vertices when the cache was written compressed.
+  */
+  std::vector<SimpleVertex> m_decodedVertices;
+
+  /*
+    *  @brief Decoded indices when the cache was written compressed.
+  */
+  std::vector<unsigned int> m_decodedIndices;
+
+  /*
+    *  @brief Number of vertices in the vertex section.
+  */
+  unsigned int m_vertexCount = 0;
+
+  /*
+    *  @brief Number of indices in the index section.
+  */
+  unsigned int m_indexCount = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+  *  @brief Lossless compression of index and vertex buffers for on-disk meshes.
+  *  @note Index buffers are coded per triangle against a FIFO of recently seen
+  *        edges and a FIFO of recently seen vertices, so a triangle that shares an
+  *        edge with a recent one costs a single byte plus two bits of rotation.
+  *        Vertex buffers are coded in blocks of 16 vertices: every byte lane of the
+  *        vertex is delta coded against the previous vertex and bit packed to
+  *        0, 2, 4 or 8 bits, and the decoder rebuilds 16 vertices per lane with SSE2.
+  *        The index decoder stays scalar: every triangle reads the FIFOs the
+  *        previous one wrote, so there is no independent work to put in SIMD
+  *        lanes. It runs at about 1-1.5 GB/s of decoded indices, a little under
+  *        the vertex decoder; MeshCodecBenchmark reports both.
+  *        Both codecs work best on meshes that went through MeshOptimizer.
+  *        Only depends on the standard library so tools can use it on Linux.
+*/
+class
+  MeshCodec {
+public:
+  /*
+    *  @brief First byte of an encoded index stream.
+  */
+  static const uint8_t kIndexVersion = 0xE1;
+
+  /*
+    *  @brief First byte of an encoded vertex stream.
+  */
+  static const uint8_t kVertexVersion = 0xA1;
+
+  /*
+    *  @brief Encodes a triangle list.
+    *  @param indices Triangle list to encode.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param outData Receives the encoded stream (replaces its content).
+    *  @return bool False if indexCount is not a multiple of 3.
+  */
+  static bool
+    encodeIndices(const unsigned int* indices, size_t indexCount, std::vector<unsigned char>& outData);
+
+  /*
+    *  @brief Decodes a triangle list written by encodeIndices.
+    *  @param destination Memory receiving indexCount indices (e.g. the buffer later
+    *         passed to Buffer::init).
+    *  @param indexCount Number of indices that were encoded.
+    *  @param data Encoded stream.
+    *  @param size Size of the encoded stream in bytes.
+    *  @return bool False if the stream is malformed or truncated.
+  */
+  static bool
+    decodeIndices(unsigned int* destination, size_t indexCount, const unsigned char* data, size_t size);
+
+  /*
+    *  @brief Encodes an array of fixed-size vertices.
+    *  @param vertices First vertex.
+    *  @param vertexCount Number of vertices.
+    *  @param stride Size of one vertex in bytes (1 - 256).
+    *  @param outData Receives the encoded stream (replaces its content).
+    *  @return bool False if the stride is out of range.
+  */
+  static bool
+    encodeVertices(const void* vertices, size_t vertexCount, size_t stride, std::vector<unsigned char>& outData);
+
+  /*
+    *  @brief Decodes a vertex array written by encodeVertices.
+    *  @param destination Memory receiving vertexCount * stride bytes.
+    *  @param vertexCount Number of vertices that were encoded.
+    *  @param stride Size of one vertex in bytes, as passed to encodeVertices.
+    *  @param data Encoded stream.
+    *  @param size Size of the encoded stream in bytes.
+    *  @return bool False if the stream is malformed or truncated.
+  */
+  static bool
+    decodeVertices(void* destination, size_t vertexCount, size_t stride, const unsigned char* data, size_t size);
+
+  /*
+    *  @brief Largest index count an index stream of size bytes can hold.
+    *  @note Every triangle takes at least one code byte. Counts read from a file
+    *        are checked against this before the destination is allocated.
+  */
+  static size_t
+    maxIndexCount(size_t size);
+
+  /*
+    *  @brief Largest vertex count a vertex stream of size bytes can hold.
+    *  @note Every block of 16 vertices takes at least its lane header.
+    *  @return size_t 0 if the stride is out of range.
+  */
+  static size_t
+    maxVertexCount(size_t stride, size_t size);
+};
@@ -1,5 +1,9 @@
 #pragma once
-#include "Prerequisites.h"
+#include "CorePrerequisites.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include "Submesh.h"
+#include "Material.h"
 
 /*
   *  @brief Forward declaration of DeviceContext class.
@@ -16,7 +20,11 @@ public:
   /*
     *  @brief Default constructor. Initializes vertex and index counts to zero.
   */
-  MeshComponent() : m_numVertex(0), m_numIndex(0) {}
+  MeshComponent()
+    : m_numVertex(0),
+      m_numIndex(0),
+      m_boundsMin(0.0f, 0.0f, 0.0f),
+      m_boundsMax(0.0f, 0.0f, 0.0f) {}
 
   /*
     *  @brief Virtual destructor for MeshComponent.
@@ -50,6 +58,19 @@ public:
   void
     destroy();
 
+  /*
+    *  @brief Moves the texture coordinates of each material into its rectangle
+    *         of a texture atlas: uv' = uv * (x, y) + (z, w). Call before the
+    *         vertex buffer is created.
+    *  @param transforms One scale and offset per material (a single one when
+    *         the mesh has no submeshes), e.g. from TextureAtlas::AtlasEntry.
+    *  @return bool False, leaving the vertices untouched, if a vertex is shared
+    *          by materials with different transforms or a coordinate lies
+    *          outside [0, 1] (a tiled texture cannot share a page).
+  */
+  bool
+    remapTexCoords(const std::vector<XMFLOAT4>& transforms);
+
 public:
   
   /*
@@ -75,4 +96,37 @@ public:
     *  @brief Number of indices in the mesh.
   */
   int m_numIndex;
+
+  /*
+    *  @brief Minimum corner of the axis-aligned bounding box of the vertices.
+  */
+  XMFLOAT3 m_boundsMin;
+
+  /*
+    *  @brief Maximum corner of the axis-aligned bounding box of the vertices.
+  */
+  XMFLOAT3 m_boundsMax;
+
+  /*
+    *  @brief Clusters covering the index buffer, empty if none were built (see MeshletBuilder).
+  */
+  std::vector<Meshlet> m_meshlets;
+
+  /*
+    *  @brief Levels of detail, finest first, empty if none were built (see MeshSimplifier).
+    *  @note When present, m_index holds every level one after the other and
+    *        m_numIndex counts them all; draw a level's range, not m_numIndex.
+  */
+  std::vector<MeshLod> m_lods;
+
+  /*
+    *  @brief Per-material index ranges of every level, sorted by offset; empty
+    *         if the model uses no materials and is drawn with a single one.
+  */
+  std::vector<Submesh> m_submeshes;
+
+  /*
+    *  @brief Materials referenced by m_submeshes, in order of first use.
+  */
+  std::vector<Material> m_materials;
 };
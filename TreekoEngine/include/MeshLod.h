@@ -0,0 +1,25 @@
+#pragma once
+#include "CorePrerequisites.h"
+
+/*
+  *  @brief One level of detail of a mesh: a contiguous range of the mesh index
+  *         buffer that draws the whole mesh with fewer triangles.
+  *  @note Every level indexes the same vertex buffer. The layout is written as is
+  *        to the .tmesh cache (see MeshCache).
+*/
+struct MeshLod
+{
+  /*
+    *  @brief First index of the level in the mesh index buffer.
+  */
+  unsigned int indexOffset;
+  /*
+    *  @brief Number of indices in the level.
+  */
+  unsigned int indexCount;
+  /*
+    *  @brief Largest deviation from the full-resolution surface, in model units
+    *         (0 for the full-resolution level).
+  */
+  float error;
+};
@@ -0,0 +1,290 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  *  @brief Post-transform vertex cache statistics of a triangle list.
+*/
+struct VertexCacheStats {
+  /*
+    *  @brief Vertices transformed (cache misses) while drawing the list.
+  */
+  unsigned int transformedVertices = 0;
+
+  /*
+    *  @brief Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0).
+  */
+  float acmr = 0.0f;
+
+  /*
+    *  @brief Average transform to vertex ratio: transformed vertices per vertex (1.0 is optimal).
+  */
+  float atvr = 0.0f;
+};
+
+/*
+  *  @brief Overdraw measured by rasterizing a mesh on the CPU.
+*/
+struct OverdrawStats {
+  /*
+    *  @brief Pixels covered by at least one triangle, summed over every view.
+  */
+  unsigned int pixelsCovered = 0;
+
+  /*
+    *  @brief Pixels that passed the depth test (were shaded), summed over every view.
+  */
+  unsigned int pixelsShaded = 0;
+
+  /*
+    *  @brief Shaded per covered pixel (1.0 means no overdraw).
+  */
+  float overdraw = 0.0f;
+};
+
+/*
+  *  @brief CPU mesh optimization pass run before a mesh is uploaded or cached.
+  *  @note Triangles are reordered with Tom Forsyth's linear-speed vertex cache
+  *        optimization, then split into clusters that are sorted so the ones
+  *        likely to occlude the rest are drawn first, and finally vertices are
+  *        reordered by first use so the vertex fetch walks the buffer forward.
+  *        None of the steps changes the rendered mesh.
+  *        Scratch storage is kept between calls, so optimizing many meshes with
+  *        the same object only allocates for the largest one.
+*/
+class
+  MeshOptimizer {
+public:
+
+  /*
+    *  @brief Results of the last call to optimize.
+  */
+  struct OptimizeStats {
+    /*
+      *  @brief Cache statistics of the mesh as it was passed in.
+    */
+    VertexCacheStats before;
+    /*
+      *  @brief Cache statistics of the optimized mesh.
+    */
+    VertexCacheStats after;
+    /*
+      *  @brief Overdraw before the pass; only filled when setMeasureOverdraw is on.
+    */
+    OverdrawStats overdrawBefore;
+    /*
+      *  @brief Overdraw after the pass; only filled when setMeasureOverdraw is on.
+    */
+    OverdrawStats overdrawAfter;
+    /*
+      *  @brief Wall time spent optimizing, in milliseconds.
+    */
+    double optimizeMs = 0.0;
+  };
+
+  /*
+    *  @brief FIFO size used for the reported statistics, close to the post-transform
+    *         cache of current desktop GPUs.
+  */
+  static const unsigned int kAnalyzeCacheSize = 16;
+
+  /*
+    *  @brief Resolution of each view rasterized by analyzeOverdraw.
+  */
+  static const int kOverdrawViewport = 256;
+
+  /*
+    *  @brief Default constructor for MeshOptimizer.
+  */
+  MeshOptimizer() = default;
+
+  /*
+    *  @brief Default destructor for MeshOptimizer.
+  */
+  ~MeshOptimizer() = default;
+
+  /*
+    *  @brief Reorders the triangles and vertices of a mesh and records before/after statistics.
+    *  @param mesh The mesh to optimize in place. m_numVertex and m_numIndex are updated;
+    *         vertices no triangle references are dropped. Triangles never
+    *         leave their submesh, so material ranges stay valid.
+    *  @return bool False if the index list is not a valid triangle list.
+  */
+  bool
+    optimize(MeshComponent& mesh);
+
+  /*
+    *  @brief Reorders the triangles of an index list for post-transform cache locality.
+    *  @param indices Triangle list to reorder in place.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param vertexCount Number of vertices the indices refer to.
+  */
+  void
+    optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+  /*
+    *  @brief Reorders the triangle clusters of a cache-optimized list to reduce overdraw.
+    *  @param indices Triangle list to reorder in place, ideally already in cache order.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param vertices Vertices the indices refer to.
+    *  @param vertexCount Number of vertices.
+    *  @param threshold Allowed ACMR growth, e.g. 1.05 trades up to 5% more vertex
+    *         transforms for smaller clusters and therefore better sorting.
+  */
+  void
+    optimizeOverdraw(unsigned int* indices,
+      size_t indexCount,
+      const SimpleVertex* vertices,
+      size_t vertexCount,
+      float threshold);
+
+  /*
+    *  @brief Reorders vertices by first use in the index list and remaps the indices.
+    *  @param vertices Vertex array to reorder. Unreferenced vertices are dropped.
+    *  @param indices Index list to remap.
+  */
+  void
+    optimizeVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices);
+
+  /*
+    *  @brief Simulates a FIFO post-transform cache over a triangle list.
+    *  @param indices Triangle list.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param vertexCount Number of vertices the indices refer to.
+    *  @param cacheSize Number of entries of the simulated cache.
+  */
+  static VertexCacheStats
+    analyzeVertexCache(const unsigned int* indices,
+      size_t indexCount,
+      size_t vertexCount,
+      unsigned int cacheSize = kAnalyzeCacheSize);
+
+  /*
+    *  @brief Rasterizes a triangle list from the six axis directions and counts overdraw.
+    *  @note Back faces are culled. Which side is the front is taken from the sign of
+    *        the mesh's volume, so the result does not depend on the winding convention.
+    *  @param indices Triangle list, drawn in order with early depth testing.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param vertices Vertices the indices refer to.
+    *  @param vertexCount Number of vertices.
+  */
+  static OverdrawStats
+    analyzeOverdraw(const unsigned int* indices,
+      size_t indexCount,
+      const SimpleVertex* vertices,
+      size_t vertexCount);
+
+  /*
+    *  @brief Sets the ACMR growth allowed by the overdraw pass. Below 1 the pass is skipped.
+  */
+  void
+    setOverdrawThreshold(float threshold) { m_overdrawThreshold = threshold; }
+
+  /*
+    *  @brief Enables measuring overdraw before and after optimize (costs six rasterizations).
+  */
+  void
+    setMeasureOverdraw(bool measureOverdraw) { m_measureOverdraw = measureOverdraw; }
+
+  /*
+    *  @brief Returns the statistics of the last call to optimize.
+  */
+  const OptimizeStats&
+    getLastStats() const { return m_lastStats; }
+
+private:
+  /*
+    *  @brief Forsyth score of a vertex from its cache position (-1 if not cached)
+    *         and the number of triangles still waiting to use it.
+  */
+  static float
+    vertexScore(int cachePosition, unsigned int activeTriangles);
+
+  /*
+    *  @brief Splits a triangle list into clusters whose own ACMR stays within threshold
+    *         of the ACMR of the surrounding patch.
+    *  @param outClusters Receives the first triangle of every cluster.
+  */
+  void
+    buildClusters(const unsigned int* indices,
+      size_t triangleCount,
+      size_t vertexCount,
+      float threshold,
+      std::vector<unsigned int>& outClusters);
+
+private:
+  /*
+    *  @brief Statistics of the last call to optimize.
+  */
+  OptimizeStats m_lastStats;
+
+  /*
+    *  @brief ACMR growth allowed by the overdraw pass.
+  */
+  float m_overdrawThreshold = 1.05f;
+
+  /*
+    *  @brief True to run analyzeOverdraw before and after optimize.
+  */
+  bool m_measureOverdraw = false;
+
+  /*
+    *  @brief Triangles not yet emitted per vertex.
+  */
+  std::vector<unsigned int> m_activeTriangles;
+
+  /*
+    *  @brief Start of each vertex's range in m_adjacency.
+  */
+  std::vector<unsigned int> m_adjacencyOffset;
+
+  /*
+    *  @brief Triangles using each vertex; the first m_activeTriangles[v] of a range are live.
+  */
+  std::vector<unsigned int> m_adjacency;
+
+  /*
+    *  @brief Current score per vertex.
+  */
+  std::vector<float> m_vertexScore;
+
+  /*
+    *  @brief Position of each vertex in the simulated LRU cache, -1 if not cached.
+  */
+  std::vector<int> m_cachePosition;
+
+  /*
+    *  @brief True once a triangle has been emitted.
+  */
+  std::vector<unsigned char> m_emitted;
+
+  /*
+    *  @brief Copy of the input triangles while the output is written in place.
+  */
+  std::vector<unsigned int> m_sourceIndices;
+
+  /*
+    *  @brief Old to new vertex index while reordering for fetch.
+  */
+  std::vector<unsigned int> m_remap;
+
+  /*
+    *  @brief FIFO load time per vertex while clustering.
+  */
+  std::vector<unsigned int> m_cacheTimestamp;
+
+  /*
+    *  @brief First triangle of each cluster, then the triangle count as an end marker.
+  */
+  std::vector<unsigned int> m_clusters;
+
+  /*
+    *  @brief Cluster indices sorted by occlusion likelihood.
+  */
+  std::vector<unsigned int> m_clusterOrder;
+
+  /*
+    *  @brief Sort key of each cluster.
+  */
+  std::vector<float> m_clusterKey;
+};
@@ -0,0 +1,229 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  *  @brief Edge-collapse mesh simplification driven by quadric error metrics.
+  *  @note Each vertex accumulates the planes of its triangles (Garland-Heckbert)
+  *        plus attribute quadrics for its normal and UV (Hoppe), and edges are
+  *        collapsed in passes, cheapest first, onto one of their end points, so
+  *        simplified levels reuse the original vertex buffer.
+  *        Vertices that share a position but not their attributes form seams:
+  *        they only collapse along the seam, together with their twin, so UV
+  *        and normal discontinuities keep their shape. Open borders only
+  *        collapse along the border, and vertices where three or more attribute
+  *        sets meet (e.g. box corners) never move. Collapses that would flip a
+  *        triangle are rejected.
+  *        Scratch storage is kept between calls, like MeshOptimizer.
+*/
+class
+  MeshSimplifier {
+public:
+
+  /*
+    *  @brief Results of the last call to buildLodChain.
+  */
+  struct LodStats {
+    /*
+      *  @brief Levels in the chain, including the full-resolution one.
+    */
+    unsigned int levels = 0;
+    /*
+      *  @brief Indices added to the index buffer for the simplified levels.
+    */
+    size_t addedIndices = 0;
+    /*
+      *  @brief Wall time spent simplifying, in milliseconds.
+    */
+    double buildMs = 0.0;
+  };
+
+  /*
+    *  @brief Default number of levels built by buildLodChain (including level 0).
+  */
+  static const unsigned int kDefaultLodCount = 5;
+
+  /*
+    *  @brief Default constructor for MeshSimplifier.
+  */
+  MeshSimplifier() = default;
+
+  /*
+    *  @brief Default destructor for MeshSimplifier.
+  */
+  ~MeshSimplifier() = default;
+
+  /*
+    *  @brief Simplifies a triangle list.
+    *  @param indices Triangle list to simplify.
+    *  @param indexCount Number of indices (a multiple of 3).
+    *  @param vertices Vertex array the indices refer to.
+    *  @param vertexCount Number of vertices.
+    *  @param targetIndexCount Stops once the list has at most this many indices.
+    *  @param targetError Stops before a collapse whose error, relative to the mesh
+    *         extent, is above this value (e.g. 0.01 for 1%).
+    *  @param outIndices Receives the simplified list (indices into the same vertices).
+    *  @return size_t Number of indices written to outIndices.
+  */
+  size_t
+    simplify(const unsigned int* indices,
+      size_t indexCount,
+      const SimpleVertex* vertices,
+      size_t vertexCount,
+      size_t targetIndexCount,
+      float targetError,
+      std::vector<unsigned int>& outIndices);
+
+  /*
+    *  @brief Geometric error of the last call to simplify, in model units.
+  */
+  float
+    getLastError() const { return m_lastError; }
+
+  /*
+    *  @brief Appends a chain of simplified levels to the mesh index buffer.
+    *  @param mesh Mesh whose m_index currently holds level 0. The levels are
+    *         appended to m_index and described in m_lods; m_numIndex is updated.
+    *         When the mesh has submeshes, every level gets its own material
+    *         ranges in m_submeshes.
+    *  @return bool False if the index list is not a valid triangle list.
+    *  @note Each level targets setLodRatio times the triangles of the previous
+    *        one and is simplified from it; the chain stops early when the mesh
+    *        cannot be reduced any further.
+  */
+  bool
+    buildLodChain(MeshComponent& mesh);
+
+  /*
+    *  @brief Sets the number of levels built by buildLodChain (including level 0).
+  */
+  void
+    setLodCount(unsigned int lodCount) { m_lodCount = lodCount; }
+
+  /*
+    *  @brief Sets the triangle ratio between consecutive levels (default 0.5).
+  */
+  void
+    setLodRatio(float lodRatio) { m_lodRatio = lodRatio; }
+
+  /*
+    *  @brief Returns the statistics of the last call to buildLodChain.
+  */
+  const LodStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Picks the coarsest level whose error stays under a pixel budget.
+    *  @param lods Levels of the mesh, finest first.
+    *  @param distance Distance from the camera to the nearest point of the mesh
+    *         bounds, in model units.
+    *  @param pixelsPerUnit Pixels covered by one model unit at distance 1
+    *         (projection _22 * viewport height / 2, times the world scale).
+    *  @param maxPixelError Largest error allowed on screen, in pixels.
+    *  @return unsigned int Index of the level to draw (0 if lods is empty).
+  */
+  static unsigned int
+    selectLod(const std::vector<MeshLod>& lods,
+      float distance,
+      float pixelsPerUnit,
+      float maxPixelError);
+
+private:
+  /*
+    *  @brief Levels built by buildLodChain.
+  */
+  unsigned int m_lodCount = kDefaultLodCount;
+
+  /*
+    *  @brief Triangle ratio between consecutive levels.
+  */
+  float m_lodRatio = 0.5f;
+
+  /*
+    *  @brief Geometric error of the last call to simplify.
+  */
+  float m_lastError = 0.0f;
+
+  /*
+    *  @brief Statistics of the last call to buildLodChain.
+  */
+  LodStats m_lastStats;
+
+  /*
+    *  @brief Positions scaled to the unit cube.
+  */
+  std::vector<XMFLOAT3> m_positions;
+
+  /*
+    *  @brief First vertex with the same position as each vertex.
+  */
+  std::vector<unsigned int> m_remap;
+
+  /*
+    *  @brief Next vertex with the same position (circular list).
+  */
+  std::vector<unsigned int> m_wedge;
+
+  /*
+    *  @brief Topological kind of every vertex (manifold, border, seam, locked).
+  */
+  std::vector<unsigned char> m_kind;
+
+  /*
+    *  @brief Other end of the single open edge leaving / entering each vertex.
+  */
+  std::vector<unsigned int> m_openOut;
+  std::vector<unsigned int> m_openIn;
+
+  /*
+    *  @brief Open edges before the current pass, while they are remapped.
+  */
+  std::vector<unsigned int> m_previousOpenOut;
+  std::vector<unsigned int> m_previousOpenIn;
+
+  /*
+    *  @brief Position quadric of every position (indexed by m_remap) and
+    *         attribute quadric of every vertex, as flat float arrays.
+  */
+  std::vector<float> m_positionQuadrics;
+  std::vector<float> m_attributeQuadrics;
+
+  /*
+    *  @brief Start of each position's triangle list in m_adjacency.
+  */
+  std::vector<unsigned int> m_adjacencyOffset;
+
+  /*
+    *  @brief Triangles using each position, grouped per position.
+  */
+  std::vector<unsigned int> m_adjacency;
+
+  /*
+    *  @brief Candidate collapses of the current pass.
+  */
+  std::vector<unsigned int> m_collapseSource;
+  std::vector<unsigned int> m_collapseTarget;
+  std::vector<float> m_collapseError;
+  std::vector<float> m_collapseGeometricError;
+  std::vector<unsigned int> m_collapseOrder;
+
+  /*
+    *  @brief Where every vertex goes in the current pass.
+  */
+  std::vector<unsigned int> m_collapseRemap;
+
+  /*
+    *  @brief Positions already touched by a collapse in the current pass.
+  */
+  std::vector<unsigned char> m_locked;
+
+  /*
+    *  @brief Working copy of the triangle list.
+  */
+  std::vector<unsigned int> m_indices;
+
+  /*
+    *  @brief Input triangle each triangle of m_indices comes from.
+  */
+  std::vector<unsigned int> m_triangleSource;
+};
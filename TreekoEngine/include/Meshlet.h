@@ -0,0 +1,40 @@
+#pragma once
+#include "CorePrerequisites.h"
+
+/*
+  *  @brief A small cluster of triangles stored as one contiguous range of the
+  *         mesh index buffer, with the bounds used to cull it.
+  *  @note The layout is written as is to the .tmesh cache (see MeshCache).
+*/
+struct Meshlet
+{
+  /*
+    *  @brief First index of the cluster in the mesh index buffer.
+  */
+  unsigned int indexOffset;
+  /*
+    *  @brief Number of indices in the cluster (three per triangle).
+  */
+  unsigned int indexCount;
+  /*
+    *  @brief Number of unique vertices the cluster references.
+  */
+  unsigned int vertexCount;
+  /*
+    *  @brief Center of the bounding sphere, in model space.
+  */
+  XMFLOAT3 center;
+  /*
+    *  @brief Radius of the bounding sphere.
+  */
+  float radius;
+  /*
+    *  @brief Average front-face normal of the triangles (unit length).
+  */
+  XMFLOAT3 coneAxis;
+  /*
+    *  @brief Sine of the widest angle between coneAxis and a triangle normal.
+    *         1.0 means the normals are too spread out for back-face culling.
+  */
+  float coneCutoff;
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "MeshComponent.h"
+
+/*
+  *  @brief Splits a mesh into meshlets and computes their culling bounds.
+  *  @note Clusters grow greedily across shared vertices, preferring triangles
+  *        that add no new vertex, then ones that close off vertices, then the
+  *        normal closest to the cluster cone, until the vertex or triangle limit
+  *        is reached. The index buffer is reordered so every meshlet is one
+  *        contiguous range that can be drawn with a single DrawIndexed call.
+  *        Triangle normals follow the default D3D11 rasterizer state (clockwise
+  *        front faces), so the cones only reject what the GPU would cull anyway.
+  *        Scratch storage is kept between calls, like MeshOptimizer.
+*/
+class
+  MeshletBuilder {
+public:
+
+  /*
+    *  @brief Results of the last call to build.
+  */
+  struct BuildStats {
+    /*
+      *  @brief Number of meshlets produced.
+    */
+    unsigned int meshletCount = 0;
+    /*
+      *  @brief Average number of triangles per meshlet.
+    */
+    float averageTriangles = 0.0f;
+    /*
+      *  @brief Average number of unique vertices per meshlet.
+    */
+    float averageVertices = 0.0f;
+    /*
+      *  @brief Meshlets whose normals are too spread out to be back-face culled.
+    */
+    unsigned int wideCones = 0;
+    /*
+      *  @brief Wall time spent building, in milliseconds.
+    */
+    double buildMs = 0.0;
+  };
+
+  /*
+    *  @brief Default vertex limit, the usual mesh shader group size.
+  */
+  static const unsigned int kDefaultMaxVertices = 64;
+
+  /*
+    *  @brief Default triangle limit.
+  */
+  static const unsigned int kDefaultMaxTriangles = 124;
+
+  /*
+    *  @brief Default constructor for MeshletBuilder.
+  */
+  MeshletBuilder() = default;
+
+  /*
+    *  @brief Default destructor for MeshletBuilder.
+  */
+  ~MeshletBuilder() = default;
+
+  /*
+    *  @brief Builds the meshlets of a mesh.
+    *  @param mesh The mesh whose m_index is reordered in place and whose
+    *         m_meshlets receives one entry per cluster. Triangles keep their
+    *         order inside a cluster, so a cache-optimized mesh stays cache friendly.
+    *         A cluster never spans two submeshes, and the submesh ranges are unchanged.
+    *  @return bool False if the index list is not a valid triangle list.
+  */
+  bool
+    build(MeshComponent& mesh);
+
+  /*
+    *  @brief Sets the largest number of unique vertices per meshlet (3 - 256).
+  */
+  void
+    setMaxVertices(unsigned int maxVertices) { m_maxVertices = maxVertices; }
+
+  /*
+    *  @brief Sets the largest number of triangles per meshlet (1 - 512).
+  */
+  void
+    setMaxTriangles(unsigned int maxTriangles) { m_maxTriangles = maxTriangles; }
+
+  /*
+    *  @brief Returns the statistics of the last call to build.
+  */
+  const BuildStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Computes the bounding sphere and normal cone of a range of triangles.
+    *  @param indices Triangle list.
+    *  @param vertices Vertex array the indices refer to.
+    *  @param outMeshlet Meshlet whose indexOffset and indexCount select the range;
+    *         its center, radius, coneAxis and coneCutoff are filled.
+  */
+  static void
+    computeBounds(const unsigned int* indices,
+      const SimpleVertex* vertices,
+      Meshlet& outMeshlet);
+
+private:
+  /*
+    *  @brief Limit of unique vertices per meshlet.
+  */
+  unsigned int m_maxVertices = kDefaultMaxVertices;
+
+  /*
+    *  @brief Limit of triangles per meshlet.
+  */
+  unsigned int m_maxTriangles = kDefaultMaxTriangles;
+
+  /*
+    *  @brief Statistics of the last call to build.
+  */
+  BuildStats m_lastStats;
+
+  /*
+    *  @brief Start of each vertex's list in m_adjacency (vertexCount + 1 entries).
+  */
+  std::vector<unsigned int> m_adjacencyOffset;
+
+  /*
+    *  @brief Triangles using each vertex, grouped per vertex.
+  */
+  std::vector<unsigned int> m_adjacency;
+
+  /*
+    *  @brief Unit front-face normal of every triangle.
+  */
+  std::vector<XMFLOAT3> m_triangleNormals;
+
+  /*
+    *  @brief Triangles of each vertex not placed in a meshlet yet.
+  */
+  std::vector<unsigned int> m_liveTriangles;
+
+  /*
+    *  @brief Submesh of every triangle; clusters only grow inside one.
+  */
+  std::vector<unsigned int> m_triangleGroup;
+
+  /*
+    *  @brief True once a triangle has been placed in a meshlet.
+  */
+  std::vector<unsigned char> m_emitted;
+
+  /*
+    *  @brief Meshlet that last used each vertex, to count new vertices in O(1).
+  */
+  std::vector<unsigned int> m_vertexTag;
+
+  /*
+    *  @brief Meshlet that last listed each triangle as a candidate.
+  */
+  std::vector<unsigned int> m_candidateTag;
+
+  /*
+    *  @brief Triangles adjacent to the meshlet being grown.
+  */
+  std::vector<unsigned int> m_candidates;
+
+  /*
+    *  @brief Reordered index list, copied back into the mesh at the end.
+  */
+  std::vector<unsigned int> m_orderedIndices;
+};
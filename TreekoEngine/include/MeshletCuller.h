@@ -0,0 +1,164 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "Meshlet.h"
+
+/*
+  *  @brief A contiguous range of the index buffer to draw with DrawIndexed.
+*/
+struct MeshletDrawRange
+{
+  /*
+    *  @brief First index of the range (StartIndexLocation).
+  */
+  unsigned int indexOffset;
+  /*
+    *  @brief Number of indices in the range (IndexCount).
+  */
+  unsigned int indexCount;
+};
+
+/*
+  *  @brief Per-frame CPU culling of the meshlets of one mesh.
+  *  @note The bounds are kept as structure-of-arrays so four meshlets are tested
+  *        per SSE2 iteration against the six frustum planes and their normal
+  *        cone. Culling happens in model space: the frustum planes are read from
+  *        the world-view-projection matrix and the camera is passed in model space,
+  *        so the bounds never have to be transformed.
+  *        Adjacent visible meshlets are merged into one draw range, so a mesh
+  *        that is entirely visible is still drawn with a single call; see
+  *        setMergeGap for bridging small culled gaps.
+*/
+class
+  MeshletCuller {
+public:
+
+  /*
+    *  @brief Results of the last call to cull.
+  */
+  struct CullStats {
+    /*
+      *  @brief Meshlets tested.
+    */
+    unsigned int meshlets = 0;
+    /*
+      *  @brief Meshlets outside the view frustum.
+    */
+    unsigned int frustumCulled = 0;
+    /*
+      *  @brief Meshlets inside the frustum whose triangles all face away.
+    */
+    unsigned int backfaceCulled = 0;
+    /*
+      *  @brief Triangles in the emitted ranges, including bridged gaps.
+    */
+    unsigned int visibleTriangles = 0;
+    /*
+      *  @brief Number of ranges emitted (draw calls).
+    */
+    unsigned int drawRanges = 0;
+    /*
+      *  @brief Wall time spent culling, in milliseconds.
+    */
+    double cullMs = 0.0;
+  };
+
+  /*
+    *  @brief Default number of culled triangles drawn anyway to save a draw call.
+  */
+  static const unsigned int kDefaultMergeGap = 128;
+
+  /*
+    *  @brief Default constructor for MeshletCuller.
+  */
+  MeshletCuller() = default;
+
+  /*
+    *  @brief Default destructor for MeshletCuller.
+  */
+  ~MeshletCuller() = default;
+
+  /*
+    *  @brief Copies the bounds of a mesh's meshlets into the culling layout.
+    *  @param meshlets Meshlets of the mesh, in index buffer order.
+  */
+  void
+    init(const std::vector<Meshlet>& meshlets);
+
+  /*
+    *  @brief Tests every meshlet and emits the index ranges left to draw.
+    *  @param worldViewProjection Row-vector world * view * projection matrix of the mesh.
+    *  @param cameraPosition Eye position in the model space of the mesh.
+    *  @param outRanges Receives the visible ranges (replaces its content).
+  */
+  void
+    cull(const XMFLOAT4X4& worldViewProjection,
+      const XMFLOAT3& cameraPosition,
+      std::vector<MeshletDrawRange>& outRanges);
+
+  /*
+    *  @brief Sets how many culled triangles between two visible ranges are drawn
+    *         anyway to merge the ranges into one call (0 only merges touching ranges).
+  */
+  void
+    setMergeGap(unsigned int triangles) { m_mergeGapTriangles = triangles; }
+
+  /*
+    *  @brief Returns the number of meshlets passed to init.
+  */
+  size_t
+    getMeshletCount() const { return m_meshletCount; }
+
+  /*
+    *  @brief Returns the statistics of the last call to cull.
+  */
+  const CullStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Destroys the culling data.
+  */
+  void
+    destroy();
+
+private:
+  /*
+    *  @brief Number of meshlets passed to init.
+  */
+  size_t m_meshletCount = 0;
+
+  /*
+    *  @brief Culled triangles bridged to merge two draw ranges.
+  */
+  unsigned int m_mergeGapTriangles = kDefaultMergeGap;
+
+  /*
+    *  @brief Bounding sphere centers and radii, padded to a multiple of four.
+  */
+  std::vector<float> m_centerX;
+  std::vector<float> m_centerY;
+  std::vector<float> m_centerZ;
+  std::vector<float> m_radius;
+
+  /*
+    *  @brief Normal cone axes and cutoffs, padded to a multiple of four.
+  */
+  std::vector<float> m_axisX;
+  std::vector<float> m_axisY;
+  std::vector<float> m_axisZ;
+  std::vector<float> m_cutoff;
+
+  /*
+    *  @brief Index range of every meshlet.
+  */
+  std::vector<MeshletDrawRange> m_ranges;
+
+  /*
+    *  @brief Visibility of every meshlet in the last call to cull.
+  */
+  std::vector<unsigned char> m_visible;
+
+  /*
+    *  @brief Statistics of the last call to cull.
+  */
+  CullStats m_lastStats;
+};
@@ -0,0 +1,228 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+  *  @brief Filter used to build each mip level from the previous one.
+*/
+enum MipFilter {
+  /*
+    *  @brief Averages the source texels under the footprint of each texel
+    *         (exact area weights, so odd sizes stay centered).
+  */
+  MIP_BOX = 0,
+  /*
+    *  @brief Kaiser-windowed sinc (width 3, alpha 4): sharper minification with
+    *         less aliasing than the box, at about twice the cost.
+  */
+  MIP_KAISER = 1
+};
+
+/*
+  *  @brief Builds complete mip chains for RGBA8 images on the CPU.
+  *  @note Texels are filtered in linear light: sRGB-encoded color channels are
+  *        decoded through a table, filtered in float with SSE2 (one texel per
+  *        register) and encoded back; alpha is always linear. Each level is
+  *        resampled from the float copy of the previous one, so the chain is not
+  *        re-quantized level after level. Non power of two sizes follow the D3D
+  *        rule (half, rounded down, at least 1) and edges are clamped.
+  *        Every level is split into bands of rows, and the bands of all the
+  *        images of a call run together on a ThreadPool.
+  *        Only depends on the standard library so tools can use it on Linux.
+*/
+class
+  MipGenerator {
+public:
+
+  /*
+    *  @brief An RGBA8 image with tightly packed rows.
+  */
+  struct MipImage {
+    const unsigned char* pixels = nullptr;
+    unsigned int width = 0;
+    unsigned int height = 0;
+  };
+
+  /*
+    *  @brief One level of a chain: width * 4 bytes per row, starting at offset.
+  */
+  struct MipLevel {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    size_t offset = 0;
+  };
+
+  /*
+    *  @brief Every level of an image, finest first, in a single allocation
+    *         (level 0 is a copy of the source).
+  */
+  struct MipChain {
+    std::vector<unsigned char> pixels;
+    std::vector<MipLevel> levels;
+  };
+
+  /*
+    *  @brief Results of the last call to generate.
+  */
+  struct MipStats {
+    /*
+      *  @brief Images processed and levels written (all images, level 0 included).
+    */
+    unsigned int images = 0;
+    unsigned int levels = 0;
+    /*
+      *  @brief Bytes of every chain.
+    */
+    size_t bytes = 0;
+    /*
+      *  @brief Bands run, and worker threads used (1 when run inline).
+    */
+    unsigned int bands = 0;
+    unsigned int threads = 0;
+    /*
+      *  @brief Wall time of the call, in milliseconds.
+    */
+    double generateMs = 0.0;
+  };
+
+  /*
+    *  @brief Default constructor for MipGenerator.
+  */
+  MipGenerator() = default;
+
+  /*
+    *  @brief Default destructor for MipGenerator.
+  */
+  ~MipGenerator() = default;
+
+  /*
+    *  @brief Builds the chain of one image.
+    *  @param image Source image (level 0).
+    *  @param outChain Receives the chain (replaces its content).
+    *  @param threadCount Worker threads. Zero picks one per hardware thread.
+    *  @return bool False if the image is empty.
+  */
+  bool
+    generate(const MipImage& image, MipChain& outChain, unsigned int threadCount = 0);
+
+  /*
+    *  @brief Builds the chains of several images at once.
+    *  @param images Source images.
+    *  @param imageCount Number of images.
+    *  @param outChains Receives one chain per image.
+    *  @param threadCount Worker threads. Zero picks one per hardware thread.
+    *  @return bool False if any image is empty (nothing is generated).
+  */
+  bool
+    generate(const MipImage* images,
+      size_t imageCount,
+      std::vector<MipChain>& outChains,
+      unsigned int threadCount = 0);
+
+  /*
+    *  @brief Sets the filter (default MIP_BOX).
+  */
+  void
+    setFilter(MipFilter filter) { m_filter = filter; }
+
+  /*
+    *  @brief Sets whether RGB is sRGB encoded (default true). Turn it off for
+    *         data textures such as normal maps.
+  */
+  void
+    setSrgb(bool srgb) { m_srgb = srgb; }
+
+  /*
+    *  @brief Returns the statistics of the last call to generate.
+  */
+  const MipStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Number of levels of a full chain for a size.
+  */
+  static unsigned int
+    mipCount(unsigned int width, unsigned int height);
+
+private:
+  /*
+    *  @brief Resampling weights along one axis: taps source indices (already
+    *         clamped) and weights per destination texel.
+  */
+  struct MipKernel {
+    unsigned int taps = 0;
+    std::vector<unsigned int> indices;
+    std::vector<float> weights;
+  };
+
+  /*
+    *  @brief State of one image while its chain is built.
+  */
+  struct MipJob {
+    const MipImage* image = nullptr;
+    MipChain* chain = nullptr;
+    /*
+      *  @brief Float RGBA of the previous and current levels (linear light).
+    */
+    std::vector<float> source;
+    std::vector<float> target;
+    MipKernel horizontal;
+    MipKernel vertical;
+  };
+
+  /*
+    *  @brief Fills the weights that resample sourceSize texels to targetSize.
+  */
+  void
+    buildKernel(unsigned int sourceSize, unsigned int targetSize, MipKernel& outKernel) const;
+
+  /*
+    *  @brief Writes rows [rowBegin, rowEnd) of a job's current level.
+    *  @param level Level being written (at least 1).
+  */
+  void
+    resampleBand(MipJob& job, unsigned int level, unsigned int rowBegin, unsigned int rowEnd) const;
+
+  /*
+    *  @brief Fills the decode / encode tables for the current color space.
+  */
+  void
+    buildTables();
+
+private:
+  /*
+    *  @brief Filter of the next calls.
+  */
+  MipFilter m_filter = MIP_BOX;
+
+  /*
+    *  @brief Whether RGB is sRGB encoded.
+  */
+  bool m_srgb = true;
+
+  /*
+    *  @brief Byte to linear float for the color channels and for alpha.
+  */
+  float m_decodeColor[256] = {};
+  float m_decodeAlpha[256] = {};
+
+  /*
+    *  @brief Linear value (scaled to the table size) to byte for the color channels.
+  */
+  std::vector<unsigned char> m_encodeColor;
+
+  /*
+    *  @brief Color space the tables were built for (-1 before the first call).
+  */
+  int m_tablesSrgb = -1;
+
+  /*
+    *  @brief Per image state of the current call.
+  */
+  std::vector<MipJob> m_jobs;
+
+  /*
+    *  @brief Statistics of the last call to generate.
+  */
+  MipStats m_lastStats;
+};
@@ -1,16 +1,69 @@
 #pragma once
-#include "Prerequisites.h"
+#include "CorePrerequisites.h"
 #include "MeshComponent.h"
-    
+#include "ObjTokenizer.h"
+#include "PolygonTriangulator.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
 
 /*
  * @brief Utility class for loading 3D model data from files.
  * @note This class is designed to parse geometry files (like .obj)
  * and populate a MeshComponent with the resulting vertex and index data.
+ * The file is memory-mapped and tokenized in place; no line or token is
+ * copied into a std::string while parsing.
 */
 class ModelLoader {
 public:
 
+  /*
+   * @brief Timings and sizes of the last call to loadModel.
+  */
+  struct LoadStats {
+    /*
+     * @brief Size of the parsed file in bytes.
+    */
+    size_t fileBytes = 0;
+    /*
+     * @brief Number of line-aligned chunks the file was split into.
+    */
+    unsigned int chunkCount = 0;
+    /*
+     * @brief Wall time spent tokenizing the chunks, in milliseconds.
+    */
+    double parseMs = 0.0;
+    /*
+     * @brief Wall time spent merging the chunks into the mesh, in milliseconds.
+    */
+    double assembleMs = 0.0;
+    /*
+     * @brief Bytes used by the corner deduplication table.
+    */
+    size_t vertexCacheBytes = 0;
+    /*
+     * @brief Vertex cache statistics before and after the optimization pass.
+    */
+    MeshOptimizer::OptimizeStats optimize;
+    /*
+     * @brief Meshlet statistics, when meshlets were built.
+    */
+    MeshletBuilder::BuildStats meshlets;
+    /*
+     * @brief LOD chain statistics, when levels were built.
+    */
+    MeshSimplifier::LodStats lods;
+    /*
+     * @brief Materials used by the faces (0 if the file has no usemtl).
+    */
+    unsigned int materials = 0;
+    /*
+     * @brief Materials used by the faces but missing from every mtllib.
+    */
+    unsigned int missingMaterials = 0;
+  };
+
   /*
    * @brief Default constructor for ModelLoader.
   */
@@ -25,26 +78,229 @@ public:
    * @brief Loads a model from the specified file and populates the outMesh.
    * @param fileName The file path to the 3D model file (e.g., "model.obj").
    * @param outMesh A reference to the MeshComponent to be filled with geometry data.
+   * @param threadCount Number of worker threads used to tokenize the file. 1 parses
+   *        on the calling thread, 0 uses one worker per hardware thread. The
+   *        resulting mesh is identical for every thread count.
    * @return bool True if the model was loaded and parsed successfully, false otherwise.
+   * @note When the file uses materials (usemtl), the triangles are grouped into
+   *       one submesh per material, in order of first use, and the materials
+   *       are read from the mtllib files next to the model. Every later pass
+   *       keeps each submesh contiguous.
+   *       Every pass below is off by default, so a loader that enables none
+   *       of them gives the parsed mesh unchanged.
+   *       When enabled with setOptimizeMesh, the mesh is reordered for the
+   *       vertex cache and vertex fetch (see MeshOptimizer). When enabled with
+   *       setBuildMeshlets, the triangles are then grouped into meshlets for
+   *       culling (see MeshletBuilder). When enabled with setBuildLods, a chain
+   *       of simplified levels is appended to the index buffer (see
+   *       MeshSimplifier). When enabled with setWriteMeshCache, a binary
+   *       .tmesh cache of the final mesh is then written next to the model
+   *       (see MeshCache). The cache is uncompressed, so it is mapped without
+   *       a copy, unless setCompressMeshCache is enabled.
   */
   bool
-    loadModel(const std::string& fileName, MeshComponent& outMesh);
+    loadModel(const std::string& fileName, MeshComponent& outMesh, unsigned int threadCount = 1);
+
+  /*
+   * @brief Returns the timings of the last call to loadModel.
+  */
+  const LoadStats&
+    getLastLoadStats() const { return m_lastStats; }
+
+  /*
+   * @brief Enables or disables writing the .tmesh cache after an OBJ parse
+   *        (off by default).
+  */
+  void
+    setWriteMeshCache(bool writeMeshCache) { m_writeMeshCache = writeMeshCache; }
+
+  /*
+   * @brief Enables or disables MeshCodec compression of the written .tmesh cache.
+   * @note Off by default: a compressed cache is about half the size but has to
+   *       be decoded on every load.
+  */
+  void
+    setCompressMeshCache(bool compressMeshCache) { m_compressMeshCache = compressMeshCache; }
+
+  /*
+   * @brief Enables or disables the vertex cache / vertex fetch optimization
+   *        pass (off by default).
+  */
+  void
+    setOptimizeMesh(bool optimizeMesh) { m_optimizeMesh = optimizeMesh; }
+
+  /*
+   * @brief Enables or disables building meshlets (MeshComponent::m_meshlets,
+   *        off by default).
+  */
+  void
+    setBuildMeshlets(bool buildMeshlets) { m_buildMeshlets = buildMeshlets; }
+
+  /*
+   * @brief Enables or disables building the LOD chain (MeshComponent::m_lods,
+   *        off by default).
+  */
+  void
+    setBuildLods(bool buildLods) { m_buildLods = buildLods; }
+
+  /*
+   * @brief Selects how faces with more than three corners are triangulated.
+   * @note The default, TRIANGULATE_AUTO, fans convex faces (the same triangles the
+   *       loader always produced for quads) and ear clips concave ones.
+  */
+  void
+    setTriangulationMode(TriangulationMode mode) { m_triangulationMode = mode; }
 
 private:
 
   /*
-   * @brief Helper function to parse a 2-component vector (XMFLOAT2) from a line stream.
-   * @param streamLine The stringstream containing the line data (e.g., "0.5 0.5").
+   * @brief A parsed face corner ("p/t/n") with 0-based indices. Corners that
+   *        spell the same indices differently (e.g. "01/2/3") are equal.
+  */
+  struct ObjFaceCorner {
+    int posIndex;
+    int uvIndex;
+    int normIndex;
+  };
+
+  /*
+   * @brief A usemtl statement: the material of the faces that follow it.
+  */
+  struct ObjMaterialUse {
+    unsigned int faceIndex;
+    std::string name;
+  };
+
+  /*
+   * @brief Records parsed from one line-aligned slice of the file.
+   * @note Each chunk only knows its local attribute counts; the highest
+   *       "index - attributes seen so far" per stream is kept so that forward
+   *       references can still be rejected once the chunk offsets are known.
+  */
+  struct ObjChunk {
+    std::vector<XMFLOAT3> positions;
+    std::vector<XMFLOAT2> texCoords;
+    std::vector<XMFLOAT3> normals;
+    std::vector<ObjFaceCorner> corners;
+    std::vector<unsigned int> faceSizes;
+    std::vector<ObjMaterialUse> materialUses;
+    std::vector<std::string> materialLibraries;
+    int maxPosExcess = -1;
+    int maxUVExcess = -1;
+    int maxNormExcess = -1;
+    const char* error = nullptr;
+  };
+
+  /*
+   * @brief Tokenizes the v/vt/vn/f/usemtl/mtllib records of [begin, end) into a chunk.
+   * @param begin First character of the chunk (start of a line).
+   * @param end One past the last character of the chunk (end of a line).
+   * @param outChunk The chunk receiving the parsed records.
+  */
+  void
+    parseChunk(const char* begin, const char* end, ObjChunk& outChunk);
+
+  /*
+   * @brief Merges the parsed chunks, in file order, into the mesh.
+   * @param chunks The chunks produced by parseChunk.
+   * @param outMesh The MeshComponent to be filled.
+   * @return bool False if a face references an attribute that does not exist.
+  */
+  bool
+    assembleMesh(std::vector<ObjChunk>& chunks, MeshComponent& outMesh);
+
+  /*
+   * @brief Fills the materials of an assembled mesh from the model's mtllib files.
+   * @param fileName Path of the model; libraries are looked up next to it.
+   * @param chunks The chunks produced by parseChunk.
+   * @param outMesh The mesh whose m_materials hold the names to resolve.
+   * @note Materials that no library defines keep the default (white, untextured).
+  */
+  void
+    resolveMaterials(const std::string& fileName,
+      const std::vector<ObjChunk>& chunks,
+      MeshComponent& outMesh);
+
+  /*
+   * @brief Helper function to parse a 2-component vector (XMFLOAT2) from the current line.
+   * @param tokenizer The tokenizer positioned after the line header (e.g., "0.5 0.5").
    * @param outVector The vector pool where the parsed data will be stored.
   */
   void
-    parseVec2(std::stringstream& streamLine, std::vector<XMFLOAT2>& outVector);
+    parseVec2(ObjTokenizer& tokenizer, std::vector<XMFLOAT2>& outVector);
 
   /*
-   * @brief Helper function to parse a 3-component vector (XMFLOAT3) from a line stream.
-   * @param streamLine The stringstream containing the line data (e.g., "1.0 2.0 3.0").
+   * @brief Helper function to parse a 3-component vector (XMFLOAT3) from the current line.
+   * @param tokenizer The tokenizer positioned after the line header (e.g., "1.0 2.0 3.0").
    * @param outVector The vector pool where the parsed data will be stored.
   */
   void
-    parseVec3(std::stringstream& streamLine, std::vector<XMFLOAT3>& outVector);
+    parseVec3(ObjTokenizer& tokenizer, std::vector<XMFLOAT3>& outVector);
+
+private:
+
+  /*
+   * @brief Timings of the last call to loadModel.
+  */
+  LoadStats m_lastStats;
+
+  /*
+   * @brief True to write a MeshCache file after each successful OBJ parse.
+  */
+  bool m_writeMeshCache = false;
+
+  /*
+   * @brief True to write the MeshCache file with MeshCodec streams.
+  */
+  bool m_compressMeshCache = false;
+
+  /*
+   * @brief True to run MeshOptimizer on each successfully parsed mesh.
+  */
+  bool m_optimizeMesh = false;
+
+  /*
+   * @brief Optimizer reused across loads to keep its scratch storage.
+  */
+  MeshOptimizer m_optimizer;
+
+  /*
+   * @brief True to build meshlets on each successfully parsed mesh.
+  */
+  bool m_buildMeshlets = false;
+
+  /*
+   * @brief Meshlet builder reused across loads to keep its scratch storage.
+  */
+  MeshletBuilder m_meshletBuilder;
+
+  /*
+   * @brief True to build the LOD chain on each successfully parsed mesh.
+  */
+  bool m_buildLods = false;
+
+  /*
+   * @brief Simplifier reused across loads to keep its scratch storage.
+  */
+  MeshSimplifier m_simplifier;
+
+  /*
+   * @brief Strategy used for faces with more than three corners.
+  */
+  TriangulationMode m_triangulationMode = TRIANGULATE_AUTO;
+
+  /*
+   * @brief Splits n-gons into triangles; its scratch storage is reused across loads.
+  */
+  PolygonTriangulator m_triangulator;
+
+  /*
+   * @brief Material of every assembled triangle; scratch reused across loads.
+  */
+  std::vector<unsigned int> m_triangleMaterials;
+
+  /*
+   * @brief Index list being regrouped by material; scratch reused across loads.
+  */
+  std::vector<unsigned int> m_sortedIndices;
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+
+/*
+  *  @brief In-place tokenizer for Wavefront .obj text.
+  *  @note Walks a read-only character range (usually a MappedFile) without
+  *        copying lines or tokens. Numbers are parsed locale-free, so the result
+  *        does not depend on the user's decimal separator. Header only and free
+  *        of Windows headers so it can be built and exercised on Linux.
+*/
+class
+  ObjTokenizer {
+public:
+
+  /*
+    *  @brief Creates a tokenizer over the range [begin, end).
+    *  @param begin First character of the text.
+    *  @param end One past the last character of the text.
+  */
+  ObjTokenizer(const char* begin, const char* end)
+    : m_cursor(begin), m_lineEnd(begin), m_next(begin), m_end(end) {}
+
+  /*
+    *  @brief Advances to the next line of the text.
+    *  @return bool False once the whole range has been consumed.
+  */
+  bool
+    nextLine() {
+    if (m_next >= m_end) {
+      return false;
+    }
+    m_cursor = m_next;
+    m_lineEnd = findLineEnd(m_next, m_end);
+    m_next = (m_lineEnd < m_end) ? m_lineEnd + 1 : m_end;
+    return true;
+  }
+
+  /*
+    *  @brief Returns the next whitespace separated token of the current line.
+    *  @param tokenBegin Receives the first character of the token.
+    *  @param tokenEnd Receives one past the last character of the token.
+    *  @return bool False when the line has no more tokens.
+  */
+  bool
+    nextToken(const char*& tokenBegin, const char*& tokenEnd) {
+    while (m_cursor < m_lineEnd && isSpace(*m_cursor)) {
+      ++m_cursor;
+    }
+    if (m_cursor >= m_lineEnd) {
+      return false;
+    }
+    tokenBegin = m_cursor;
+    while (m_cursor < m_lineEnd && !isSpace(*m_cursor)) {
+      ++m_cursor;
+    }
+    tokenEnd = m_cursor;
+    return true;
+  }
+
+  /*
+    *  @brief Parses the next token of the current line as a float.
+    *  @param out Receives the value, or 0 if the token is missing or malformed.
+    *  @return bool True if a number was read.
+  */
+  bool
+    readFloat(float& out) {
+    const char* tokenBegin;
+    const char* tokenEnd;
+    if (!nextToken(tokenBegin, tokenEnd)) {
+      out = 0.0f;
+      return false;
+    }
+    return parseFloat(tokenBegin, tokenEnd, out);
+  }
+
+  /*
+    *  @brief Returns the unread remainder of the current line without its
+    *         surrounding whitespace (e.g. a material name containing spaces).
+    *  @param restBegin Receives the first non-space character.
+    *  @param restEnd Receives one past the last non-space character.
+    *  @return bool False if nothing but whitespace is left.
+  */
+  bool
+    restOfLine(const char*& restBegin, const char*& restEnd) {
+    while (m_cursor < m_lineEnd && isSpace(*m_cursor)) {
+      ++m_cursor;
+    }
+    restBegin = m_cursor;
+    restEnd = m_lineEnd;
+    while (restEnd > restBegin && isSpace(restEnd[-1])) {
+      --restEnd;
+    }
+    m_cursor = m_lineEnd;
+    return restBegin < restEnd;
+  }
+
+  /*
+    *  @brief Returns the unread remainder of the current line.
+  */
+  const char*
+    lineCursor() const { return m_cursor; }
+
+  /*
+    *  @brief Returns one past the last character of the current line.
+  */
+  const char*
+    lineEnd() const { return m_lineEnd; }
+
+  /*
+    *  @brief Finds the end of the line that starts at cursor.
+    *  @return const char* Position of the terminating '\n', or end.
+  */
+  static const char*
+    findLineEnd(const char* cursor, const char* end) {
+    while (cursor < end && *cursor != '\n') {
+      ++cursor;
+    }
+    return cursor;
+  }
+
+  /*
+    *  @brief Same whitespace set as std::isspace in the "C" locale.
+  */
+  static bool
+    isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  /*
+    *  @brief Parses a locale-free float from the start of [cursor, end).
+    *  @param cursor Start of the text; advanced past the number on success.
+    *  @param end One past the last readable character.
+    *  @param out Receives the parsed value, or 0 on failure.
+    *  @return bool True if a number was read.
+  */
+  static bool
+    parseFloat(const char*& cursor, const char* end, float& out) {
+    const char* start = cursor;
+    // std::from_chars does not accept an explicit '+' sign
+    if (start < end && *start == '+') {
+      ++start;
+    }
+    std::from_chars_result result = std::from_chars(start, end, out);
+    if (result.ec != std::errc() || result.ptr == start) {
+      out = 0.0f;
+      return false;
+    }
+    cursor = result.ptr;
+    return true;
+  }
+
+  /*
+    *  @brief Parses a locale-free signed decimal integer from [cursor, end).
+    *  @param cursor Start of the text; advanced past the number on success.
+    *  @param end One past the last readable character.
+    *  @param out Receives the parsed value.
+    *  @return bool True if at least one digit was read.
+  */
+  static bool
+    parseInt(const char*& cursor, const char* end, int& out) {
+    const char* current = cursor;
+    while (current < end && isSpace(*current)) {
+      ++current;
+    }
+    bool negative = false;
+    if (current < end && (*current == '-' || *current == '+')) {
+      negative = (*current == '-');
+      ++current;
+    }
+    const char* digitsStart = current;
+    int64_t value = 0;
+    while (current < end && static_cast<unsigned char>(*current - '0') <= 9) {
+      if (value <= INT32_MAX) {
+        value = value * 10 + (*current - '0');
+      }
+      ++current;
+    }
+    if (current == digitsStart) {
+      return false;
+    }
+    if (value > INT32_MAX) {
+      value = INT32_MAX;
+    }
+    out = static_cast<int>(negative ? -value : value);
+    cursor = current;
+    return true;
+  }
+
+  /*
+    *  @brief Parses a "p/t/n" face corner, matching sscanf("%d/%d/%d").
+    *  @param begin First character of the corner token.
+    *  @param end One past the last character of the corner token.
+    *  @param pos Receives the position index.
+    *  @param uv Receives the texture coordinate index.
+    *  @param norm Receives the normal index.
+    *  @return int Number of indices read (3 for a complete corner).
+  */
+  static int
+    parseFaceCorner(const char* begin, const char* end, int& pos, int& uv, int& norm) {
+    if (!parseInt(begin, end, pos)) {
+      return 0;
+    }
+    if (begin >= end || *begin != '/' || !parseInt(++begin, end, uv)) {
+      return 1;
+    }
+    if (begin >= end || *begin != '/' || !parseInt(++begin, end, norm)) {
+      return 2;
+    }
+    return 3;
+  }
+
+private:
+  /*
+    *  @brief Next unread character of the current line.
+  */
+  const char* m_cursor;
+
+  /*
+    *  @brief One past the last character of the current line.
+  */
+  const char* m_lineEnd;
+
+  /*
+    *  @brief First character of the line after the current one.
+  */
+  const char* m_next;
+
+  /*
+    *  @brief One past the last character of the text.
+  */
+  const char* m_end;
+};
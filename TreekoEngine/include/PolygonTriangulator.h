@@ -0,0 +1,105 @@
+#pragma once
+#include "CorePrerequisites.h"
+
+/*
+  *  @brief How polygons with more than three corners are split into triangles.
+*/
+enum TriangulationMode {
+  /*
+    *  @brief Fan for convex polygons, ear clipping for concave ones.
+  */
+  TRIANGULATE_AUTO = 0,
+  /*
+    *  @brief Always fan from the first corner (fast, only correct for convex polygons).
+  */
+  TRIANGULATE_FAN = 1,
+  /*
+    *  @brief Always ear clip (handles concave polygons).
+  */
+  TRIANGULATE_EAR_CLIPPING = 2
+};
+
+/*
+  *  @brief Splits planar polygons of any size into triangle-list indices.
+  *  @note Scratch storage lives in the object and only grows, so triangulating
+  *        face after face does not allocate once the largest polygon has been seen.
+*/
+class
+  PolygonTriangulator {
+public:
+
+  /*
+    *  @brief Default constructor for PolygonTriangulator.
+  */
+  PolygonTriangulator() = default;
+
+  /*
+    *  @brief Default destructor for PolygonTriangulator.
+  */
+  ~PolygonTriangulator() = default;
+
+  /*
+    *  @brief Appends the triangles of a polygon to an index list.
+    *  @param corners Vertex indices of the polygon, in winding order.
+    *  @param cornerCount Number of corners (3 or more).
+    *  @param vertices Vertex pool the corners index into.
+    *  @param mode Triangulation strategy.
+    *  @param outIndices Index list receiving (cornerCount - 2) * 3 indices.
+  */
+  void
+    triangulate(const unsigned int* corners,
+      unsigned int cornerCount,
+      const std::vector<SimpleVertex>& vertices,
+      TriangulationMode mode,
+      std::vector<unsigned int>& outIndices);
+
+private:
+  /*
+    *  @brief Emits a fan around the first corner.
+  */
+  void
+    triangulateFan(const unsigned int* corners,
+      unsigned int cornerCount,
+      std::vector<unsigned int>& outIndices);
+
+  /*
+    *  @brief Emits the triangles found by ear clipping the projected polygon.
+    *  @param orientation Signed area returned by projectCorners.
+  */
+  void
+    triangulateEarClipping(const unsigned int* corners,
+      unsigned int cornerCount,
+      float orientation,
+      std::vector<unsigned int>& outIndices);
+
+  /*
+    *  @brief Projects the corners onto the polygon's dominant plane.
+    *  @return float Twice the signed area of the projected polygon.
+  */
+  float
+    projectCorners(const unsigned int* corners,
+      unsigned int cornerCount,
+      const std::vector<SimpleVertex>& vertices);
+
+  /*
+    *  @brief True if every turn of the projected polygon has the orientation's sign.
+  */
+  bool
+    isConvex(unsigned int cornerCount, float orientation) const;
+
+private:
+  /*
+    *  @brief Corners projected to 2D.
+  */
+  std::vector<XMFLOAT2> m_projected;
+
+  /*
+    *  @brief Next corner of the remaining polygon while ear clipping.
+  */
+  std::vector<unsigned int> m_next;
+
+  /*
+    *  @brief Previous corner of the remaining polygon while ear clipping.
+  */
+  std::vector<unsigned int> m_prev;
+};
@@ -1,14 +1,6 @@
 #pragma once
 
-/*
-  *  @brief Standard C++ libraries used in the project
-*/
-#include <string>
-#include <sstream>
-#include <vector>
-#include <windows.h>
-#include <xnamath.h>
-#include <thread>
+#include "CorePrerequisites.h"
 
 /*
   *  @brief DirectX libraries required for rendering and resource management
@@ -16,6 +8,7 @@
 #include <d3d11.h>
 #include <d3dx11.h>
 #include <d3dcompiler.h>
+#include "HlslPacking.h"
 #include "Resource.h"
 #include "resource.h"
 
@@ -24,51 +17,6 @@
 */
 #define SAFE_RELEASE(x) if(x != nullptr) x->Release(); x = nullptr;
 
-/*
-  *  @brief Macro to output a debug message about resource creation
-*/
-#define MESSAGE( classObj, method, state )   \
-{                                            \
-   std::wostringstream os_;                  \
-   os_ << classObj << "::" << method << " : " << "[CREATION OF RESOURCE " << ": " << state << "] \n"; \
-   OutputDebugStringW( os_.str().c_str() );  \
-}
-
-/*
-  *  @brief Macro to output an error message to the debug output
-*/
-#define ERROR(classObj, method, errorMSG)                     \
-{                                                             \
-    try {                                                     \
-        std::wostringstream os_;                              \
-        os_ << L"ERROR : " << classObj << L"::" << method     \
-            << L" : " << errorMSG << L"\n";                   \
-        OutputDebugStringW(os_.str().c_str());                \
-    } catch (...) {                                           \
-        OutputDebugStringW(L"Failed to log error message.\n");\
-    }                                                         \
-}
-
-
-
-/*
-  *  @brief Structure representing a simple vertex with position and texture coordinates
-*/
-struct SimpleVertex
-{
-  /*
-    *  @brief 3D position of the vertex
-  */
-  XMFLOAT3 Pos;
-  /*
-    *  @brief 2D texture coordinates of the vertex
-  */
-  XMFLOAT2 Tex;
-
-  XMFLOAT3 Norm;
-
-};
-
 /*
   *  @brief Constant buffer structure for view matrix (never changes)
 */
@@ -79,6 +27,9 @@ struct CBNeverChanges
   */
   XMMATRIX mView;
 };
+static_assert(HlslPacking::matches(sizeof(CBNeverChanges), {
+  HLSL_MEMBER(CBNeverChanges, mView) }),
+  "CBNeverChanges does not match the HLSL cbuffer packing");
 
 /*
   *  @brief Constant buffer structure for projection matrix (changes on resize)
@@ -90,6 +41,9 @@ struct CBChangeOnResize
   */
   XMMATRIX mProjection;
 };
+static_assert(HlslPacking::matches(sizeof(CBChangeOnResize), {
+  HLSL_MEMBER(CBChangeOnResize, mProjection) }),
+  "CBChangeOnResize does not match the HLSL cbuffer packing");
 
 /*
   *  @brief Constant buffer structure for world matrix and mesh color (changes every frame)
@@ -105,6 +59,10 @@ struct CBChangesEveryFrame
   */
   XMFLOAT4 vMeshColor;
 };
+static_assert(HlslPacking::matches(sizeof(CBChangesEveryFrame), {
+  HLSL_MEMBER(CBChangesEveryFrame, mWorld),
+  HLSL_MEMBER(CBChangesEveryFrame, vMeshColor) }),
+  "CBChangesEveryFrame does not match the HLSL cbuffer packing");
 
 /*
   *  @brief Enum representing supported image file extensions
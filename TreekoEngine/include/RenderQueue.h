@@ -0,0 +1,135 @@
+#pragma once
+#include "Prerequisites.h"
+#include "Submesh.h"
+#include "MeshletCuller.h"
+
+class DeviceContext;
+class Texture;
+class SamplerState;
+
+/*
+  *  @brief Collects the index ranges drawn in a frame and submits them sorted
+  *         by material.
+  *  @note Ranges are split at submesh boundaries, sorted by material and then
+  *        by offset, and ranges of one material that touch are merged. A
+  *        texture or sampler is only bound when it differs from the one
+  *        already bound, so each material costs one bind per frame however
+  *        many objects or ranges use it. Every item is drawn from the vertex
+  *        and index buffers bound by the caller.
+*/
+class
+  RenderQueue {
+public:
+
+  /*
+    *  @brief Pipeline state bound for one material.
+  */
+  struct MaterialBinding {
+    /*
+      *  @brief Texture bound to pixel shader slot 0.
+    */
+    Texture* texture = nullptr;
+    /*
+      *  @brief Sampler bound to pixel shader slot 0.
+    */
+    SamplerState* sampler = nullptr;
+  };
+
+  /*
+    *  @brief State changes of the last call to submit.
+  */
+  struct SubmitStats {
+    /*
+      *  @brief Ranges queued, after splitting at submesh boundaries.
+    */
+    unsigned int items = 0;
+    /*
+      *  @brief DrawIndexed calls issued, after merging.
+    */
+    unsigned int drawCalls = 0;
+    /*
+      *  @brief Times the material changed between two draws.
+    */
+    unsigned int materialChanges = 0;
+    /*
+      *  @brief Texture and sampler binds issued.
+    */
+    unsigned int textureBinds = 0;
+    unsigned int samplerBinds = 0;
+    /*
+      *  @brief Texture and sampler binds the same items would have needed in
+      *         the order they were queued, for comparison.
+    */
+    unsigned int unsortedTextureBinds = 0;
+    unsigned int unsortedSamplerBinds = 0;
+  };
+
+  /*
+    *  @brief Default constructor. The queue starts empty.
+  */
+  RenderQueue() = default;
+
+  /*
+    *  @brief Default destructor for RenderQueue.
+  */
+  ~RenderQueue() = default;
+
+  /*
+    *  @brief Removes every queued range.
+  */
+  void
+    clear() { m_items.clear(); }
+
+  /*
+    *  @brief Queues a range drawn with one material.
+    *  @param materialIndex Index into the bindings passed to submit.
+    *  @param indexOffset First index of the range (StartIndexLocation).
+    *  @param indexCount Number of indices in the range.
+  */
+  void
+    add(unsigned int materialIndex, unsigned int indexOffset, unsigned int indexCount);
+
+  /*
+    *  @brief Queues draw ranges of a mesh, split at its submesh boundaries.
+    *  @param ranges Ranges to draw (e.g. from MeshletCuller or one LOD level).
+    *  @param submeshes Submeshes of the mesh, sorted by offset. When empty,
+    *         every range is queued with material 0.
+  */
+  void
+    addRanges(const std::vector<MeshletDrawRange>& ranges, const std::vector<Submesh>& submeshes);
+
+  /*
+    *  @brief Sorts the queued ranges and draws them, binding state on change.
+    *  @param deviceContext Context the draws are recorded on.
+    *  @param materials Binding of every material index used by the queue.
+    *  @note The queue keeps its content; call clear() before the next frame.
+  */
+  void
+    submit(DeviceContext& deviceContext, const std::vector<MaterialBinding>& materials);
+
+  /*
+    *  @brief Returns the state changes of the last call to submit.
+  */
+  const SubmitStats&
+    getLastStats() const { return m_lastStats; }
+
+private:
+  /*
+    *  @brief One queued range.
+  */
+  struct DrawItem {
+    unsigned int materialIndex;
+    unsigned int indexOffset;
+    unsigned int indexCount;
+  };
+
+  /*
+    *  @brief Ranges queued since the last clear, in submission order.
+  */
+  std::vector<DrawItem> m_items;
+
+  /*
+    *  @brief Statistics of the last call to submit.
+  */
+  SubmitStats m_lastStats;
+};
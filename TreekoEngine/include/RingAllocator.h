@@ -0,0 +1,150 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+/*
+  *  @brief Linear allocator over a ring of bytes whose ranges are released
+  *         frame by frame, once the GPU has passed a fence.
+  *  @note Allocations are handed out in order from a head that wraps to the
+  *        start of the ring; the bytes skipped at the end of the ring when an
+  *        allocation does not fit there are counted as used until released.
+  *        endFrame tags everything allocated so far with a fence value, and
+  *        retire releases the frames whose fence the GPU has completed, so
+  *        the head only wraps over bytes the GPU no longer reads. When every
+  *        byte belongs to frames still in flight, allocate fails instead of
+  *        overwriting them.
+  *        Pure bookkeeping: it never touches memory or the GPU. Not
+  *        thread-safe; used from the render thread. Only depends on the
+  *        standard library so the wraparound can be tested on Linux.
+*/
+class
+  RingAllocator {
+public:
+  /*
+    *  @brief A range of the ring.
+  */
+  struct Allocation {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    /*
+      *  @brief The head went back to the start of the ring for this allocation.
+    */
+    bool wrapped = false;
+  };
+
+  /*
+    *  @brief Counters since the ring was created.
+  */
+  struct RingStats {
+    uint64_t allocations = 0;
+    /*
+      *  @brief Allocations refused because the frames in flight hold the space.
+    */
+    uint64_t failures = 0;
+    uint64_t wraps = 0;
+    /*
+      *  @brief Most bytes held at once, padding included.
+    */
+    uint64_t peakUsed = 0;
+  };
+
+  /*
+    *  @brief Creates a ring.
+    *  @param capacity Size of the ring, rounded down to a multiple of alignment.
+    *  @param alignment Alignment of every offset.
+  */
+  explicit
+    RingAllocator(uint64_t capacity = 0, uint64_t alignment = 256);
+
+  /*
+    *  @brief Default destructor for RingAllocator.
+  */
+  ~RingAllocator() = default;
+
+  /*
+    *  @brief Empties the ring and gives it a new size.
+  */
+  void
+    reset(uint64_t capacity, uint64_t alignment);
+
+  /*
+    *  @brief Takes an aligned range.
+    *  @return bool False if size is zero, larger than the ring, or more than
+    *          the space released so far.
+  */
+  bool
+    allocate(uint64_t size, Allocation& outAllocation);
+
+  /*
+    *  @brief Tags everything allocated since the previous call with a fence.
+    *  @param fence Value the GPU signals once it is done with the frame;
+    *         must increase from one call to the next.
+  */
+  void
+    endFrame(uint64_t fence);
+
+  /*
+    *  @brief Releases the frames whose fence is at most completedFence.
+  */
+  void
+    retire(uint64_t completedFence);
+
+  /*
+    *  @brief Releases everything, e.g. once the GPU is idle.
+  */
+  void
+    releaseAll();
+
+  /*
+    *  @brief Size of the ring.
+  */
+  uint64_t
+    capacity() const { return m_capacity; }
+
+  /*
+    *  @brief Bytes allocated and not released, padding included.
+  */
+  uint64_t
+    used() const { return m_allocated - m_released; }
+
+  /*
+    *  @brief Frames tagged by endFrame and not retired yet.
+  */
+  size_t
+    framesInFlight() const { return m_frames.size(); }
+
+  /*
+    *  @brief Returns the counters.
+  */
+  const RingStats&
+    getStats() const { return m_stats; }
+
+private:
+  /*
+    *  @brief Fence of a frame and the allocation total when it ended.
+  */
+  struct FrameMark {
+    uint64_t fence;
+    uint64_t allocatedEnd;
+  };
+
+private:
+  uint64_t m_capacity = 0;
+  uint64_t m_alignment = 1;
+
+  /*
+    *  @brief Bytes ever allocated and ever released. The head is
+    *         m_allocated modulo the capacity, since wrapping counts the
+    *         skipped tail as allocated.
+  */
+  uint64_t m_allocated = 0;
+  uint64_t m_released = 0;
+
+  /*
+    *  @brief Frames in flight, oldest first.
+  */
+  std::deque<FrameMark> m_frames;
+
+  RingStats m_stats;
+};
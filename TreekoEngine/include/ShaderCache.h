@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+  *  @brief On-disk cache of compiled shader bytecode.
+  *  @note An entry is keyed by a hash of the shader source, every file it
+  *        includes (followed recursively), the entry point, the profile, the
+  *        compile flags and the defines, so editing any of them misses and
+  *        recompiles. Each entry is one "<key>.tshc" file in the cache
+  *        directory: a small header with the key and a hash of the bytecode,
+  *        then the bytecode. Files are written to a temporary name and
+  *        renamed, so a crash never leaves a torn entry; entries whose header
+  *        or hash do not match are treated as misses. Entries of old sources
+  *        are never removed; deleting the directory resets the cache.
+  *        File hashes are remembered by size and modification time, so the
+  *        sources of several shaders are only read once per change.
+  *        Thread-safe. Only depends on the standard library so hits, misses
+  *        and invalidation can be checked on Linux.
+*/
+class
+  ShaderCache {
+public:
+  /*
+    *  @brief "TSHC" read as a little-endian uint32.
+  */
+  static const uint32_t kTag = 0x43485354u;
+
+  /*
+    *  @brief Bumped whenever the entry layout or the compiler changes.
+  */
+  static const uint32_t kVersion = 1;
+
+  /*
+    *  @brief A preprocessor define passed to the compiler.
+  */
+  struct ShaderDefine {
+    std::string name;
+    std::string value;
+  };
+
+  /*
+    *  @brief Everything that changes the bytecode of a compile.
+  */
+  struct CompileRequest {
+    std::string sourcePath;
+    std::string entryPoint;
+    std::string profile;
+    uint32_t flags = 0;
+    std::vector<ShaderDefine> defines;
+  };
+
+  /*
+    *  @brief Counters since the cache was created.
+  */
+  struct CacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int stores = 0;
+    /*
+      *  @brief Entries found on disk but rejected (torn, stale version or
+      *         corrupted bytecode), counted as misses too.
+    */
+    unsigned int rejected = 0;
+  };
+
+  /*
+    *  @brief Creates a cache over a directory, created on the first store.
+  */
+  explicit
+    ShaderCache(const std::string& directory = "ShaderCache");
+
+  /*
+    *  @brief Default destructor for ShaderCache.
+  */
+  ~ShaderCache() = default;
+
+  ShaderCache(const ShaderCache&) = delete;
+  ShaderCache& operator=(const ShaderCache&) = delete;
+
+  /*
+    *  @brief Computes the key of a compile.
+    *  @return bool False if the source cannot be read. Includes that cannot
+    *          be found only contribute their name, like the compiler would
+    *          fail on them anyway.
+  */
+  bool
+    computeKey(const CompileRequest& request, uint64_t& outKey);
+
+  /*
+    *  @brief Reads the bytecode of a key.
+    *  @return bool False on a miss.
+  */
+  bool
+    load(uint64_t key, std::vector<char>& outBytecode);
+
+  /*
+    *  @brief Writes the bytecode of a key, replacing any previous entry.
+    *  @return bool False if the entry cannot be written.
+  */
+  bool
+    store(uint64_t key, const void* bytecode, size_t size);
+
+  /*
+    *  @brief Path of the entry of a key.
+  */
+  std::string
+    pathFor(uint64_t key) const;
+
+  /*
+    *  @brief Returns the counters.
+  */
+  CacheStats
+    getStats() const;
+
+private:
+  /*
+    *  @brief Header of an entry file.
+  */
+  struct EntryHeader {
+    uint32_t tag;
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint64_t bytecodeHash;
+  };
+
+  /*
+    *  @brief Content hash of a file, with the stamp it was taken at and the
+    *         includes it names.
+  */
+  struct FileHash {
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint64_t hash = 0;
+    std::vector<std::string> includes;
+  };
+
+  /*
+    *  @brief Chains the hash of a file and, depth first, of its includes.
+    *  @return bool False if the file cannot be read.
+  */
+  bool
+    hashTree(const std::string& fileName,
+      const std::string& rootDirectory,
+      std::unordered_set<std::string>& visited,
+      uint64_t& hash);
+
+  /*
+    *  @brief Hashes one file and lists its includes, reusing the previous
+    *         result while its size and modification time are unchanged.
+  */
+  bool
+    hashFile(const std::string& fileName, FileHash& outHash);
+
+  /*
+    *  @brief Names of the #include directives of a source.
+  */
+  static void
+    scanIncludes(const char* text, size_t size, std::vector<std::string>& outIncludes);
+
+private:
+  /*
+    *  @brief Directory holding the entries.
+  */
+  std::string m_directory;
+
+  /*
+    *  @brief Guards every member below.
+  */
+  mutable std::mutex m_mutex;
+
+  /*
+    *  @brief File hashes by path.
+  */
+  std::unordered_map<std::string, FileHash> m_fileHashes;
+
+  /*
+    *  @brief Counters.
+  */
+  CacheStats m_stats;
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include "Prerequisites.h"
+#include "FileWatcher.h"
+#include "ShaderPermutations.h"
+#include <memory>
+
+class Device;
+class ShaderProgram;
+class ShaderPermutationProgram;
+
+/*
+  *  @brief Recompiles shader programs in the background when their sources
+  *         change on disk, and swaps them in between frames.
+  *  @note A FileWatcher reports the shader files (.fx, .fxh, .hlsl, .hlsli)
+  *        written in the directory of a watched program; includes from other
+  *        directories are not watched. Every program of that directory is
+  *        recompiled on a worker through the ShaderCache, so the ones whose
+  *        sources did not change come back from the cache with the same
+  *        bytecode and are left alone. update swaps in the shaders that
+  *        finished; a program that fails to compile keeps its current
+  *        shaders and the compiler errors are logged. The render thread only
+  *        polls the watcher and creates the new shader objects, so editing a
+  *        shader never stalls a frame on the compiler.
+  *        Everything but the workers runs on the render thread.
+*/
+class
+  ShaderHotReload {
+public:
+  /*
+    *  @brief Counters since the reloader was created.
+  */
+  struct ReloadStats {
+    /*
+      *  @brief Shader files reported changed.
+    */
+    unsigned int changes = 0;
+    /*
+      *  @brief Programs recompiled, swapped in, left alone because their
+      *         bytecode did not change, and kept after a failure.
+    */
+    unsigned int recompiles = 0;
+    unsigned int swaps = 0;
+    unsigned int unchanged = 0;
+    unsigned int failed = 0;
+  };
+
+  /*
+    *  @brief Creates a reloader with nothing watched.
+    *  @param shaderCache Bytecode cache, kept alive by the caller; may be nullptr.
+  */
+  explicit
+    ShaderHotReload(ShaderCache* shaderCache = nullptr);
+
+  /*
+    *  @brief Stops the watcher and finishes the compiles in flight.
+  */
+  ~ShaderHotReload() = default;
+
+  ShaderHotReload(const ShaderHotReload&) = delete;
+  ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+  /*
+    *  @brief Reloads an initialized program when its sources change.
+    *  @param program Program kept alive by the caller until clear.
+    *  @return bool False if its directory cannot be watched.
+  */
+  bool
+    watch(ShaderProgram& program);
+
+  /*
+    *  @brief Reloads the ready permutations of a program when its sources change.
+    *  @note The program's own update creates the new permutations, so it has
+    *        to keep being called every frame.
+  */
+  bool
+    watch(ShaderPermutationProgram& program);
+
+  /*
+    *  @brief Stops reloading every program. Call before destroying them.
+  */
+  void
+    clear();
+
+  /*
+    *  @brief Starts the recompiles of changed sources and swaps in the
+    *         programs that finished. Call once per frame, between frames.
+  */
+  void
+    update(Device& device);
+
+  /*
+    *  @brief Returns the counters.
+  */
+  const ReloadStats&
+    getStats() const { return m_stats; }
+
+  /*
+    *  @brief Whether a changed file can affect a shader.
+  */
+  static bool
+    isShaderFile(const std::string& path);
+
+private:
+  /*
+    *  @brief A ShaderProgram, with the single-permutation compiler that
+    *         rebuilds it.
+  */
+  struct WatchedProgram {
+    ShaderProgram* program = nullptr;
+    std::string directory;
+    std::unique_ptr<ShaderPermutationCompiler> compiler;
+    /*
+      *  @brief Hash of the bytecode swapped in last; zero until the first swap.
+    */
+    uint64_t bytecodeHash = 0;
+  };
+
+  /*
+    *  @brief A ShaderPermutationProgram and the directory of its source.
+  */
+  struct WatchedPermutations {
+    ShaderPermutationProgram* program = nullptr;
+    std::string directory;
+  };
+
+  /*
+    *  @brief Normalized directory of a file, "." for the working directory.
+  */
+  static std::string
+    directoryOf(const std::string& path);
+
+private:
+  /*
+    *  @brief Bytecode cache, not owned.
+  */
+  ShaderCache* m_shaderCache;
+
+  FileWatcher m_watcher;
+
+  /*
+    *  @brief Scratch lists of the changed files and of their directories.
+  */
+  std::vector<std::string> m_changed;
+  std::vector<std::string> m_changedDirectories;
+
+  /*
+    *  @brief Scratch list of the finished compiles of a program.
+  */
+  std::vector<ShaderPermutationCompiler::CompiledPermutation> m_completed;
+
+  std::vector<WatchedPermutations> m_permutationPrograms;
+
+  std::vector<std::unique_ptr<WatchedProgram>> m_programs;
+
+  ReloadStats m_stats;
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include "Prerequisites.h"
+#include "ShaderPermutations.h"
+#include <memory>
+#include <unordered_map>
+
+class Device;
+class DeviceContext;
+
+/*
+  *  @brief A shader program with keyword permutations, compiled in parallel
+  *         and looked up by PermutationKey at draw time.
+  *  @note Permutations are compiled by a ShaderPermutationCompiler with
+  *        D3DX11CompileFromFile; update, on the render thread, creates the
+  *        shaders and input layout of the ones that finished. render binds a
+  *        ready permutation, or requests a missing one and returns false so
+  *        the caller can skip the draw for the frames it takes to compile.
+  *        prepare compiles a set of keys up front and blocks until they exist.
+  *        reload recompiles the ready keys in the background and update
+  *        replaces each one only once its new shaders exist.
+*/
+class
+  ShaderPermutationProgram {
+public:
+  /*
+    *  @brief Default constructor for ShaderPermutationProgram.
+  */
+  ShaderPermutationProgram() = default;
+
+  /*
+    *  @brief Default destructor. Call destroy to release the shaders.
+  */
+  ~ShaderPermutationProgram() = default;
+
+  ShaderPermutationProgram(const ShaderPermutationProgram&) = delete;
+  ShaderPermutationProgram& operator=(const ShaderPermutationProgram&) = delete;
+
+  /*
+    *  @brief Declares the program. Nothing is compiled until a key is requested.
+    *  @param device Device the shaders will be created on.
+    *  @param fileName Shader file with "VS" and "PS" entry points.
+    *  @param keywords Feature keywords, bit 0 first.
+    *  @param Layout Vertex input of every permutation.
+    *  @param shaderCache Bytecode cache, kept alive by the caller; may be nullptr.
+    *  @param threadCount Compile threads. Zero picks one per hardware thread.
+    *  @return HRESULT indicating success or failure.
+  */
+  HRESULT
+    init(Device& device,
+      const std::string& fileName,
+      const std::vector<std::string>& keywords,
+      std::vector<D3D11_INPUT_ELEMENT_DESC> Layout,
+      ShaderCache* shaderCache = nullptr,
+      unsigned int threadCount = 0);
+
+  /*
+    *  @brief Key of a set of enabled keywords (see ShaderPermutationCompiler::keyFor).
+  */
+  PermutationKey
+    keyFor(const std::vector<std::string>& enabledKeywords) const;
+
+  /*
+    *  @brief Starts compiling a permutation in the background.
+  */
+  void
+    request(PermutationKey key);
+
+  /*
+    *  @brief Compiles permutations and creates their shaders before returning.
+    *  @return HRESULT E_FAIL if one of them did not compile.
+  */
+  HRESULT
+    prepare(Device& device, const std::vector<PermutationKey>& keys);
+
+  /*
+    *  @brief Creates the shaders of the permutations that finished compiling.
+    *         Call once per frame on the render thread.
+  */
+  void
+    update(Device& device);
+
+  /*
+    *  @brief Binds the shaders and input layout of a permutation.
+    *  @return bool False if the permutation is not ready yet; it is requested.
+  */
+  bool
+    render(DeviceContext& deviceContext, PermutationKey key);
+
+  /*
+    *  @brief Recompiles every ready permutation from the current sources.
+    *  @note The current shaders stay bound until update swaps in the new
+    *        ones; a permutation that fails to compile keeps its old shaders.
+  */
+  void
+    reload();
+
+  /*
+    *  @brief Releases every permutation and stops the compiler.
+  */
+  void
+    destroy();
+
+  /*
+    *  @brief Path of the shader file, empty before init.
+  */
+  std::string
+    getFileName() const { return m_compiler ? m_compiler->sourcePath() : std::string(); }
+
+  /*
+    *  @brief Whether a permutation can be bound.
+  */
+  bool
+    isReady(PermutationKey key) const { return m_variants.count(key) != 0; }
+
+  /*
+    *  @brief Returns the compiler counters.
+  */
+  ShaderPermutationCompiler::CompilerStats
+    getCompilerStats() const;
+
+  /*
+    *  @brief Compiles one stage with D3DX11CompileFromFile.
+    *  @note Used as the ShaderPermutationCompiler::CompileFunction; safe on
+    *        any thread.
+  */
+  static bool
+    compileStage(const ShaderCache::CompileRequest& request,
+      std::vector<char>& outBytecode,
+      std::string& outErrors);
+
+private:
+  /*
+    *  @brief GPU objects of one permutation.
+  */
+  struct Variant {
+    ID3D11VertexShader* vertexShader = nullptr;
+    ID3D11PixelShader* pixelShader = nullptr;
+    ID3D11InputLayout* inputLayout = nullptr;
+  };
+
+  /*
+    *  @brief Creates the objects of a compiled permutation.
+  */
+  HRESULT
+    createVariant(Device& device,
+      const ShaderPermutationCompiler::CompiledPermutation& compiled,
+      Variant& outVariant);
+
+  /*
+    *  @brief Releases the objects of a permutation.
+  */
+  static void
+    releaseVariant(Variant& variant);
+
+private:
+  /*
+    *  @brief Compiler of the permutations.
+  */
+  std::unique_ptr<ShaderPermutationCompiler> m_compiler;
+
+  /*
+    *  @brief Vertex input of every permutation.
+  */
+  std::vector<D3D11_INPUT_ELEMENT_DESC> m_layout;
+
+  /*
+    *  @brief Ready permutations by key. Only touched on the render thread.
+  */
+  std::unordered_map<PermutationKey, Variant> m_variants;
+
+  /*
+    *  @brief Scratch list of the permutations finished since the last update.
+  */
+  std::vector<ShaderPermutationCompiler::CompiledPermutation> m_completed;
+};
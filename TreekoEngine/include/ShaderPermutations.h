@@ -0,0 +1,234 @@
+#pragma once
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+  *  @brief Compact key of a permutation: bit i set means keyword i is enabled.
+*/
+using PermutationKey = uint32_t;
+
+/*
+  *  @brief Compiles the permutations of a shader file on a thread pool.
+  *  @note A program declares up to 31 feature keywords; a permutation is
+  *        compiled with "#define KEYWORD 1" for each keyword of its key, so
+  *        the shader strips disabled features with #if instead of branching.
+  *        Each request compiles the vertex and pixel stage on a worker,
+  *        through the ShaderCache when one is set. Requests are deduplicated:
+  *        asking for a key already requested returns the same future.
+  *        Finished permutations are queued for takeCompleted, which the
+  *        render thread calls to create the GPU objects.
+  *        Thread-safe. Only depends on the standard library; the compiler
+  *        is a callback, so scheduling and deduplication can run on Linux.
+*/
+class
+  ShaderPermutationCompiler {
+public:
+  /*
+    *  @brief Compiles one stage.
+    *  @param request Source, entry point, profile, flags and defines.
+    *  @param outBytecode Receives the bytecode.
+    *  @param outErrors Receives the compiler messages on failure.
+    *  @return bool False if the compile failed.
+  */
+  using CompileFunction = std::function<bool(const ShaderCache::CompileRequest& request,
+    std::vector<char>& outBytecode,
+    std::string& outErrors)>;
+
+  /*
+    *  @brief Key returned by keyFor for an unknown keyword.
+  */
+  static const PermutationKey kInvalidKey = 0xFFFFFFFFu;
+
+  /*
+    *  @brief Most keywords a program can declare.
+  */
+  static const unsigned int kMaxKeywords = 31;
+
+  /*
+    *  @brief Result of one permutation.
+  */
+  struct CompiledPermutation {
+    PermutationKey key = 0;
+    bool succeeded = false;
+    std::vector<char> vertexBytecode;
+    std::vector<char> pixelBytecode;
+    std::string errors;
+  };
+
+  /*
+    *  @brief Counters since the compiler was created.
+  */
+  struct CompilerStats {
+    unsigned int requests = 0;
+    /*
+      *  @brief Requests served by a key already requested.
+    */
+    unsigned int deduplicated = 0;
+    /*
+      *  @brief Stages read from the cache, and stages actually compiled.
+    */
+    unsigned int cacheHits = 0;
+    unsigned int compiles = 0;
+    unsigned int failed = 0;
+    /*
+      *  @brief Worker time spent compiling and reading the cache.
+    */
+    double workerMs = 0.0;
+  };
+
+  /*
+    *  @brief Creates the compiler of a shader file.
+    *  @param sourcePath Path of the shader file.
+    *  @param keywords Feature keywords, bit 0 first. Keywords past
+    *         kMaxKeywords are ignored, so keyFor rejects them.
+    *  @param compile Compiles one stage.
+    *  @param shaderCache Bytecode cache, kept alive by the caller; may be nullptr.
+    *  @param threadCount Workers. Zero picks one per hardware thread.
+  */
+  ShaderPermutationCompiler(const std::string& sourcePath,
+    const std::vector<std::string>& keywords,
+    CompileFunction compile,
+    ShaderCache* shaderCache = nullptr,
+    unsigned int threadCount = 0);
+
+  /*
+    *  @brief Finishes the compiles in flight.
+  */
+  ~ShaderPermutationCompiler() = default;
+
+  ShaderPermutationCompiler(const ShaderPermutationCompiler&) = delete;
+  ShaderPermutationCompiler& operator=(const ShaderPermutationCompiler&) = delete;
+
+  /*
+    *  @brief Sets the entry points, profiles and flags used by later requests
+    *         (default "VS" vs_4_0, "PS" ps_4_0, no flags).
+  */
+  void
+    setStages(const std::string& vertexEntry,
+      const std::string& vertexProfile,
+      const std::string& pixelEntry,
+      const std::string& pixelProfile,
+      uint32_t flags);
+
+  /*
+    *  @brief Key of a set of enabled keywords.
+    *  @return PermutationKey kInvalidKey if a keyword was not declared.
+  */
+  PermutationKey
+    keyFor(const std::vector<std::string>& enabledKeywords) const;
+
+  /*
+    *  @brief Defines a permutation is compiled with, in keyword order.
+  */
+  std::vector<ShaderCache::ShaderDefine>
+    definesFor(PermutationKey key) const;
+
+  /*
+    *  @brief Starts compiling a permutation unless it was already requested.
+    *  @return std::shared_future Becomes true once the permutation compiled,
+    *          false if it failed or the key is invalid.
+  */
+  std::shared_future<bool>
+    request(PermutationKey key);
+
+  /*
+    *  @brief Forgets every request, so requesting a key again compiles it
+    *         from the current sources. Compiles already running finish, but
+    *         their results are dropped instead of queued.
+  */
+  void
+    invalidate();
+
+  /*
+    *  @brief Moves the permutations finished since the last call into outCompleted.
+  */
+  void
+    takeCompleted(std::vector<CompiledPermutation>& outCompleted);
+
+  /*
+    *  @brief Blocks until every request so far has finished.
+  */
+  void
+    idle();
+
+  /*
+    *  @brief Declared keywords, bit 0 first.
+  */
+  const std::vector<std::string>&
+    keywords() const { return m_keywords; }
+
+  /*
+    *  @brief Path of the shader file.
+  */
+  const std::string&
+    sourcePath() const { return m_sourcePath; }
+
+  /*
+    *  @brief Returns the counters.
+  */
+  CompilerStats
+    getStats() const;
+
+private:
+  /*
+    *  @brief Compiles one stage through the cache.
+  */
+  bool
+    compileStage(const ShaderCache::CompileRequest& request,
+      std::vector<char>& outBytecode,
+      std::string& outErrors);
+
+  /*
+    *  @brief Worker job of a request.
+  */
+  void
+    compilePermutation(PermutationKey key,
+      uint32_t generation,
+      std::shared_ptr<std::promise<bool>> done);
+
+private:
+  std::string m_sourcePath;
+  std::vector<std::string> m_keywords;
+  CompileFunction m_compile;
+  ShaderCache* m_shaderCache;
+
+  /*
+    *  @brief Guards every member below.
+  */
+  mutable std::mutex m_mutex;
+  std::condition_variable m_idle;
+
+  std::string m_vertexEntry = "VS";
+  std::string m_vertexProfile = "vs_4_0";
+  std::string m_pixelEntry = "PS";
+  std::string m_pixelProfile = "ps_4_0";
+  uint32_t m_flags = 0;
+
+  /*
+    *  @brief Every key requested so far.
+  */
+  std::unordered_map<PermutationKey, std::shared_future<bool>> m_requests;
+  std::vector<CompiledPermutation> m_completed;
+  unsigned int m_inFlight = 0;
+
+  /*
+    *  @brief Bumped by invalidate; results of older requests are dropped.
+  */
+  uint32_t m_generation = 0;
+  CompilerStats m_stats;
+
+  /*
+    *  @brief Workers. Declared last so it is destroyed (and its jobs
+    *         finished) before the members they use.
+  */
+  ThreadPool m_workers;
+};
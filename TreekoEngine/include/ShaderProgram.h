@@ -5,6 +5,7 @@
 // Forward declarations
 class Device;
 class DeviceContext;
+class ShaderCache;
 
 /*
   @class ShaderProgram
@@ -37,6 +38,14 @@ public:
       const std::string& fileName,
       std::vector<D3D11_INPUT_ELEMENT_DESC> Layout);
 
+  /*
+    @brief Sets the bytecode cache used by CompileShaderFromFile.
+    @details With a cache, a shader whose source, includes and options did not change since the last compile is created from the cached bytecode without compiling.
+    @param shaderCache The cache, kept alive by the caller; nullptr always compiles.
+  */
+  void
+    setShaderCache(ShaderCache* shaderCache) { m_shaderCache = shaderCache; }
+
   /*
     @brief Updates the shader program.
   */
@@ -57,6 +66,25 @@ public:
   void
     render(DeviceContext& deviceContext, ShaderType type);
 
+  /*
+    @brief Replaces the shaders and input layout with ones created from new bytecode.
+    @details Every new object is created before the current ones are released, so on failure the program keeps the shaders it had. Call it between frames on the render thread.
+    @param device The device to create the shaders and input layout on.
+    @param vertexBytecode Compiled vertex shader.
+    @param pixelBytecode Compiled pixel shader.
+    @return HRESULT indicating success or failure of the operation.
+  */
+  HRESULT
+    reload(Device& device,
+      const std::vector<char>& vertexBytecode,
+      const std::vector<char>& pixelBytecode);
+
+  /*
+    @brief Returns the name of the shader file the program was created from.
+  */
+  const std::string&
+    getFileName() const { return m_shaderFileName; }
+
   /*
     @brief Destroys the shader program and releases associated resources.
   */
@@ -89,7 +117,7 @@ public:
 
   /*
     @brief Compiles a shader from a file.
-    @details This method compiles the shader code from the specified file using the given entry point and shader model.
+    @details This method compiles the shader code from the specified file using the given entry point and shader model, or reads the bytecode from the shader cache when it is up to date.
     @param szFileName The name of the shader file to compile.
     @param szEntryPoint The entry point function name in the shader code.
     @param szShaderModel The shader model to use for compilation (e.g., "vs_5_0" for vertex shader, "ps_5_0" for pixel shader).
@@ -123,6 +151,11 @@ private:
   */
   std::string m_shaderFileName;
 
+  /*
+    @brief Input layout description, kept to recreate the layout on reload.
+  */
+  std::vector<D3D11_INPUT_ELEMENT_DESC> m_layout;
+
   /*
     @brief Compiled vertex shader bytecode.
   */
@@ -132,4 +165,9 @@ private:
     @brief Compiled pixel shader bytecode.
   */
   ID3DBlob* m_pixelShaderData = nullptr;
+
+  /*
+    @brief Bytecode cache, not owned.
+  */
+  ShaderCache* m_shaderCache = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+#include "CorePrerequisites.h"
+
+/*
+  *  @brief A contiguous range of the mesh index buffer drawn with one material.
+  *  @note Ranges are sorted by indexOffset and never overlap. Each level of
+  *        detail has its own ranges, so a draw range is split at submesh
+  *        boundaries to find the material of every triangle (see RenderQueue).
+  *        The layout is written as is to the .tmesh cache (see MeshCache).
+*/
+struct Submesh
+{
+  /*
+    *  @brief First index of the range in the mesh index buffer.
+  */
+  unsigned int indexOffset;
+  /*
+    *  @brief Number of indices in the range (three per triangle).
+  */
+  unsigned int indexCount;
+  /*
+    *  @brief Index of the material in MeshComponent::m_materials.
+  */
+  unsigned int materialIndex;
+};
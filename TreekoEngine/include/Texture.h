@@ -1,5 +1,6 @@
 #pragma once
 #include "Prerequisites.h"
+#include "TextureDecoder.h"
 
 class Device;
 class DeviceContext;
@@ -28,12 +29,51 @@ public:
     *  @param device Reference to the device used for resource creation.
     *  @param textureName Name of the texture file.
     *  @param extensionType Type of the file extension.
+    *  @param maxMipLevels For PNG/JPG, the most mip levels to keep resident,
+    *         dropping the finest ones first (0 keeps the whole chain).
     *  @return HRESULT indicating success or failure.
+    *  @note PNG/JPG textures load from their .ttex cache when it is up to date,
+    *        and bake it on the first load otherwise.
   */
   HRESULT
     init(Device& device,
       const std::string& textureName,
-      ExtensionType extensionType);
+      ExtensionType extensionType,
+      unsigned int maxMipLevels = 0);
+
+  /*
+    *  @brief Creates the texture from data made by TextureDecoder.
+    *  @param device Reference to the device used for resource creation.
+    *  @param fileName Path of the image, kept as the texture name.
+    *  @param data Mip chain to upload.
+    *  @param maxMipLevels Most levels to keep, dropping the finest ones first
+    *         (0 keeps the whole chain).
+    *  @return HRESULT indicating success or failure.
+  */
+  HRESULT
+    init(Device& device,
+      const std::string& fileName,
+      const TextureDecoder::TextureData& data,
+      unsigned int maxMipLevels = 0);
+
+  /*
+    *  @brief Creates a Texture2DArray from RGBA8 slices of the same size, with
+    *         mip chains and one block format every slice fits.
+    *  @param device Reference to the device used for resource creation.
+    *  @param textureName Name kept for the texture.
+    *  @param slices Top level of every slice, width * 4 bytes per row.
+    *  @param width Width of the slices.
+    *  @param height Height of the slices.
+    *  @param levelCount Levels to keep, finest first (0 keeps the full chain).
+    *  @return HRESULT indicating success or failure.
+  */
+  HRESULT
+    initArray(Device& device,
+      const std::string& textureName,
+      const std::vector<const unsigned char*>& slices,
+      unsigned int width,
+      unsigned int height,
+      unsigned int levelCount = 0);
 
   
   /*
@@ -91,6 +131,18 @@ public:
   void
     destroy();
 
+private:
+
+  /*
+    *  @brief Creates the texture and its view from a finest-first mip chain,
+    *         skipping the finest levels beyond maxMipLevels.
+  */
+  HRESULT
+    createFromLevels(Device& device,
+      DXGI_FORMAT format,
+      const std::vector<TextureCache::CacheLevel>& levels,
+      unsigned int maxMipLevels);
+
 public:
  
   /*
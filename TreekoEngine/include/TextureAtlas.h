@@ -0,0 +1,196 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+  *  @brief How TextureAtlas lays out its images.
+*/
+enum AtlasLayout {
+  /*
+    *  @brief Images share 2D pages, each in its own padded cell; meshes read
+    *         them through a UV scale and offset.
+  */
+  ATLAS_PAGES = 0,
+  /*
+    *  @brief One image per slice of a Texture2DArray; every image must have
+    *         the same size. UVs are untouched, so tiling still works.
+  */
+  ATLAS_ARRAY = 1
+};
+
+/*
+  *  @brief Packs small RGBA8 images into shared pages so that objects with
+  *         different textures can be drawn with a single texture bind.
+  *  @note Pages: cells are placed with a first-fit shelf packer, tallest
+  *        images first. Each image sits in a cell aligned to 2^(mipLevels-1)
+  *        texels (and to 4x4 blocks) with a gutter of that width on every
+  *        side, filled by repeating its edges. Every mip level up to
+  *        mipLevels - 1 then keeps whole texels of one image per cell and at
+  *        least one texel of gutter, so pages built with that many levels
+  *        (see TextureDecoder::buildData) never bleed between neighbours, with
+  *        bilinear filtering or block compression.
+  *        Only depends on the standard library so an offline tool can bake
+  *        the pages on Linux.
+*/
+class
+  TextureAtlas {
+public:
+
+  /*
+    *  @brief An RGBA8 image with tightly packed rows.
+  */
+  struct AtlasImage {
+    const unsigned char* pixels = nullptr;
+    unsigned int width = 0;
+    unsigned int height = 0;
+  };
+
+  /*
+    *  @brief Where an image went: its page (or slice), its texel rectangle,
+    *         and the transform taking its UVs into the page,
+    *         uv' = uv * scale + offset.
+  */
+  struct AtlasEntry {
+    unsigned int page = 0;
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    float scaleU = 1.0f;
+    float scaleV = 1.0f;
+    float offsetU = 0.0f;
+    float offsetV = 0.0f;
+  };
+
+  /*
+    *  @brief Results of the last call to pack.
+  */
+  struct AtlasStats {
+    size_t images = 0;
+    size_t pages = 0;
+    /*
+      *  @brief Texels of the images, and of the pages holding them.
+    */
+    size_t imageTexels = 0;
+    size_t pageTexels = 0;
+  };
+
+  /*
+    *  @brief Default constructor for TextureAtlas.
+  */
+  TextureAtlas() = default;
+
+  /*
+    *  @brief Default destructor for TextureAtlas.
+  */
+  ~TextureAtlas() = default;
+
+  /*
+    *  @brief Packs images and composes the pages (replaces the previous result).
+    *  @param images Images to pack; entries() follows the same order.
+    *  @param imageCount Number of images.
+    *  @param layout Shared pages or array slices.
+    *  @return bool False if an image is empty, larger than a page with its
+    *          gutter, or (ATLAS_ARRAY) not the size of the first one.
+  */
+  bool
+    pack(const AtlasImage* images, size_t imageCount, AtlasLayout layout);
+
+  /*
+    *  @brief Sets the size of the pages (default 2048). Rounded up to the
+    *         cell alignment.
+  */
+  void
+    setPageSize(unsigned int pageSize) { m_pageSize = pageSize; }
+
+  /*
+    *  @brief Sets the mip levels the pages must keep free of bleeding
+    *         (default 5, a 16 texel gutter).
+  */
+  void
+    setMipLevels(unsigned int mipLevels) { m_mipLevels = mipLevels; }
+
+  /*
+    *  @brief Mip levels the packed pages support.
+  */
+  unsigned int
+    mipLevels() const { return m_mipLevels; }
+
+  /*
+    *  @brief Size of every page (of every slice with ATLAS_ARRAY).
+  */
+  unsigned int
+    pageWidth() const { return m_pageWidth; }
+  unsigned int
+    pageHeight() const { return m_pageHeight; }
+
+  /*
+    *  @brief One entry per packed image.
+  */
+  const std::vector<AtlasEntry>&
+    entries() const { return m_entries; }
+
+  /*
+    *  @brief RGBA8 pixels of every page, pageWidth * 4 bytes per row.
+  */
+  const std::vector<std::vector<unsigned char>>&
+    pages() const { return m_pages; }
+
+  /*
+    *  @brief Returns the statistics of the last call to pack.
+  */
+  const AtlasStats&
+    getLastStats() const { return m_lastStats; }
+
+private:
+  /*
+    *  @brief A row of cells of one page.
+  */
+  struct AtlasShelf {
+    unsigned int page;
+    unsigned int y;
+    unsigned int height;
+    unsigned int usedWidth;
+  };
+
+  /*
+    *  @brief Places the cells of ATLAS_PAGES and composes the pages.
+  */
+  bool
+    packPages(const AtlasImage* images, size_t imageCount);
+
+  /*
+    *  @brief Copies an image into its cell and repeats its edges over the gutter.
+  */
+  void
+    blitCell(const AtlasImage& image, const AtlasEntry& entry, unsigned int gutter);
+
+private:
+  /*
+    *  @brief Requested page size and mip levels.
+  */
+  unsigned int m_pageSize = 2048;
+  unsigned int m_mipLevels = 5;
+
+  /*
+    *  @brief Size of the pages of the last pack.
+  */
+  unsigned int m_pageWidth = 0;
+  unsigned int m_pageHeight = 0;
+
+  /*
+    *  @brief Result of the last pack.
+  */
+  std::vector<AtlasEntry> m_entries;
+  std::vector<std::vector<unsigned char>> m_pages;
+
+  /*
+    *  @brief Shelves of the pages being packed.
+  */
+  std::vector<AtlasShelf> m_shelves;
+
+  /*
+    *  @brief Statistics of the last call to pack.
+  */
+  AtlasStats m_lastStats;
+};
@@ -0,0 +1,216 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  *  @brief Pre-mipped, pre-compressed texture cache (.ttex) written next to the
+  *         source image.
+  *  @note The file is a plain DDS with the DX10 extension header, so any DDS
+  *        viewer opens it: "DDS ", DDS_HEADER, DDS_HEADER_DXT10, then every mip
+  *        level back to back, finest first. The cache tag, version and the
+  *        stamp of the source image live in the reserved words of DDS_HEADER.
+  *        A valid cache is memory-mapped and its levels are handed to
+  *        CreateTexture2D straight from the mapping, with no decode and no copy.
+  *        Only depends on the standard library; formats are DXGI_FORMAT values.
+*/
+class
+  TextureCache {
+public:
+  /*
+    *  @brief "DDS " read as a little-endian uint32.
+  */
+  static const uint32_t kDdsMagic = 0x20534444u;
+
+  /*
+    *  @brief "TTEX" read as a little-endian uint32, stored in the reserved words.
+  */
+  static const uint32_t kTag = 0x58455454u;
+
+  /*
+    *  @brief Bumped whenever the layout or the encoding settings change.
+  */
+  static const uint32_t kVersion = 1;
+
+  /*
+    *  @brief DDS_PIXELFORMAT.
+  */
+  struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+  };
+
+  /*
+    *  @brief DDS_HEADER, with the cache fields in place of dwReserved1.
+    *  @note Packed to 4 bytes: the 64-bit stamp fields sit at offsets that are
+    *        not multiples of 8 in the DDS layout.
+  */
+#pragma pack(push, 4)
+  struct DdsHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t tag;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t reserved[3];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+  };
+#pragma pack(pop)
+
+  /*
+    *  @brief DDS_HEADER_DXT10.
+  */
+  struct DdsHeaderDx10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+  };
+
+  /*
+    *  @brief One mip level: its size, the pitch of a row (of texels or of 4x4
+    *         blocks) and its bytes.
+  */
+  struct CacheLevel {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int rowPitch = 0;
+    const void* data = nullptr;
+    size_t size = 0;
+  };
+
+  /*
+    *  @brief Default constructor. No cache is mapped.
+  */
+  TextureCache() = default;
+
+  /*
+    *  @brief Default destructor. Unmaps the cache file.
+  */
+  ~TextureCache() = default;
+
+  /*
+    *  @brief Returns the cache path used for a source image ("stone.jpg.ttex").
+  */
+  static std::string
+    cachePathFor(const std::string& sourcePath) { return sourcePath + ".ttex"; }
+
+  /*
+    *  @brief Maps a cache file and checks it against its source image.
+    *  @param cachePath Path of the .ttex file.
+    *  @param sourcePath Path of the image the cache was built from.
+    *  @return bool True if the cache is valid and up to date. A cache whose source
+    *          timestamp changed is still accepted when the source content hash matches.
+  */
+  bool
+    open(const std::string& cachePath, const std::string& sourcePath);
+
+  /*
+    *  @brief Unmaps the cache file. Pointers returned earlier become invalid.
+  */
+  void
+    close();
+
+  /*
+    *  @brief Writes a mip chain to a cache file tagged with its source image.
+    *  @param cachePath Path of the .ttex file to create or replace.
+    *  @param sourcePath Path of the image the chain was built from.
+    *  @param dxgiFormat DXGI_FORMAT of the levels (RGBA8 or BCn).
+    *  @param levels Every level, finest first, each one half the previous.
+    *  @return bool True if the file was written.
+  */
+  static bool
+    write(const std::string& cachePath,
+      const std::string& sourcePath,
+      uint32_t dxgiFormat,
+      const std::vector<CacheLevel>& levels);
+
+  /*
+    *  @brief DXGI_FORMAT of the mapped cache.
+  */
+  uint32_t
+    dxgiFormat() const { return m_dx10 ? m_dx10->dxgiFormat : 0; }
+
+  /*
+    *  @brief Mip levels of the mapped cache.
+  */
+  const std::vector<CacheLevel>&
+    levels() const { return m_levels; }
+
+  /*
+    *  @brief Index of the finest level to load so at most maxLevels are
+    *         resident, e.g. to skip the largest levels when memory is tight.
+    *  @param maxLevels Levels to keep (0 keeps them all).
+    *  @note Block-compressed textures only start on a level whose size is a
+    *        multiple of 4, as D3D11 requires, so one or two extra levels may
+    *        be kept.
+  */
+  static unsigned int
+    firstLevelFor(const std::vector<CacheLevel>& levels, unsigned int maxLevels, bool blockCompressed);
+
+  /*
+    *  @brief Whether a DXGI_FORMAT is one of the BC formats the cache stores.
+  */
+  static bool
+    isBlockCompressed(uint32_t dxgiFormat);
+
+private:
+  /*
+    *  @brief Reads size and last write time of the source image.
+    *  @return bool False if the source does not exist.
+  */
+  static bool
+    getSourceStamp(const std::string& sourcePath, uint64_t& outSize, int64_t& outTime);
+
+  /*
+    *  @brief Hashes the whole content of the source image.
+  */
+  static bool
+    hashSource(const std::string& sourcePath, uint64_t& outHash);
+
+  /*
+    *  @brief Bytes per row and per level of a format at a given size.
+    *  @return bool False for formats the cache does not store.
+  */
+  static bool
+    levelLayout(uint32_t dxgiFormat, unsigned int width, unsigned int height,
+      unsigned int& outRowPitch, size_t& outSize);
+
+private:
+  /*
+    *  @brief Mapping of the cache file.
+  */
+  MappedFile m_file;
+
+  /*
+    *  @brief Headers inside the mapping (nullptr when closed).
+  */
+  const DdsHeader* m_header = nullptr;
+  const DdsHeaderDx10* m_dx10 = nullptr;
+
+  /*
+    *  @brief Levels inside the mapping.
+  */
+  std::vector<CacheLevel> m_levels;
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include "TextureDecoder.h"
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/*
+  *  @brief Runs TextureDecoder on a pool of worker threads within a memory
+  *         budget: the worker half of TextureLoader.
+  *  @note Workers map the .ttex cache, or decode the image and bake the
+  *        cache, and queue the result for takeDecoded. Decoded data counts
+  *        against the budget until release: a worker only starts a decode once
+  *        its estimated peak fits, so a burst of requests cannot hold every
+  *        image in memory at once. Only depends on the standard library, so
+  *        the loading throughput can be measured on Linux.
+*/
+class
+  TextureDecodeQueue {
+public:
+  /*
+    *  @brief Totals since construction.
+  */
+  struct DecodeStats {
+    size_t requests = 0;
+    size_t cacheHits = 0;
+    size_t decoded = 0;
+    size_t failed = 0;
+    /*
+      *  @brief Bytes reserved by decodes and by data not released yet.
+    */
+    size_t bytesInFlight = 0;
+    size_t peakBytesInFlight = 0;
+    /*
+      *  @brief Time spent on the workers, summed over threads, in milliseconds.
+    */
+    double workerMs = 0.0;
+  };
+
+  /*
+    *  @brief Result of one request, owned by the caller of takeDecoded.
+  */
+  struct DecodedTexture {
+    /*
+      *  @brief Value passed to submit.
+    */
+    uint64_t ticket = 0;
+    std::string fileName;
+    TextureDecoder::TextureData data;
+    bool succeeded = false;
+    bool cacheHit = false;
+    /*
+      *  @brief Budget held until release.
+    */
+    size_t reservedBytes = 0;
+  };
+
+  /*
+    *  @brief Starts the worker threads.
+    *  @param threadCount Number of workers. Zero picks one per hardware thread.
+    *  @param memoryBudget Bytes of decoded data allowed in flight.
+  */
+  explicit
+    TextureDecodeQueue(unsigned int threadCount = 0, size_t memoryBudget = 256ull * 1024 * 1024);
+
+  /*
+    *  @brief Drops the queued requests and joins the workers. Results not
+    *         taken yet are discarded.
+  */
+  ~TextureDecodeQueue();
+
+  TextureDecodeQueue(const TextureDecodeQueue&) = delete;
+  TextureDecodeQueue& operator=(const TextureDecodeQueue&) = delete;
+
+  /*
+    *  @brief Queues a PNG/JPG image.
+    *  @param ticket Value handed back with the result.
+    *  @param fileName Path of the image, with its extension.
+  */
+  void
+    submit(uint64_t ticket, const std::string& fileName);
+
+  /*
+    *  @brief Moves finished requests, in completion order, to outDecoded
+    *         (appended). Never blocks.
+    *  @param maxCount Most results to take (0 for all).
+    *  @return size_t Results taken.
+  */
+  size_t
+    takeDecoded(std::vector<std::unique_ptr<DecodedTexture>>& outDecoded, size_t maxCount = 0);
+
+  /*
+    *  @brief Frees the data of a taken result and returns its budget.
+  */
+  void
+    release(DecodedTexture& decoded);
+
+  /*
+    *  @brief Sets the bytes of decoded data allowed in flight. A single
+    *         image larger than the budget still decodes, alone.
+  */
+  void
+    setMemoryBudget(size_t memoryBudget);
+
+  /*
+    *  @brief Returns a snapshot of the statistics.
+  */
+  DecodeStats
+    getStats() const;
+
+private:
+  /*
+    *  @brief Worker side of a request: cache or decode, then queue the result.
+  */
+  void
+    decodeRequest(std::unique_ptr<DecodedTexture> request);
+
+  /*
+    *  @brief Waits until bytes fit the budget, then reserves them.
+    *  @return bool False if the queue is shutting down.
+  */
+  bool
+    reserve(size_t bytes);
+
+  /*
+    *  @brief Returns reserved bytes to the budget and wakes waiting workers.
+  */
+  void
+    releaseBytes(size_t bytes);
+
+private:
+  /*
+    *  @brief Guards everything below except m_workers.
+  */
+  mutable std::mutex m_mutex;
+
+  /*
+    *  @brief Signalled when reserved bytes are released or on shutdown.
+  */
+  std::condition_variable m_budgetFreed;
+
+  /*
+    *  @brief Bytes of decoded data allowed in flight.
+  */
+  size_t m_memoryBudget;
+
+  /*
+    *  @brief Finished requests, in completion order.
+  */
+  std::deque<std::unique_ptr<DecodedTexture>> m_decoded;
+
+  /*
+    *  @brief Set by the destructor so waiting and queued work aborts.
+  */
+  bool m_stopping = false;
+
+  /*
+    *  @brief Statistics since construction.
+  */
+  DecodeStats m_stats;
+
+  /*
+    *  @brief Decoding threads.
+  */
+  std::unique_ptr<ThreadPool> m_workers;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include "CorePrerequisites.h"
+#include "TextureCache.h"
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+#include <memory>
+
+/*
+  *  @brief CPU half of loading a PNG/JPG texture: the .ttex cache, or decoding,
+  *         mip generation and block compression.
+  *  @note Produces a finest-first mip chain ready for CreateTexture2D, which
+  *        Texture::init uploads. Every function is safe to call from any
+  *        thread. Only depends on the standard library so tools can use it on
+  *        Linux; formats are DXGI_FORMAT values.
+*/
+class
+  TextureDecoder {
+public:
+  /*
+    *  @brief Levels of one texture.
+    *  @note The levels point into the mapped .ttex cache or into the chains
+    *        owned here, so the struct must outlive their upload.
+  */
+  struct TextureData {
+    uint32_t dxgiFormat = 0;
+    std::vector<TextureCache::CacheLevel> levels;
+    std::unique_ptr<TextureCache> cache;
+    MipGenerator::MipChain mipChain;
+    BlockCompressor::BlockChain blockChain;
+
+    /*
+      *  @brief Bytes the levels keep alive (mapped or allocated).
+    */
+    size_t
+      residentBytes() const;
+  };
+
+  /*
+    *  @brief Loads the up to date .ttex cache of an image, if there is one.
+    *  @param fileName Path of the PNG/JPG image, with its extension.
+    *  @param outData Receives the mapped levels.
+    *  @return bool False if there is no valid cache.
+  */
+  static bool
+    loadCached(const std::string& fileName, TextureData& outData);
+
+  /*
+    *  @brief Reads the size of an image held in memory without decoding it.
+    *  @return bool False if the content is not an image stb_image reads.
+  */
+  static bool
+    readInfo(const unsigned char* fileBytes, size_t fileSize, unsigned int& outWidth, unsigned int& outHeight);
+
+  /*
+    *  @brief Decodes an image held in memory, generates its mip chain, block
+    *         compresses it and bakes the .ttex cache.
+    *  @param fileName Path of the image, with its extension (names the cache).
+    *  @param fileBytes Content of the PNG/JPG file.
+    *  @param fileSize Size of the content in bytes.
+    *  @param outData Receives the levels.
+    *  @return bool False if the image could not be decoded.
+  */
+  static bool
+    decode(const std::string& fileName,
+      const unsigned char* fileBytes,
+      size_t fileSize,
+      TextureData& outData);
+
+  /*
+    *  @brief Builds the mip chain of RGBA8 pixels and block compresses it when
+    *         the size allows (the CPU half of decode, without the cache).
+    *  @param pixels Top level, width * 4 bytes per row.
+    *  @param width Width of the image.
+    *  @param height Height of the image.
+    *  @param outData Receives the levels.
+    *  @param levelCount Levels to keep, finest first (0 keeps the full chain).
+    *  @return bool False if the mip chain could not be generated.
+  */
+  static bool
+    buildData(const unsigned char* pixels,
+      unsigned int width,
+      unsigned int height,
+      TextureData& outData,
+      unsigned int levelCount = 0);
+};
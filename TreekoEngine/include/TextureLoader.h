@@ -0,0 +1,171 @@
+#pragma once
+#include "Prerequisites.h"
+#include "Texture.h"
+#include "TextureDecodeQueue.h"
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class Device;
+
+/*
+  *  @brief Loads textures in the background: files are mapped and decoded on a
+  *         pool of worker threads, and the GPU resources are created on the
+  *         render thread.
+  *  @note A TextureDecodeQueue runs the CPU half of Texture::init (the .ttex
+  *        cache, or stbi_load_from_memory plus mip generation and block
+  *        compression) within a memory budget; update() creates the textures,
+  *        then completes the futures and runs the callbacks, all on the thread
+  *        calling it. DDS files are loaded by D3DX, directly in update().
+*/
+class
+  TextureLoader {
+public:
+  /*
+    *  @brief Called on the render thread once a request has finished.
+  */
+  using LoadedCallback = std::function<void(HRESULT hr, Texture& texture)>;
+
+  /*
+    *  @brief Totals since construction.
+  */
+  struct LoaderStats {
+    size_t requests = 0;
+    size_t cacheHits = 0;
+    size_t decoded = 0;
+    size_t uploaded = 0;
+    size_t failed = 0;
+    /*
+      *  @brief Bytes reserved by decodes and by data waiting for update().
+    */
+    size_t bytesInFlight = 0;
+    size_t peakBytesInFlight = 0;
+    /*
+      *  @brief Time spent on the workers (summed over threads) and in update,
+      *         in milliseconds.
+    */
+    double workerMs = 0.0;
+    double uploadMs = 0.0;
+  };
+
+  /*
+    *  @brief Starts the worker threads.
+    *  @param threadCount Number of workers. Zero picks one per hardware thread.
+    *  @param memoryBudget Bytes of decoded data allowed in flight.
+  */
+  explicit
+    TextureLoader(unsigned int threadCount = 0, size_t memoryBudget = 256ull * 1024 * 1024);
+
+  /*
+    *  @brief Cancels the queued requests and joins the workers. Requests not
+    *         uploaded yet complete with E_ABORT, without their callbacks.
+  */
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+
+  /*
+    *  @brief Queues a texture.
+    *  @param textureName Name without extension, as passed to Texture::init.
+    *  @param extensionType Type of the file extension.
+    *  @param outTexture Texture to initialize; must stay alive until the
+    *         request completes.
+    *  @param maxMipLevels Most levels to keep (0 keeps them all).
+    *  @param onLoaded Optional callback, run by update().
+    *  @return std::future Ready once update() created the texture. Never wait
+    *          on it from the thread that calls update().
+  */
+  std::future<HRESULT>
+    load(const std::string& textureName,
+      ExtensionType extensionType,
+      Texture& outTexture,
+      unsigned int maxMipLevels = 0,
+      LoadedCallback onLoaded = nullptr);
+
+  /*
+    *  @brief Creates the GPU resources of finished decodes. Call once per
+    *         frame on the render thread.
+    *  @param device Device used for resource creation.
+    *  @param maxUploads Most textures to create in this call (0 for all), to
+    *         spread the uploads over several frames.
+    *  @return size_t Requests completed by this call.
+  */
+  size_t
+    update(Device& device, size_t maxUploads = 0);
+
+  /*
+    *  @brief Returns true when every request has completed.
+  */
+  bool
+    idle() const;
+
+  /*
+    *  @brief Sets the bytes of decoded data allowed in flight. A single
+    *         texture larger than the budget still loads, alone.
+  */
+  void
+    setMemoryBudget(size_t memoryBudget);
+
+  /*
+    *  @brief Returns a snapshot of the statistics.
+  */
+  LoaderStats
+    getStats() const;
+
+private:
+  /*
+    *  @brief One queued texture.
+  */
+  struct LoadRequest {
+    std::string textureName;
+    std::string fileName;
+    ExtensionType extensionType = DDS;
+    Texture* texture = nullptr;
+    unsigned int maxMipLevels = 0;
+    LoadedCallback onLoaded;
+    std::promise<HRESULT> loaded;
+  };
+
+  /*
+    *  @brief Creates the texture of a request and completes it.
+    *  @param decoded Result of the decode queue, or nullptr for a DDS file.
+    *  @return bool False if the request failed.
+  */
+  bool
+    completeRequest(Device& device, LoadRequest& request, TextureDecodeQueue::DecodedTexture* decoded);
+
+private:
+  /*
+    *  @brief Guards everything below except m_decodeQueue.
+  */
+  mutable std::mutex m_mutex;
+
+  /*
+    *  @brief PNG/JPG requests by ticket, until update() completes them.
+  */
+  std::unordered_map<uint64_t, std::unique_ptr<LoadRequest>> m_decoding;
+
+  /*
+    *  @brief DDS requests, created by update() without a decode.
+  */
+  std::deque<std::unique_ptr<LoadRequest>> m_direct;
+
+  /*
+    *  @brief Ticket of the next PNG/JPG request.
+  */
+  uint64_t m_nextTicket = 0;
+
+  /*
+    *  @brief Requests counted here; decode totals come from the queue.
+  */
+  LoaderStats m_stats;
+
+  /*
+    *  @brief Decoding threads and memory budget.
+  */
+  std::unique_ptr<TextureDecodeQueue> m_decodeQueue;
+};
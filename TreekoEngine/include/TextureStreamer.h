@@ -0,0 +1,235 @@
+#pragma once
+#include "TextureCache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+  *  @brief Receives the residency changes decided by TextureStreamer.
+  *  @note Implemented on top of D3D11 by GpuStreamingDevice; any other
+  *        implementation (e.g. one that only counts bytes) lets the residency
+  *        logic run headless.
+*/
+class
+  StreamingDevice {
+public:
+  virtual
+    ~StreamingDevice() = default;
+
+  /*
+    *  @brief Replaces the resident levels of a texture.
+    *  @param textureId Id returned by TextureStreamer::addTexture.
+    *  @param dxgiFormat DXGI_FORMAT of the levels.
+    *  @param levels Finest resident level first, down to the smallest one.
+    *  @param levelCount Number of levels.
+    *  @return bool False if the levels could not be made resident; the
+    *          previous ones must then stay in place.
+  */
+  virtual bool
+    setResidentLevels(unsigned int textureId,
+      uint32_t dxgiFormat,
+      const TextureCache::CacheLevel* levels,
+      unsigned int levelCount) = 0;
+
+  /*
+    *  @brief Frees every level of a texture.
+  */
+  virtual void
+    releaseTexture(unsigned int textureId) = 0;
+};
+
+/*
+  *  @brief Keeps a low resolution tail of every texture resident and streams
+  *         the finer mip levels in and out within a memory budget.
+  *  @note Levels come from the memory-mapped .ttex caches, so streaming a
+  *        level in is a CreateTexture2D straight from the mapping. Every
+  *        frame the caller reports how large each texture appears on screen;
+  *        update() turns that into the level each texture wants, grants the
+  *        wanted levels by priority (larger on screen and closer first) while
+  *        they fit the budget, keeps finer levels already resident while
+  *        there is room left, and applies the changes: coarser residency
+  *        right away, finer residency at most maxUploads textures per frame.
+  *        Only depends on the standard library so it can run on Linux.
+*/
+class
+  TextureStreamer {
+public:
+  /*
+    *  @brief Id returned when a texture cannot be streamed.
+  */
+  static const unsigned int kInvalidTexture = ~0u;
+
+  /*
+    *  @brief Results of the last call to update.
+  */
+  struct StreamerStats {
+    size_t textures = 0;
+    /*
+      *  @brief Bytes resident after the update, and the budget.
+    */
+    size_t residentBytes = 0;
+    size_t memoryBudget = 0;
+    /*
+      *  @brief Bytes every texture at its wanted level would take.
+    */
+    size_t wantedBytes = 0;
+    /*
+      *  @brief Textures made finer, made coarser, and left coarser than
+      *         granted because of the per-frame upload limit.
+    */
+    size_t streamedIn = 0;
+    size_t streamedOut = 0;
+    size_t deferred = 0;
+  };
+
+  /*
+    *  @brief Creates a streamer.
+    *  @param memoryBudget Bytes all resident levels may take. Tails are
+    *         always resident, even past the budget.
+    *  @param tailSize Largest dimension of the levels kept resident for
+    *         every texture.
+  */
+  explicit
+    TextureStreamer(size_t memoryBudget, unsigned int tailSize = 64);
+
+  /*
+    *  @brief Default destructor. Call releaseAll first to free the device side.
+  */
+  ~TextureStreamer() = default;
+
+  /*
+    *  @brief Maps the .ttex cache of an image and registers it for streaming.
+    *  @param sourcePath Path of the PNG/JPG image the cache was baked from.
+    *  @return unsigned int Id of the texture, or kInvalidTexture if there is
+    *          no up to date cache.
+    *  @note Only the tail is made resident, on the next update.
+  */
+  unsigned int
+    addTexture(const std::string& sourcePath);
+
+  /*
+    *  @brief Reports one use of a texture this frame; several uses keep the
+    *         largest.
+    *  @param textureId Id returned by addTexture.
+    *  @param screenSize Size of the object on screen, in pixels.
+    *  @param distance Distance from the camera to the object.
+  */
+  void
+    reportUsage(unsigned int textureId, float screenSize, float distance);
+
+  /*
+    *  @brief Decides the residency of every texture and applies the changes.
+    *         Textures not reported since the last update fall back to their tail.
+    *  @param device Receives the changes.
+    *  @param maxUploads Most textures made finer per call (0 for no limit).
+  */
+  void
+    update(StreamingDevice& device, unsigned int maxUploads = 4);
+
+  /*
+    *  @brief Releases every texture on the device.
+  */
+  void
+    releaseAll(StreamingDevice& device);
+
+  /*
+    *  @brief Sets the memory budget.
+  */
+  void
+    setMemoryBudget(size_t memoryBudget) { m_memoryBudget = memoryBudget; }
+
+  /*
+    *  @brief Finest level resident for a texture (its level count if none is).
+  */
+  unsigned int
+    residentLevel(unsigned int textureId) const;
+
+  /*
+    *  @brief Returns the statistics of the last call to update.
+  */
+  const StreamerStats&
+    getLastStats() const { return m_lastStats; }
+
+  /*
+    *  @brief Size on screen of a sphere, in pixels.
+    *  @param radius Radius of the bounding sphere of the object.
+    *  @param distance Distance from the camera to its center.
+    *  @param fovY Vertical field of view, in radians.
+    *  @param viewportHeight Height of the viewport, in pixels.
+  */
+  static float
+    projectedSize(float radius, float distance, float fovY, float viewportHeight);
+
+private:
+  /*
+    *  @brief One streamed texture.
+  */
+  struct StreamedTexture {
+    std::unique_ptr<TextureCache> cache;
+    /*
+      *  @brief Levels a resident chain may start at, finest first (BC chains
+      *         must start on a size that is a multiple of 4).
+    */
+    std::vector<unsigned int> firstLevels;
+    /*
+      *  @brief Bytes of the chain starting at each level.
+    */
+    std::vector<size_t> chainBytes;
+    unsigned int tailLevel = 0;
+    /*
+      *  @brief Finest level resident, levels().size() when none is.
+    */
+    unsigned int residentLevel = 0;
+    unsigned int wantedLevel = 0;
+    unsigned int targetLevel = 0;
+    float priority = 0.0f;
+    bool reported = false;
+  };
+
+  /*
+    *  @brief The coarsest valid first level at or finer than a level.
+  */
+  static unsigned int
+    validFirstLevel(const StreamedTexture& texture, unsigned int level);
+
+  /*
+    *  @brief The next valid first level finer than a level, or the level
+    *         itself if there is none.
+  */
+  static unsigned int
+    finerFirstLevel(const StreamedTexture& texture, unsigned int level);
+
+  /*
+    *  @brief Makes a chain resident on the device.
+  */
+  bool
+    makeResident(StreamingDevice& device, unsigned int textureId, unsigned int firstLevel);
+
+private:
+  /*
+    *  @brief Bytes all resident levels may take.
+  */
+  size_t m_memoryBudget;
+
+  /*
+    *  @brief Largest dimension of the tail levels.
+  */
+  unsigned int m_tailSize;
+
+  /*
+    *  @brief Streamed textures, indexed by id.
+  */
+  std::vector<StreamedTexture> m_textures;
+
+  /*
+    *  @brief Scratch: texture ids sorted by priority.
+  */
+  std::vector<unsigned int> m_order;
+
+  /*
+    *  @brief Statistics of the last call to update.
+  */
+  StreamerStats m_lastStats;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  *  @brief Fixed-size pool of worker threads consuming a FIFO job queue.
+  *  @note Only depends on the standard library so CPU-side asset processing
+  *        built on top of it can also run on Linux.
+*/
+class
+  ThreadPool {
+public:
+
+  /*
+    *  @brief Starts the worker threads.
+    *  @param threadCount Number of workers. Zero picks one per hardware thread.
+  */
+  explicit
+    ThreadPool(unsigned int threadCount = 0);
+
+  /*
+    *  @brief Finishes the queued jobs and joins every worker.
+  */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /*
+    *  @brief Queues a callable and returns a future for its result.
+    *  @param task Callable taking no arguments.
+    *  @return std::future Becomes ready when the task has run; rethrows its exceptions.
+  */
+  template<typename Function>
+  auto
+    submit(Function&& task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(task));
+    std::future<Result> result = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+  /*
+    *  @brief Queues a fire-and-forget job.
+    *  @param job Callable executed on one of the workers.
+  */
+  void
+    enqueue(std::function<void()> job);
+
+  /*
+    *  @brief Number of worker threads in the pool.
+  */
+  unsigned int
+    size() const { return static_cast<unsigned int>(m_workers.size()); }
+
+private:
+  /*
+    *  @brief Loop run by every worker thread.
+  */
+  void
+    workerLoop();
+
+private:
+  /*
+    *  @brief Worker threads owned by the pool.
+  */
+  std::vector<std::thread> m_workers;
+
+  /*
+    *  @brief Pending jobs in submission order.
+  */
+  std::deque<std::function<void()>> m_jobs;
+
+  /*
+    *  @brief Guards m_jobs and m_stopping.
+  */
+  std::mutex m_mutex;
+
+  /*
+    *  @brief Signalled when a job is queued or the pool is stopping.
+  */
+  std::condition_variable m_wakeUp;
+
+  /*
+    *  @brief Set by the destructor to let the workers exit.
+  */
+  bool m_stopping = false;
+};
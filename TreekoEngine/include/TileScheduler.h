@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+  *  @brief Runs a fixed set of independent tiles on several threads with work
+  *         stealing.
+  *  @note Every worker starts with a contiguous range of tiles, which keeps
+  *        neighbouring tiles on the same core, and takes them from the front of
+  *        its own queue. A worker that runs dry steals from the back of the
+  *        others, so tiles of uneven cost (flat blocks versus detailed ones)
+  *        still finish together. The calling thread is one of the workers; the
+  *        others come from a ThreadPool that lives for the call.
+  *        Only depends on the standard library so tools can use it on Linux.
+*/
+class
+  TileScheduler {
+public:
+
+  /*
+    *  @brief Results of the last call to run.
+  */
+  struct ScheduleStats {
+    /*
+      *  @brief Tiles run and workers used (1 when run inline).
+    */
+    size_t tiles = 0;
+    unsigned int threads = 0;
+    /*
+      *  @brief Tiles run by a worker other than the one they were given to.
+    */
+    size_t steals = 0;
+  };
+
+  /*
+    *  @brief Default constructor for TileScheduler.
+  */
+  TileScheduler() = default;
+
+  /*
+    *  @brief Default destructor for TileScheduler.
+  */
+  ~TileScheduler() = default;
+
+  /*
+    *  @brief Runs work(tile) once for every tile in [0, tileCount) and returns
+    *         when all of them are done.
+    *  @param tileCount Number of tiles.
+    *  @param threadCount Workers, the calling thread included. Zero picks one
+    *         per hardware thread.
+    *  @param work Callable run for every tile; it must be safe to call from
+    *         several threads at once.
+  */
+  void
+    run(size_t tileCount, unsigned int threadCount, const std::function<void(size_t)>& work);
+
+  /*
+    *  @brief Returns the statistics of the last call to run.
+  */
+  const ScheduleStats&
+    getLastStats() const { return m_lastStats; }
+
+private:
+  /*
+    *  @brief Tiles still owned by one worker.
+  */
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<size_t> tiles;
+  };
+
+  /*
+    *  @brief Loop of worker index: own tiles first, then stolen ones.
+    *  @return size_t Number of tiles stolen.
+  */
+  size_t
+    workerLoop(size_t index, const std::function<void(size_t)>& work);
+
+private:
+  /*
+    *  @brief One queue per worker of the current call.
+  */
+  std::vector<WorkerQueue> m_queues;
+
+  /*
+    *  @brief Statistics of the last call to run.
+  */
+  ScheduleStats m_lastStats;
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+  *  @brief Deduplicates OBJ face corners by their (position, uv, normal) index triple.
+  *  @note Flat open-addressing table with linear probing. Each slot packs the
+  *        three attribute indices and the resulting vertex index into 16 bytes,
+  *        so a lookup costs one hash and usually a single cache line, with no
+  *        per-entry allocation.
+*/
+class
+  VertexCache {
+public:
+
+  /*
+    *  @brief Default constructor. The table starts empty.
+  */
+  VertexCache() = default;
+
+  /*
+    *  @brief Default destructor.
+  */
+  ~VertexCache() = default;
+
+  /*
+    *  @brief Sizes the table for the expected number of unique vertices.
+    *  @param expectedVertices Number of entries that should fit without rehashing.
+  */
+  void
+    reserve(size_t expectedVertices);
+
+  /*
+    *  @brief Returns the vertex index stored for a corner, inserting it if new.
+    *  @param posIndex 0-based position index.
+    *  @param uvIndex 0-based texture coordinate index.
+    *  @param normIndex 0-based normal index.
+    *  @param newVertex Vertex index to store when the corner has not been seen yet.
+    *  @param inserted Set to true when the corner was inserted.
+    *  @return int The vertex index associated with the corner.
+  */
+  int
+    findOrInsert(int posIndex, int uvIndex, int normIndex, int newVertex, bool& inserted);
+
+  /*
+    *  @brief Number of corners stored in the table.
+  */
+  size_t
+    size() const { return m_count; }
+
+  /*
+    *  @brief Bytes used by the slot array.
+  */
+  size_t
+    memoryBytes() const { return m_slots.capacity() * sizeof(Slot); }
+
+private:
+  /*
+    *  @brief One table entry. vertex == -1 marks an empty slot.
+  */
+  struct Slot {
+    int posIndex;
+    int uvIndex;
+    int normIndex;
+    int vertex;
+  };
+
+  /*
+    *  @brief Doubles the table and reinserts every entry.
+  */
+  void
+    grow();
+
+  /*
+    *  @brief Reallocates the table with slotCount slots and reinserts every entry.
+    *  @param slotCount New number of slots, a power of two.
+  */
+  void
+    rehash(size_t slotCount);
+
+  /*
+    *  @brief Mixes the index triple into a 32-bit hash.
+  */
+  static uint32_t
+    hash(int posIndex, int uvIndex, int normIndex);
+
+private:
+  /*
+    *  @brief Power-of-two sized slot array.
+  */
+  std::vector<Slot> m_slots;
+
+  /*
+    *  @brief m_slots.size() - 1, used to wrap probe positions.
+  */
+  size_t m_mask = 0;
+
+  /*
+    *  @brief Number of occupied slots.
+  */
+  size_t m_count = 0;
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include "Prerequisites.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*
+  *  @brief Vertex attributes a VertexLayout is built from.
+  *  @note An attribute gives its HLSL semantic, its DXGI format, the byte
+  *        size of that format and the C++ type of the matching vertex member,
+  *        which must be the same size. New attributes only need the same five
+  *        members.
+*/
+namespace VertexAttribute {
+  struct Position {
+    using Type = XMFLOAT3;
+    static constexpr const char* kSemantic = "POSITION";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+    static const unsigned int kSize = 12;
+  };
+
+  struct TexCoord {
+    using Type = XMFLOAT2;
+    static constexpr const char* kSemantic = "TEXCOORD";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R32G32_FLOAT;
+    static const unsigned int kSize = 8;
+  };
+
+  struct Normal {
+    using Type = XMFLOAT3;
+    static constexpr const char* kSemantic = "NORMAL";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+    static const unsigned int kSize = 12;
+  };
+
+  struct Tangent {
+    using Type = XMFLOAT4;
+    static constexpr const char* kSemantic = "TANGENT";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    static const unsigned int kSize = 16;
+  };
+
+  struct Color {
+    using Type = XMFLOAT4;
+    static constexpr const char* kSemantic = "COLOR";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    static const unsigned int kSize = 16;
+  };
+
+  /*
+    *  @brief Quantized position of PackedVertex, relative to the mesh bounds.
+  */
+  struct PackedPosition {
+    using Type = uint16_t[4];
+    static constexpr const char* kSemantic = "POSITION";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R16G16B16A16_UNORM;
+    static const unsigned int kSize = 8;
+  };
+
+  /*
+    *  @brief Octahedral-encoded normal of PackedVertex.
+  */
+  struct OctahedralNormal {
+    using Type = int16_t[2];
+    static constexpr const char* kSemantic = "NORMAL";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R16G16_SNORM;
+    static const unsigned int kSize = 4;
+  };
+
+  /*
+    *  @brief Texture coordinates of PackedVertex when every UV lies in [0, 1].
+  */
+  struct PackedTexCoord {
+    using Type = uint16_t[2];
+    static constexpr const char* kSemantic = "TEXCOORD";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R16G16_UNORM;
+    static const unsigned int kSize = 4;
+  };
+
+  /*
+    *  @brief Texture coordinates of PackedVertex as half floats, for UVs that tile.
+  */
+  struct HalfTexCoord {
+    using Type = uint16_t[2];
+    static constexpr const char* kSemantic = "TEXCOORD";
+    static const unsigned int kSemanticIndex = 0;
+    static const DXGI_FORMAT kFormat = DXGI_FORMAT_R16G16_FLOAT;
+    static const unsigned int kSize = 4;
+  };
+}
+
+/*
+  *  @brief Input layout of a vertex made of the given attributes, tightly
+  *         packed in order in slot 0, computed at compile time.
+  *  @note elements() is a constexpr array of D3D11_INPUT_ELEMENT_DESC and
+  *        kStride the vertex size, so a vertex struct can be checked against
+  *        its layout with static_assert (see SimpleVertexLayout) instead of
+  *        kept in sync by hand.
+*/
+template<typename... Attributes>
+class
+  VertexLayout {
+public:
+  static_assert(sizeof...(Attributes) > 0, "A vertex layout needs at least one attribute");
+  static_assert(((sizeof(typename Attributes::Type) == Attributes::kSize) && ...),
+    "A vertex attribute's type is not the size of its format");
+
+  /*
+    *  @brief Number of input elements.
+  */
+  static const unsigned int kElementCount = sizeof...(Attributes);
+
+  /*
+    *  @brief Size of a vertex in bytes.
+  */
+  static const unsigned int kStride = (0u + ... + Attributes::kSize);
+
+  /*
+    *  @brief Attribute at an index.
+  */
+  template<unsigned int Index>
+  using AttributeAt = typename std::tuple_element<Index, std::tuple<Attributes...>>::type;
+
+  /*
+    *  @brief Byte offset of every element.
+  */
+  static constexpr std::array<unsigned int, kElementCount>
+    offsets() {
+    const unsigned int sizes[] = { Attributes::kSize... };
+    std::array<unsigned int, kElementCount> result = {};
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < kElementCount; ++i) {
+      result[i] = offset;
+      offset += sizes[i];
+    }
+    return result;
+  }
+
+  /*
+    *  @brief Byte offset of the element at an index.
+  */
+  template<unsigned int Index>
+  static constexpr unsigned int
+    offsetOf() { return offsets()[Index]; }
+
+  /*
+    *  @brief Input element descriptions of the layout.
+  */
+  static constexpr std::array<D3D11_INPUT_ELEMENT_DESC, kElementCount>
+    elements() {
+    static_assert(elementsAligned(), "A vertex element is not aligned to its size");
+    return elementsAt(std::make_index_sequence<kElementCount>());
+  }
+
+  /*
+    *  @brief Input element descriptions in the form InputLayout::init takes.
+  */
+  static std::vector<D3D11_INPUT_ELEMENT_DESC>
+    toVector() {
+    const std::array<D3D11_INPUT_ELEMENT_DESC, kElementCount> layout = elements();
+    return std::vector<D3D11_INPUT_ELEMENT_DESC>(layout.begin(), layout.end());
+  }
+
+private:
+  template<size_t... Indices>
+  static constexpr std::array<D3D11_INPUT_ELEMENT_DESC, kElementCount>
+    elementsAt(std::index_sequence<Indices...>) {
+    return { { D3D11_INPUT_ELEMENT_DESC{ Attributes::kSemantic,
+      Attributes::kSemanticIndex,
+      Attributes::kFormat,
+      0,
+      offsets()[Indices],
+      D3D11_INPUT_PER_VERTEX_DATA,
+      0 }... } };
+  }
+
+  /*
+    *  @brief D3D11 wants each element aligned to its size, up to 4 bytes.
+  */
+  static constexpr bool
+    elementsAligned() {
+    const unsigned int sizes[] = { Attributes::kSize... };
+    const std::array<unsigned int, kElementCount> elementOffsets = offsets();
+    for (unsigned int i = 0; i < kElementCount; ++i) {
+      const unsigned int alignment = sizes[i] < 4 ? sizes[i] : 4;
+      if (alignment == 0 || elementOffsets[i] % alignment != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/*
+  *  @brief Layout of SimpleVertex: POSITION (float3), TEXCOORD (float2), NORMAL (float3).
+*/
+using SimpleVertexLayout = VertexLayout<VertexAttribute::Position,
+  VertexAttribute::TexCoord,
+  VertexAttribute::Normal>;
+
+static_assert(SimpleVertexLayout::kStride == sizeof(SimpleVertex),
+  "SimpleVertex does not match SimpleVertexLayout");
+static_assert(std::is_same<decltype(SimpleVertex::Pos), SimpleVertexLayout::AttributeAt<0>::Type>::value &&
+  SimpleVertexLayout::offsetOf<0>() == offsetof(SimpleVertex, Pos),
+  "SimpleVertex::Pos does not match SimpleVertexLayout");
+static_assert(std::is_same<decltype(SimpleVertex::Tex), SimpleVertexLayout::AttributeAt<1>::Type>::value &&
+  SimpleVertexLayout::offsetOf<1>() == offsetof(SimpleVertex, Tex),
+  "SimpleVertex::Tex does not match SimpleVertexLayout");
+static_assert(std::is_same<decltype(SimpleVertex::Norm), SimpleVertexLayout::AttributeAt<2>::Type>::value &&
+  SimpleVertexLayout::offsetOf<2>() == offsetof(SimpleVertex, Norm),
+  "SimpleVertex::Norm does not match SimpleVertexLayout");
@@ -0,0 +1,193 @@
+#pragma once
+#include "Prerequisites.h"
+#include "MeshComponent.h"
+#include "VertexLayout.h"
+#include <cstdint>
+
+/*
+  *  @brief 16-byte quantized counterpart of SimpleVertex (32 bytes).
+  *  @note Pos is R16G16B16A16_UNORM relative to the mesh bounds (w is always 1.0);
+  *        Norm is an octahedral-encoded unit vector in R16G16_SNORM; Tex is
+  *        R16G16_UNORM when every UV lies in [0, 1] and R16G16_FLOAT otherwise.
+  *        Positions and UVs are expanded by the input assembler; the normal must be
+  *        decoded in the vertex shader:
+  *
+  *          float3 octDecode(float2 e) {
+  *            float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+  *            float t = saturate(-n.z);
+  *            n.xy += (n.xy >= 0.0f) ? -t : t;
+  *            return normalize(n);
+  *          }
+*/
+struct PackedVertex
+{
+  /*
+    *  @brief Quantized position, 0..65535 across the mesh bounds per axis.
+  */
+  uint16_t Pos[4];
+  /*
+    *  @brief Octahedral-encoded normal.
+  */
+  int16_t Norm[2];
+  /*
+    *  @brief 16-bit texture coordinates (UNORM or half float, see PackedVertexParams).
+  */
+  uint16_t Tex[2];
+};
+
+/*
+  *  @brief Layouts of PackedVertex, one per PackedVertexParams::texCoordFormat.
+*/
+using PackedVertexLayout = VertexLayout<VertexAttribute::PackedPosition,
+  VertexAttribute::OctahedralNormal,
+  VertexAttribute::PackedTexCoord>;
+using PackedVertexHalfLayout = VertexLayout<VertexAttribute::PackedPosition,
+  VertexAttribute::OctahedralNormal,
+  VertexAttribute::HalfTexCoord>;
+
+static_assert(PackedVertexLayout::kStride == sizeof(PackedVertex) &&
+  PackedVertexHalfLayout::kStride == sizeof(PackedVertex),
+  "PackedVertex does not match PackedVertexLayout");
+static_assert(std::is_same<decltype(PackedVertex::Pos), PackedVertexLayout::AttributeAt<0>::Type>::value &&
+  PackedVertexLayout::offsetOf<0>() == offsetof(PackedVertex, Pos),
+  "PackedVertex::Pos does not match PackedVertexLayout");
+static_assert(std::is_same<decltype(PackedVertex::Norm), PackedVertexLayout::AttributeAt<1>::Type>::value &&
+  PackedVertexLayout::offsetOf<1>() == offsetof(PackedVertex, Norm),
+  "PackedVertex::Norm does not match PackedVertexLayout");
+static_assert(std::is_same<decltype(PackedVertex::Tex), PackedVertexLayout::AttributeAt<2>::Type>::value &&
+  PackedVertexLayout::offsetOf<2>() == offsetof(PackedVertex, Tex),
+  "PackedVertex::Tex does not match PackedVertexLayout");
+
+/*
+  *  @brief Per-mesh constants needed to encode and decode PackedVertex data.
+*/
+struct PackedVertexParams
+{
+  /*
+    *  @brief Position that quantizes to 0.
+  */
+  XMFLOAT3 positionMin;
+  /*
+    *  @brief Size of the quantization range per axis (mesh bounds extent).
+  */
+  XMFLOAT3 positionExtent;
+  /*
+    *  @brief DXGI_FORMAT_R16G16_UNORM or DXGI_FORMAT_R16G16_FLOAT.
+  */
+  DXGI_FORMAT texCoordFormat;
+};
+
+/*
+  *  @brief Largest differences between a mesh and its packed round trip.
+*/
+struct PackedVertexError
+{
+  /*
+    *  @brief Largest position error, in model units.
+  */
+  float maxPositionError = 0.0f;
+  /*
+    *  @brief Root mean square position error, in model units.
+  */
+  float rmsPositionError = 0.0f;
+  /*
+    *  @brief Largest angle between a normal and its decoded value, in degrees.
+  */
+  float maxNormalErrorDegrees = 0.0f;
+  /*
+    *  @brief Largest texture coordinate error.
+  */
+  float maxTexCoordError = 0.0f;
+};
+
+/*
+  *  @brief Converts meshes between SimpleVertex and PackedVertex on the CPU.
+*/
+class
+  VertexPacker {
+public:
+
+  /*
+    *  @brief Default constructor for VertexPacker.
+  */
+  VertexPacker() = default;
+
+  /*
+    *  @brief Default destructor for VertexPacker.
+  */
+  ~VertexPacker() = default;
+
+  /*
+    *  @brief Packs every vertex of a mesh and measures the quantization error.
+    *  @param mesh Mesh to pack; its bounds define the position range.
+    *  @param outVertices Receives one PackedVertex per mesh vertex (indices are unchanged).
+    *  @param outParams Receives the constants needed to draw or decode the packed data.
+    *  @return bool False if the mesh has no vertices.
+  */
+  bool
+    pack(const MeshComponent& mesh,
+      std::vector<PackedVertex>& outVertices,
+      PackedVertexParams& outParams);
+
+  /*
+    *  @brief Returns the error measured by the last call to pack.
+  */
+  const PackedVertexError&
+    getLastError() const { return m_lastError; }
+
+  /*
+    *  @brief Picks the quantization range and UV format for a mesh.
+  */
+  static PackedVertexParams
+    computeParams(const MeshComponent& mesh);
+
+  /*
+    *  @brief Quantizes one vertex.
+  */
+  static void
+    encode(const SimpleVertex& vertex, const PackedVertexParams& params, PackedVertex& outVertex);
+
+  /*
+    *  @brief Expands one packed vertex back to floats (what the GPU sees after decoding).
+  */
+  static void
+    decode(const PackedVertex& vertex, const PackedVertexParams& params, SimpleVertex& outVertex);
+
+  /*
+    *  @brief Matrix that maps the UNORM position range [0, 1] back to model space.
+    *  @note Premultiply it into the world matrix when drawing packed vertices, so
+    *        the vertex shader needs no extra constants for positions.
+  */
+  static XMMATRIX
+    dequantizeMatrix(const PackedVertexParams& params);
+
+  /*
+    *  @brief Octahedral-encodes a unit vector into two SNORM16 values.
+  */
+  static void
+    octEncode(const XMFLOAT3& normal, int16_t outEncoded[2]);
+
+  /*
+    *  @brief Decodes two SNORM16 values into a unit vector.
+  */
+  static XMFLOAT3
+    octDecode(const int16_t encoded[2]);
+
+  /*
+    *  @brief Converts a float to IEEE half precision (round to nearest even).
+  */
+  static uint16_t
+    floatToHalf(float value);
+
+  /*
+    *  @brief Converts an IEEE half to a float.
+  */
+  static float
+    halfToFloat(uint16_t value);
+
+private:
+  /*
+    *  @brief Error of the last call to pack.
+  */
+  PackedVertexError m_lastError;
+};
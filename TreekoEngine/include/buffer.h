@@ -40,13 +40,34 @@ public:
     init(Device& device, const MeshComponent& mesh, unsigned int bindFlag);
 
   /*
-    *  @brief Initializes the buffer with a specified byte width.
+    *  @brief Initializes a vertex or index buffer from raw element data.
+    *  @param device Reference to the Device object.
+    *  @param data Pointer to the first element. Any readable memory works,
+    *         e.g. a memory-mapped MeshCache section; it is only read during the call.
+    *  @param elementSize Size of one element in bytes (vertex stride or index size).
+    *  @param elementCount Number of elements.
+    *  @param bindFlag Flags specifying how the buffer will be bound to the pipeline.
+    *  @return HRESULT indicating success or failure.
+  */
+  HRESULT
+    init(Device& device,
+      const void* data,
+      unsigned int elementSize,
+      unsigned int elementCount,
+      unsigned int bindFlag);
+
+  /*
+    *  @brief Initializes a constant buffer with a specified byte width.
     *  @param device Reference to the Device object.
     *  @param ByteWidth Size of the buffer in bytes.
+    *  @param dynamic Creates a USAGE_DYNAMIC buffer that update() rewrites
+    *         with Map(WRITE_DISCARD), for constants that change every draw:
+    *         the driver renames the buffer instead of copying the data
+    *         through UpdateSubresource.
     *  @return HRESULT indicating success or failure.
   */
   HRESULT
-    init(Device& device, unsigned int ByteWidth);
+    init(Device& device, unsigned int ByteWidth, bool dynamic = false);
 
   /*
     *  @brief Updates the contents of a resource.
@@ -57,6 +78,8 @@ public:
     *  @param pSrcData Pointer to the source data.
     *  @param SrcRowPitch Row pitch of the source data.
     *  @param SrcDepthPitch Depth pitch of the source data.
+    *  @note A dynamic buffer is always replaced whole: pDstBox must be null
+    *        and pSrcData must hold the full byte width.
   */
   void
     update(DeviceContext& deviceContext,
@@ -119,4 +142,8 @@ private:
     *  @brief Flags specifying how the buffer is bound to the pipeline.
   */
   unsigned int m_bindFlag = 0;
+  /*
+    *  @brief Created with USAGE_DYNAMIC: written with Map, never UpdateSubresource.
+  */
+  bool m_dynamic = false;
 };